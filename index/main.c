@@ -0,0 +1,91 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <libdunfell/dunfell.h>
+#include <locale.h>
+
+/* Build and save the sidecar index for each of the given text logs, so that
+ * they can later be loaded partially, and their extent shown, without
+ * scanning them. */
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GOptionContext) context = NULL;
+  gboolean quiet = FALSE;
+  int status = 0;
+  int i;
+  g_autoptr (GError) error = NULL;
+  const GOptionEntry entries[] = {
+    { "quiet", 'q', 0, G_OPTION_ARG_NONE, &quiet,
+      "Don’t print a summary of each log", NULL },
+    { NULL, },
+  };
+
+  setlocale (LC_ALL, "");
+
+  context = g_option_context_new ("LOG-FILE… — index Dunfell logs");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s: %s\n", g_get_prgname (), error->message);
+      return 2;
+    }
+
+  if (argc < 2)
+    {
+      g_printerr ("%s: %s\n", g_get_prgname (), "No log files given");
+      return 2;
+    }
+
+  for (i = 1; i < argc; i++)
+    {
+      g_autoptr (DflLogIndex) index = NULL;
+
+      index = dfl_log_index_build (argv[i], &error);
+
+      if (index != NULL)
+        dfl_log_index_save (index, &error);
+
+      if (error != NULL)
+        {
+          g_printerr ("%s: Error indexing ‘%s’: %s\n", g_get_prgname (),
+                      argv[i], error->message);
+          g_clear_error (&error);
+          status = 1;
+          continue;
+        }
+
+      if (!quiet)
+        {
+          gsize n_threads;
+
+          dfl_log_index_get_threads (index, &n_threads);
+          g_print ("%s: %" G_GSIZE_FORMAT " threads, %" G_GUINT64_FORMAT
+                   " µs\n", argv[i], n_threads,
+                   dfl_log_index_get_final_timestamp (index) -
+                   dfl_log_index_get_initial_timestamp (index));
+        }
+    }
+
+  return status;
+}
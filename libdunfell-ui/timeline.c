@@ -697,16 +697,22 @@ draw_source_dispatch_line (DwlTimeline           *self,
   /* Label the dispatch with the relevant callback function, but only if the
    * zoom level is high enough to accommodate it.. */
   if (self->zoom > 0.3 &&
-      (dispatch->dispatch_name != NULL || dispatch->callback_name != NULL))
+      (dispatch->dispatch_name != DFL_ATOM_INVALID ||
+       dispatch->callback_name != DFL_ATOM_INVALID))
     {
       PangoLayout *layout = NULL;
       PangoRectangle layout_rect;
       gchar *text = NULL;
+      DflAtomTable *atom_table;
 
       gtk_style_context_add_class (context, "source_dispatch_details");
 
-      text = g_strdup_printf ("%s\n%s", dispatch->dispatch_name,
-                              dispatch->callback_name);
+      atom_table = dfl_model_get_atom_table (self->model);
+      text = g_strdup_printf ("%s\n%s",
+                              dfl_atom_table_lookup (atom_table,
+                                                     dispatch->dispatch_name),
+                              dfl_atom_table_lookup (atom_table,
+                                                     dispatch->callback_name));
       layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), text);
       g_free (text);
 
@@ -1266,11 +1272,17 @@ dwl_timeline_draw (GtkWidget *widget,
       cairo_set_line_width (cr, MAIN_CONTEXT_ACQUIRED_WIDTH);
       cairo_new_path (cr);
 
-      dfl_main_context_thread_ownership_iter (main_context, &iter,
-                                              min_visible_timestamp);
-
-      while (dfl_time_sequence_iter_next (&iter, &timestamp, (gpointer *) &data) &&
-             timestamp <= max_visible_timestamp)
+      /* Include spans which started above the visible area but are still
+       * ongoing at the top of it. */
+      dfl_main_context_thread_ownership_iter (main_context, &iter, 0);
+
+      while (dfl_time_sequence_iter_next_overlapping (&iter,
+                                                      G_STRUCT_OFFSET (DflThreadOwnershipData,
+                                                                       duration),
+                                                      min_visible_timestamp,
+                                                      max_visible_timestamp + 1,
+                                                      &timestamp,
+                                                      (gpointer *) &data))
         {
           gdouble thread_centre;
           gint timestamp_y;
@@ -1298,11 +1310,15 @@ dwl_timeline_draw (GtkWidget *widget,
       /* Iterate through the dispatch events. */
       gtk_style_context_add_class (context, "main_context_dispatch");
 
-      dfl_main_context_dispatch_iter (main_context, &iter,
-                                      min_visible_timestamp);
+      dfl_main_context_dispatch_iter (main_context, &iter, 0);
 
-      while (dfl_time_sequence_iter_next (&iter, &timestamp, (gpointer *) &data) &&
-             timestamp <= max_visible_timestamp)
+      while (dfl_time_sequence_iter_next_overlapping (&iter,
+                                                      G_STRUCT_OFFSET (DflMainContextDispatchData,
+                                                                       duration),
+                                                      min_visible_timestamp,
+                                                      max_visible_timestamp + 1,
+                                                      &timestamp,
+                                                      (gpointer *) &data))
         {
           gdouble thread_centre, dispatch_width, dispatch_height;
           gint timestamp_y;
@@ -1514,17 +1530,16 @@ dwl_timeline_draw (GtkWidget *widget,
            * the column containing the source, round the corner, then up to where
            * the source is rendered (the g_source_new()). */
 
-          dfl_source_dispatch_iter (source, &source_iter,
-                                    dfl_time_sequence_iter_get_timestamp (main_context_iter));
+          dfl_source_dispatch_iter_range (source, &source_iter,
+                                          main_context_timestamp,
+                                          main_context_timestamp +
+                                          MAX (main_context_data->duration, 0) + 1);
           dispatch_drawn = FALSE;
 
           while (dfl_time_sequence_iter_next (&source_iter, &source_timestamp,
                                               (gpointer *) &source_data))
             {
-              if (source_data->thread_id != main_context_data->thread_id ||
-                  source_timestamp < main_context_timestamp ||
-                  source_timestamp > main_context_timestamp +
-                  main_context_data->duration)
+              if (source_data->thread_id != main_context_data->thread_id)
                 continue;
 
               draw_source_dispatch_line (self, cr, source, source_x, source_y,
@@ -1752,15 +1767,25 @@ dwl_timeline_motion_notify_event (GtkWidget      *widget,
     {
       DflMainContext *main_context = self->main_contexts->pdata[i];
       DflTimeSequenceIter iter;
-      DflTimestamp timestamp;
+      DflTimestamp timestamp, hit_start, hit_end;
       DflThreadOwnershipData *data;
 
-      /* Iterate through the thread ownership events. */
+      /* Only consider the dispatches running within a couple of pixels of the
+       * pointer; the exact hit test is done below. */
+      hit_start = min_timestamp +
+                  ((event->y > HEADER_HEIGHT + 2) ?
+                   y_to_timestamp (self, event->y - 2) : 0);
+      hit_end = min_timestamp +
+                y_to_timestamp (self, MAX (event->y + 2, HEADER_HEIGHT + 1)) + 1;
 
-      /* TODO: Set the start timestamp according to the clip area */
       dfl_main_context_dispatch_iter (main_context, &iter, 0);
 
-      while (dfl_time_sequence_iter_next (&iter, &timestamp, (gpointer *) &data))
+      while (dfl_time_sequence_iter_next_overlapping (&iter,
+                                                      G_STRUCT_OFFSET (DflMainContextDispatchData,
+                                                                       duration),
+                                                      hit_start, hit_end,
+                                                      &timestamp,
+                                                      (gpointer *) &data))
         {
           gdouble thread_centre, dispatch_width, dispatch_height;
           gdouble dispatch_left, dispatch_right, dispatch_top, dispatch_bottom;
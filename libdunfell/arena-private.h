@@ -0,0 +1,51 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_ARENA_PRIVATE_H
+#define DFL_ARENA_PRIVATE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* A reference counted region allocator. Memory is handed out from large
+ * blocks by bumping a pointer, is never moved once allocated, and is only
+ * freed when the last reference to the arena is dropped, a block at a time.
+ * This makes building large, append-only data structures (such as the
+ * columns of a #DflEventStore) cheap, and tearing them down cheaper still.
+ *
+ * Allocations are aligned to 8 bytes. The arena is not thread safe, apart
+ * from its reference count. */
+typedef struct _DflArena DflArena;
+
+DflArena *_dfl_arena_new     (void);
+DflArena *_dfl_arena_ref     (DflArena    *arena);
+void      _dfl_arena_unref   (DflArena    *arena);
+
+gpointer  _dfl_arena_alloc   (DflArena    *arena,
+                              gsize        size);
+gchar    *_dfl_arena_strndup (DflArena    *arena,
+                              const gchar *str,
+                              gsize        length);
+
+void      _dfl_arena_absorb  (DflArena    *arena,
+                              DflArena    *other);
+
+G_END_DECLS
+
+#endif /* !DFL_ARENA_PRIVATE_H */
@@ -0,0 +1,156 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "arena-private.h"
+
+
+/* Blocks in the arena start small, so that short logs don’t waste memory, and
+ * double in size up to a maximum, so that long logs don’t need too many
+ * allocations. Allocations longer than the maximum get a block of their own. */
+#define ARENA_MIN_BLOCK_SIZE 4096
+#define ARENA_MAX_BLOCK_SIZE (1024 * 1024)
+#define ARENA_ALIGNMENT 8
+
+struct _DflArena
+{
+  gint ref_count;  /* atomic */
+
+  GPtrArray/*<owned gchar*>*/ *blocks;  /* owned */
+  gchar *current_block;  /* unowned; nullable; last block allocated from */
+  gsize current_block_size;
+  gsize current_block_used;
+};
+
+DflArena *
+_dfl_arena_new (void)
+{
+  DflArena *arena;
+
+  arena = g_new0 (DflArena, 1);
+  arena->ref_count = 1;
+  arena->blocks = g_ptr_array_new_with_free_func (g_free);
+
+  return arena;
+}
+
+DflArena *
+_dfl_arena_ref (DflArena *arena)
+{
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  g_atomic_int_inc (&arena->ref_count);
+
+  return arena;
+}
+
+void
+_dfl_arena_unref (DflArena *arena)
+{
+  g_return_if_fail (arena != NULL);
+
+  if (g_atomic_int_dec_and_test (&arena->ref_count))
+    {
+      g_ptr_array_unref (arena->blocks);
+      g_free (arena);
+    }
+}
+
+/* Allocate @size bytes from @arena. The memory is uninitialised, owned by the
+ * arena, and is not moved until the arena is freed. */
+gpointer
+_dfl_arena_alloc (DflArena *arena,
+                  gsize     size)
+{
+  gchar *retval;
+
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  arena->current_block_used = (arena->current_block_used +
+                               ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+  if (arena->current_block == NULL ||
+      arena->current_block_used > arena->current_block_size ||
+      arena->current_block_size - arena->current_block_used < size)
+    {
+      gsize block_size;
+
+      block_size = (arena->current_block == NULL) ?
+                   ARENA_MIN_BLOCK_SIZE :
+                   MIN (arena->current_block_size * 2, ARENA_MAX_BLOCK_SIZE);
+      block_size = MAX (block_size, size);
+
+      arena->current_block = g_malloc (block_size);
+      arena->current_block_size = block_size;
+      arena->current_block_used = 0;
+      g_ptr_array_add (arena->blocks, arena->current_block);
+    }
+
+  retval = arena->current_block + arena->current_block_used;
+  arena->current_block_used += size;
+
+  return retval;
+}
+
+/* Copy the first @length bytes of @str into @arena, and nul-terminate
+ * them. */
+gchar *
+_dfl_arena_strndup (DflArena    *arena,
+                    const gchar *str,
+                    gsize        length)
+{
+  gchar *retval;
+
+  g_return_val_if_fail (arena != NULL, NULL);
+  g_return_val_if_fail (length < G_MAXSIZE, NULL);
+
+  retval = _dfl_arena_alloc (arena, length + 1);
+  memcpy (retval, str, length);
+  retval[length] = '\0';
+
+  return retval;
+}
+
+/* Move all the blocks from @other into @arena, so that pointers into @other
+ * stay valid as long as @arena is alive. @other must not be referenced by
+ * anything else, and is left empty (but still usable). */
+void
+_dfl_arena_absorb (DflArena *arena,
+                   DflArena *other)
+{
+  guint i;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (other != NULL);
+  g_assert (g_atomic_int_get (&other->ref_count) == 1);
+
+  for (i = 0; i < other->blocks->len; i++)
+    g_ptr_array_add (arena->blocks, other->blocks->pdata[i]);
+
+  g_ptr_array_set_free_func (other->blocks, NULL);
+  g_ptr_array_set_size (other->blocks, 0);
+  g_ptr_array_set_free_func (other->blocks, g_free);
+
+  other->current_block = NULL;
+  other->current_block_size = 0;
+  other->current_block_used = 0;
+}
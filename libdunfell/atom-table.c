@@ -0,0 +1,219 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:atom-table
+ * @short_description: table of interned strings
+ * @stability: Unstable
+ * @include: libdunfell/atom-table.h
+ *
+ * A #DflAtomTable interns strings from a log, such as callback, dispatch
+ * function and source tag names, and maps each distinct string to a small
+ * integer #DflAtom. Each string is stored once, however many times it appears
+ * in the log, and names can be compared by comparing their atoms.
+ *
+ * A single table is shared between all the objects in a model; see
+ * dfl_event_sequence_get_atom_table(). Atoms from different tables must not be
+ * compared.
+ *
+ * A #DflAtomTable may be used from multiple threads at once, as walkers which
+ * intern strings may be run in parallel; see
+ * dfl_event_sequence_walk_sharded().
+ *
+ * Since: UNRELEASED
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "arena-private.h"
+#include "atom-table.h"
+
+
+static void dfl_atom_table_finalize (GObject *object);
+
+struct _DflAtomTable
+{
+  GObject parent;
+
+  /* Protects all the other members. */
+  GMutex lock;
+
+  /* Storage for the strings, freed in one go with the table. */
+  DflArena *strings;  /* owned */
+
+  /* Index (atom - 1) → string, and string → atom. Both point into
+   * @strings. */
+  GPtrArray/*<unowned utf8>*/ *atoms;  /* owned */
+  GHashTable/*<unowned utf8, DflAtom>*/ *lookup;  /* owned */
+};
+
+G_DEFINE_TYPE (DflAtomTable, dfl_atom_table, G_TYPE_OBJECT)
+
+static void
+dfl_atom_table_class_init (DflAtomTableClass *klass)
+{
+  GObjectClass *object_class = (GObjectClass *) klass;
+
+  object_class->finalize = dfl_atom_table_finalize;
+}
+
+static void
+dfl_atom_table_init (DflAtomTable *self)
+{
+  g_mutex_init (&self->lock);
+  self->strings = _dfl_arena_new ();
+  self->atoms = g_ptr_array_new ();
+  self->lookup = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+static void
+dfl_atom_table_finalize (GObject *object)
+{
+  DflAtomTable *self = DFL_ATOM_TABLE (object);
+
+  g_hash_table_unref (self->lookup);
+  g_ptr_array_unref (self->atoms);
+  _dfl_arena_unref (self->strings);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (dfl_atom_table_parent_class)->finalize (object);
+}
+
+/**
+ * dfl_atom_table_new:
+ *
+ * Create a new, empty #DflAtomTable.
+ *
+ * Returns: (transfer full): a new #DflAtomTable
+ * Since: UNRELEASED
+ */
+DflAtomTable *
+dfl_atom_table_new (void)
+{
+  return g_object_new (DFL_TYPE_ATOM_TABLE, NULL);
+}
+
+/**
+ * dfl_atom_table_intern:
+ * @self: a #DflAtomTable
+ * @str: (nullable): string to intern
+ *
+ * Intern @str in the table, returning its atom. If @str has already been
+ * interned, its existing atom is returned. If @str is %NULL,
+ * %DFL_ATOM_INVALID is returned.
+ *
+ * Returns: atom for @str
+ * Since: UNRELEASED
+ */
+DflAtom
+dfl_atom_table_intern (DflAtomTable *self,
+                       const gchar  *str)
+{
+  gpointer value;
+  gchar *copy;
+  DflAtom atom;
+
+  g_return_val_if_fail (DFL_IS_ATOM_TABLE (self), DFL_ATOM_INVALID);
+
+  if (str == NULL)
+    return DFL_ATOM_INVALID;
+
+  g_mutex_lock (&self->lock);
+
+  if (g_hash_table_lookup_extended (self->lookup, str, NULL, &value))
+    {
+      atom = GPOINTER_TO_UINT (value);
+    }
+  else
+    {
+      g_assert (self->atoms->len < G_MAXUINT32);
+
+      copy = _dfl_arena_strndup (self->strings, str, strlen (str));
+      g_ptr_array_add (self->atoms, copy);
+      atom = self->atoms->len;
+
+      g_hash_table_insert (self->lookup, copy, GUINT_TO_POINTER (atom));
+    }
+
+  g_mutex_unlock (&self->lock);
+
+  return atom;
+}
+
+/**
+ * dfl_atom_table_lookup:
+ * @self: a #DflAtomTable
+ * @atom: an atom returned by dfl_atom_table_intern() on this table
+ *
+ * Get the string which @atom was interned from. The string is valid for as
+ * long as the table is.
+ *
+ * Returns: (nullable): the string for @atom, or %NULL if @atom is
+ *    %DFL_ATOM_INVALID
+ * Since: UNRELEASED
+ */
+const gchar *
+dfl_atom_table_lookup (DflAtomTable *self,
+                       DflAtom       atom)
+{
+  const gchar *str;
+
+  g_return_val_if_fail (DFL_IS_ATOM_TABLE (self), NULL);
+
+  if (atom == DFL_ATOM_INVALID)
+    return NULL;
+
+  g_mutex_lock (&self->lock);
+
+  if (atom <= self->atoms->len)
+    str = self->atoms->pdata[atom - 1];
+  else
+    str = NULL;
+
+  g_mutex_unlock (&self->lock);
+
+  g_return_val_if_fail (str != NULL, NULL);
+
+  return str;
+}
+
+/**
+ * dfl_atom_table_get_n_atoms:
+ * @self: a #DflAtomTable
+ *
+ * Get the number of distinct strings interned in the table.
+ *
+ * Returns: number of atoms in the table
+ * Since: UNRELEASED
+ */
+guint
+dfl_atom_table_get_n_atoms (DflAtomTable *self)
+{
+  guint n_atoms;
+
+  g_return_val_if_fail (DFL_IS_ATOM_TABLE (self), 0);
+
+  g_mutex_lock (&self->lock);
+  n_atoms = self->atoms->len;
+  g_mutex_unlock (&self->lock);
+
+  return n_atoms;
+}
@@ -0,0 +1,69 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_ATOM_TABLE_H
+#define DFL_ATOM_TABLE_H
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/**
+ * DflAtom:
+ *
+ * Handle for a string which has been interned in a #DflAtomTable. Two atoms
+ * from the same table are equal if and only if their strings are equal, so
+ * names can be compared as integers. Look up the string again using
+ * dfl_atom_table_lookup().
+ *
+ * Since: UNRELEASED
+ */
+typedef guint32 DflAtom;
+
+/**
+ * DFL_ATOM_INVALID:
+ *
+ * Atom representing a %NULL string. This is never returned for a non-%NULL
+ * string.
+ *
+ * Since: UNRELEASED
+ */
+#define DFL_ATOM_INVALID ((DflAtom) 0)
+
+/**
+ * DflAtomTable:
+ *
+ * All the fields in this structure are private.
+ *
+ * Since: UNRELEASED
+ */
+#define DFL_TYPE_ATOM_TABLE dfl_atom_table_get_type ()
+G_DECLARE_FINAL_TYPE (DflAtomTable, dfl_atom_table, DFL, ATOM_TABLE, GObject)
+
+DflAtomTable *dfl_atom_table_new         (void);
+
+DflAtom       dfl_atom_table_intern      (DflAtomTable *self,
+                                          const gchar  *str);
+const gchar  *dfl_atom_table_lookup      (DflAtomTable *self,
+                                          DflAtom       atom);
+guint         dfl_atom_table_get_n_atoms (DflAtomTable *self);
+
+G_END_DECLS
+
+#endif /* !DFL_ATOM_TABLE_H */
@@ -20,8 +20,10 @@
 #define DFL_H
 
 /* Core files */
+#include <libdunfell/atom-table.h>
 #include <libdunfell/event.h>
 #include <libdunfell/event-sequence.h>
+#include <libdunfell/log-index.h>
 #include <libdunfell/main-context.h>
 #include <libdunfell/model.h>
 #include <libdunfell/parser.h>
@@ -31,5 +33,6 @@
 #include <libdunfell/time-sequence.h>
 #include <libdunfell/types.h>
 #include <libdunfell/version.h>
+#include <libdunfell/writer.h>
 
 #endif /* !DFL_H */
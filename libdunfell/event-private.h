@@ -0,0 +1,101 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_EVENT_PRIVATE_H
+#define DFL_EVENT_PRIVATE_H
+
+#include <glib.h>
+
+#include "arena-private.h"
+#include "event.h"
+
+G_BEGIN_DECLS
+
+/* A field from a log line: a slice of memory owned by someone else (typically
+ * a mapped log file or a line buffer). It is not nul-terminated. */
+typedef struct
+{
+  const gchar *data;
+  gsize length;
+} DflEventField;
+
+/* Maximum number of parameters an event can have. This is the same as the
+ * limit for binary logs. */
+#define DFL_EVENT_MAX_PARAMETERS 8
+
+/* Events merged from several logs are tagged with the index of the process
+ * (log) they came from, in the top byte of their thread ID and object IDs.
+ * Thread IDs and object IDs are pointers, so the top byte is otherwise zero on
+ * 64-bit platforms. See dfl_event_sequence_new_merged(). */
+#define DFL_PROCESS_SHIFT 56
+#define DFL_PROCESS_MAX 255
+
+/* A decoded event parameter: either an ID, or a nul-terminated string. */
+typedef union
+{
+  guint64 id;
+  const gchar *string;
+} DflEventParameter;
+
+/* The decoded parameters of an event. Parameters which are canonical decimal
+ * integers are stored as IDs; all others are stored as strings, and are marked
+ * in @string_mask. String parameters which are not valid UTF-8 are also marked
+ * in @invalid_mask. The strings are normally stored in the same allocation as
+ * @values, after the values, but events in a #DflEventStore may also share
+ * strings which are owned by the store (see _dfl_event_store_add_decoded()). */
+typedef struct
+{
+  const DflEventParameter *values;  /* nullable; n_parameters elements */
+  guint8 n_parameters;
+  guint8 string_mask;  /* bit i set if parameter i is a string */
+  guint8 invalid_mask;  /* bit i set if parameter i is invalid UTF-8 */
+} DflEventParameters;
+
+G_STATIC_ASSERT (DFL_EVENT_MAX_PARAMETERS <= 8);
+
+/* Allocate @size bytes, aligned for a #DflEventParameter. */
+typedef gpointer (*DflEventParameterAllocFunc) (gsize    size,
+                                                gpointer user_data);
+
+void _dfl_event_parameters_decode (const DflEventField        *fields,
+                                   gsize                       n_fields,
+                                   DflEventParameterAllocFunc  alloc_func,
+                                   gpointer                    user_data,
+                                   DflEventParameters         *out);
+void _dfl_event_parameters_copy   (const DflEventParameters   *parameters,
+                                   DflEventParameterAllocFunc  alloc_func,
+                                   gpointer                    user_data,
+                                   DflEventParameters         *out);
+
+DflEvent *_dfl_event_new_view (const gchar              *event_type,
+                               DflTimestamp              timestamp,
+                               DflThreadId               thread_id,
+                               const DflEventParameters *parameters,
+                               DflArena                 *arena);
+void      _dfl_event_set_view (DflEvent                 *self,
+                               const gchar              *event_type,
+                               DflTimestamp              timestamp,
+                               DflThreadId               thread_id,
+                               const DflEventParameters *parameters,
+                               DflArena                 *arena);
+
+const DflEventParameters *_dfl_event_get_parameters (DflEvent *self);
+
+G_END_DECLS
+
+#endif /* !DFL_EVENT_PRIVATE_H */
@@ -0,0 +1,59 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_EVENT_SEQUENCE_PRIVATE_H
+#define DFL_EVENT_SEQUENCE_PRIVATE_H
+
+#include <glib.h>
+
+#include "event-sequence.h"
+#include "event-store-private.h"
+
+G_BEGIN_DECLS
+
+DflEventSequence *_dfl_event_sequence_new_from_store (DflEventStore    *store,
+                                                      DflTimestamp      initial_timestamp);
+void              _dfl_event_sequence_append_store   (DflEventSequence *self,
+                                                      DflEventStore    *store);
+
+void              _dfl_event_sequence_set_window_start (DflEventSequence *self,
+                                                        DflTimestamp      window_start);
+gboolean          _dfl_event_sequence_get_window_start (DflEventSequence *self,
+                                                        DflTimestamp     *window_start);
+
+DflEventSequence *_dfl_event_sequence_new_merged_take (DflEventSequence    **sequences,
+                                                       const gchar * const  *process_names,
+                                                       guint                 n_sequences);
+
+GPtrArray        *_dfl_event_sequence_dup_events     (DflEventSequence *self,
+                                                      guint             position,
+                                                      guint             n_events);
+
+/* Callback for _dfl_event_sequence_foreach(). Return %FALSE to stop
+ * iterating. */
+typedef gboolean (*DflEventSequenceForeachFunc) (DflEvent *event,
+                                                 gpointer  user_data);
+
+void              _dfl_event_sequence_foreach        (DflEventSequence            *self,
+                                                      guint                        position,
+                                                      DflEventSequenceForeachFunc  func,
+                                                      gpointer                     user_data);
+
+G_END_DECLS
+
+#endif /* !DFL_EVENT_SEQUENCE_PRIVATE_H */
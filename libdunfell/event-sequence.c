@@ -23,11 +23,22 @@
  * @include: libdunfell/event-sequence.h
  *
  * An //event sequence// is a list of #DflEvents, in ascending time order. It
- * uses a moderately compact representation which is optimised for in-order
+ * uses a compact columnar representation which is optimised for in-order
  * iteration over the sequence (‘walking’ over it from start to finish). It
  * supports matching events to dispatch callbacks ([‘walkers’](#walkers)) for
  * analysing the event sequence.
  *
+ * The events are not stored as #DflEvent objects: one is created on demand
+ * when an event is retrieved with g_list_model_get_item(). As with any
+ * #GListModel, the caller owns a reference to the returned #DflEvent and must
+ * unref it when done. The sequence keeps the most recently retrieved events
+ * (and those passed in to dfl_event_sequence_new() or
+ * dfl_event_sequence_append()), so retrieving the same position repeatedly
+ * usually returns the same #DflEvent; but this is only an optimisation, and
+ * events should not be compared by pointer. The #DflEvent passed to a walker
+ * is only valid for the duration of the callback unless the walker takes a
+ * reference to it.
+ *
  * # Walkers # {#walkers}
  *
  * A //walker// is a callback function which is executed for each event out of
@@ -49,6 +60,35 @@
  * Any walkers remaining in the #DflEventSequence when it is destroyed are
  * freed.
  *
+ * Walkers are indexed by their event type and ID, so each event is only
+ * checked against the walkers which could match it, rather than against every
+ * installed walker. Walking is therefore cheap even when many thousands of
+ * walkers are installed, as happens for logs containing many sources.
+ *
+ * # Sharded Walking # {#sharded-walking}
+ *
+ * Most walkers only update the object identified by the ID they match, such
+ * as a #DflSource. Such walkers can be added with
+ * %DFL_EVENT_WALKER_FLAGS_SHARD_SAFE, and dfl_event_sequence_walk_sharded()
+ * will then partition them by ID over several worker threads. Each shard sees
+ * its events in the order they appear in the sequence. Other walkers, such as
+ * the ones which create objects and add walkers for them, are still called
+ * from the calling thread, in order; they run slightly ahead of the shard-safe
+ * walkers, so must not read state which shard-safe walkers modify.
+ *
+ * Shard-safe walkers must not add or remove walkers.
+ *
+ * # Indexed Iteration # {#indexed-iteration}
+ *
+ * To find the events of a particular type, or of a particular type and ID,
+ * without walking the whole sequence, use a #DflEventSequenceIter. The
+ * sequence builds posting lists (arrays of event positions) for each event
+ * type, and for each ID of an event type, the first time they are needed, and
+ * keeps them until more events are appended. Once built, iterating takes time
+ * proportional to the number of matching events, and
+ * dfl_event_sequence_iter_skip_to_timestamp() takes time logarithmic in the
+ * number of events skipped.
+ *
  * # Walker Groups # {#walker-groups}
  *
  * In order to simplify adding groups of walkers to a #DflEventSequence to match
@@ -73,8 +113,12 @@
 #include <gio/gio.h>
 #include <string.h>
 
+#include "atom-table.h"
 #include "event.h"
+#include "event-private.h"
 #include "event-sequence.h"
+#include "event-sequence-private.h"
+#include "event-store-private.h"
 
 
 static void dfl_event_sequence_list_model_init (GListModelInterface *iface);
@@ -84,28 +128,170 @@ static guint dfl_event_sequence_get_n_items (GListModel *list);
 static gpointer dfl_event_sequence_get_item (GListModel  *list,
                                              guint        position);
 
+/* Key which walkers are indexed by. Walkers which match any event type have a
+ * %NULL @event_type; walkers which match any ID have an @id of
+ * %DFL_ID_INVALID. */
 typedef struct
 {
   const gchar *event_type;  /* nullable, unowned, interned */
   DflId id;  /* could be %DFL_ID_INVALID */
-  DflEventWalker walker;
+} DflEventSequenceWalkerKey;
+
+typedef struct _DflEventSequenceWalkerBucket DflEventSequenceWalkerBucket;
+
+typedef struct
+{
+  DflEventWalker walker;  /* %NULL once the walker has been removed */
   gpointer user_data;  /* nullable */
   GDestroyNotify destroy_user_data;  /* nullable */
+  DflEventWalkerFlags flags;
+  DflEventSequenceWalkerBucket *bucket;  /* unowned */
 } DflEventSequenceWalkerClosure;
 
+/* A call to a shard-safe walker which has been queued for a shard. The walker
+ * and its user data are copied, as the walker may be removed before the shard
+ * runs. */
+typedef struct
+{
+  guint position;
+  DflEventWalker walker;
+  gpointer user_data;  /* nullable */
+} DflEventSequenceShardItem;
+
+typedef struct
+{
+  DflEventSequence *sequence;  /* unowned */
+  GArray/*<DflEventSequenceShardItem>*/ *items;  /* owned */
+  DflEvent *view;  /* owned; nullable */
+} DflEventSequenceShard;
+
+/* User data from a walker removed during a sharded walk, which cannot be
+ * destroyed until the queued calls to the walker have been made. */
+typedef struct
+{
+  GDestroyNotify destroy_user_data;
+  gpointer user_data;
+} DflEventSequenceDeferredDestroy;
+
+/* Number of queued walker calls after which the shards are run. This bounds
+ * the memory used by the queues. */
+#define SHARD_WINDOW_SIZE (1 << 16)
+
+/* All the walkers with the same key, in the order they were added. Removed
+ * walkers are left in @closures as tombstones until the bucket is compacted,
+ * so that removing a walker from within a callback does not disturb the
+ * iteration over the bucket. */
+struct _DflEventSequenceWalkerBucket
+{
+  DflEventSequenceWalkerKey key;  /* must be the first member */
+  GPtrArray/*<owned DflEventSequenceWalkerClosure>*/ *closures;  /* owned */
+  gboolean dirty;  /* whether @closures contains any tombstones */
+};
+
+/* Number of views created by g_list_model_get_item() which are kept, so that
+ * repeated lookups of nearby positions don’t create a new #DflEvent each time.
+ * Must be a power of two. */
+#define N_RECENT_VIEWS 256
+
+/* A slot in the cache of recently created views. */
+typedef struct
+{
+  guint position;
+  DflEvent *view;  /* owned; nullable */
+} DflEventSequenceRecentView;
+
 struct _DflEventSequence
 {
   GObject parent;
 
-  DflEvent **events;  /* owned */
-  guint n_events;
+  /* Events are stored in @own_store, unless this sequence is a slice of
+   * @slice_parent, in which case @store is the parent’s store, and this
+   * sequence covers the @n_slice_events events starting at @offset in it.
+   * Positions in this sequence are relative to @offset. */
+  DflEventStore own_store;
+  DflEventStore *store;  /* unowned */
+  DflEventSequence *slice_parent;  /* owned; nullable */
+  guint offset;
+  guint n_slice_events;
+
   guint64 initial_timestamp;
 
-  GArray/*<DflEventWalkerClosure>*/ *walkers;  /* owned */
+  /* If the sequence was loaded from a time range of a log, rather than from
+   * its start, the timestamp the range starts at; see
+   * _dfl_event_sequence_get_window_start(). */
+  gboolean has_window_start;
+  DflTimestamp window_start;
+
+  /* Names of the processes whose logs were merged to create this sequence,
+   * indexed by process; %NULL if it was not created by merging. */
+  GPtrArray/*<owned utf8>*/ *process_names;  /* owned; nullable */
+
+  /* The #DflEvents passed in to dfl_event_sequence_new() or
+   * dfl_event_sequence_append(), which are the views onto their events in
+   * @store for the lifetime of the sequence. */
+  GHashTable/*<guint, owned DflEvent>*/ *views;  /* owned; nullable */
+
+  /* Views created by g_list_model_get_item(), in a direct-mapped cache indexed
+   * by position modulo %N_RECENT_VIEWS. Older views are evicted, so that
+   * retrieving every event does not keep a #DflEvent alive for each. */
+  DflEventSequenceRecentView *recent_views;  /* owned; nullable */
+
+  /* View which is re-pointed at each event in turn when walking, as long as
+   * nothing else has taken a reference to it. */
+  DflEvent *walk_view;  /* owned; nullable */
+
+  /* Walkers indexed by their key, so that each event only has to be checked
+   * against the walkers which can match it. */
+  GHashTable/*<unowned DflEventSequenceWalkerKey,
+               owned DflEventSequenceWalkerBucket>*/ *walker_buckets;  /* owned */
+  GHashTable/*<guint, unowned DflEventSequenceWalkerClosure>*/ *walkers;  /* owned */
+  guint next_walker_id;
+
+  /* Buckets containing tombstones, which are compacted once the current event
+   * has been dispatched. */
+  GPtrArray/*<unowned DflEventSequenceWalkerBucket>*/ *dirty_buckets;  /* owned */
+  gboolean walking;
+
+  /* State for dfl_event_sequence_walk_sharded(). @shards is non-%NULL while a
+   * sharded walk is in progress. */
+  DflEventSequenceShard *shards;  /* owned; nullable */
+  guint n_shards;
+  guint n_queued_items;
+  gboolean running_shards;
+  GArray/*<DflEventSequenceDeferredDestroy>*/ *deferred_destroys;  /* owned; nullable */
 
   GArray/*<guint>*/ *walker_group;  /* owned; nullable */
+
+  /* Strings from the events, interned by the objects built from them. */
+  DflAtomTable *atom_table;  /* owned */
+
+  /* Posting lists for #DflEventSequenceIter, indexed by event type code, and
+   * by event type code and ID. Built lazily; cleared when events are
+   * appended. @id_postings_built records which event type codes have had all
+   * their per-ID posting lists built. */
+  GPtrArray/*<owned GArray<guint>>*/ *type_postings;  /* owned; nullable */
+  GHashTable/*<owned DflEventSequencePostingKey,
+               owned GArray<guint>>*/ *id_postings;  /* owned; nullable */
+  GArray/*<gboolean>*/ *id_postings_built;  /* owned; nullable */
 };
 
+typedef struct
+{
+  guint code;
+  DflId id;
+} DflEventSequencePostingKey;
+
+typedef struct
+{
+  DflEventSequence *sequence;  /* unowned */
+  const guint *positions;  /* unowned; %NULL to iterate over all events */
+  guint n_positions;
+  guint index;
+} DflEventSequenceIterReal;
+
+G_STATIC_ASSERT (sizeof (DflEventSequenceIterReal) <=
+                 sizeof (DflEventSequenceIter));
+
 G_DEFINE_TYPE_WITH_CODE (DflEventSequence, dfl_event_sequence, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL,
                                                 dfl_event_sequence_list_model_init))
@@ -126,46 +312,112 @@ dfl_event_sequence_list_model_init (GListModelInterface *iface)
   iface->get_item = dfl_event_sequence_get_item;
 }
 
-static void
-walkers_clear_cb (gpointer user_data)
+static guint
+walker_key_hash (gconstpointer key)
+{
+  const DflEventSequenceWalkerKey *k = key;
+
+  return g_direct_hash (k->event_type) ^ g_direct_hash ((gpointer) k->id);
+}
+
+static gboolean
+walker_key_equal (gconstpointer a,
+                  gconstpointer b)
 {
-  DflEventSequenceWalkerClosure *closure = user_data;
+  const DflEventSequenceWalkerKey *k1 = a, *k2 = b;
+
+  return (k1->event_type == k2->event_type && k1->id == k2->id);
+}
 
+/* Turn @closure into a tombstone, releasing its user data. */
+static void
+walker_closure_clear (DflEventSequenceWalkerClosure *closure)
+{
   if (closure->user_data != NULL && closure->destroy_user_data != NULL)
     closure->destroy_user_data (closure->user_data);
 
-  closure->event_type = NULL;
-  closure->id = DFL_ID_INVALID;
   closure->walker = NULL;
   closure->user_data = NULL;
   closure->destroy_user_data = NULL;
 }
 
+static void
+walker_closure_free (gpointer data)
+{
+  DflEventSequenceWalkerClosure *closure = data;
+
+  walker_closure_clear (closure);
+  g_free (closure);
+}
+
+static void
+walker_bucket_free (gpointer data)
+{
+  DflEventSequenceWalkerBucket *bucket = data;
+
+  g_ptr_array_unref (bucket->closures);
+  g_free (bucket);
+}
+
 static void
 dfl_event_sequence_init (DflEventSequence *self)
 {
-  self->walkers = g_array_new (FALSE, FALSE,
-                               sizeof (DflEventSequenceWalkerClosure));
-  g_array_set_clear_func (self->walkers, walkers_clear_cb);
+  _dfl_event_store_init (&self->own_store);
+  self->store = &self->own_store;
+  self->atom_table = dfl_atom_table_new ();
+
+  self->walker_buckets = g_hash_table_new_full (walker_key_hash,
+                                                walker_key_equal,
+                                                NULL, walker_bucket_free);
+  self->walkers = g_hash_table_new (NULL, NULL);
+  self->next_walker_id = 1;
+  self->dirty_buckets = g_ptr_array_new ();
+}
+
+/* Drop all the posting lists, so they are rebuilt when next needed. */
+static void
+event_sequence_clear_postings (DflEventSequence *self)
+{
+  g_clear_pointer (&self->id_postings_built, g_array_unref);
+  g_clear_pointer (&self->id_postings, g_hash_table_unref);
+  g_clear_pointer (&self->type_postings, g_ptr_array_unref);
+}
+
+static void
+event_sequence_clear_recent_views (DflEventSequence *self)
+{
+  guint i;
+
+  if (self->recent_views == NULL)
+    return;
+
+  for (i = 0; i < N_RECENT_VIEWS; i++)
+    g_clear_object (&self->recent_views[i].view);
+
+  g_clear_pointer (&self->recent_views, g_free);
 }
 
 static void
 dfl_event_sequence_dispose (GObject *object)
 {
   DflEventSequence *self = DFL_EVENT_SEQUENCE (object);
-  guint i;
 
   /* The programmer must have closed any walker groups before disposing the
    * event sequence. */
   g_assert (self->walker_group == NULL);
 
-  for (i = 0; i < self->n_events; i++)
-    g_object_unref (self->events[i]);
+  event_sequence_clear_postings (self);
+  g_clear_object (&self->walk_view);
+  g_clear_pointer (&self->views, g_hash_table_unref);
+  event_sequence_clear_recent_views (self);
+  _dfl_event_store_clear (&self->own_store);
+  g_clear_object (&self->slice_parent);
+  g_clear_pointer (&self->process_names, g_ptr_array_unref);
 
-  g_clear_pointer (&self->events, g_free);
-  self->n_events = 0;
-
-  g_clear_pointer (&self->walkers, g_array_unref);
+  g_clear_pointer (&self->dirty_buckets, g_ptr_array_unref);
+  g_clear_pointer (&self->walkers, g_hash_table_unref);
+  g_clear_pointer (&self->walker_buckets, g_hash_table_unref);
+  g_clear_object (&self->atom_table);
 
   /* Chain up to the parent class */
   G_OBJECT_CLASS (dfl_event_sequence_parent_class)->dispose (object);
@@ -177,24 +429,134 @@ dfl_event_sequence_get_item_type (GListModel *list)
   return DFL_TYPE_EVENT;
 }
 
+static guint
+event_sequence_get_n_events (DflEventSequence *self)
+{
+  if (self->slice_parent != NULL)
+    return self->n_slice_events;
+
+  return _dfl_event_store_get_n_events (self->store);
+}
+
 static guint
 dfl_event_sequence_get_n_items (GListModel *list)
 {
   DflEventSequence *self = DFL_EVENT_SEQUENCE (list);
 
-  return self->n_events;
+  return event_sequence_get_n_events (self);
+}
+
+/* Pin @view as the view onto the event at @position, for the lifetime of the
+ * sequence. */
+static void
+event_sequence_cache_view (DflEventSequence *self,
+                           guint             position,
+                           DflEvent         *view)
+{
+  if (self->views == NULL)
+    self->views = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+
+  g_hash_table_insert (self->views, GUINT_TO_POINTER (position),
+                       g_object_ref (view));
+}
+
+/* Add @view to the cache of recently created views, evicting whichever view
+ * was previously in its slot. */
+static void
+event_sequence_cache_recent_view (DflEventSequence *self,
+                                  guint             position,
+                                  DflEvent         *view)
+{
+  DflEventSequenceRecentView *slot;
+
+  if (self->recent_views == NULL)
+    self->recent_views = g_new0 (DflEventSequenceRecentView, N_RECENT_VIEWS);
+
+  slot = &self->recent_views[position & (N_RECENT_VIEWS - 1)];
+  g_clear_object (&slot->view);
+  slot->position = position;
+  slot->view = g_object_ref (view);
+}
+
+static DflEvent *
+event_sequence_lookup_view (DflEventSequence *self,
+                            guint             position)
+{
+  DflEvent *view = NULL;
+
+  if (self->views != NULL)
+    view = g_hash_table_lookup (self->views, GUINT_TO_POINTER (position));
+
+  if (view == NULL && self->recent_views != NULL)
+    {
+      const DflEventSequenceRecentView *slot;
+
+      slot = &self->recent_views[position & (N_RECENT_VIEWS - 1)];
+
+      if (slot->view != NULL && slot->position == position)
+        view = slot->view;
+    }
+
+  /* Slices return the same views as their parent, where it has them. */
+  if (view == NULL && self->slice_parent != NULL)
+    view = event_sequence_lookup_view (self->slice_parent,
+                                       self->offset + position);
+
+  return view;
 }
 
+/* Get a view onto the event at @position for walking over the sequence. This
+ * re-uses the same #DflEvent for each event unless the previous one has been
+ * referenced elsewhere. The returned event is owned by the sequence. */
+static DflEvent *
+event_sequence_get_walk_view (DflEventSequence *self,
+                              guint             position)
+{
+  DflEvent *view;
+
+  view = event_sequence_lookup_view (self, position);
+
+  if (view != NULL)
+    return view;
+
+  if (self->walk_view != NULL &&
+      g_atomic_int_get (&G_OBJECT (self->walk_view)->ref_count) > 1)
+    g_clear_object (&self->walk_view);
+
+  if (self->walk_view == NULL)
+    self->walk_view = _dfl_event_store_new_view (self->store,
+                                                 self->offset + position);
+  else
+    _dfl_event_store_update_view (self->store, self->offset + position,
+                                  self->walk_view);
+
+  return self->walk_view;
+}
+
+/* The returned event is transfer full, as required by #GListModel. The
+ * sequence keeps its own reference in its cache of recent views, which only
+ * saves re-creating it on nearby lookups. */
 static gpointer
 dfl_event_sequence_get_item (GListModel  *list,
                              guint        position)
 {
   DflEventSequence *self = DFL_EVENT_SEQUENCE (list);
+  DflEvent *view;
 
-  if (position >= self->n_events)
+  if (position >= event_sequence_get_n_events (self))
     return NULL;
 
-  return self->events[position];
+  view = event_sequence_lookup_view (self, position);
+
+  if (view == NULL)
+    {
+      view = _dfl_event_store_new_view (self->store, self->offset + position);
+      event_sequence_cache_recent_view (self, position, view);
+
+      return view;
+    }
+
+  return g_object_ref (view);
 }
 
 /**
@@ -218,189 +580,1030 @@ dfl_event_sequence_new (const DflEvent **events,
   guint i;
 
   g_return_val_if_fail (n_events == 0 || events != NULL, NULL);
-  g_return_val_if_fail (n_events < G_MAXUINT / sizeof (DflEvent *), NULL);
+
+  for (i = 0; i < n_events; i++)
+    g_return_val_if_fail (DFL_IS_EVENT (events[i]), NULL);
 
   obj = g_object_new (DFL_TYPE_EVENT_SEQUENCE, NULL);
-  obj->events = g_memdup (events, sizeof (DflEvent *) * n_events);
-  obj->n_events = n_events;
   obj->initial_timestamp = initial_timestamp;
 
-  /* Reference all the events. */
+  /* Copy the events into the store, and keep the originals as the views onto
+   * them so that they are returned by g_list_model_get_item(). */
   for (i = 0; i < n_events; i++)
     {
-      g_return_val_if_fail (DFL_IS_EVENT (obj->events[i]), NULL);
-      g_object_ref (obj->events[i]);
+      _dfl_event_store_add_event (obj->store, (DflEvent *) events[i]);
+      event_sequence_cache_view (obj, i, (DflEvent *) events[i]);
     }
 
   return obj;
 }
 
-/**
- * dfl_event_sequence_start_walker_group:
- * @self: a #DflEventSequence
- *
- * Start a new walker group. For more information, see
- * [Walker Groups](#walker-groups).
- *
- * It is an error to call this if a walker group has already been started and
- * has not yet been ended with a call to dfl_event_sequence_end_walker_group().
- *
- * Since: UNRELEASED
- */
-void
-dfl_event_sequence_start_walker_group (DflEventSequence *self)
+/* Create a new #DflEventSequence containing all the events from @store,
+ * leaving @store empty. This is cheap, as no #DflEvents are created and the
+ * parameters are not copied. */
+DflEventSequence *
+_dfl_event_sequence_new_from_store (DflEventStore *store,
+                                    DflTimestamp   initial_timestamp)
 {
-  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
-  g_return_if_fail (self->walker_group == NULL);
+  DflEventSequence *obj = NULL;
 
-  self->walker_group = g_array_new (FALSE, FALSE, sizeof (guint));
-}
+  g_return_val_if_fail (store != NULL, NULL);
 
-static void
-remove_walkers_cb (DflEventSequence *sequence,
-                   DflEvent         *event,
-                   gpointer          user_data)
-{
-  GArray/*<guint>*/ *walkers = user_data;  /* owned */
-  gsize i, n_walkers;
+  obj = g_object_new (DFL_TYPE_EVENT_SEQUENCE, NULL);
+  obj->initial_timestamp = initial_timestamp;
+  _dfl_event_store_take (obj->store, store);
 
-  for (i = 0, n_walkers = walkers->len; i < n_walkers; i++)
-    {
-      guint walker_id = g_array_index (walkers, guint, i);
-      dfl_event_sequence_remove_walker (sequence, walker_id);
-    }
+  return obj;
 }
 
-/**
- * dfl_event_sequence_end_walker_group:
- * @self: a #DflEventSequence
- * @event_type: event type to trigger removal of the walker group
- * @id: event ID to trigger removal of the walker group, or %DFL_ID_INVALID to
- *    match any event ID
- *
- * End the current walker group, and add a trigger to remove the walkers in the
- * group from the #DflEventSequence when an event matching @event_type and @id
- * is seen. @event_type must be specified; @id is optional. Matching is the same
- * as with dfl_event_sequence_add_walker().
- *
- * It is an error to call this if a walker group is not currently started.
- *
- * Since: UNRELEASED
- */
-void
-dfl_event_sequence_end_walker_group (DflEventSequence *self,
-                                     const gchar      *event_type,
-                                     DflId             id)
+/* Find the position of the first event in @self with a timestamp ≥
+ * @timestamp, or the number of events if there is none. */
+static guint
+event_sequence_find_timestamp (DflEventSequence *self,
+                               DflTimestamp      timestamp)
 {
-  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
-  g_return_if_fail (event_type != NULL);
-  g_return_if_fail (self->walker_group != NULL);
+  guint low, high;
 
-  /* Remove the walkers once the next @event_type is seen which matches @id. */
-  if (self->walker_group->len > 0)
+  low = 0;
+  high = event_sequence_get_n_events (self);
+
+  while (low < high)
     {
-      dfl_event_sequence_add_walker (self, event_type, id,
-                                     remove_walkers_cb,
-                                     g_array_ref (self->walker_group),
-                                     (GDestroyNotify) g_array_unref);
+      guint mid = low + (high - low) / 2;
+
+      if (g_array_index (self->store->timestamps, DflTimestamp,
+                         self->offset + mid) < timestamp)
+        low = mid + 1;
+      else
+        high = mid;
     }
 
-  g_clear_pointer (&self->walker_group, g_array_unref);
+  return low;
 }
 
 /**
- * dfl_event_sequence_add_walker:
+ * dfl_event_sequence_slice:
  * @self: a #DflEventSequence
- * @event_type: (nullable): event type to match, or %NULL to match all event
- *    types
- * @id: event ID to match, or %DFL_ID_INVALID to match all event IDs
- * @walker: the event walker to add
- * @user_data: user data to pass to @walker
- * @destroy_user_data: (nullable): destroy handler for @user_data
- *
- * Add a walker to the event sequence, to be called in the next (or current)
- * call to dfl_event_sequence_walk(). For more information on walkers, see
- * [the summary](#walkers).
- *
- * The @event_type and @id are optional. If @id is specified, @event_type must
- * be specified. Only events which match both properties (if specified) are
- * returned to the @walker callback.
+ * @start: timestamp of the start of the slice (inclusive)
+ * @end: timestamp of the end of the slice (exclusive)
  *
- * The @user_data is held at least until the walker is removed from the
- * #DflEventSequence, but may be held longer. @destroy_user_data is called when
- * the @user_data is no longer needed.
+ * Create a new #DflEventSequence containing the events from @self whose
+ * timestamps are in the range [@start, @end). The slice shares the events,
+ * and the #DflAtomTable, of @self rather than copying them, and is found by
+ * binary search, so this is cheap however large @self is. Walkers,
+ * #DflEventSequenceIters and the #GListModel interface all work on the slice
+ * as normal, with positions relative to the start of the slice; so a
+ * #DflModel can be built for just the slice.
  *
- * Returned walker IDs are guaranteed to never be zero, which is not a valid ID.
+ * The slice keeps a reference to @self. Events cannot be appended to a slice,
+ * and events appended to @self later are not added to the slice.
  *
- * Returns: the ID of the walker
+ * Returns: (transfer full): a new #DflEventSequence for the slice
  * Since: UNRELEASED
  */
-guint
-dfl_event_sequence_add_walker (DflEventSequence *self,
-                               const gchar      *event_type,
-                               DflId             id,
-                               DflEventWalker    walker,
-                               gpointer          user_data,
-                               GDestroyNotify    destroy_user_data)
+DflEventSequence *
+dfl_event_sequence_slice (DflEventSequence *self,
+                          DflTimestamp      start,
+                          DflTimestamp      end)
 {
-  DflEventSequenceWalkerClosure closure;
+  DflEventSequence *slice = NULL;
+  guint start_position, end_position;
 
-  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self), 0);
-  g_return_val_if_fail (event_type == NULL || *event_type != '\0', 0);
-  g_return_val_if_fail (event_type != NULL || id == DFL_ID_INVALID, 0);
-  g_return_val_if_fail (walker != NULL, 0);
+  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self), NULL);
+  g_return_val_if_fail (start <= end, NULL);
 
-  closure.event_type = g_intern_string (event_type);
-  closure.id = id;
-  closure.walker = walker;
-  closure.user_data = user_data;
-  closure.destroy_user_data = destroy_user_data;
+  start_position = event_sequence_find_timestamp (self, start);
+  end_position = event_sequence_find_timestamp (self, end);
 
-  g_array_append_val (self->walkers, closure);
+  slice = g_object_new (DFL_TYPE_EVENT_SEQUENCE, NULL);
+  slice->initial_timestamp = self->initial_timestamp;
 
-  if (self->walker_group != NULL)
-    g_array_append_val (self->walker_group, self->walkers->len);
+  /* Slices of slices refer to the original sequence directly. */
+  slice->slice_parent = g_object_ref ((self->slice_parent != NULL) ?
+                                      self->slice_parent : self);
+  slice->store = self->store;
+  slice->offset = self->offset + start_position;
+  slice->n_slice_events = end_position - start_position;
 
-  g_assert (self->walkers->len != 0);
-  return self->walkers->len;
+  g_object_unref (slice->atom_table);
+  slice->atom_table = g_object_ref (self->atom_table);
+
+  if (self->process_names != NULL)
+    slice->process_names = g_ptr_array_ref (self->process_names);
+
+  return slice;
 }
 
-/**
- * dfl_event_sequence_remove_walker:
- * @self: a #DflEventSequence
- * @walker_id: ID of the walker to remove
- *
- * Remove a walker from the #DflEventSequence which was previously added using
- * dfl_event_sequence_add_walker().
- *
- * Removing the same ID twice, either using this function or as part of a walker
- * group, is an error.
- *
- * Since: 0.1.0
- */
-void
-dfl_event_sequence_remove_walker (DflEventSequence *self,
-                                  guint             walker_id)
+/* Get the mask of the parameters of events of type @event_type which are
+ * object IDs, and so need tagging with their process when merging logs. The
+ * first parameter is the object the event is about; a few event types refer
+ * to other objects too. */
+static guint8
+merge_get_id_mask (const gchar *event_type)
 {
-  DflEventSequenceWalkerClosure *closure;
+  if (event_type == g_intern_static_string ("g_source_attach"))
+    return (1 << 0) | (1 << 1);  /* source, main context */
+  else if (event_type == g_intern_static_string ("g_task_new"))
+    return (1 << 0) | (1 << 1) | (1 << 2) | (1 << 4);  /* task, source
+                                                        * object, cancellable,
+                                                        * callback data */
+  else
+    return (1 << 0);
+}
 
-  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
-  g_return_if_fail (walker_id != 0 && walker_id <= self->walkers->len);
+/* One input to a merge: a sequence, and the position of its next event. */
+typedef struct
+{
+  DflEventSequence *sequence;  /* unowned */
+  guint position;
+  guint n_events;
+} MergeCursor;
 
-  /* Clear the given element of the walkers array, but don’t remove it so we
-   * don’t muck up the IDs of other walkers. */
-  closure = &g_array_index (self->walkers, DflEventSequenceWalkerClosure,
-                            walker_id - 1);
+static DflTimestamp
+merge_cursor_get_timestamp (const MergeCursor *cursor)
+{
+  DflEventSequence *sequence = cursor->sequence;
 
-  g_return_if_fail (closure->walker != NULL);
-  walkers_clear_cb (closure);
+  return g_array_index (sequence->store->timestamps, DflTimestamp,
+                        sequence->offset + cursor->position);
 }
 
-/**
- * dfl_event_sequence_walk:
- * @self: a #DflEventSequence
+/* Order cursors by the timestamp of their next event, breaking ties by input
+ * order so that the merge is stable. */
+static gboolean
+merge_cursor_less (const MergeCursor *cursors,
+                   guint              a,
+                   guint              b)
+{
+  DflTimestamp timestamp_a, timestamp_b;
+
+  timestamp_a = merge_cursor_get_timestamp (&cursors[a]);
+  timestamp_b = merge_cursor_get_timestamp (&cursors[b]);
+
+  return (timestamp_a < timestamp_b || (timestamp_a == timestamp_b && a < b));
+}
+
+/* Restore the min-heap property of @heap (which contains indices into
+ * @cursors) below @index. */
+static void
+merge_heap_sift_down (guint             *heap,
+                      guint              n_heap,
+                      const MergeCursor *cursors,
+                      guint              index)
+{
+  while (TRUE)
+    {
+      guint smallest = index;
+      guint left = 2 * index + 1, right = 2 * index + 2;
+      guint tmp;
+
+      if (left < n_heap &&
+          merge_cursor_less (cursors, heap[left], heap[smallest]))
+        smallest = left;
+      if (right < n_heap &&
+          merge_cursor_less (cursors, heap[right], heap[smallest]))
+        smallest = right;
+
+      if (smallest == index)
+        break;
+
+      tmp = heap[index];
+      heap[index] = heap[smallest];
+      heap[smallest] = tmp;
+      index = smallest;
+    }
+}
+
+/* Merge @sequences into a new sequence; see dfl_event_sequence_new_merged().
+ * If @take is %TRUE, the events are moved out of @sequences rather than
+ * copied; see _dfl_event_sequence_new_merged_take(). */
+static DflEventSequence *
+event_sequence_merge (DflEventSequence    **sequences,
+                      const gchar * const  *process_names,
+                      guint                 n_sequences,
+                      gboolean              take)
+{
+  DflEventSequence *obj = NULL;
+  MergeCursor *cursors = NULL;
+  guint *heap = NULL;
+  guint i, n_heap;
+  DflTimestamp window_start, first_window_start = G_MAXUINT64;
+
+  obj = g_object_new (DFL_TYPE_EVENT_SEQUENCE, NULL);
+  obj->initial_timestamp = (n_sequences > 0) ? G_MAXUINT64 : 0;
+  obj->process_names = g_ptr_array_new_full (n_sequences, g_free);
+
+  cursors = g_new0 (MergeCursor, n_sequences);
+  heap = g_new (guint, n_sequences);
+  n_heap = 0;
+
+  for (i = 0; i < n_sequences; i++)
+    {
+      obj->initial_timestamp = MIN (obj->initial_timestamp,
+                                    sequences[i]->initial_timestamp);
+
+      /* The merged window starts at the earliest input window, so that it
+       * never starts after an event from any of the inputs. */
+      if (_dfl_event_sequence_get_window_start (sequences[i], &window_start))
+        obj->has_window_start = TRUE;
+      else
+        window_start = sequences[i]->initial_timestamp;
+
+      first_window_start = MIN (first_window_start, window_start);
+
+      if (process_names != NULL)
+        g_ptr_array_add (obj->process_names, g_strdup (process_names[i]));
+      else
+        g_ptr_array_add (obj->process_names,
+                         g_strdup_printf ("Process %u", i));
+
+      /* The views hold references to the store’s arena, which is about to be
+       * absorbed, and the postings will be stale once the store is empty. */
+      if (take)
+        {
+          event_sequence_clear_postings (sequences[i]);
+          g_clear_object (&sequences[i]->walk_view);
+          g_clear_pointer (&sequences[i]->views, g_hash_table_unref);
+          event_sequence_clear_recent_views (sequences[i]);
+        }
+
+      cursors[i].sequence = sequences[i];
+      cursors[i].position = 0;
+      cursors[i].n_events = event_sequence_get_n_events (sequences[i]);
+
+      if (cursors[i].n_events > 0)
+        heap[n_heap++] = i;
+    }
+
+  if (obj->has_window_start)
+    obj->window_start = first_window_start;
+
+  for (i = n_heap / 2; i > 0; i--)
+    merge_heap_sift_down (heap, n_heap, cursors, i - 1);
+
+  /* Repeatedly take the next event from the cursor with the earliest one. */
+  while (n_heap > 0)
+    {
+      MergeCursor *cursor = &cursors[heap[0]];
+      DflEventSequence *sequence = cursor->sequence;
+      const gchar *event_type;
+      guint index, code;
+      guint8 id_mask;
+
+      index = sequence->offset + cursor->position;
+      code = g_array_index (sequence->store->event_types, guint16, index);
+      event_type = sequence->store->event_type_table->pdata[code];
+      id_mask = merge_get_id_mask (event_type);
+
+      if (take)
+        _dfl_event_store_move_tagged (obj->store, sequence->store, index,
+                                      heap[0], id_mask);
+      else
+        _dfl_event_store_add_tagged (obj->store, sequence->store, index,
+                                     heap[0], id_mask);
+
+      cursor->position++;
+
+      if (cursor->position >= cursor->n_events)
+        heap[0] = heap[--n_heap];
+
+      merge_heap_sift_down (heap, n_heap, cursors, 0);
+    }
+
+  if (take)
+    {
+      for (i = 0; i < n_sequences; i++)
+        _dfl_event_store_absorb (obj->store, sequences[i]->store);
+    }
+
+  g_free (heap);
+  g_free (cursors);
+
+  return obj;
+}
+
+/**
+ * dfl_event_sequence_new_merged:
+ * @sequences: (array length=n_sequences): sequences to merge, one per process
+ * @process_names: (array length=n_sequences) (nullable): names of the processes
+ *    the sequences were recorded from, or %NULL to number them
+ * @n_sequences: number of sequences to merge; at most 256
+ *
+ * Create a new #DflEventSequence containing all the events from @sequences,
+ * ordered by timestamp. This is for analysing several cooperating processes,
+ * such as a D-Bus service and its clients, on one timeline. It assumes their
+ * logs use the same clock, which is the case for processes on the same
+ * machine. Events with the same timestamp are ordered by the index of their
+ * sequence in @sequences.
+ *
+ * The events are merged by streaming a k-way merge over the inputs, without
+ * creating a #DflEvent per event or any intermediate arrays. As @sequences
+ * are left unchanged, each event’s columns and parameters are copied into the
+ * new sequence, so while merging, memory is needed for both @sequences and the
+ * result. (dfl_parser_load_from_files() avoids this by moving the events of
+ * the logs it loads instead.)
+ *
+ * Each event is tagged with the index of its sequence in @sequences, which is
+ * returned by dfl_event_get_process(). So that objects from different
+ * processes which happen to have the same address are not confused, the
+ * thread IDs and (non-%NULL) object IDs of events from every process other
+ * than the first are modified to include the process index. This is only
+ * reliable on 64-bit platforms.
+ *
+ * Returns: (transfer full): a new #DflEventSequence
+ * Since: UNRELEASED
+ */
+DflEventSequence *
+dfl_event_sequence_new_merged (DflEventSequence    **sequences,
+                               const gchar * const  *process_names,
+                               guint                 n_sequences)
+{
+  guint i;
+
+  g_return_val_if_fail (sequences != NULL || n_sequences == 0, NULL);
+  g_return_val_if_fail (n_sequences <= DFL_PROCESS_MAX + 1, NULL);
+
+  for (i = 0; i < n_sequences; i++)
+    g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (sequences[i]), NULL);
+
+  return event_sequence_merge (sequences, process_names, n_sequences, FALSE);
+}
+
+/* Like dfl_event_sequence_new_merged(), but moves the events out of
+ * @sequences rather than copying them: their IDs are tagged in place, and
+ * their stores’ arenas are absorbed into the new sequence’s. This halves the
+ * peak memory needed to merge. @sequences must not be slices, or have slices
+ * taken of them, or have any of their #DflEvents referenced elsewhere; they
+ * are left empty. */
+DflEventSequence *
+_dfl_event_sequence_new_merged_take (DflEventSequence    **sequences,
+                                     const gchar * const  *process_names,
+                                     guint                 n_sequences)
+{
+  guint i;
+
+  g_return_val_if_fail (sequences != NULL || n_sequences == 0, NULL);
+  g_return_val_if_fail (n_sequences <= DFL_PROCESS_MAX + 1, NULL);
+
+  for (i = 0; i < n_sequences; i++)
+    {
+      g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (sequences[i]), NULL);
+      g_return_val_if_fail (sequences[i]->slice_parent == NULL, NULL);
+    }
+
+  return event_sequence_merge (sequences, process_names, n_sequences, TRUE);
+}
+
+/**
+ * dfl_event_sequence_get_n_processes:
+ * @self: a #DflEventSequence
+ *
+ * Get the number of processes whose events are in the sequence. This is 1
+ * unless the sequence was created using dfl_event_sequence_new_merged().
+ *
+ * Returns: number of processes
+ * Since: UNRELEASED
+ */
+guint
+dfl_event_sequence_get_n_processes (DflEventSequence *self)
+{
+  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self), 0);
+
+  return (self->process_names != NULL) ? self->process_names->len : 1;
+}
+
+/**
+ * dfl_event_sequence_get_process_name:
+ * @self: a #DflEventSequence
+ * @process: index of the process, as returned by dfl_event_get_process()
+ *
+ * Get the name of the process with index @process, as passed to
+ * dfl_event_sequence_new_merged().
+ *
+ * Returns: (nullable): name of the process, or %NULL if the sequence was not
+ *    created by merging
+ * Since: UNRELEASED
+ */
+const gchar *
+dfl_event_sequence_get_process_name (DflEventSequence *self,
+                                     guint             process)
+{
+  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self), NULL);
+  g_return_val_if_fail (process < dfl_event_sequence_get_n_processes (self),
+                        NULL);
+
+  if (self->process_names == NULL)
+    return NULL;
+
+  return self->process_names->pdata[process];
+}
+
+/**
+ * dfl_event_sequence_append:
+ * @self: a #DflEventSequence
+ * @events: (array length=n_events): array of #DflEvents to append
+ * @n_events: number of items in @events
+ *
+ * Append @events to the end of the sequence, for example when parsing a log
+ * which is still being written. The events must be in order, and must not
+ * precede the events already in the sequence from the same threads.
+ *
+ * This emits #GListModel::items-changed. It must not be called while walking
+ * over the sequence.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_event_sequence_append (DflEventSequence  *self,
+                           const DflEvent   **events,
+                           guint              n_events)
+{
+  guint i, old_n_events;
+
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
+  g_return_if_fail (self->slice_parent == NULL);
+  g_return_if_fail (n_events == 0 || events != NULL);
+
+  for (i = 0; i < n_events; i++)
+    g_return_if_fail (DFL_IS_EVENT (events[i]));
+
+  if (n_events == 0)
+    return;
+
+  old_n_events = _dfl_event_store_get_n_events (self->store);
+
+  for (i = 0; i < n_events; i++)
+    {
+      _dfl_event_store_add_event (self->store, (DflEvent *) events[i]);
+      event_sequence_cache_view (self, old_n_events + i,
+                                 (DflEvent *) events[i]);
+    }
+
+  event_sequence_clear_postings (self);
+
+  g_list_model_items_changed (G_LIST_MODEL (self), old_n_events, 0, n_events);
+}
+
+/* Append all the events from @store to the sequence, leaving @store empty,
+ * and emit #GListModel::items-changed. */
+void
+_dfl_event_sequence_append_store (DflEventSequence *self,
+                                  DflEventStore    *store)
+{
+  guint old_n_events, n_events;
+
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
+  g_return_if_fail (self->slice_parent == NULL);
+  g_return_if_fail (store != NULL);
+
+  n_events = _dfl_event_store_get_n_events (store);
+
+  if (n_events == 0)
+    return;
+
+  old_n_events = _dfl_event_store_get_n_events (self->store);
+  _dfl_event_store_take (self->store, store);
+
+  event_sequence_clear_postings (self);
+
+  g_list_model_items_changed (G_LIST_MODEL (self), old_n_events, 0, n_events);
+}
+
+/* Record that the sequence was loaded from a time range of its log starting at
+ * @window_start, so events before then (including the first halves of spans
+ * which continue into the range) are missing. */
+void
+_dfl_event_sequence_set_window_start (DflEventSequence *self,
+                                      DflTimestamp      window_start)
+{
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
+  g_return_if_fail (self->slice_parent == NULL);
+
+  self->has_window_start = TRUE;
+  self->window_start = window_start;
+}
+
+/* Get the start of the time range the sequence was loaded from, if it was
+ * loaded from a time range rather than from the start of its log. Model
+ * builders clip spans whose first half is missing to start here, rather than
+ * treating them as malformed. Returns %FALSE if there is no such window. */
+gboolean
+_dfl_event_sequence_get_window_start (DflEventSequence *self,
+                                      DflTimestamp     *window_start)
+{
+  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self), FALSE);
+  g_return_val_if_fail (window_start != NULL, FALSE);
+
+  if (self->slice_parent != NULL)
+    return _dfl_event_sequence_get_window_start (self->slice_parent,
+                                                 window_start);
+
+  *window_start = self->window_start;
+
+  return self->has_window_start;
+}
+
+/* Get new references to the @n_events events starting at @position, for
+ * passing to code which needs the #DflEvents to outlive a single callback. */
+GPtrArray/*<owned DflEvent>*/ *
+_dfl_event_sequence_dup_events (DflEventSequence *self,
+                                guint             position,
+                                guint             n_events)
+{
+  GPtrArray/*<owned DflEvent>*/ *events = NULL;
+  guint i;
+
+  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self), NULL);
+  g_return_val_if_fail (position + n_events <=
+                        event_sequence_get_n_events (self), NULL);
+
+  events = g_ptr_array_new_full (n_events, g_object_unref);
+
+  for (i = position; i < position + n_events; i++)
+    {
+      DflEvent *view = event_sequence_lookup_view (self, i);
+
+      if (view != NULL)
+        g_ptr_array_add (events, g_object_ref (view));
+      else
+        g_ptr_array_add (events,
+                         _dfl_event_store_new_view (self->store,
+                                                    self->offset + i));
+    }
+
+  return events;
+}
+
+/* Call @func for each event in the sequence in order, starting at @position,
+ * until it returns %FALSE. This does not create a #DflEvent per event, so the
+ * event passed to @func is only valid for the duration of the call unless
+ * @func references it. */
+void
+_dfl_event_sequence_foreach (DflEventSequence            *self,
+                             guint                        position,
+                             DflEventSequenceForeachFunc  func,
+                             gpointer                     user_data)
+{
+  guint i, n_events;
+
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
+  g_return_if_fail (func != NULL);
+
+  n_events = event_sequence_get_n_events (self);
+
+  for (i = position; i < n_events; i++)
+    {
+      if (!func (event_sequence_get_walk_view (self, i), user_data))
+        break;
+    }
+}
+
+/**
+ * dfl_event_sequence_start_walker_group:
+ * @self: a #DflEventSequence
+ *
+ * Start a new walker group. For more information, see
+ * [Walker Groups](#walker-groups).
+ *
+ * It is an error to call this if a walker group has already been started and
+ * has not yet been ended with a call to dfl_event_sequence_end_walker_group().
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_event_sequence_start_walker_group (DflEventSequence *self)
+{
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
+  g_return_if_fail (self->walker_group == NULL);
+
+  self->walker_group = g_array_new (FALSE, FALSE, sizeof (guint));
+}
+
+static void
+remove_walkers_cb (DflEventSequence *sequence,
+                   DflEvent         *event,
+                   gpointer          user_data)
+{
+  GArray/*<guint>*/ *walkers = user_data;  /* owned */
+  gsize i, n_walkers;
+
+  for (i = 0, n_walkers = walkers->len; i < n_walkers; i++)
+    {
+      guint walker_id = g_array_index (walkers, guint, i);
+      dfl_event_sequence_remove_walker (sequence, walker_id);
+    }
+}
+
+/**
+ * dfl_event_sequence_end_walker_group:
+ * @self: a #DflEventSequence
+ * @event_type: event type to trigger removal of the walker group
+ * @id: event ID to trigger removal of the walker group, or %DFL_ID_INVALID to
+ *    match any event ID
+ *
+ * End the current walker group, and add a trigger to remove the walkers in the
+ * group from the #DflEventSequence when an event matching @event_type and @id
+ * is seen. @event_type must be specified; @id is optional. Matching is the same
+ * as with dfl_event_sequence_add_walker().
+ *
+ * It is an error to call this if a walker group is not currently started.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_event_sequence_end_walker_group (DflEventSequence *self,
+                                     const gchar      *event_type,
+                                     DflId             id)
+{
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
+  g_return_if_fail (event_type != NULL);
+  g_return_if_fail (self->walker_group != NULL);
+
+  /* Remove the walkers once the next @event_type is seen which matches @id. */
+  if (self->walker_group->len > 0)
+    {
+      dfl_event_sequence_add_walker (self, event_type, id,
+                                     remove_walkers_cb,
+                                     g_array_ref (self->walker_group),
+                                     (GDestroyNotify) g_array_unref);
+    }
+
+  g_clear_pointer (&self->walker_group, g_array_unref);
+}
+
+/**
+ * dfl_event_sequence_add_walker:
+ * @self: a #DflEventSequence
+ * @event_type: (nullable): event type to match, or %NULL to match all event
+ *    types
+ * @id: event ID to match, or %DFL_ID_INVALID to match all event IDs
+ * @walker: the event walker to add
+ * @user_data: user data to pass to @walker
+ * @destroy_user_data: (nullable): destroy handler for @user_data
+ *
+ * Add a walker to the event sequence, to be called in the next (or current)
+ * call to dfl_event_sequence_walk(). For more information on walkers, see
+ * [the summary](#walkers).
+ *
+ * The @event_type and @id are optional. If @id is specified, @event_type must
+ * be specified. Only events which match both properties (if specified) are
+ * returned to the @walker callback.
+ *
+ * The @user_data is held at least until the walker is removed from the
+ * #DflEventSequence, but may be held longer. @destroy_user_data is called when
+ * the @user_data is no longer needed.
+ *
+ * Returned walker IDs are guaranteed to never be zero, which is not a valid ID.
+ *
+ * Returns: the ID of the walker
+ * Since: UNRELEASED
+ */
+guint
+dfl_event_sequence_add_walker (DflEventSequence *self,
+                               const gchar      *event_type,
+                               DflId             id,
+                               DflEventWalker    walker,
+                               gpointer          user_data,
+                               GDestroyNotify    destroy_user_data)
+{
+  return dfl_event_sequence_add_walker_full (self, event_type, id,
+                                             DFL_EVENT_WALKER_FLAGS_NONE,
+                                             walker, user_data,
+                                             destroy_user_data);
+}
+
+/**
+ * dfl_event_sequence_add_walker_full:
+ * @self: a #DflEventSequence
+ * @event_type: (nullable): event type to match, or %NULL to match all event
+ *    types
+ * @id: event ID to match, or %DFL_ID_INVALID to match all event IDs
+ * @flags: flags affecting how @walker is called
+ * @walker: the event walker to add
+ * @user_data: user data to pass to @walker
+ * @destroy_user_data: (nullable): destroy handler for @user_data
+ *
+ * Version of dfl_event_sequence_add_walker() which takes @flags. If
+ * %DFL_EVENT_WALKER_FLAGS_SHARD_SAFE is set, @id must not be
+ * %DFL_ID_INVALID, as it is used to pick the shard; see
+ * [Sharded Walking](#sharded-walking).
+ *
+ * Returns: the ID of the walker
+ * Since: UNRELEASED
+ */
+guint
+dfl_event_sequence_add_walker_full (DflEventSequence    *self,
+                                    const gchar         *event_type,
+                                    DflId                id,
+                                    DflEventWalkerFlags  flags,
+                                    DflEventWalker       walker,
+                                    gpointer             user_data,
+                                    GDestroyNotify       destroy_user_data)
+{
+  DflEventSequenceWalkerKey key;
+  DflEventSequenceWalkerBucket *bucket;
+  DflEventSequenceWalkerClosure *closure;
+  guint walker_id;
+
+  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self), 0);
+  g_return_val_if_fail (event_type == NULL || *event_type != '\0', 0);
+  g_return_val_if_fail (event_type != NULL || id == DFL_ID_INVALID, 0);
+  g_return_val_if_fail (!(flags & DFL_EVENT_WALKER_FLAGS_SHARD_SAFE) ||
+                        id != DFL_ID_INVALID, 0);
+  g_return_val_if_fail (walker != NULL, 0);
+  g_return_val_if_fail (!self->running_shards, 0);
+
+  key.event_type = g_intern_string (event_type);
+  key.id = id;
+
+  bucket = g_hash_table_lookup (self->walker_buckets, &key);
+
+  if (bucket == NULL)
+    {
+      bucket = g_new0 (DflEventSequenceWalkerBucket, 1);
+      bucket->key = key;
+      bucket->closures = g_ptr_array_new_with_free_func (walker_closure_free);
+      g_hash_table_insert (self->walker_buckets, &bucket->key, bucket);
+    }
+
+  closure = g_new (DflEventSequenceWalkerClosure, 1);
+  closure->walker = walker;
+  closure->user_data = user_data;
+  closure->destroy_user_data = destroy_user_data;
+  closure->flags = flags;
+  closure->bucket = bucket;
+
+  g_ptr_array_add (bucket->closures, closure);
+
+  walker_id = self->next_walker_id++;
+  g_assert (walker_id != 0);
+  g_hash_table_insert (self->walkers, GUINT_TO_POINTER (walker_id), closure);
+
+  if (self->walker_group != NULL)
+    g_array_append_val (self->walker_group, walker_id);
+
+  return walker_id;
+}
+
+/* Drop the tombstones from all the dirty buckets, and free any buckets which
+ * are left empty. This must not be called while dispatching an event. */
+static void
+event_sequence_compact_walkers (DflEventSequence *self)
+{
+  guint i, j;
+
+  for (i = 0; i < self->dirty_buckets->len; i++)
+    {
+      DflEventSequenceWalkerBucket *bucket = self->dirty_buckets->pdata[i];
+
+      for (j = 0; j < bucket->closures->len;)
+        {
+          const DflEventSequenceWalkerClosure *closure;
+
+          closure = bucket->closures->pdata[j];
+
+          if (closure->walker == NULL)
+            g_ptr_array_remove_index (bucket->closures, j);
+          else
+            j++;
+        }
+
+      bucket->dirty = FALSE;
+
+      if (bucket->closures->len == 0)
+        g_hash_table_remove (self->walker_buckets, &bucket->key);
+    }
+
+  g_ptr_array_set_size (self->dirty_buckets, 0);
+}
+
+/**
+ * dfl_event_sequence_remove_walker:
+ * @self: a #DflEventSequence
+ * @walker_id: ID of the walker to remove
+ *
+ * Remove a walker from the #DflEventSequence which was previously added using
+ * dfl_event_sequence_add_walker().
+ *
+ * Removing the same ID twice, either using this function or as part of a walker
+ * group, is an error.
  *
- * TODO
+ * Since: 0.1.0
+ */
+void
+dfl_event_sequence_remove_walker (DflEventSequence *self,
+                                  guint             walker_id)
+{
+  DflEventSequenceWalkerClosure *closure;
+
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
+  g_return_if_fail (walker_id != 0 && walker_id < self->next_walker_id);
+  g_return_if_fail (!self->running_shards);
+
+  closure = g_hash_table_lookup (self->walkers, GUINT_TO_POINTER (walker_id));
+  g_return_if_fail (closure != NULL);
+
+  g_hash_table_remove (self->walkers, GUINT_TO_POINTER (walker_id));
+
+  /* Calls to the walker may still be queued for a shard, so its user data
+   * must be kept alive until the shards have run. */
+  if (self->shards != NULL &&
+      closure->user_data != NULL && closure->destroy_user_data != NULL)
+    {
+      DflEventSequenceDeferredDestroy deferred;
+
+      deferred.destroy_user_data = closure->destroy_user_data;
+      deferred.user_data = closure->user_data;
+      g_array_append_val (self->deferred_destroys, deferred);
+
+      closure->destroy_user_data = NULL;
+    }
+
+  /* Leave a tombstone in the bucket, as it may be being iterated over; it is
+   * reclaimed once the current event has been dispatched. */
+  walker_closure_clear (closure);
+
+  if (!closure->bucket->dirty)
+    {
+      closure->bucket->dirty = TRUE;
+      g_ptr_array_add (self->dirty_buckets, closure->bucket);
+    }
+
+  if (!self->walking)
+    event_sequence_compact_walkers (self);
+}
+
+/**
+ * dfl_event_sequence_get_atom_table:
+ * @self: a #DflEventSequence
+ *
+ * Get the #DflAtomTable which objects built from this sequence, such as
+ * #DflSources and #DflTasks, use to intern their names. Atoms from the table
+ * may be compared between all of those objects.
+ *
+ * Returns: (transfer none): the sequence’s atom table
+ * Since: UNRELEASED
+ */
+DflAtomTable *
+dfl_event_sequence_get_atom_table (DflEventSequence *self)
+{
+  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self), NULL);
+
+  return self->atom_table;
+}
+
+/* IDs are typically pointers, so their low bits are mostly zero. Mix them
+ * before picking a shard. */
+static guint
+shard_for_id (DflId id,
+              guint n_shards)
+{
+  return (guint) (((guint64) id * G_GUINT64_CONSTANT (0x9e3779b97f4a7c15)) >>
+                  32) % n_shards;
+}
+
+/* Call all the walkers in the bucket for @event_type and @id, if there is one.
+ * Walkers added to the bucket by the callbacks are not called until the next
+ * event. If a sharded walk is in progress, calls to shard-safe walkers are
+ * queued for their shard instead. */
+static void
+event_sequence_dispatch_bucket (DflEventSequence *self,
+                                const gchar      *event_type,
+                                DflId             id,
+                                guint             position,
+                                DflEvent         *event)
+{
+  DflEventSequenceWalkerKey key = { event_type, id };
+  DflEventSequenceWalkerBucket *bucket;
+  guint i, n_closures;
+
+  bucket = g_hash_table_lookup (self->walker_buckets, &key);
+
+  if (bucket == NULL)
+    return;
+
+  for (i = 0, n_closures = bucket->closures->len; i < n_closures; i++)
+    {
+      const DflEventSequenceWalkerClosure *closure;
+
+      closure = bucket->closures->pdata[i];
+
+      /* Has the walker been removed? */
+      if (closure->walker == NULL)
+        continue;
+
+      if (self->shards != NULL &&
+          (closure->flags & DFL_EVENT_WALKER_FLAGS_SHARD_SAFE))
+        {
+          DflEventSequenceShardItem item;
+          DflEventSequenceShard *shard;
+
+          item.position = position;
+          item.walker = closure->walker;
+          item.user_data = closure->user_data;
+
+          shard = &self->shards[shard_for_id (id, self->n_shards)];
+          g_array_append_val (shard->items, item);
+          self->n_queued_items++;
+        }
+      else
+        {
+          closure->walker (self, event, closure->user_data);
+        }
+    }
+}
+
+/* Worker thread function which makes all the queued walker calls for one
+ * shard, in order. Each shard has its own view, so it doesn’t race with the
+ * other shards or the calling thread. */
+static void
+run_shard_cb (gpointer data,
+              gpointer user_data)
+{
+  DflEventSequenceShard *shard = data;
+  DflEventSequence *self = shard->sequence;
+  guint i;
+
+  for (i = 0; i < shard->items->len; i++)
+    {
+      const DflEventSequenceShardItem *item;
+      DflEvent *event;
+
+      item = &g_array_index (shard->items, DflEventSequenceShardItem, i);
+
+      /* This only reads the cached views, which are not modified while the
+       * shards are running. */
+      event = event_sequence_lookup_view (self, item->position);
+
+      if (event == NULL)
+        {
+          if (shard->view != NULL &&
+              g_atomic_int_get (&G_OBJECT (shard->view)->ref_count) > 1)
+            g_clear_object (&shard->view);
+
+          if (shard->view == NULL)
+            shard->view = _dfl_event_store_new_view (self->store,
+                                                     self->offset +
+                                                     item->position);
+          else
+            _dfl_event_store_update_view (self->store,
+                                          self->offset + item->position,
+                                          shard->view);
+
+          event = shard->view;
+        }
+
+      item->walker (self, event, item->user_data);
+    }
+
+  g_array_set_size (shard->items, 0);
+}
+
+/* Make all the walker calls which have been queued for the shards, then
+ * release the user data of any walkers which were removed meanwhile. */
+static void
+event_sequence_run_shards (DflEventSequence *self)
+{
+  GThreadPool *pool = NULL;
+  guint i;
+
+  if (self->n_queued_items > 0)
+    {
+      self->running_shards = TRUE;
+
+      pool = g_thread_pool_new (run_shard_cb, NULL, self->n_shards, FALSE,
+                                NULL);
+
+      for (i = 0; i < self->n_shards; i++)
+        {
+          if (self->shards[i].items->len > 0)
+            g_thread_pool_push (pool, &self->shards[i], NULL);
+        }
+
+      g_thread_pool_free (pool, FALSE, TRUE);
+
+      self->running_shards = FALSE;
+      self->n_queued_items = 0;
+    }
+
+  for (i = 0; i < self->deferred_destroys->len; i++)
+    {
+      const DflEventSequenceDeferredDestroy *deferred;
+
+      deferred = &g_array_index (self->deferred_destroys,
+                                 DflEventSequenceDeferredDestroy, i);
+      deferred->destroy_user_data (deferred->user_data);
+    }
+
+  g_array_set_size (self->deferred_destroys, 0);
+}
+
+/**
+ * dfl_event_sequence_walk:
+ * @self: a #DflEventSequence
+ *
+ * Walk over the events in the sequence, in order, calling all the installed
+ * walkers which match each event. See [the summary](#walkers).
  *
  * It is allowed to add and remove walkers from callbacks within this function.
  *
@@ -409,36 +1612,423 @@ dfl_event_sequence_remove_walker (DflEventSequence *self,
 void
 dfl_event_sequence_walk (DflEventSequence *self)
 {
-  guint i, j;
+  dfl_event_sequence_walk_sharded (self, 1);
+}
+
+/**
+ * dfl_event_sequence_walk_sharded:
+ * @self: a #DflEventSequence
+ * @n_shards: number of shards to split shard-safe walkers between, or 0 to
+ *    use one per processor
+ *
+ * Version of dfl_event_sequence_walk() which calls walkers added with
+ * %DFL_EVENT_WALKER_FLAGS_SHARD_SAFE from @n_shards worker threads, as
+ * described in [Sharded Walking](#sharded-walking). If @n_shards is 1, this
+ * is equivalent to dfl_event_sequence_walk().
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_event_sequence_walk_sharded (DflEventSequence *self,
+                                 guint             n_shards)
+{
+  guint i, n_events;
 
   g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self));
+  g_return_if_fail (!self->walking && self->shards == NULL);
 
-  if (self->walkers->len == 0)
+  if (g_hash_table_size (self->walkers) == 0)
     return;
 
-  for (i = 0; i < self->n_events; i++)
+  if (n_shards == 0)
+    n_shards = g_get_num_processors ();
+
+  if (n_shards > 1)
     {
-      DflEvent *event = self->events[i];
+      self->n_shards = n_shards;
+      self->shards = g_new0 (DflEventSequenceShard, n_shards);
 
-      for (j = 0; j < self->walkers->len; j++)
+      for (i = 0; i < n_shards; i++)
         {
-          const DflEventSequenceWalkerClosure *closure;
+          self->shards[i].sequence = self;
+          self->shards[i].items =
+              g_array_new (FALSE, FALSE, sizeof (DflEventSequenceShardItem));
+        }
+
+      self->deferred_destroys =
+          g_array_new (FALSE, FALSE, sizeof (DflEventSequenceDeferredDestroy));
+    }
 
-          closure = &g_array_index (self->walkers,
-                                    DflEventSequenceWalkerClosure, j);
+  n_events = event_sequence_get_n_events (self);
 
-          /* Has the walker been removed? */
-          if (closure->walker == NULL)
+  for (i = 0; i < n_events; i++)
+    {
+      DflEvent *event = event_sequence_get_walk_view (self, i);
+      const gchar *event_type;
+      DflId event_id;
+
+      /* The parameters are decoded when loading, so the ID can be read
+       * directly rather than parsed for each walker. */
+      event_type = dfl_event_get_event_type (event);
+      event_id = _dfl_event_store_get_id (self->store, self->offset + i);
+
+      self->walking = TRUE;
+
+      /* FIXME: Having the ID hard-coded in index 0 is a bit icky. */
+      event_sequence_dispatch_bucket (self, NULL, DFL_ID_INVALID, i, event);
+      event_sequence_dispatch_bucket (self, event_type, DFL_ID_INVALID, i,
+                                      event);
+
+      if (event_id != DFL_ID_INVALID)
+        event_sequence_dispatch_bucket (self, event_type, event_id, i, event);
+
+      self->walking = FALSE;
+
+      if (self->dirty_buckets->len > 0)
+        event_sequence_compact_walkers (self);
+
+      if (self->shards != NULL && self->n_queued_items >= SHARD_WINDOW_SIZE)
+        event_sequence_run_shards (self);
+
+      if (g_hash_table_size (self->walkers) == 0)
+        break;
+    }
+
+  if (self->shards != NULL)
+    {
+      event_sequence_run_shards (self);
+
+      for (i = 0; i < self->n_shards; i++)
+        {
+          g_array_unref (self->shards[i].items);
+          g_clear_object (&self->shards[i].view);
+        }
+
+      g_clear_pointer (&self->shards, g_free);
+      g_clear_pointer (&self->deferred_destroys, g_array_unref);
+      self->n_shards = 0;
+    }
+}
+
+static guint
+posting_key_hash (gconstpointer key)
+{
+  const DflEventSequencePostingKey *k = key;
+
+  return k->code ^ g_direct_hash ((gpointer) k->id);
+}
+
+static gboolean
+posting_key_equal (gconstpointer a,
+                   gconstpointer b)
+{
+  const DflEventSequencePostingKey *k1 = a, *k2 = b;
+
+  return (k1->code == k2->code && k1->id == k2->id);
+}
+
+/* Get the posting list of all the events with event type @code, building the
+ * lists for all event types in a single pass over the sequence if needed.
+ *
+ * A slice shares its parent’s store, so event types may be added to the store
+ * after the slice’s lists were built, by appending to the parent. The slice
+ * cannot contain any events of those types, so %NULL is returned for them. */
+static const GArray *
+event_sequence_get_type_postings (DflEventSequence *self,
+                                  guint             code)
+{
+  if (self->type_postings == NULL)
+    {
+      guint i, n_codes, n_events;
+
+      n_codes = self->store->event_type_table->len;
+      n_events = event_sequence_get_n_events (self);
+
+      self->type_postings = g_ptr_array_new_full (n_codes,
+                                                  (GDestroyNotify) g_array_unref);
+
+      for (i = 0; i < n_codes; i++)
+        g_ptr_array_add (self->type_postings,
+                         g_array_new (FALSE, FALSE, sizeof (guint)));
+
+      for (i = 0; i < n_events; i++)
+        {
+          guint16 event_code;
+
+          event_code = g_array_index (self->store->event_types, guint16,
+                                      self->offset + i);
+          g_array_append_val (self->type_postings->pdata[event_code], i);
+        }
+    }
+
+  if (code >= self->type_postings->len)
+    return NULL;
+
+  return self->type_postings->pdata[code];
+}
+
+/* Get the posting list of all the events with event type @code and ID @id,
+ * building the lists for all IDs of that event type in a single pass over its
+ * posting list if needed. Returns %NULL if there are no such events. */
+static const GArray *
+event_sequence_get_id_postings (DflEventSequence *self,
+                                guint             code,
+                                DflId             id)
+{
+  DflEventSequencePostingKey key = { code, id };
+
+  if (self->id_postings == NULL)
+    {
+      self->id_postings = g_hash_table_new_full (posting_key_hash,
+                                                 posting_key_equal, g_free,
+                                                 (GDestroyNotify) g_array_unref);
+      self->id_postings_built = g_array_new (FALSE, TRUE, sizeof (gboolean));
+      g_array_set_size (self->id_postings_built,
+                        self->store->event_type_table->len);
+    }
+
+  /* Event types added to the store since the lists were built (see
+   * event_sequence_get_type_postings()) have no events in this sequence. */
+  if (code >= self->id_postings_built->len)
+    return NULL;
+
+  if (!g_array_index (self->id_postings_built, gboolean, code))
+    {
+      const GArray *type_postings;
+      guint i;
+
+      type_postings = event_sequence_get_type_postings (self, code);
+
+      if (type_postings == NULL)
+        return NULL;
+
+      for (i = 0; i < type_postings->len; i++)
+        {
+          guint position = g_array_index (type_postings, guint, i);
+          DflEventSequencePostingKey lookup_key;
+          GArray/*<guint>*/ *postings;
+
+          lookup_key.code = code;
+          lookup_key.id = _dfl_event_store_get_id (self->store,
+                                                   self->offset + position);
+
+          if (lookup_key.id == DFL_ID_INVALID)
             continue;
 
-          /* FIXME: Having the ID hard-coded in index 0 is a bit icky. */
-          if ((closure->event_type == NULL ||
-               closure->event_type == dfl_event_get_event_type (event)) &&
-              (closure->id == DFL_ID_INVALID ||
-               closure->id == dfl_event_get_parameter_id (event, 0)))
+          postings = g_hash_table_lookup (self->id_postings, &lookup_key);
+
+          if (postings == NULL)
             {
-              closure->walker (self, event, closure->user_data);
+              DflEventSequencePostingKey *new_key;
+
+              new_key = g_new (DflEventSequencePostingKey, 1);
+              *new_key = lookup_key;
+
+              postings = g_array_new (FALSE, FALSE, sizeof (guint));
+              g_hash_table_insert (self->id_postings, new_key, postings);
             }
+
+          g_array_append_val (postings, position);
         }
+
+      g_array_index (self->id_postings_built, gboolean, code) = TRUE;
+    }
+
+  return g_hash_table_lookup (self->id_postings, &key);
+}
+
+/**
+ * dfl_event_sequence_iter_init:
+ * @iter: an uninitialised #DflEventSequenceIter
+ * @sequence: the #DflEventSequence to iterate over
+ * @event_type: (nullable): event type to match, or %NULL to match all events
+ * @id: event ID to match, or %DFL_ID_INVALID to match all event IDs
+ *
+ * Initialise @iter to iterate over the events in @sequence which match
+ * @event_type and @id, in order. As with dfl_event_sequence_add_walker(), if
+ * @id is specified, @event_type must be specified. See
+ * [Indexed Iteration](#indexed-iteration).
+ *
+ * The iterator is invalidated if events are appended to @sequence.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_event_sequence_iter_init (DflEventSequenceIter *iter,
+                              DflEventSequence     *sequence,
+                              const gchar          *event_type,
+                              DflId                 id)
+{
+  DflEventSequenceIterReal *self = (DflEventSequenceIterReal *) iter;
+  gpointer code_ptr;
+  const GArray *postings;
+
+  g_return_if_fail (iter != NULL);
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (sequence));
+  g_return_if_fail (event_type == NULL || *event_type != '\0');
+  g_return_if_fail (event_type != NULL || id == DFL_ID_INVALID);
+
+  self->sequence = sequence;
+  self->positions = NULL;
+  self->n_positions = 0;
+  self->index = 0;
+
+  if (event_type == NULL)
+    {
+      self->n_positions = event_sequence_get_n_events (sequence);
+      return;
+    }
+
+  code_ptr = g_hash_table_lookup (sequence->store->event_type_codes,
+                                  g_intern_string (event_type));
+
+  /* No events of this type? */
+  if (code_ptr == NULL)
+    return;
+
+  if (id == DFL_ID_INVALID)
+    postings = event_sequence_get_type_postings (sequence,
+                                                 GPOINTER_TO_UINT (code_ptr) - 1);
+  else
+    postings = event_sequence_get_id_postings (sequence,
+                                               GPOINTER_TO_UINT (code_ptr) - 1,
+                                               id);
+
+  if (postings != NULL && postings->len > 0)
+    {
+      self->positions = (const guint *) postings->data;
+      self->n_positions = postings->len;
+    }
+}
+
+static guint
+event_sequence_iter_get_position (DflEventSequenceIterReal *self,
+                                  guint                     index)
+{
+  return (self->positions != NULL) ? self->positions[index] : index;
+}
+
+static DflTimestamp
+event_sequence_iter_get_timestamp (DflEventSequenceIterReal *self,
+                                   guint                     index)
+{
+  return g_array_index (self->sequence->store->timestamps, DflTimestamp,
+                        self->sequence->offset +
+                        event_sequence_iter_get_position (self, index));
+}
+
+/**
+ * dfl_event_sequence_iter_next:
+ * @iter: a #DflEventSequenceIter
+ * @position: (out caller-allocates) (optional): return location for the
+ *    position of the next matching event in the sequence
+ * @timestamp: (out caller-allocates) (optional): return location for the
+ *    timestamp of the next matching event
+ *
+ * Advance @iter to the next matching event and return its position and
+ * timestamp. The #DflEvent itself can be retrieved using
+ * g_list_model_get_item() with the position.
+ *
+ * Returns: %TRUE if there was another matching event, %FALSE otherwise
+ * Since: UNRELEASED
+ */
+gboolean
+dfl_event_sequence_iter_next (DflEventSequenceIter *iter,
+                              guint                *position,
+                              DflTimestamp         *timestamp)
+{
+  DflEventSequenceIterReal *self = (DflEventSequenceIterReal *) iter;
+
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self->sequence), FALSE);
+
+  /* Reached the end? */
+  if (self->index >= self->n_positions)
+    return FALSE;
+
+  if (position != NULL)
+    *position = event_sequence_iter_get_position (self, self->index);
+  if (timestamp != NULL)
+    *timestamp = event_sequence_iter_get_timestamp (self, self->index);
+
+  self->index++;
+
+  return TRUE;
+}
+
+/**
+ * dfl_event_sequence_iter_skip_to_timestamp:
+ * @iter: a #DflEventSequenceIter
+ * @timestamp: timestamp to skip to
+ *
+ * Advance @iter so that the next call to dfl_event_sequence_iter_next()
+ * returns the first remaining matching event whose timestamp is greater than
+ * or equal to @timestamp. The iterator never moves backwards.
+ *
+ * This uses an exponential search from the current position, so skipping over
+ * n events takes O(log n) time.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_event_sequence_iter_skip_to_timestamp (DflEventSequenceIter *iter,
+                                           DflTimestamp          timestamp)
+{
+  DflEventSequenceIterReal *self = (DflEventSequenceIterReal *) iter;
+  guint low, high, step;
+
+  g_return_if_fail (iter != NULL);
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (self->sequence));
+
+  if (self->index >= self->n_positions ||
+      event_sequence_iter_get_timestamp (self, self->index) >= timestamp)
+    return;
+
+  /* Gallop forwards to find an upper bound, then binary search within it.
+   * Invariant: the timestamp at @low is < @timestamp. */
+  low = self->index;
+  step = 1;
+
+  while (low + step < self->n_positions &&
+         event_sequence_iter_get_timestamp (self, low + step) < timestamp)
+    {
+      low += step;
+      step *= 2;
+    }
+
+  high = MIN (low + step, self->n_positions);
+
+  while (high - low > 1)
+    {
+      guint mid = low + (high - low) / 2;
+
+      if (event_sequence_iter_get_timestamp (self, mid) < timestamp)
+        low = mid;
+      else
+        high = mid;
     }
+
+  self->index = high;
+}
+
+/**
+ * dfl_event_sequence_iter_get_n_remaining:
+ * @iter: a #DflEventSequenceIter
+ *
+ * Get the number of matching events which have not yet been returned by
+ * dfl_event_sequence_iter_next(). This is cheap, so can be used to count the
+ * events of a given type or ID.
+ *
+ * Returns: number of remaining matching events
+ * Since: UNRELEASED
+ */
+guint
+dfl_event_sequence_iter_get_n_remaining (DflEventSequenceIter *iter)
+{
+  DflEventSequenceIterReal *self = (DflEventSequenceIterReal *) iter;
+
+  g_return_val_if_fail (iter != NULL, 0);
+  g_return_val_if_fail (DFL_IS_EVENT_SEQUENCE (self->sequence), 0);
+
+  return self->n_positions - self->index;
 }
@@ -23,6 +23,7 @@
 #include <glib-object.h>
 #include <gio/gio.h>
 
+#include "atom-table.h"
 #include "event.h"
 
 G_BEGIN_DECLS
@@ -41,6 +42,22 @@ DflEventSequence *dfl_event_sequence_new (const DflEvent **events,
                                           guint            n_events,
                                           DflTimestamp     initial_timestamp);
 
+DflEventSequence *dfl_event_sequence_new_merged (DflEventSequence    **sequences,
+                                                 const gchar * const  *process_names,
+                                                 guint                 n_sequences);
+
+guint        dfl_event_sequence_get_n_processes  (DflEventSequence *self);
+const gchar *dfl_event_sequence_get_process_name (DflEventSequence *self,
+                                                  guint             process);
+
+DflEventSequence *dfl_event_sequence_slice (DflEventSequence *self,
+                                            DflTimestamp      start,
+                                            DflTimestamp      end);
+
+void dfl_event_sequence_append (DflEventSequence  *self,
+                                const DflEvent   **events,
+                                guint              n_events);
+
 /**
  * DflEventWalker:
  * @sequence: a #DflEventSequence
@@ -59,6 +76,24 @@ typedef void (*DflEventWalker) (DflEventSequence *sequence,
                                 DflEvent         *event,
                                 gpointer          user_data);
 
+/**
+ * DflEventWalkerFlags:
+ * @DFL_EVENT_WALKER_FLAGS_NONE: no flags set
+ * @DFL_EVENT_WALKER_FLAGS_SHARD_SAFE: the walker only touches state belonging
+ *    to the object identified by its ID, so may be called from a worker thread
+ *    in parallel with walkers for other IDs; see
+ *    dfl_event_sequence_walk_sharded()
+ *
+ * Flags affecting how a walker is called.
+ *
+ * Since: UNRELEASED
+ */
+typedef enum
+{
+  DFL_EVENT_WALKER_FLAGS_NONE = 0,
+  DFL_EVENT_WALKER_FLAGS_SHARD_SAFE = (1 << 0),
+} DflEventWalkerFlags;
+
 void  dfl_event_sequence_start_walker_group (DflEventSequence *self);
 void  dfl_event_sequence_end_walker_group   (DflEventSequence *self,
                                              const gchar      *event_type,
@@ -70,10 +105,45 @@ guint dfl_event_sequence_add_walker    (DflEventSequence *self,
                                         DflEventWalker    walker,
                                         gpointer          user_data,
                                         GDestroyNotify    destroy_user_data);
+guint dfl_event_sequence_add_walker_full (DflEventSequence    *self,
+                                          const gchar         *event_type,
+                                          DflId                id,
+                                          DflEventWalkerFlags  flags,
+                                          DflEventWalker       walker,
+                                          gpointer             user_data,
+                                          GDestroyNotify       destroy_user_data);
 void  dfl_event_sequence_remove_walker (DflEventSequence *self,
                                         guint             walker_id);
 
 void  dfl_event_sequence_walk          (DflEventSequence *self);
+void  dfl_event_sequence_walk_sharded  (DflEventSequence *self,
+                                        guint             n_shards);
+
+DflAtomTable *dfl_event_sequence_get_atom_table (DflEventSequence *self);
+
+/**
+ * DflEventSequenceIter:
+ *
+ * All the fields in this structure are private. Use
+ * dfl_event_sequence_iter_init() to initialise an already-allocated iterator.
+ *
+ * Since: UNRELEASED
+ */
+typedef struct
+{
+  gpointer dummy[4];
+} DflEventSequenceIter;
+
+void     dfl_event_sequence_iter_init              (DflEventSequenceIter *iter,
+                                                    DflEventSequence     *sequence,
+                                                    const gchar          *event_type,
+                                                    DflId                 id);
+gboolean dfl_event_sequence_iter_next              (DflEventSequenceIter *iter,
+                                                    guint                *position,
+                                                    DflTimestamp         *timestamp);
+void     dfl_event_sequence_iter_skip_to_timestamp (DflEventSequenceIter *iter,
+                                                    DflTimestamp          timestamp);
+guint    dfl_event_sequence_iter_get_n_remaining   (DflEventSequenceIter *iter);
 
 G_END_DECLS
 
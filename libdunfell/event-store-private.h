@@ -0,0 +1,103 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_EVENT_STORE_PRIVATE_H
+#define DFL_EVENT_STORE_PRIVATE_H
+
+#include <glib.h>
+
+#include "arena-private.h"
+#include "event.h"
+#include "event-private.h"
+
+G_BEGIN_DECLS
+
+/* Columnar storage for a list of events: one array per event field, indexed
+ * by the event’s position, plus an arena of decoded parameters (see
+ * #DflEventParameters). This costs around 29 bytes per event plus 8 bytes per
+ * parameter and the length of any string parameters, rather than a #GObject
+ * and several allocations per event. #DflEvent objects are only created as
+ * views onto the store when needed, using _dfl_event_store_new_view().
+ *
+ * Event types are stored as indices into a per-store table of interned event
+ * types. */
+typedef struct
+{
+  GArray/*<DflTimestamp>*/ *timestamps;  /* owned */
+  GArray/*<DflThreadId>*/ *thread_ids;  /* owned */
+  GArray/*<guint16>*/ *event_types;  /* owned; indices into @event_type_table */
+  GArray/*<guint8>*/ *n_parameters;  /* owned */
+  GArray/*<guint8>*/ *string_masks;  /* owned */
+  GArray/*<guint8>*/ *invalid_masks;  /* owned */
+  GArray/*<unowned DflEventParameter *>*/ *parameters;  /* owned; into @arena */
+
+  GPtrArray/*<unowned utf8>*/ *event_type_table;  /* owned; interned strings */
+  GHashTable/*<unowned utf8, guint>*/ *event_type_codes;  /* owned; code + 1 */
+
+  DflArena *arena;  /* owned */
+} DflEventStore;
+
+void _dfl_event_store_init  (DflEventStore *store);
+void _dfl_event_store_clear (DflEventStore *store);
+
+guint _dfl_event_store_get_n_events (const DflEventStore *store);
+DflId _dfl_event_store_get_id       (const DflEventStore *store,
+                                     guint                index);
+
+void _dfl_event_store_add       (DflEventStore       *store,
+                                 const gchar         *event_type,
+                                 DflTimestamp         timestamp,
+                                 DflThreadId          thread_id,
+                                 const DflEventField *parameters,
+                                 gsize                n_parameters);
+void _dfl_event_store_add_decoded (DflEventStore           *store,
+                                   const gchar             *event_type,
+                                   DflTimestamp             timestamp,
+                                   DflThreadId              thread_id,
+                                   const DflEventParameter *values,
+                                   gsize                    n_parameters,
+                                   guint8                   string_mask);
+const gchar *_dfl_event_store_add_string (DflEventStore *store,
+                                          const gchar   *data,
+                                          gsize          length);
+void _dfl_event_store_add_event (DflEventStore       *store,
+                                 DflEvent            *event);
+void _dfl_event_store_take      (DflEventStore       *store,
+                                 DflEventStore       *other);
+void _dfl_event_store_add_tagged (DflEventStore       *store,
+                                  DflEventStore       *other,
+                                  guint                index,
+                                  guint                process,
+                                  guint8               id_mask);
+void _dfl_event_store_move_tagged (DflEventStore      *store,
+                                   DflEventStore      *other,
+                                   guint               index,
+                                   guint               process,
+                                   guint8              id_mask);
+void _dfl_event_store_absorb     (DflEventStore       *store,
+                                  DflEventStore       *other);
+
+DflEvent *_dfl_event_store_new_view    (DflEventStore *store,
+                                        guint          index);
+void      _dfl_event_store_update_view (DflEventStore *store,
+                                        guint          index,
+                                        DflEvent      *view);
+
+G_END_DECLS
+
+#endif /* !DFL_EVENT_STORE_PRIVATE_H */
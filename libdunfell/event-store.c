@@ -0,0 +1,451 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "arena-private.h"
+#include "event.h"
+#include "event-private.h"
+#include "event-store-private.h"
+
+
+/* Allocate @length bytes for decoded parameters from the #DflArena in
+ * @user_data. */
+static gpointer
+event_store_alloc_cb (gsize    length,
+                      gpointer user_data)
+{
+  return _dfl_arena_alloc (user_data, length);
+}
+
+void
+_dfl_event_store_init (DflEventStore *store)
+{
+  store->timestamps = g_array_new (FALSE, FALSE, sizeof (DflTimestamp));
+  store->thread_ids = g_array_new (FALSE, FALSE, sizeof (DflThreadId));
+  store->event_types = g_array_new (FALSE, FALSE, sizeof (guint16));
+  store->n_parameters = g_array_new (FALSE, FALSE, sizeof (guint8));
+  store->string_masks = g_array_new (FALSE, FALSE, sizeof (guint8));
+  store->invalid_masks = g_array_new (FALSE, FALSE, sizeof (guint8));
+  store->parameters = g_array_new (FALSE, FALSE,
+                                   sizeof (const DflEventParameter *));
+
+  store->event_type_table = g_ptr_array_new ();
+  store->event_type_codes = g_hash_table_new (NULL, NULL);
+
+  store->arena = _dfl_arena_new ();
+}
+
+void
+_dfl_event_store_clear (DflEventStore *store)
+{
+  g_clear_pointer (&store->arena, _dfl_arena_unref);
+
+  g_clear_pointer (&store->event_type_codes, g_hash_table_unref);
+  g_clear_pointer (&store->event_type_table, g_ptr_array_unref);
+
+  g_clear_pointer (&store->parameters, g_array_unref);
+  g_clear_pointer (&store->invalid_masks, g_array_unref);
+  g_clear_pointer (&store->string_masks, g_array_unref);
+  g_clear_pointer (&store->n_parameters, g_array_unref);
+  g_clear_pointer (&store->event_types, g_array_unref);
+  g_clear_pointer (&store->thread_ids, g_array_unref);
+  g_clear_pointer (&store->timestamps, g_array_unref);
+}
+
+guint
+_dfl_event_store_get_n_events (const DflEventStore *store)
+{
+  return store->timestamps->len;
+}
+
+/* Get the ID of the event at @index in @store: its first parameter, or
+ * %DFL_ID_INVALID if it has no parameters or the first is a string. */
+DflId
+_dfl_event_store_get_id (const DflEventStore *store,
+                         guint                index)
+{
+  const DflEventParameter *values;
+
+  if (g_array_index (store->n_parameters, guint8, index) == 0 ||
+      (g_array_index (store->string_masks, guint8, index) & 1))
+    return DFL_ID_INVALID;
+
+  values = g_array_index (store->parameters, const DflEventParameter *, index);
+
+  return values[0].id;
+}
+
+/* Get the code for @event_type (which must be interned) in @store, adding it
+ * to the store’s table if needed. */
+static guint16
+event_store_get_event_type_code (DflEventStore *store,
+                                 const gchar   *event_type)
+{
+  gpointer code_ptr;
+  guint16 code;
+
+  code_ptr = g_hash_table_lookup (store->event_type_codes, event_type);
+
+  if (code_ptr != NULL)
+    return GPOINTER_TO_UINT (code_ptr) - 1;
+
+  g_assert (store->event_type_table->len < G_MAXUINT16);
+
+  code = store->event_type_table->len;
+  g_ptr_array_add (store->event_type_table, (gpointer) event_type);
+  g_hash_table_insert (store->event_type_codes, (gpointer) event_type,
+                       GUINT_TO_POINTER (code + 1));
+
+  return code;
+}
+
+static void
+event_store_append (DflEventStore            *store,
+                    const gchar              *event_type,
+                    DflTimestamp              timestamp,
+                    DflThreadId               thread_id,
+                    const DflEventParameters *parameters)
+{
+  guint16 code;
+
+  code = event_store_get_event_type_code (store, event_type);
+
+  g_array_append_val (store->timestamps, timestamp);
+  g_array_append_val (store->thread_ids, thread_id);
+  g_array_append_val (store->event_types, code);
+  g_array_append_val (store->n_parameters, parameters->n_parameters);
+  g_array_append_val (store->string_masks, parameters->string_mask);
+  g_array_append_val (store->invalid_masks, parameters->invalid_mask);
+  g_array_append_val (store->parameters, parameters->values);
+}
+
+/* Add an event to the end of @store, decoding @parameters (which are not
+ * nul-terminated) into the store’s arena. @event_type must be interned. */
+void
+_dfl_event_store_add (DflEventStore       *store,
+                      const gchar         *event_type,
+                      DflTimestamp         timestamp,
+                      DflThreadId          thread_id,
+                      const DflEventField *parameters,
+                      gsize                n_parameters)
+{
+  DflEventParameters decoded;
+
+  g_return_if_fail (event_type != NULL);
+  g_return_if_fail (n_parameters == 0 || parameters != NULL);
+  g_return_if_fail (n_parameters <= DFL_EVENT_MAX_PARAMETERS);
+
+  _dfl_event_parameters_decode (parameters, n_parameters,
+                                event_store_alloc_cb, store->arena, &decoded);
+  event_store_append (store, event_type, timestamp, thread_id, &decoded);
+}
+
+/* Add an event whose parameters have already been decoded to the end of
+ * @store. Only @values is copied: string parameters (marked in @string_mask)
+ * must be nul-terminated, valid UTF-8 and owned by @store, and are shared
+ * between all the events which use them. Strings can be added to the store
+ * using _dfl_event_store_add_string(). @event_type must be interned. */
+void
+_dfl_event_store_add_decoded (DflEventStore           *store,
+                              const gchar             *event_type,
+                              DflTimestamp             timestamp,
+                              DflThreadId              thread_id,
+                              const DflEventParameter *values,
+                              gsize                    n_parameters,
+                              guint8                   string_mask)
+{
+  DflEventParameters decoded;
+  DflEventParameter *copied = NULL;
+
+  g_return_if_fail (event_type != NULL);
+  g_return_if_fail (n_parameters == 0 || values != NULL);
+  g_return_if_fail (n_parameters <= DFL_EVENT_MAX_PARAMETERS);
+
+  if (n_parameters > 0)
+    {
+      copied = _dfl_arena_alloc (store->arena,
+                                 n_parameters * sizeof (DflEventParameter));
+      memcpy (copied, values, n_parameters * sizeof (DflEventParameter));
+    }
+
+  decoded.values = copied;
+  decoded.n_parameters = n_parameters;
+  decoded.string_mask = string_mask;
+  decoded.invalid_mask = 0;
+
+  event_store_append (store, event_type, timestamp, thread_id, &decoded);
+}
+
+/* Copy @length bytes of @data into @store as a nul-terminated string, for use
+ * as a parameter with _dfl_event_store_add_decoded(). @data must be valid
+ * UTF-8 with no embedded nuls. */
+const gchar *
+_dfl_event_store_add_string (DflEventStore *store,
+                             const gchar   *data,
+                             gsize          length)
+{
+  return _dfl_arena_strndup (store->arena, data, length);
+}
+
+/* Add a copy of @event to the end of @store. */
+void
+_dfl_event_store_add_event (DflEventStore *store,
+                            DflEvent      *event)
+{
+  DflEventParameters copied;
+
+  g_return_if_fail (DFL_IS_EVENT (event));
+
+  _dfl_event_parameters_copy (_dfl_event_get_parameters (event),
+                              event_store_alloc_cb, store->arena, &copied);
+  event_store_append (store, dfl_event_get_event_type (event),
+                      dfl_event_get_timestamp (event),
+                      dfl_event_get_thread_id (event), &copied);
+}
+
+/* Move all the events from @other to the end of @store, leaving @other empty.
+ * This is cheap, as the parameters are not copied. There must be no views onto
+ * @other. */
+void
+_dfl_event_store_take (DflEventStore *store,
+                       DflEventStore *other)
+{
+  guint16 *codes;
+  gboolean codes_match = TRUE;
+  guint i, n_events;
+
+  g_return_if_fail (store != other);
+
+  n_events = _dfl_event_store_get_n_events (other);
+
+  if (n_events == 0)
+    return;
+
+  /* Map @other’s event type codes to @store’s. */
+  codes = g_new (guint16, other->event_type_table->len);
+
+  for (i = 0; i < other->event_type_table->len; i++)
+    {
+      codes[i] = event_store_get_event_type_code (store,
+                                                  other->event_type_table->pdata[i]);
+      codes_match = codes_match && (codes[i] == i);
+    }
+
+  if (codes_match)
+    {
+      g_array_append_vals (store->event_types, other->event_types->data,
+                           n_events);
+    }
+  else
+    {
+      for (i = 0; i < n_events; i++)
+        {
+          guint16 code = codes[g_array_index (other->event_types, guint16, i)];
+          g_array_append_val (store->event_types, code);
+        }
+    }
+
+  g_free (codes);
+
+  g_array_append_vals (store->timestamps, other->timestamps->data, n_events);
+  g_array_append_vals (store->thread_ids, other->thread_ids->data, n_events);
+  g_array_append_vals (store->n_parameters, other->n_parameters->data,
+                       n_events);
+  g_array_append_vals (store->string_masks, other->string_masks->data,
+                       n_events);
+  g_array_append_vals (store->invalid_masks, other->invalid_masks->data,
+                       n_events);
+  g_array_append_vals (store->parameters, other->parameters->data, n_events);
+
+  _dfl_event_store_absorb (store, other);
+}
+
+/* Get the decoded parameters of the event at @index in @store. */
+static void
+event_store_get_parameters (DflEventStore      *store,
+                            guint               index,
+                            DflEventParameters *out)
+{
+  out->values = g_array_index (store->parameters, const DflEventParameter *,
+                               index);
+  out->n_parameters = g_array_index (store->n_parameters, guint8, index);
+  out->string_mask = g_array_index (store->string_masks, guint8, index);
+  out->invalid_mask = g_array_index (store->invalid_masks, guint8, index);
+}
+
+/* Create a new #DflEvent for the event at @index in @store. It holds a
+ * reference to the store’s arena, so stays valid after the store is cleared. */
+DflEvent *
+_dfl_event_store_new_view (DflEventStore *store,
+                           guint          index)
+{
+  DflEventParameters parameters;
+  guint16 code;
+
+  g_return_val_if_fail (index < _dfl_event_store_get_n_events (store), NULL);
+
+  code = g_array_index (store->event_types, guint16, index);
+  event_store_get_parameters (store, index, &parameters);
+
+  return _dfl_event_new_view (store->event_type_table->pdata[code],
+                              g_array_index (store->timestamps,
+                                             DflTimestamp, index),
+                              g_array_index (store->thread_ids,
+                                             DflThreadId, index),
+                              &parameters, store->arena);
+}
+
+/* Re-point an existing view at the event at @index in @store, to avoid
+ * creating a new #DflEvent for each event when iterating. */
+void
+_dfl_event_store_update_view (DflEventStore *store,
+                              guint          index,
+                              DflEvent      *view)
+{
+  DflEventParameters parameters;
+  guint16 code;
+
+  g_return_if_fail (index < _dfl_event_store_get_n_events (store));
+
+  code = g_array_index (store->event_types, guint16, index);
+  event_store_get_parameters (store, index, &parameters);
+
+  _dfl_event_set_view (view,
+                       store->event_type_table->pdata[code],
+                       g_array_index (store->timestamps, DflTimestamp, index),
+                       g_array_index (store->thread_ids, DflThreadId, index),
+                       &parameters, store->arena);
+}
+
+/* XOR @tag into each ID parameter in @parameters which is set in @id_mask.
+ * %DFL_ID_INVALID (NULL) IDs are not tagged, so they stay invalid. The
+ * parameter values must be writable. */
+static void
+event_store_tag_parameters (const DflEventParameters *parameters,
+                            guint8                    id_mask,
+                            guint64                   tag)
+{
+  DflEventParameter *values = (DflEventParameter *) parameters->values;
+  guint i;
+
+  for (i = 0; i < parameters->n_parameters; i++)
+    {
+      if ((id_mask & (1 << i)) && !(parameters->string_mask & (1 << i)) &&
+          values[i].id != DFL_ID_INVALID)
+        values[i].id ^= tag;
+    }
+}
+
+/* Add a copy of the event at @index in @other to the end of @store, tagging it
+ * as coming from @process by XORing @process into the top byte of its thread
+ * ID and of each ID parameter set in @id_mask. %DFL_ID_INVALID (NULL) IDs are
+ * not tagged, so they stay invalid. Events from process 0 are left unchanged.
+ * See dfl_event_get_process(). */
+void
+_dfl_event_store_add_tagged (DflEventStore *store,
+                             DflEventStore *other,
+                             guint          index,
+                             guint          process,
+                             guint8         id_mask)
+{
+  DflEventParameters parameters, copied;
+  guint64 tag;
+  guint16 code;
+
+  g_return_if_fail (store != other);
+  g_return_if_fail (index < _dfl_event_store_get_n_events (other));
+  g_return_if_fail (process <= DFL_PROCESS_MAX);
+
+  tag = (guint64) process << DFL_PROCESS_SHIFT;
+
+  event_store_get_parameters (other, index, &parameters);
+  _dfl_event_parameters_copy (&parameters, event_store_alloc_cb, store->arena,
+                              &copied);
+
+  /* The copy is owned by @store, so can be modified. */
+  if (tag != 0)
+    event_store_tag_parameters (&copied, id_mask, tag);
+
+  code = g_array_index (other->event_types, guint16, index);
+  event_store_append (store, other->event_type_table->pdata[code],
+                      g_array_index (other->timestamps, DflTimestamp, index),
+                      g_array_index (other->thread_ids, DflThreadId,
+                                     index) ^ tag,
+                      &copied);
+}
+
+/* Move the event at @index in @other to the end of @store, tagging it as with
+ * _dfl_event_store_add_tagged(). Unlike that, the event’s parameters are
+ * tagged in place in @other’s arena and shared with @store rather than copied,
+ * so each event in @other must be moved at most once, and
+ * _dfl_event_store_absorb() must be called once they have all been moved. */
+void
+_dfl_event_store_move_tagged (DflEventStore *store,
+                              DflEventStore *other,
+                              guint          index,
+                              guint          process,
+                              guint8         id_mask)
+{
+  DflEventParameters parameters;
+  guint64 tag;
+  guint16 code;
+
+  g_return_if_fail (store != other);
+  g_return_if_fail (index < _dfl_event_store_get_n_events (other));
+  g_return_if_fail (process <= DFL_PROCESS_MAX);
+
+  tag = (guint64) process << DFL_PROCESS_SHIFT;
+
+  /* Each event’s parameter values are a separate allocation, so tagging them
+   * does not affect any other event. */
+  event_store_get_parameters (other, index, &parameters);
+
+  if (tag != 0)
+    event_store_tag_parameters (&parameters, id_mask, tag);
+
+  code = g_array_index (other->event_types, guint16, index);
+  event_store_append (store, other->event_type_table->pdata[code],
+                      g_array_index (other->timestamps, DflTimestamp, index),
+                      g_array_index (other->thread_ids, DflThreadId,
+                                     index) ^ tag,
+                      &parameters);
+}
+
+/* Take ownership of @other’s arena, once its events have been moved to @store
+ * (for example using _dfl_event_store_move_tagged()), and leave @other empty.
+ * There must be no views onto @other. */
+void
+_dfl_event_store_absorb (DflEventStore *store,
+                         DflEventStore *other)
+{
+  g_return_if_fail (store != other);
+
+  _dfl_arena_absorb (store->arena, other->arena);
+
+  g_array_set_size (other->timestamps, 0);
+  g_array_set_size (other->thread_ids, 0);
+  g_array_set_size (other->event_types, 0);
+  g_array_set_size (other->n_parameters, 0);
+  g_array_set_size (other->string_masks, 0);
+  g_array_set_size (other->invalid_masks, 0);
+  g_array_set_size (other->parameters, 0);
+}
@@ -35,6 +35,7 @@
 #include <string.h>
 
 #include "event.h"
+#include "event-private.h"
 
 
 static void dfl_event_get_property (GObject      *object,
@@ -54,9 +55,17 @@ struct _DflEvent
   const gchar *event_type;  /* unowned, interned */
   DflTimestamp timestamp;
   DflThreadId thread_id;
-  gchar **parameters;  /* owned, null terminated */
+
+  /* Decoded parameters. If @arena is set, the event is a view onto a
+   * #DflEventStore and the parameter values are owned by the arena; otherwise
+   * they are owned by the event. */
+  DflEventParameters parameters;
+  DflArena *arena;  /* owned; nullable */
 };
 
+/* Long enough for G_MAXUINT64 in decimal, plus a nul terminator. */
+G_STATIC_ASSERT (DFL_EVENT_PARAMETER_BUFFER_SIZE >= 21);
+
 G_DEFINE_TYPE (DflEvent, dfl_event, G_TYPE_OBJECT)
 
 typedef enum
@@ -141,6 +150,232 @@ dfl_event_class_init (DflEventClass *klass)
                                                        G_PARAM_STATIC_STRINGS));
 }
 
+/* Parse @field as a canonical decimal integer (no sign, and no leading zeros
+ * unless the value is zero), so that formatting @out gives back exactly
+ * @field. This is the same rule as is used for parameter values in binary
+ * logs. */
+static gboolean
+field_to_uint64 (const DflEventField *field,
+                 guint64             *out)
+{
+  guint64 value = 0;
+  gsize i;
+
+  if (field->length == 0 ||
+      field->length > DFL_EVENT_PARAMETER_BUFFER_SIZE - 1 ||
+      (field->data[0] == '0' && field->length > 1))
+    return FALSE;
+
+  for (i = 0; i < field->length; i++)
+    {
+      guint digit;
+
+      if (field->data[i] < '0' || field->data[i] > '9')
+        return FALSE;
+
+      digit = field->data[i] - '0';
+
+      if (value > (G_MAXUINT64 - digit) / 10)
+        return FALSE;
+
+      value = value * 10 + digit;
+    }
+
+  *out = value;
+
+  return TRUE;
+}
+
+/* Decode @n_fields fields into typed parameters in a single allocation from
+ * @alloc_func, which must return memory aligned for a #DflEventParameter. IDs
+ * are stored as integers; all other parameters are copied as nul-terminated
+ * strings after the parameter values, and validated as UTF-8 once here rather
+ * than on each access. */
+void
+_dfl_event_parameters_decode (const DflEventField        *fields,
+                              gsize                       n_fields,
+                              DflEventParameterAllocFunc  alloc_func,
+                              gpointer                    user_data,
+                              DflEventParameters         *out)
+{
+  DflEventParameter *values;
+  guint64 ids[DFL_EVENT_MAX_PARAMETERS];
+  guint8 string_mask = 0, invalid_mask = 0;
+  gsize i, size;
+  gchar *strings;
+
+  g_assert (n_fields <= DFL_EVENT_MAX_PARAMETERS);
+
+  out->n_parameters = n_fields;
+  out->string_mask = 0;
+  out->invalid_mask = 0;
+  out->values = NULL;
+
+  if (n_fields == 0)
+    return;
+
+  size = n_fields * sizeof (DflEventParameter);
+
+  for (i = 0; i < n_fields; i++)
+    {
+      if (!field_to_uint64 (&fields[i], &ids[i]))
+        {
+          string_mask |= 1 << i;
+          size += fields[i].length + 1;
+
+          if (!g_utf8_validate (fields[i].data, fields[i].length, NULL))
+            invalid_mask |= 1 << i;
+        }
+    }
+
+  values = alloc_func (size, user_data);
+  strings = (gchar *) (values + n_fields);
+
+  for (i = 0; i < n_fields; i++)
+    {
+      if (string_mask & (1 << i))
+        {
+          values[i].string = strings;
+          memcpy (strings, fields[i].data, fields[i].length);
+          strings[fields[i].length] = '\0';
+          strings += fields[i].length + 1;
+        }
+      else
+        {
+          values[i].id = ids[i];
+        }
+    }
+
+  out->values = values;
+  out->string_mask = string_mask;
+  out->invalid_mask = invalid_mask;
+}
+
+/* Copy @parameters into a single allocation from @alloc_func, as with
+ * _dfl_event_parameters_decode(). */
+void
+_dfl_event_parameters_copy (const DflEventParameters   *parameters,
+                            DflEventParameterAllocFunc  alloc_func,
+                            gpointer                    user_data,
+                            DflEventParameters         *out)
+{
+  DflEventParameter *values;
+  gchar *strings;
+  gsize size;
+  guint i;
+
+  *out = *parameters;
+
+  if (parameters->n_parameters == 0)
+    return;
+
+  size = parameters->n_parameters * sizeof (DflEventParameter);
+
+  for (i = 0; i < parameters->n_parameters; i++)
+    {
+      if (parameters->string_mask & (1 << i))
+        size += strlen (parameters->values[i].string) + 1;
+    }
+
+  values = alloc_func (size, user_data);
+  strings = (gchar *) (values + parameters->n_parameters);
+
+  for (i = 0; i < parameters->n_parameters; i++)
+    {
+      if (parameters->string_mask & (1 << i))
+        {
+          gsize length = strlen (parameters->values[i].string) + 1;
+
+          values[i].string = strings;
+          memcpy (strings, parameters->values[i].string, length);
+          strings += length;
+        }
+      else
+        {
+          values[i].id = parameters->values[i].id;
+        }
+    }
+
+  out->values = values;
+}
+
+static gpointer
+parameters_alloc_cb (gsize    size,
+                     gpointer user_data)
+{
+  return g_malloc (size);
+}
+
+/* Get parameter @parameter_index as a string. String parameters are returned
+ * directly, and are owned by the event; ID parameters are formatted into
+ * @buffer, which must be at least %DFL_EVENT_PARAMETER_BUFFER_SIZE bytes. The
+ * event is never modified, so this is safe to call on shared views. */
+static const gchar *
+parameters_get_string (DflEvent *self,
+                       guint     parameter_index,
+                       gchar    *buffer)
+{
+  if (self->parameters.string_mask & (1 << parameter_index))
+    return self->parameters.values[parameter_index].string;
+
+  g_snprintf (buffer, DFL_EVENT_PARAMETER_BUFFER_SIZE, "%" G_GUINT64_FORMAT,
+              self->parameters.values[parameter_index].id);
+
+  return buffer;
+}
+
+/* Decode the strings in @strv into an allocation owned by the event. */
+static void
+parameters_set_strv (DflEvent            *self,
+                     const gchar * const *strv)
+{
+  DflEventField fields[DFL_EVENT_MAX_PARAMETERS];
+  gsize i;
+
+  for (i = 0; strv != NULL && strv[i] != NULL; i++)
+    {
+      g_return_if_fail (i < DFL_EVENT_MAX_PARAMETERS);
+
+      fields[i].data = strv[i];
+      fields[i].length = strlen (strv[i]);
+    }
+
+  _dfl_event_parameters_decode (fields, i, parameters_alloc_cb, NULL,
+                                &self->parameters);
+}
+
+/* Unpack the event’s parameters into a newly allocated strv. */
+static gchar **
+parameters_get_strv (DflEvent *self)
+{
+  gchar **strv;
+  gchar buffer[DFL_EVENT_PARAMETER_BUFFER_SIZE];
+  guint i;
+
+  strv = g_new (gchar *, self->parameters.n_parameters + 1);
+
+  for (i = 0; i < self->parameters.n_parameters; i++)
+    strv[i] = g_strdup (parameters_get_string (self, i, buffer));
+
+  strv[self->parameters.n_parameters] = NULL;
+
+  return strv;
+}
+
+static void
+parameters_clear (DflEvent *self)
+{
+  if (self->arena != NULL)
+    g_clear_pointer (&self->arena, _dfl_arena_unref);
+  else
+    g_free ((DflEventParameter *) self->parameters.values);
+
+  self->parameters.values = NULL;
+  self->parameters.n_parameters = 0;
+  self->parameters.string_mask = 0;
+  self->parameters.invalid_mask = 0;
+}
+
 static void
 dfl_event_init (DflEvent *self)
 {
@@ -167,7 +402,7 @@ dfl_event_get_property (GObject     *object,
       g_value_set_uint64 (value, self->thread_id);
       break;
     case PROP_PARAMETERS:
-      g_value_set_boxed (value, self->parameters);
+      g_value_take_boxed (value, parameters_get_strv (self));
       break;
     default:
       g_assert_not_reached ();
@@ -199,8 +434,8 @@ dfl_event_set_property (GObject           *object,
       break;
     case PROP_PARAMETERS:
       /* Construct only. */
-      g_assert (self->parameters == NULL);
-      self->parameters = g_value_dup_boxed (value);
+      g_assert (self->parameters.values == NULL);
+      parameters_set_strv (self, g_value_get_boxed (value));
       break;
     default:
       g_assert_not_reached ();
@@ -212,7 +447,7 @@ dfl_event_finalize (GObject *object)
 {
   DflEvent *self = DFL_EVENT (object);
 
-  g_strfreev (self->parameters);
+  parameters_clear (self);
 
   G_OBJECT_CLASS (dfl_event_parent_class)->finalize (object);
 }
@@ -223,7 +458,7 @@ dfl_event_finalize (GObject *object)
  * @timestamp: timestamp when the event happened
  * @thread_id: ID of the thread the event happened in
  * @parameters: (array zero-terminated): zero or more parameters specific
- *    to @event_type, %NULL terminated
+ *    to @event_type, %NULL terminated; at most 8
  *
  * TODO
  *
@@ -237,6 +472,9 @@ dfl_event_new (const gchar         *event_type,
                const gchar * const *parameters)
 {
   g_return_val_if_fail (event_type != NULL && *event_type != '\0', NULL);
+  g_return_val_if_fail (parameters == NULL ||
+                        g_strv_length ((gchar **) parameters) <=
+                        DFL_EVENT_MAX_PARAMETERS, NULL);
 
   return g_object_new (DFL_TYPE_EVENT,
                        "event-type", event_type,
@@ -246,6 +484,64 @@ dfl_event_new (const gchar         *event_type,
                        NULL);
 }
 
+/* Construct a new #DflEvent as a view onto an event in a #DflEventStore. This
+ * avoids the overhead of going through the #GObject property machinery, and of
+ * copying the parameters, which are owned by @arena.
+ *
+ * @event_type must be interned. */
+DflEvent *
+_dfl_event_new_view (const gchar              *event_type,
+                     DflTimestamp              timestamp,
+                     DflThreadId               thread_id,
+                     const DflEventParameters *parameters,
+                     DflArena                 *arena)
+{
+  DflEvent *event = NULL;
+
+  event = g_object_new (DFL_TYPE_EVENT, NULL);
+  _dfl_event_set_view (event, event_type, timestamp, thread_id, parameters,
+                       arena);
+
+  return event;
+}
+
+/* Re-point an existing event at a different event in a #DflEventStore. This
+ * must only be used on events which nothing else holds a reference to, as the
+ * event’s properties are otherwise immutable. */
+void
+_dfl_event_set_view (DflEvent                 *self,
+                     const gchar              *event_type,
+                     DflTimestamp              timestamp,
+                     DflThreadId               thread_id,
+                     const DflEventParameters *parameters,
+                     DflArena                 *arena)
+{
+  g_return_if_fail (DFL_IS_EVENT (self));
+  g_return_if_fail (event_type != NULL && *event_type != '\0');
+  g_return_if_fail (parameters != NULL);
+  g_return_if_fail (arena != NULL);
+
+  if (self->arena != arena)
+    {
+      parameters_clear (self);
+      self->arena = _dfl_arena_ref (arena);
+    }
+
+  self->event_type = event_type;
+  self->timestamp = timestamp;
+  self->thread_id = thread_id;
+  self->parameters = *parameters;
+}
+
+/* Get the event’s decoded parameters. They are owned by the event. */
+const DflEventParameters *
+_dfl_event_get_parameters (DflEvent *self)
+{
+  g_return_val_if_fail (DFL_IS_EVENT (self), NULL);
+
+  return &self->parameters;
+}
+
 /**
  * dfl_event_get_event_type:
  * @self: a #DflEvent
@@ -299,6 +595,25 @@ dfl_event_get_thread_id (DflEvent *self)
   return self->thread_id;
 }
 
+/**
+ * dfl_event_get_process:
+ * @self: a #DflEvent
+ *
+ * Get the index of the process the event came from, if it is from a sequence
+ * created by merging several logs using dfl_event_sequence_new_merged(). For
+ * events from a single log, this is always 0.
+ *
+ * Returns: index of the process the event came from
+ * Since: UNRELEASED
+ */
+guint
+dfl_event_get_process (DflEvent *self)
+{
+  g_return_val_if_fail (DFL_IS_EVENT (self), 0);
+
+  return self->thread_id >> DFL_PROCESS_SHIFT;
+}
+
 /**
  * dfl_event_get_parameter_id:
  * @self: a #DflEvent
@@ -313,33 +628,28 @@ DflId
 dfl_event_get_parameter_id (DflEvent *self,
                             guint     parameter_index)
 {
-  gsize i;
+  const gchar *parameter, *end;
+  guint64 retval;
 
   g_return_val_if_fail (DFL_IS_EVENT (self), DFL_ID_INVALID);
+  g_return_val_if_fail (parameter_index < self->parameters.n_parameters,
+                        DFL_ID_INVALID);
 
-  for (i = 0; self->parameters[i] != NULL; i++)
-    {
-      if (i == parameter_index)
-        {
-          guint64 retval;
-          const gchar *end;
+  if (!(self->parameters.string_mask & (1 << parameter_index)))
+    return self->parameters.values[parameter_index].id;
 
-          retval = g_ascii_strtoull (self->parameters[i], (gchar **) &end, 10);
+  /* Only canonical decimal integers are decoded as IDs on load, so that they
+   * round-trip exactly. Other numbers which g_ascii_strtoull() accepts (such
+   * as ‘007’ or ‘+5’) are kept as strings, but are still valid IDs. */
+  parameter = self->parameters.values[parameter_index].string;
+  errno = 0;
+  retval = g_ascii_strtoull (parameter, (gchar **) &end, 10);
 
-          if (errno == ERANGE || end == self->parameters[i] || *end != '\0')
-            g_warning ("Event parameter ‘%s’ cannot be interpreted as an ID.",
-                       self->parameters[i]);
+  if (errno == ERANGE || end == parameter || *end != '\0')
+    g_warning ("Event parameter ‘%s’ cannot be interpreted as an ID.",
+               parameter);
 
-          return retval;
-        }
-    }
-
-  /* Invalid @parameter_index. This check will always be hit if this code is
-   * reached, as the check is actually performed more efficiently in the loop
-   * above. */
-  g_return_val_if_fail (parameter_index < g_strv_length (self->parameters),
-                        DFL_ID_INVALID);
-  return DFL_ID_INVALID;
+  return retval;
 }
 
 /**
@@ -347,38 +657,78 @@ dfl_event_get_parameter_id (DflEvent *self,
  * @self: a #DflEvent
  * @parameter_index: index of the parameter
  *
- * TODO
+ * Get string parameter @parameter_index of @self. The returned string is valid
+ * for as long as @self is.
  *
- * Returns: TODO
+ * Parameters which are decimal integers are stored as IDs rather than strings;
+ * for those, this returns %NULL. Use dfl_event_format_parameter() to get a
+ * parameter as a string whatever its type.
+ *
+ * Returns: (nullable): the parameter, or %NULL if it is an ID or is not valid
+ *    UTF-8
  * Since: UNRELEASED
  */
 const gchar *
 dfl_event_get_parameter_utf8 (DflEvent *self,
                               guint     parameter_index)
 {
-  gsize i;
+  g_return_val_if_fail (DFL_IS_EVENT (self), NULL);
+  g_return_val_if_fail (parameter_index < self->parameters.n_parameters, NULL);
 
+  if (!(self->parameters.string_mask & (1 << parameter_index)))
+    {
+      g_warning ("Event parameter %u is an ID; use "
+                 "dfl_event_format_parameter() to get it as a string.",
+                 parameter_index);
+      return NULL;
+    }
+
+  if (self->parameters.invalid_mask & (1 << parameter_index))
+    {
+      g_warning ("Event parameter %u cannot be interpreted as UTF-8.",
+                 parameter_index);
+      return NULL;
+    }
+
+  return self->parameters.values[parameter_index].string;
+}
+
+/**
+ * dfl_event_format_parameter:
+ * @self: a #DflEvent
+ * @parameter_index: index of the parameter
+ * @buffer: (out caller-allocates) (array length=buffer_size): buffer to
+ *    format an ID parameter into
+ * @buffer_size: size of @buffer, in bytes; at least
+ *    %DFL_EVENT_PARAMETER_BUFFER_SIZE
+ *
+ * Get parameter @parameter_index of @self as a string, whatever its type. If
+ * it is a string, it is returned directly, and is valid for as long as @self
+ * is. If it is an ID, it is formatted in decimal into @buffer, and @buffer is
+ * returned. @self is not modified, so this is safe to call on events which are
+ * shared between threads.
+ *
+ * Returns: (nullable): the parameter as a string, or %NULL if it is a string
+ *    which is not valid UTF-8
+ * Since: UNRELEASED
+ */
+const gchar *
+dfl_event_format_parameter (DflEvent *self,
+                            guint     parameter_index,
+                            gchar    *buffer,
+                            gsize     buffer_size)
+{
   g_return_val_if_fail (DFL_IS_EVENT (self), NULL);
+  g_return_val_if_fail (parameter_index < self->parameters.n_parameters, NULL);
+  g_return_val_if_fail (buffer != NULL, NULL);
+  g_return_val_if_fail (buffer_size >= DFL_EVENT_PARAMETER_BUFFER_SIZE, NULL);
 
-  for (i = 0; self->parameters[i] != NULL; i++)
+  if (self->parameters.invalid_mask & (1 << parameter_index))
     {
-      if (i == parameter_index)
-        {
-          if (!g_utf8_validate (self->parameters[i], -1, NULL))
-            {
-              g_warning ("Event parameter %" G_GSIZE_FORMAT " cannot be "
-                         "interpreted as UTF-8.", i);
-              return NULL;
-            }
-
-          return self->parameters[i];
-        }
+      g_warning ("Event parameter %u cannot be interpreted as UTF-8.",
+                 parameter_index);
+      return NULL;
     }
 
-  /* Invalid @parameter_index. This check will always be hit if this code is
-   * reached, as the check is actually performed more efficiently in the loop
-   * above. */
-  g_return_val_if_fail (parameter_index < g_strv_length (self->parameters),
-                        NULL);
-  return NULL;
+  return parameters_get_string (self, parameter_index, buffer);
 }
@@ -37,6 +37,16 @@ G_BEGIN_DECLS
 #define DFL_TYPE_EVENT dfl_event_get_type ()
 G_DECLARE_FINAL_TYPE (DflEvent, dfl_event, DFL, EVENT, GObject)
 
+/**
+ * DFL_EVENT_PARAMETER_BUFFER_SIZE:
+ *
+ * Size of a buffer which is large enough to format any ID parameter into using
+ * dfl_event_format_parameter(), including the nul terminator.
+ *
+ * Since: UNRELEASED
+ */
+#define DFL_EVENT_PARAMETER_BUFFER_SIZE 21
+
 DflEvent *dfl_event_new (const gchar         *event_type,
                          DflTimestamp         timestamp,
                          DflThreadId          thread_id,
@@ -45,11 +55,16 @@ DflEvent *dfl_event_new (const gchar         *event_type,
 const gchar *dfl_event_get_event_type   (DflEvent *self);
 DflTimestamp dfl_event_get_timestamp    (DflEvent *self);
 DflThreadId  dfl_event_get_thread_id    (DflEvent *self);
+guint        dfl_event_get_process      (DflEvent *self);
 
 DflId        dfl_event_get_parameter_id (DflEvent *self,
                                          guint     parameter_index);
 const gchar *dfl_event_get_parameter_utf8 (DflEvent *self,
                                            guint     parameter_index);
+const gchar *dfl_event_format_parameter   (DflEvent *self,
+                                           guint     parameter_index,
+                                           gchar    *buffer,
+                                           gsize     buffer_size);
 
 G_END_DECLS
 
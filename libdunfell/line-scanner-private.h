@@ -0,0 +1,37 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_LINE_SCANNER_PRIVATE_H
+#define DFL_LINE_SCANNER_PRIVATE_H
+
+#include <glib.h>
+
+#include "event-private.h"
+
+G_BEGIN_DECLS
+
+gsize _dfl_line_scan (const gchar   *data,
+                      gsize          length,
+                      DflEventField *fields,
+                      gsize          max_fields,
+                      gsize         *n_fields_out,
+                      gboolean      *is_ascii_out);
+
+G_END_DECLS
+
+#endif /* !DFL_LINE_SCANNER_PRIVATE_H */
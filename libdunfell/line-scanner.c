@@ -0,0 +1,285 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Line scanner for text logs. This finds the end of a line, splits it at
+ * commas and checks whether it is plain ASCII, all in a single pass over the
+ * data. This is the innermost loop of loading a log.
+ *
+ * On x86, the scan is vectorised with SSE2 (which is always available on
+ * x86-64), or AVX2 if the CPU supports it, which is checked at runtime. On
+ * other architectures, a scalar implementation is used.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "event-private.h"
+#include "line-scanner-private.h"
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define HAVE_SSE2_SCANNER 1
+#include <immintrin.h>
+#endif
+
+typedef struct
+{
+  const gchar *data;
+  DflEventField *fields;
+  gsize max_fields;
+  gsize n_fields;
+  gsize field_start;
+} ScanState;
+
+/* Record a field ending at offset @end (exclusive) in the line. */
+static inline void
+scan_state_add_field (ScanState *state,
+                      gsize      end)
+{
+  if (state->n_fields < state->max_fields)
+    {
+      state->fields[state->n_fields].data = state->data + state->field_start;
+      state->fields[state->n_fields].length = end - state->field_start;
+    }
+
+  state->n_fields++;
+  state->field_start = end + 1;
+}
+
+/* Scan from offset @i to the end of the line (or of the data) one byte at a
+ * time. Returns the line length. */
+static inline gsize
+scan_scalar (ScanState   *state,
+             gsize        i,
+             gsize        length,
+             gboolean    *is_ascii)
+{
+  const guchar *data = (const guchar *) state->data;
+  guchar non_ascii = 0;
+
+  for (; i < length; i++)
+    {
+      guchar c = data[i];
+
+      if (c == '\n')
+        break;
+      else if (c == ',')
+        scan_state_add_field (state, i);
+
+      /* Nul bytes are treated as non-ASCII, so that the caller validates
+       * them. */
+      non_ascii |= (c & 0x80) | (c == '\0');
+    }
+
+  if (non_ascii != 0)
+    *is_ascii = FALSE;
+
+  return i;
+}
+
+#ifdef HAVE_SSE2_SCANNER
+/* Record a field for each set bit in @comma_mask, which is a bitmask of the
+ * commas in the block of data starting at offset @block_start. */
+static inline void
+scan_state_add_fields_from_mask (ScanState *state,
+                                 gsize      block_start,
+                                 guint32    comma_mask)
+{
+  while (comma_mask != 0)
+    {
+      scan_state_add_field (state, block_start + __builtin_ctz (comma_mask));
+      comma_mask &= comma_mask - 1;
+    }
+}
+
+static gsize
+scan_sse2 (ScanState *state,
+           gsize      length,
+           gboolean  *is_ascii)
+{
+  const __m128i newline = _mm_set1_epi8 ('\n');
+  const __m128i comma = _mm_set1_epi8 (',');
+  const __m128i nul = _mm_setzero_si128 ();
+  guint32 non_ascii = 0;
+  gsize i;
+
+  for (i = 0; i + 16 <= length; i += 16)
+    {
+      __m128i block;
+      guint32 newline_mask, comma_mask, non_ascii_mask;
+
+      block = _mm_loadu_si128 ((const __m128i *) (state->data + i));
+      newline_mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, newline));
+      comma_mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, comma));
+      non_ascii_mask = _mm_movemask_epi8 (block) |
+                       _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, nul));
+
+      if (newline_mask != 0)
+        {
+          guint32 newline_position = __builtin_ctz (newline_mask);
+          guint32 before_newline = (1u << newline_position) - 1;
+
+          scan_state_add_fields_from_mask (state, i,
+                                           comma_mask & before_newline);
+          non_ascii |= non_ascii_mask & before_newline;
+          i += newline_position;
+          goto done;
+        }
+
+      scan_state_add_fields_from_mask (state, i, comma_mask);
+      non_ascii |= non_ascii_mask;
+    }
+
+  i = scan_scalar (state, i, length, is_ascii);
+
+done:
+  if (non_ascii != 0)
+    *is_ascii = FALSE;
+
+  return i;
+}
+
+__attribute__((target ("avx2")))
+static gsize
+scan_avx2 (ScanState *state,
+           gsize      length,
+           gboolean  *is_ascii)
+{
+  const __m256i newline = _mm256_set1_epi8 ('\n');
+  const __m256i comma = _mm256_set1_epi8 (',');
+  const __m256i nul = _mm256_setzero_si256 ();
+  guint32 non_ascii = 0;
+  gsize i;
+
+  for (i = 0; i + 32 <= length; i += 32)
+    {
+      __m256i block;
+      guint32 newline_mask, comma_mask, non_ascii_mask;
+
+      block = _mm256_loadu_si256 ((const __m256i *) (state->data + i));
+      newline_mask = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, newline));
+      comma_mask = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, comma));
+      non_ascii_mask = _mm256_movemask_epi8 (block) |
+                       _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, nul));
+
+      if (newline_mask != 0)
+        {
+          guint32 newline_position = __builtin_ctz (newline_mask);
+          guint32 before_newline = (1u << newline_position) - 1;
+
+          scan_state_add_fields_from_mask (state, i,
+                                           comma_mask & before_newline);
+          non_ascii |= non_ascii_mask & before_newline;
+          i += newline_position;
+          goto done;
+        }
+
+      scan_state_add_fields_from_mask (state, i, comma_mask);
+      non_ascii |= non_ascii_mask;
+    }
+
+  i = scan_scalar (state, i, length, is_ascii);
+
+done:
+  if (non_ascii != 0)
+    *is_ascii = FALSE;
+
+  return i;
+}
+
+typedef gsize (*ScanFunc) (ScanState *state,
+                           gsize      length,
+                           gboolean  *is_ascii);
+
+static ScanFunc
+get_scan_func (void)
+{
+  static gsize scan_func = 0;
+
+  if (g_once_init_enter (&scan_func))
+    {
+      ScanFunc func;
+
+      __builtin_cpu_init ();
+      func = __builtin_cpu_supports ("avx2") ? scan_avx2 : scan_sse2;
+
+      g_once_init_leave (&scan_func, (gsize) func);
+    }
+
+  return (ScanFunc) scan_func;
+}
+#endif  /* HAVE_SSE2_SCANNER */
+
+/*
+ * _dfl_line_scan:
+ * @data: data to scan, which need not be nul-terminated
+ * @length: number of bytes in @data
+ * @fields: (out caller-allocates) (array length=max_fields): return location
+ *    for the fields of the line
+ * @max_fields: number of elements in @fields
+ * @n_fields_out: (out): return location for the number of fields in the line
+ * @is_ascii_out: (out): return location for whether the line contains only
+ *    non-nul ASCII characters
+ *
+ * Scan the line at the start of @data, which ends at the first newline
+ * character or at the end of @data. The line is split at commas, with the
+ * same semantics as g_strsplit() with an unlimited number of tokens, and the
+ * fields (which are not nul-terminated) are returned in @fields. At most
+ * @max_fields are stored, but the total number of fields is returned in
+ * @n_fields_out, so there is always at least one.
+ *
+ * If @is_ascii_out is %FALSE, the line contains non-ASCII or nul bytes, and
+ * the caller must validate it as UTF-8. Otherwise, the line is valid UTF-8.
+ *
+ * Returns: length of the line, excluding the newline character
+ */
+gsize
+_dfl_line_scan (const gchar   *data,
+                gsize          length,
+                DflEventField *fields,
+                gsize          max_fields,
+                gsize         *n_fields_out,
+                gboolean      *is_ascii_out)
+{
+  ScanState state;
+  gboolean is_ascii = TRUE;
+  gsize line_length;
+
+  state.data = data;
+  state.fields = fields;
+  state.max_fields = max_fields;
+  state.n_fields = 0;
+  state.field_start = 0;
+
+#ifdef HAVE_SSE2_SCANNER
+  line_length = get_scan_func () (&state, length, &is_ascii);
+#else
+  line_length = scan_scalar (&state, 0, length, &is_ascii);
+#endif
+
+  /* Final field. */
+  scan_state_add_field (&state, line_length);
+
+  *n_fields_out = state.n_fields;
+  *is_ascii_out = is_ascii;
+
+  return line_length;
+}
@@ -0,0 +1,111 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_LOG_INDEX_PRIVATE_H
+#define DFL_LOG_INDEX_PRIVATE_H
+
+#include <glib.h>
+
+#include "log-index.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Sidecar index file format, version 1.0. The index for a text log at
+ * `path` is stored at `path.idx`. All integers are little-endian.
+ *
+ * Header (80 bytes):
+ *    magic[8]          "\x89" "DFI\r\n\x1a\n"
+ *    u16               major version (1)
+ *    u16               minor version (0)
+ *    u32               reserved (0)
+ *    u64               size of the log, in bytes
+ *    u64               modification time of the log (seconds since the epoch)
+ *    u64               initial timestamp from the log header
+ *    u64               final timestamp (highest timestamp of any event)
+ *    u64               number of blocks (n_blocks)
+ *    u64               number of threads (n_threads)
+ *    u64               number of event types (n_event_types)
+ *    u64               number of lifetime event offsets (n_lifetime_offsets)
+ *
+ * followed by:
+ *    n_blocks × { u64 offset, u64 min_timestamp, u64 max_timestamp }
+ *    n_threads × { u64 thread_id, u64 first_timestamp, u64 last_timestamp,
+ *                  u64 n_events }
+ *    n_event_types × u64 count
+ *    n_lifetime_offsets × u64 offset
+ *
+ * A block is a run of lines starting at the given byte offset in the log and
+ * ending at the next block’s offset (or the end of the log). Blocks start at
+ * the first event line at least DFL_LOG_INDEX_BLOCK_SIZE bytes after the start
+ * of the previous block (up to twice that where indexes of parallel-parsed
+ * chunks are joined); their timestamp ranges may overlap, as timestamps are
+ * only monotonic per thread.
+ * Event type counts are indexed by the event type’s binary code (see
+ * parser-private.h). Lifetime event offsets are the byte offsets of each line
+ * containing an event which creates, names or destroys an object, in file
+ * order, so they can be loaded without scanning the rest of the log.
+ *
+ * The index is considered stale, and is ignored, if the log’s size or
+ * modification time differ from those recorded in it.
+ */
+
+#define DFL_LOG_INDEX_MAGIC "\x89" "DFI\r\n\x1a\n"
+#define DFL_LOG_INDEX_MAGIC_LENGTH 8
+#define DFL_LOG_INDEX_VERSION_MAJOR 1
+#define DFL_LOG_INDEX_VERSION_MINOR 0
+#define DFL_LOG_INDEX_HEADER_LENGTH 80
+#define DFL_LOG_INDEX_BLOCK_SIZE (256 * 1024)
+
+typedef struct
+{
+  guint64 offset;
+  DflTimestamp min_timestamp;
+  DflTimestamp max_timestamp;
+} DflLogIndexBlock;
+
+DflLogIndex *_dfl_log_index_new (guint n_event_types);
+
+void _dfl_log_index_set_initial_timestamp (DflLogIndex  *self,
+                                           DflTimestamp  initial_timestamp);
+void _dfl_log_index_add_event             (DflLogIndex  *self,
+                                           guint64       offset,
+                                           guint         code,
+                                           DflTimestamp  timestamp,
+                                           DflThreadId   thread_id,
+                                           gboolean      is_lifetime);
+void _dfl_log_index_append                (DflLogIndex  *self,
+                                           DflLogIndex  *other);
+void _dfl_log_index_set_log               (DflLogIndex  *self,
+                                           const gchar  *log_filename,
+                                           guint64       log_size,
+                                           guint64       log_mtime);
+
+gboolean _dfl_log_index_stat_log (const gchar  *log_filename,
+                                  guint64      *size_out,
+                                  guint64      *mtime_out,
+                                  GError      **error);
+
+const DflLogIndexBlock *_dfl_log_index_get_blocks           (DflLogIndex *self,
+                                                             gsize       *n_blocks);
+const guint64          *_dfl_log_index_get_lifetime_offsets (DflLogIndex *self,
+                                                             gsize       *n_offsets);
+
+G_END_DECLS
+
+#endif /* !DFL_LOG_INDEX_PRIVATE_H */
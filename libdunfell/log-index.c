@@ -0,0 +1,783 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:log-index
+ * @short_description: Sidecar index for random access into text logs
+ * @stability: Unstable
+ * @include: libdunfell/log-index.h
+ *
+ * #DflLogIndex is a small summary of a text log, stored alongside it in a
+ * sidecar file (the log’s filename with `.idx` appended). It contains a
+ * sparse table mapping timestamps to byte offsets in the log, the first and
+ * last timestamps of each thread, and the number of events of each type.
+ *
+ * The extent of a log can be shown from its index without loading the log.
+ * #DflParser also uses the index, if one exists, when a time range has been
+ * set with dfl_parser_set_time_range(), to skip the parts of the log outside
+ * the range; and builds it on first use. Indexes can also be built ahead of
+ * time with the `dunfell-index` program.
+ *
+ * Indexes are only supported for uncompressed text logs.
+ *
+ * Since: UNRELEASED
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "log-index.h"
+#include "log-index-private.h"
+#include "parser-private.h"
+
+
+static void dfl_log_index_finalize (GObject *object);
+
+struct _DflLogIndex
+{
+  GObject parent;
+
+  gchar *log_filename;  /* owned; NULL until built or loaded */
+  guint64 log_size;
+  guint64 log_mtime;
+
+  DflTimestamp initial_timestamp;
+  DflTimestamp final_timestamp;
+
+  GArray/*<DflLogIndexBlock>*/ *blocks;  /* owned */
+  GArray/*<DflLogIndexThread>*/ *threads;  /* owned */
+  GArray/*<guint64>*/ *event_type_counts;  /* owned; indexed by code */
+  GArray/*<guint64>*/ *lifetime_offsets;  /* owned */
+
+  /* Map from thread ID to its index in @threads, used while building. */
+  GHashTable/*<owned guint64, guint>*/ *thread_indices;  /* owned; nullable */
+};
+
+G_DEFINE_TYPE (DflLogIndex, dfl_log_index, G_TYPE_OBJECT)
+
+static void
+dfl_log_index_class_init (DflLogIndexClass *klass)
+{
+  GObjectClass *object_class = (GObjectClass *) klass;
+
+  object_class->finalize = dfl_log_index_finalize;
+}
+
+static void
+dfl_log_index_init (DflLogIndex *self)
+{
+  self->blocks = g_array_new (FALSE, FALSE, sizeof (DflLogIndexBlock));
+  self->threads = g_array_new (FALSE, FALSE, sizeof (DflLogIndexThread));
+  self->event_type_counts = g_array_new (FALSE, TRUE, sizeof (guint64));
+  self->lifetime_offsets = g_array_new (FALSE, FALSE, sizeof (guint64));
+}
+
+static void
+dfl_log_index_finalize (GObject *object)
+{
+  DflLogIndex *self = DFL_LOG_INDEX (object);
+
+  g_clear_pointer (&self->thread_indices, g_hash_table_unref);
+  g_array_unref (self->lifetime_offsets);
+  g_array_unref (self->event_type_counts);
+  g_array_unref (self->threads);
+  g_array_unref (self->blocks);
+  g_free (self->log_filename);
+
+  G_OBJECT_CLASS (dfl_log_index_parent_class)->finalize (object);
+}
+
+/* Create a new, empty index, to be filled in by _dfl_log_index_add_event()
+ * while scanning a log. */
+DflLogIndex *
+_dfl_log_index_new (guint n_event_types)
+{
+  DflLogIndex *self = NULL;
+
+  self = g_object_new (DFL_TYPE_LOG_INDEX, NULL);
+  g_array_set_size (self->event_type_counts, n_event_types);
+  self->thread_indices = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                                g_free, NULL);
+
+  return self;
+}
+
+void
+_dfl_log_index_set_initial_timestamp (DflLogIndex  *self,
+                                      DflTimestamp  initial_timestamp)
+{
+  self->initial_timestamp = initial_timestamp;
+  self->final_timestamp = MAX (self->final_timestamp, initial_timestamp);
+}
+
+/* Add an event, whose line starts at @offset in the log, to the index. Events
+ * must be added in file order. */
+void
+_dfl_log_index_add_event (DflLogIndex  *self,
+                          guint64       offset,
+                          guint         code,
+                          DflTimestamp  timestamp,
+                          DflThreadId   thread_id,
+                          gboolean      is_lifetime)
+{
+  DflLogIndexBlock *block = NULL;
+  DflLogIndexThread *thread = NULL;
+  gpointer thread_index;
+
+  g_assert (self->thread_indices != NULL);
+  g_assert (code < self->event_type_counts->len);
+
+  /* Start a new block if this event is far enough past the start of the
+   * previous one. */
+  if (self->blocks->len > 0)
+    block = &g_array_index (self->blocks, DflLogIndexBlock,
+                            self->blocks->len - 1);
+
+  if (block == NULL || offset - block->offset >= DFL_LOG_INDEX_BLOCK_SIZE)
+    {
+      DflLogIndexBlock new_block = { offset, timestamp, timestamp };
+
+      g_array_append_val (self->blocks, new_block);
+    }
+  else
+    {
+      block->min_timestamp = MIN (block->min_timestamp, timestamp);
+      block->max_timestamp = MAX (block->max_timestamp, timestamp);
+    }
+
+  /* Thread summary. Timestamps are monotonic within each thread. */
+  if (g_hash_table_lookup_extended (self->thread_indices, &thread_id, NULL,
+                                    &thread_index))
+    {
+      thread = &g_array_index (self->threads, DflLogIndexThread,
+                               GPOINTER_TO_UINT (thread_index));
+      thread->last_timestamp = timestamp;
+      thread->n_events++;
+    }
+  else
+    {
+      DflLogIndexThread new_thread = { thread_id, timestamp, timestamp, 1 };
+      guint64 *key = NULL;
+
+      key = g_new0 (guint64, 1);
+      *key = thread_id;
+      g_hash_table_insert (self->thread_indices, key,
+                           GUINT_TO_POINTER (self->threads->len));
+      g_array_append_val (self->threads, new_thread);
+    }
+
+  g_array_index (self->event_type_counts, guint64, code)++;
+
+  if (is_lifetime)
+    g_array_append_val (self->lifetime_offsets, offset);
+
+  self->final_timestamp = MAX (self->final_timestamp, timestamp);
+}
+
+/* Append @other, which must have been built from the part of the same log
+ * immediately following the part @self was built from (with offsets relative
+ * to the start of the log), to @self. This is used to combine indexes built in
+ * parallel from consecutive chunks of a log. A block of @other which starts
+ * too close to the last block of @self is merged into it, so blocks may be up
+ * to twice DFL_LOG_INDEX_BLOCK_SIZE long, but still cover the log in order. */
+void
+_dfl_log_index_append (DflLogIndex *self,
+                       DflLogIndex *other)
+{
+  guint i;
+
+  g_assert (self->thread_indices != NULL);
+  g_assert (self->event_type_counts->len == other->event_type_counts->len);
+
+  for (i = 0; i < other->blocks->len; i++)
+    {
+      const DflLogIndexBlock *other_block = &g_array_index (other->blocks,
+                                                            DflLogIndexBlock,
+                                                            i);
+      DflLogIndexBlock *block = NULL;
+
+      if (self->blocks->len > 0)
+        block = &g_array_index (self->blocks, DflLogIndexBlock,
+                                self->blocks->len - 1);
+
+      if (block == NULL ||
+          other_block->offset - block->offset >= DFL_LOG_INDEX_BLOCK_SIZE)
+        {
+          g_array_append_val (self->blocks, *other_block);
+        }
+      else
+        {
+          block->min_timestamp = MIN (block->min_timestamp,
+                                      other_block->min_timestamp);
+          block->max_timestamp = MAX (block->max_timestamp,
+                                      other_block->max_timestamp);
+        }
+    }
+
+  for (i = 0; i < other->threads->len; i++)
+    {
+      const DflLogIndexThread *other_thread = &g_array_index (other->threads,
+                                                              DflLogIndexThread,
+                                                              i);
+      gpointer thread_index;
+
+      if (g_hash_table_lookup_extended (self->thread_indices,
+                                        &other_thread->thread_id, NULL,
+                                        &thread_index))
+        {
+          DflLogIndexThread *thread = NULL;
+
+          thread = &g_array_index (self->threads, DflLogIndexThread,
+                                   GPOINTER_TO_UINT (thread_index));
+          thread->last_timestamp = other_thread->last_timestamp;
+          thread->n_events += other_thread->n_events;
+        }
+      else
+        {
+          guint64 *key = NULL;
+
+          key = g_new0 (guint64, 1);
+          *key = other_thread->thread_id;
+          g_hash_table_insert (self->thread_indices, key,
+                               GUINT_TO_POINTER (self->threads->len));
+          g_array_append_val (self->threads, *other_thread);
+        }
+    }
+
+  for (i = 0; i < self->event_type_counts->len; i++)
+    g_array_index (self->event_type_counts, guint64, i) +=
+        g_array_index (other->event_type_counts, guint64, i);
+
+  g_array_append_vals (self->lifetime_offsets, other->lifetime_offsets->data,
+                       other->lifetime_offsets->len);
+
+  self->final_timestamp = MAX (self->final_timestamp, other->final_timestamp);
+}
+
+/* Finish building the index, recording which log it is for. @log_mtime should
+ * be taken before the log is read, so that if it is modified meanwhile, the
+ * index is considered stale next time. */
+void
+_dfl_log_index_set_log (DflLogIndex *self,
+                        const gchar *log_filename,
+                        guint64      log_size,
+                        guint64      log_mtime)
+{
+  g_free (self->log_filename);
+  self->log_filename = g_strdup (log_filename);
+  self->log_size = log_size;
+  self->log_mtime = log_mtime;
+  g_clear_pointer (&self->thread_indices, g_hash_table_unref);
+}
+
+const DflLogIndexBlock *
+_dfl_log_index_get_blocks (DflLogIndex *self,
+                           gsize       *n_blocks)
+{
+  *n_blocks = self->blocks->len;
+  return (const DflLogIndexBlock *) self->blocks->data;
+}
+
+const guint64 *
+_dfl_log_index_get_lifetime_offsets (DflLogIndex *self,
+                                     gsize       *n_offsets)
+{
+  *n_offsets = self->lifetime_offsets->len;
+  return (const guint64 *) self->lifetime_offsets->data;
+}
+
+static gchar *
+index_filename_for_log (const gchar *log_filename)
+{
+  return g_strconcat (log_filename, ".idx", NULL);
+}
+
+/* Get the size of @log_filename, and its modification time in seconds since
+ * the epoch. */
+gboolean
+_dfl_log_index_stat_log (const gchar  *log_filename,
+                         guint64      *size_out,
+                         guint64      *mtime_out,
+                         GError      **error)
+{
+  GStatBuf buf;
+
+  if (g_stat (log_filename, &buf) != 0)
+    {
+      int errsv = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+                   "Error getting information about log file ‘%s’: %s",
+                   log_filename, g_strerror (errsv));
+      return FALSE;
+    }
+
+  if (size_out != NULL)
+    *size_out = buf.st_size;
+  *mtime_out = buf.st_mtime;
+
+  return TRUE;
+}
+
+/**
+ * dfl_log_index_build:
+ * @log_filename: (type filename): path to a text log
+ * @error: return location for a #GError, or %NULL
+ *
+ * Build an index for the log at @log_filename by scanning it. This does not
+ * create any #DflEvents, so is faster than loading the log, but the whole log
+ * is still read. The index is not saved; use dfl_log_index_save() to do so.
+ *
+ * An error is returned if the log is invalid, or is a binary or compressed
+ * log, which cannot be indexed.
+ *
+ * Returns: (transfer full): the new index, or %NULL on error
+ * Since: UNRELEASED
+ */
+DflLogIndex *
+dfl_log_index_build (const gchar  *log_filename,
+                     GError      **error)
+{
+  GMappedFile *mapped_file = NULL;
+  DflLogIndex *index = NULL;
+  guint64 mtime;
+
+  g_return_val_if_fail (log_filename != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  /* Get the modification time first, so that if the log is modified while
+   * it’s being scanned, the index will be considered stale next time. */
+  if (!_dfl_log_index_stat_log (log_filename, NULL, &mtime, error))
+    return NULL;
+
+  mapped_file = g_mapped_file_new (log_filename, FALSE, error);
+
+  if (mapped_file == NULL)
+    return NULL;
+
+  index = _dfl_parser_build_log_index (g_mapped_file_get_contents (mapped_file),
+                                       g_mapped_file_get_length (mapped_file),
+                                       error);
+
+  if (index != NULL)
+    _dfl_log_index_set_log (index, log_filename,
+                            g_mapped_file_get_length (mapped_file), mtime);
+
+  g_mapped_file_unref (mapped_file);
+
+  return index;
+}
+
+static guint16
+read_uint16_le (const guint8 *data)
+{
+  guint16 value;
+
+  memcpy (&value, data, sizeof (value));
+
+  return GUINT16_FROM_LE (value);
+}
+
+static guint64
+read_uint64_le (const guint8 *data)
+{
+  guint64 value;
+
+  memcpy (&value, data, sizeof (value));
+
+  return GUINT64_FROM_LE (value);
+}
+
+static void
+append_uint64_le (GByteArray *buffer,
+                  guint64     value)
+{
+  value = GUINT64_TO_LE (value);
+  g_byte_array_append (buffer, (const guint8 *) &value, sizeof (value));
+}
+
+/* Read @n_elements elements of @n_fields u64s each from @data into @array,
+ * advancing @offset. Returns %FALSE if @data is too short. */
+static gboolean
+read_uint64_array (const guint8 *data,
+                   gsize         length,
+                   gsize        *offset,
+                   guint64       n_elements,
+                   guint         n_fields,
+                   GArray       *array)
+{
+  guint64 i;
+  guint j;
+
+  if (n_elements > (length - *offset) / (n_fields * sizeof (guint64)))
+    return FALSE;
+
+  g_array_set_size (array, n_elements);
+
+  for (i = 0; i < n_elements; i++)
+    {
+      guint64 *element = (guint64 *) (array->data +
+                                      i * n_fields * sizeof (guint64));
+
+      for (j = 0; j < n_fields; j++)
+        {
+          element[j] = read_uint64_le (data + *offset);
+          *offset += sizeof (guint64);
+        }
+    }
+
+  return TRUE;
+}
+
+/**
+ * dfl_log_index_load:
+ * @log_filename: (type filename): path to a text log
+ * @error: return location for a #GError, or %NULL
+ *
+ * Load the index for the log at @log_filename from its sidecar file. If there
+ * is no index, or it is out of date with respect to the log, an error is
+ * returned; the index can then be rebuilt with dfl_log_index_build().
+ *
+ * Returns: (transfer full): the index, or %NULL on error
+ * Since: UNRELEASED
+ */
+DflLogIndex *
+dfl_log_index_load (const gchar  *log_filename,
+                    GError      **error)
+{
+  DflLogIndex *index = NULL;
+  gchar *index_filename = NULL;
+  gchar *contents = NULL;
+  const guint8 *data;
+  gsize length, offset, i;
+  guint64 log_size, log_mtime;
+  guint64 n_blocks, n_threads, n_event_types, n_lifetime_offsets;
+  const DflLogIndexBlock *blocks;
+  const guint64 *lifetime_offsets;
+  GError *child_error = NULL;
+
+  g_return_val_if_fail (log_filename != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (!_dfl_log_index_stat_log (log_filename, &log_size, &log_mtime, error))
+    return NULL;
+
+  index_filename = index_filename_for_log (log_filename);
+
+  if (!g_file_get_contents (index_filename, &contents, &length, error))
+    goto done;
+
+  data = (const guint8 *) contents;
+
+  /* Header. */
+  if (length < DFL_LOG_INDEX_HEADER_LENGTH ||
+      memcmp (data, DFL_LOG_INDEX_MAGIC, DFL_LOG_INDEX_MAGIC_LENGTH) != 0)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid log index file ‘%s’ — %s", index_filename,
+                   "header is invalid");
+      goto done;
+    }
+
+  if (read_uint16_le (data + 8) != DFL_LOG_INDEX_VERSION_MAJOR)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid log index file ‘%s’ — %s", index_filename,
+                   "unsupported version");
+      goto done;
+    }
+
+  if (read_uint64_le (data + 16) != log_size ||
+      read_uint64_le (data + 24) != log_mtime)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid log index file ‘%s’ — %s", index_filename,
+                   "log has changed since it was indexed");
+      goto done;
+    }
+
+  index = g_object_new (DFL_TYPE_LOG_INDEX, NULL);
+  index->log_filename = g_strdup (log_filename);
+  index->log_size = log_size;
+  index->log_mtime = log_mtime;
+  index->initial_timestamp = read_uint64_le (data + 32);
+  index->final_timestamp = read_uint64_le (data + 40);
+  n_blocks = read_uint64_le (data + 48);
+  n_threads = read_uint64_le (data + 56);
+  n_event_types = read_uint64_le (data + 64);
+  n_lifetime_offsets = read_uint64_le (data + 72);
+  offset = DFL_LOG_INDEX_HEADER_LENGTH;
+
+  G_STATIC_ASSERT (sizeof (DflLogIndexBlock) == 3 * sizeof (guint64));
+  G_STATIC_ASSERT (sizeof (DflLogIndexThread) == 4 * sizeof (guint64));
+
+  if (!read_uint64_array (data, length, &offset, n_blocks, 3,
+                          index->blocks) ||
+      !read_uint64_array (data, length, &offset, n_threads, 4,
+                          index->threads) ||
+      !read_uint64_array (data, length, &offset, n_event_types, 1,
+                          index->event_type_counts) ||
+      !read_uint64_array (data, length, &offset, n_lifetime_offsets, 1,
+                          index->lifetime_offsets) ||
+      offset != length)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid log index file ‘%s’ — %s", index_filename,
+                   "file is truncated");
+      goto done;
+    }
+
+  /* Check the offsets are in order and within the log, so the parser can
+   * trust them. */
+  blocks = _dfl_log_index_get_blocks (index, &n_blocks);
+  lifetime_offsets = _dfl_log_index_get_lifetime_offsets (index,
+                                                          &n_lifetime_offsets);
+
+  for (i = 0; i < n_blocks; i++)
+    {
+      if (blocks[i].offset >= log_size ||
+          (i > 0 && blocks[i].offset <= blocks[i - 1].offset))
+        break;
+    }
+
+  if (i == n_blocks)
+    {
+      for (i = 0; i < n_lifetime_offsets; i++)
+        {
+          if (lifetime_offsets[i] >= log_size ||
+              (i > 0 && lifetime_offsets[i] <= lifetime_offsets[i - 1]))
+            break;
+        }
+
+      if (i == n_lifetime_offsets)
+        goto done;
+    }
+
+  /* TODO: Use a proper error code here. */
+  g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+               "Invalid log index file ‘%s’ — %s", index_filename,
+               "offsets are out of order");
+
+done:
+  g_free (contents);
+  g_free (index_filename);
+
+  if (child_error != NULL)
+    {
+      g_propagate_error (error, child_error);
+      g_clear_object (&index);
+    }
+
+  return index;
+}
+
+/**
+ * dfl_log_index_save:
+ * @self: a #DflLogIndex
+ * @error: return location for a #GError, or %NULL
+ *
+ * Save the index to its sidecar file, next to its log, replacing any existing
+ * index atomically.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_log_index_save (DflLogIndex  *self,
+                    GError      **error)
+{
+  GByteArray *buffer = NULL;
+  gchar *index_filename = NULL;
+  guint16 version[2];
+  guint32 reserved = 0;
+  guint i;
+
+  g_return_if_fail (DFL_IS_LOG_INDEX (self));
+  g_return_if_fail (self->log_filename != NULL);
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  buffer = g_byte_array_new ();
+
+  /* Header. */
+  version[0] = GUINT16_TO_LE (DFL_LOG_INDEX_VERSION_MAJOR);
+  version[1] = GUINT16_TO_LE (DFL_LOG_INDEX_VERSION_MINOR);
+
+  g_byte_array_append (buffer, (const guint8 *) DFL_LOG_INDEX_MAGIC,
+                       DFL_LOG_INDEX_MAGIC_LENGTH);
+  g_byte_array_append (buffer, (const guint8 *) version, sizeof (version));
+  g_byte_array_append (buffer, (const guint8 *) &reserved, sizeof (reserved));
+  append_uint64_le (buffer, self->log_size);
+  append_uint64_le (buffer, self->log_mtime);
+  append_uint64_le (buffer, self->initial_timestamp);
+  append_uint64_le (buffer, self->final_timestamp);
+  append_uint64_le (buffer, self->blocks->len);
+  append_uint64_le (buffer, self->threads->len);
+  append_uint64_le (buffer, self->event_type_counts->len);
+  append_uint64_le (buffer, self->lifetime_offsets->len);
+
+  g_assert (buffer->len == DFL_LOG_INDEX_HEADER_LENGTH);
+
+  /* Tables. */
+  for (i = 0; i < self->blocks->len; i++)
+    {
+      const DflLogIndexBlock *block = &g_array_index (self->blocks,
+                                                      DflLogIndexBlock, i);
+
+      append_uint64_le (buffer, block->offset);
+      append_uint64_le (buffer, block->min_timestamp);
+      append_uint64_le (buffer, block->max_timestamp);
+    }
+
+  for (i = 0; i < self->threads->len; i++)
+    {
+      const DflLogIndexThread *thread = &g_array_index (self->threads,
+                                                        DflLogIndexThread, i);
+
+      append_uint64_le (buffer, thread->thread_id);
+      append_uint64_le (buffer, thread->first_timestamp);
+      append_uint64_le (buffer, thread->last_timestamp);
+      append_uint64_le (buffer, thread->n_events);
+    }
+
+  for (i = 0; i < self->event_type_counts->len; i++)
+    append_uint64_le (buffer, g_array_index (self->event_type_counts,
+                                             guint64, i));
+
+  for (i = 0; i < self->lifetime_offsets->len; i++)
+    append_uint64_le (buffer, g_array_index (self->lifetime_offsets,
+                                             guint64, i));
+
+  index_filename = index_filename_for_log (self->log_filename);
+  g_file_set_contents (index_filename, (const gchar *) buffer->data,
+                       buffer->len, error);
+
+  g_free (index_filename);
+  g_byte_array_unref (buffer);
+}
+
+/**
+ * dfl_log_index_get_log_filename:
+ * @self: a #DflLogIndex
+ *
+ * Get the path of the log which this index is for.
+ *
+ * Returns: (type filename): path to the log
+ * Since: UNRELEASED
+ */
+const gchar *
+dfl_log_index_get_log_filename (DflLogIndex *self)
+{
+  g_return_val_if_fail (DFL_IS_LOG_INDEX (self), NULL);
+
+  return self->log_filename;
+}
+
+/**
+ * dfl_log_index_get_initial_timestamp:
+ * @self: a #DflLogIndex
+ *
+ * Get the initial timestamp from the log’s header.
+ *
+ * Returns: initial timestamp of the log
+ * Since: UNRELEASED
+ */
+DflTimestamp
+dfl_log_index_get_initial_timestamp (DflLogIndex *self)
+{
+  g_return_val_if_fail (DFL_IS_LOG_INDEX (self), 0);
+
+  return self->initial_timestamp;
+}
+
+/**
+ * dfl_log_index_get_final_timestamp:
+ * @self: a #DflLogIndex
+ *
+ * Get the highest timestamp of any event in the log. If the log contains no
+ * events, this is the same as dfl_log_index_get_initial_timestamp().
+ *
+ * Returns: final timestamp of the log
+ * Since: UNRELEASED
+ */
+DflTimestamp
+dfl_log_index_get_final_timestamp (DflLogIndex *self)
+{
+  g_return_val_if_fail (DFL_IS_LOG_INDEX (self), 0);
+
+  return self->final_timestamp;
+}
+
+/**
+ * dfl_log_index_get_threads:
+ * @self: a #DflLogIndex
+ * @n_threads: (out caller-allocates): return location for the number of
+ *    threads
+ *
+ * Get a summary of each thread in the log, in the order in which the threads
+ * first appear in it.
+ *
+ * Returns: (array length=n_threads) (transfer none): thread summaries
+ * Since: UNRELEASED
+ */
+const DflLogIndexThread *
+dfl_log_index_get_threads (DflLogIndex *self,
+                           gsize       *n_threads)
+{
+  g_return_val_if_fail (DFL_IS_LOG_INDEX (self), NULL);
+  g_return_val_if_fail (n_threads != NULL, NULL);
+
+  *n_threads = self->threads->len;
+
+  return (const DflLogIndexThread *) self->threads->data;
+}
+
+/**
+ * dfl_log_index_get_event_type_count:
+ * @self: a #DflLogIndex
+ * @event_type: an event type, such as `g_source_new`
+ *
+ * Get the number of events of type @event_type in the log. Unrecognised event
+ * types are ignored when parsing a log, so they always have a count of zero.
+ *
+ * Returns: number of events of the given type
+ * Since: UNRELEASED
+ */
+guint64
+dfl_log_index_get_event_type_count (DflLogIndex *self,
+                                    const gchar *event_type)
+{
+  guint16 code;
+  guint n_parameters;
+
+  g_return_val_if_fail (DFL_IS_LOG_INDEX (self), 0);
+  g_return_val_if_fail (event_type != NULL, 0);
+
+  if (!_dfl_parser_event_type_to_code (event_type, &code, &n_parameters) ||
+      code >= self->event_type_counts->len)
+    return 0;
+
+  return g_array_index (self->event_type_counts, guint64, code);
+}
@@ -0,0 +1,78 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_LOG_INDEX_H
+#define DFL_LOG_INDEX_H
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "types.h"
+
+G_BEGIN_DECLS
+
+/**
+ * DflLogIndexThread:
+ * @thread_id: ID of the thread
+ * @first_timestamp: timestamp of the first event in the thread
+ * @last_timestamp: timestamp of the last event in the thread
+ * @n_events: number of events in the thread
+ *
+ * Summary of the events from one thread in an indexed log.
+ *
+ * Since: UNRELEASED
+ */
+typedef struct
+{
+  DflThreadId thread_id;
+  DflTimestamp first_timestamp;
+  DflTimestamp last_timestamp;
+  guint64 n_events;
+} DflLogIndexThread;
+
+/**
+ * DflLogIndex:
+ *
+ * All the fields in this structure are private.
+ *
+ * Since: UNRELEASED
+ */
+#define DFL_TYPE_LOG_INDEX dfl_log_index_get_type ()
+G_DECLARE_FINAL_TYPE (DflLogIndex, dfl_log_index, DFL, LOG_INDEX, GObject)
+
+DflLogIndex *dfl_log_index_build (const gchar  *log_filename,
+                                  GError      **error);
+DflLogIndex *dfl_log_index_load  (const gchar  *log_filename,
+                                  GError      **error);
+void         dfl_log_index_save  (DflLogIndex  *self,
+                                  GError      **error);
+
+const gchar *dfl_log_index_get_log_filename (DflLogIndex *self);
+
+DflTimestamp dfl_log_index_get_initial_timestamp (DflLogIndex *self);
+DflTimestamp dfl_log_index_get_final_timestamp   (DflLogIndex *self);
+
+const DflLogIndexThread *dfl_log_index_get_threads (DflLogIndex *self,
+                                                    gsize       *n_threads);
+
+guint64 dfl_log_index_get_event_type_count (DflLogIndex *self,
+                                            const gchar *event_type);
+
+G_END_DECLS
+
+#endif /* !DFL_LOG_INDEX_H */
@@ -35,7 +35,9 @@
 #include <string.h>
 
 #include "event.h"
+#include "event-sequence-private.h"
 #include "main-context.h"
+#include "model-cache-private.h"
 #include "time-sequence.h"
 
 
@@ -62,6 +64,16 @@ struct _DflMainContext
    * dispatch. A duration of ≥ 0 is valid; < 0 is not. */
   DflTimeSequence/*<DflMainContextDispatchData>*/ dispatch_events;
 
+  /* Sequence of main loop iterations (starting at the
+   * g_main_context_prepare() call), with the time spent in each phase. A
+   * duration of ≥ 0 is valid; < 0 means the phase was not seen. */
+  DflTimeSequence/*<DflMainContextIterationData>*/ iteration_events;
+
+  /* Type and timestamp of the most recent phase event of the last iteration;
+   * only used while building @iteration_events. */
+  const gchar *phase_start_event_type;  /* interned */
+  DflTimestamp phase_start_timestamp;
+
   /* TODO */
   DflTimeSequence source_events;
   DflTimeSequence thread_default_events;
@@ -82,10 +94,21 @@ dfl_main_context_init (DflMainContext *self)
 {
   dfl_time_sequence_init (&self->thread_ownership_events,
                           sizeof (DflThreadOwnershipData), NULL, 0);
+  dfl_time_sequence_add_interval_index (&self->thread_ownership_events,
+                                        G_STRUCT_OFFSET (DflThreadOwnershipData,
+                                                         duration));
   dfl_time_sequence_init (&self->thread_acquisition_failure_events,
                           sizeof (DflThreadId), NULL, 0);
   dfl_time_sequence_init (&self->dispatch_events,
                           sizeof (DflMainContextDispatchData), NULL, 0);
+  dfl_time_sequence_add_aggregate (&self->dispatch_events,
+                                   G_STRUCT_OFFSET (DflMainContextDispatchData,
+                                                    duration));
+  dfl_time_sequence_add_interval_index (&self->dispatch_events,
+                                        G_STRUCT_OFFSET (DflMainContextDispatchData,
+                                                         duration));
+  dfl_time_sequence_init (&self->iteration_events,
+                          sizeof (DflMainContextIterationData), NULL, 0);
 
 #if 0
 TODO
@@ -99,6 +122,7 @@ dfl_main_context_dispose (GObject *object)
 {
   DflMainContext *self = DFL_MAIN_CONTEXT (object);
 
+  dfl_time_sequence_clear (&self->iteration_events);
   dfl_time_sequence_clear (&self->dispatch_events);
   dfl_time_sequence_clear (&self->thread_default_events);
   dfl_time_sequence_clear (&self->source_events);
@@ -188,7 +212,7 @@ main_context_acquire_release_cb (DflEventSequence *sequence,
   else
     {
       DflThreadOwnershipData *last_element;
-      DflTimestamp last_timestamp;
+      DflTimestamp last_timestamp, window_start;
 
       /* Check that the previous element in the sequence has an invalid (zero)
        * duration, otherwise no acquire event was logged.
@@ -197,7 +221,19 @@ main_context_acquire_release_cb (DflEventSequence *sequence,
       last_element = dfl_time_sequence_get_last_element (&main_context->thread_ownership_events,
                                                          &last_timestamp);
 
-      if (last_element == NULL)
+      if (last_element == NULL &&
+          _dfl_event_sequence_get_window_start (sequence, &window_start) &&
+          window_start <= timestamp)
+        {
+          /* The acquire was before the start of the loaded time range, so
+           * clip the span to start there. */
+          last_element = dfl_time_sequence_append (&main_context->thread_ownership_events,
+                                                   window_start);
+          last_timestamp = window_start;
+          last_element->thread_id = thread_id;
+          last_element->duration = -1;
+        }
+      else if (last_element == NULL)
         {
           /* TODO: Some better error reporting framework than g_warning(). */
           g_warning ("Saw a g_main_context_release() call for a context with "
@@ -313,7 +349,7 @@ main_context_before_after_dispatch_cb (DflEventSequence *sequence,
   else
     {
       DflMainContextDispatchData *last_element;
-      DflTimestamp last_timestamp;
+      DflTimestamp last_timestamp, window_start;
 
       /* Check that the previous element in the sequence has an invalid (zero)
        * duration, otherwise no //before// event was logged.
@@ -322,7 +358,19 @@ main_context_before_after_dispatch_cb (DflEventSequence *sequence,
       last_element = dfl_time_sequence_get_last_element (&main_context->dispatch_events,
                                                          &last_timestamp);
 
-      if (last_element == NULL)
+      if (last_element == NULL &&
+          _dfl_event_sequence_get_window_start (sequence, &window_start) &&
+          window_start <= timestamp)
+        {
+          /* The dispatch started before the start of the loaded time range,
+           * so clip it to start there. */
+          last_element = dfl_time_sequence_append (&main_context->dispatch_events,
+                                                   window_start);
+          last_timestamp = window_start;
+          last_element->thread_id = thread_id;
+          last_element->duration = -1;
+        }
+      else if (last_element == NULL)
         {
           /* TODO: Some better error reporting framework than g_warning(). */
           g_warning ("Saw a g_main_context_dispatch() call finish for a "
@@ -366,6 +414,103 @@ main_context_before_after_dispatch_cb (DflEventSequence *sequence,
     }
 }
 
+/* Build up the phases of each main loop iteration. GLib emits the phase events
+ * in a fixed order for each iteration: prepare, query, poll (between the query
+ * and the check), check (during which a wakeup from another thread is
+ * acknowledged), then dispatch. Events which don’t belong to an iteration
+ * which has been seen starting on the same thread are ignored, as the log (or
+ * the loaded time range) may start part-way through an iteration. */
+static void
+main_context_iteration_cb (DflEventSequence *sequence,
+                           DflEvent         *event,
+                           gpointer          user_data)
+{
+  DflMainContext *main_context = user_data;
+  const gchar *event_type;
+  DflTimestamp timestamp, iteration_timestamp;
+  DflThreadId thread_id;
+  DflMainContextIterationData *iteration;
+  DflDuration phase_duration;
+
+  /* Does this event correspond to the right main context? */
+  g_assert (dfl_event_get_parameter_id (event, 0) == main_context->id);
+
+  event_type = dfl_event_get_event_type (event);
+  timestamp = dfl_event_get_timestamp (event);
+  thread_id = dfl_event_get_thread_id (event);
+
+  if (event_type == g_intern_static_string ("g_main_context_before_prepare"))
+    {
+      /* Start the next iteration. */
+      iteration = dfl_time_sequence_append (&main_context->iteration_events,
+                                            timestamp);
+      iteration->thread_id = thread_id;
+      iteration->prepare_duration = -1;
+      iteration->query_duration = -1;
+      iteration->poll_duration = -1;
+      iteration->check_duration = -1;
+      iteration->dispatch_duration = -1;
+      iteration->woken_up = FALSE;
+
+      main_context->phase_start_event_type = event_type;
+      main_context->phase_start_timestamp = timestamp;
+
+      return;
+    }
+
+  iteration = dfl_time_sequence_get_last_element (&main_context->iteration_events,
+                                                  &iteration_timestamp);
+
+  if (iteration == NULL || iteration->thread_id != thread_id)
+    return;
+
+  /* Each phase is timed from the event which started it; if that was not the
+   * most recent phase event (for example, because the recorder dropped an
+   * event), the duration is left unknown. */
+  phase_duration = timestamp - main_context->phase_start_timestamp;
+
+  if (event_type == g_intern_static_string ("g_main_context_wakeup_acknowledge"))
+    {
+      iteration->woken_up = TRUE;
+      return;
+    }
+  else if (event_type == g_intern_static_string ("g_main_context_after_prepare"))
+    {
+      if (main_context->phase_start_event_type ==
+          g_intern_static_string ("g_main_context_before_prepare"))
+        iteration->prepare_duration = phase_duration;
+    }
+  else if (event_type == g_intern_static_string ("g_main_context_after_query"))
+    {
+      if (main_context->phase_start_event_type ==
+          g_intern_static_string ("g_main_context_before_query"))
+        iteration->query_duration = phase_duration;
+    }
+  else if (event_type == g_intern_static_string ("g_main_context_before_check"))
+    {
+      /* The poll runs from the end of the query to the start of the check. */
+      if (main_context->phase_start_event_type ==
+          g_intern_static_string ("g_main_context_after_query"))
+        iteration->poll_duration = phase_duration;
+    }
+  else if (event_type == g_intern_static_string ("g_main_context_after_check"))
+    {
+      if (main_context->phase_start_event_type ==
+          g_intern_static_string ("g_main_context_before_check"))
+        iteration->check_duration = phase_duration;
+    }
+  else if (event_type ==
+           g_intern_static_string ("g_main_context_after_dispatch"))
+    {
+      if (main_context->phase_start_event_type ==
+          g_intern_static_string ("g_main_context_before_dispatch"))
+        iteration->dispatch_duration = phase_duration;
+    }
+
+  main_context->phase_start_event_type = event_type;
+  main_context->phase_start_timestamp = timestamp;
+}
+
 static void
 main_context_new_cb (DflEventSequence *sequence,
                      DflEvent         *event,
@@ -374,6 +519,18 @@ main_context_new_cb (DflEventSequence *sequence,
   GPtrArray/*<owned DflMainContext>*/ *main_contexts = user_data;
   DflMainContext *main_context = NULL;
   DflId main_context_id;
+  gsize i;
+  const gchar * const iteration_event_types[] = {
+    "g_main_context_before_prepare",
+    "g_main_context_after_prepare",
+    "g_main_context_before_query",
+    "g_main_context_after_query",
+    "g_main_context_before_check",
+    "g_main_context_wakeup_acknowledge",
+    "g_main_context_after_check",
+    "g_main_context_before_dispatch",
+    "g_main_context_after_dispatch",
+  };
 
   main_context_id = dfl_event_get_parameter_id (event, 0);
   main_context = dfl_main_context_new (main_context_id,
@@ -381,31 +538,44 @@ main_context_new_cb (DflEventSequence *sequence,
 
   dfl_event_sequence_start_walker_group (sequence);
 
-  dfl_event_sequence_add_walker (sequence, "g_main_context_acquire",
-                                 main_context_id,
-                                 main_context_acquire_release_cb,
-                                 g_object_ref (main_context),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_main_context_release",
-                                 main_context_id,
-                                 main_context_acquire_release_cb,
-                                 g_object_ref (main_context),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_main_context_free",
-                                 main_context_id,
-                                 main_context_free_cb,
-                                 g_object_ref (main_context),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_main_context_before_dispatch",
-                                 main_context_id,
-                                 main_context_before_after_dispatch_cb,
-                                 g_object_ref (main_context),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_main_context_after_dispatch",
-                                 main_context_id,
-                                 main_context_before_after_dispatch_cb,
-                                 g_object_ref (main_context),
-                                 (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_main_context_acquire",
+                                      main_context_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      main_context_acquire_release_cb,
+                                      g_object_ref (main_context),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_main_context_release",
+                                      main_context_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      main_context_acquire_release_cb,
+                                      g_object_ref (main_context),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_main_context_free",
+                                      main_context_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      main_context_free_cb,
+                                      g_object_ref (main_context),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_main_context_before_dispatch",
+                                      main_context_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      main_context_before_after_dispatch_cb,
+                                      g_object_ref (main_context),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_main_context_after_dispatch",
+                                      main_context_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      main_context_before_after_dispatch_cb,
+                                      g_object_ref (main_context),
+                                      (GDestroyNotify) g_object_unref);
+
+  for (i = 0; i < G_N_ELEMENTS (iteration_event_types); i++)
+    dfl_event_sequence_add_walker_full (sequence, iteration_event_types[i],
+                                        main_context_id,
+                                        DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                        main_context_iteration_cb,
+                                        g_object_ref (main_context),
+                                        (GDestroyNotify) g_object_unref);
 
   dfl_event_sequence_end_walker_group (sequence, "g_main_context_free",
                                        main_context_id);
@@ -437,6 +607,49 @@ dfl_main_context_factory_from_event_sequence (DflEventSequence *sequence)
   return main_contexts;
 }
 
+/* Serialise the analysed state of @self to a model cache. See
+ * model-cache-private.h. */
+void
+_dfl_main_context_save_cache (DflMainContext      *self,
+                              DflModelCacheWriter *writer)
+{
+  _dfl_model_cache_writer_add_uint64 (writer, self->id);
+  _dfl_model_cache_writer_add_uint64 (writer, self->new_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->free_timestamp);
+
+  _dfl_time_sequence_save_cache (&self->thread_ownership_events, writer);
+  _dfl_time_sequence_save_cache (&self->thread_acquisition_failure_events,
+                                 writer);
+  _dfl_time_sequence_save_cache (&self->dispatch_events, writer);
+  _dfl_time_sequence_save_cache (&self->iteration_events, writer);
+}
+
+DflMainContext *
+_dfl_main_context_load_cache (DflModelCacheReader *reader)
+{
+  g_autoptr (DflMainContext) main_context = NULL;
+  DflId id;
+  DflTimestamp new_timestamp;
+
+  id = _dfl_model_cache_reader_read_uint64 (reader);
+  new_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+
+  main_context = dfl_main_context_new (id, new_timestamp);
+  main_context->free_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+
+  if (!_dfl_time_sequence_load_cache (&main_context->thread_ownership_events,
+                                      reader) ||
+      !_dfl_time_sequence_load_cache (&main_context->thread_acquisition_failure_events,
+                                      reader) ||
+      !_dfl_time_sequence_load_cache (&main_context->dispatch_events,
+                                      reader) ||
+      !_dfl_time_sequence_load_cache (&main_context->iteration_events,
+                                      reader))
+    return NULL;
+
+  return g_steal_pointer (&main_context);
+}
+
 /**
  * dfl_main_context_get_id:
  * @self: a #DflMainContext
@@ -529,3 +742,59 @@ dfl_main_context_dispatch_iter (DflMainContext      *self,
 
   dfl_time_sequence_iter_init (iter, &self->dispatch_events, start);
 }
+
+/**
+ * dfl_main_context_get_dispatch_aggregate:
+ * @self: a #DflMainContext
+ * @start: timestamp to start from (inclusive)
+ * @end: timestamp to end at (exclusive)
+ * @aggregate: (out caller-allocates): return location for the statistics
+ *
+ * Get the number of dispatches of this main context which started in
+ * [@start, @end), along with their total, minimum and maximum durations. This
+ * takes O(log n) time in the number of dispatches, so is suitable for
+ * summarising arbitrarily large windows of the timeline.
+ *
+ * Returns: %TRUE if there were any dispatches in the range, %FALSE otherwise
+ * Since: UNRELEASED
+ */
+gboolean
+dfl_main_context_get_dispatch_aggregate (DflMainContext           *self,
+                                         DflTimestamp              start,
+                                         DflTimestamp              end,
+                                         DflTimeSequenceAggregate *aggregate)
+{
+  g_return_val_if_fail (DFL_IS_MAIN_CONTEXT (self), FALSE);
+  g_return_val_if_fail (aggregate != NULL, FALSE);
+
+  return dfl_time_sequence_get_aggregate (&self->dispatch_events,
+                                          G_STRUCT_OFFSET (DflMainContextDispatchData,
+                                                           duration),
+                                          start, end, aggregate);
+}
+
+/**
+ * dfl_main_context_iteration_iter:
+ * @self: a #DflMainContext
+ * @iter: an uninitialised #DflTimeSequenceIter to use
+ * @start: optional timestamp to start iterating from, or 0
+ *
+ * Iterate over the main loop iterations of this main context, each of which is
+ * a #DflMainContextIterationData giving the time spent in each phase of the
+ * iteration. The timestamp of each element is the start of the iteration.
+ *
+ * This requires a log which contains the main context prepare, query and check
+ * events, such as one recorded by `dunfell-record`.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_main_context_iteration_iter (DflMainContext      *self,
+                                 DflTimeSequenceIter *iter,
+                                 DflTimestamp         start)
+{
+  g_return_if_fail (DFL_IS_MAIN_CONTEXT (self));
+  g_return_if_fail (iter != NULL);
+
+  dfl_time_sequence_iter_init (iter, &self->iteration_events, start);
+}
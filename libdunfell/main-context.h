@@ -57,6 +57,39 @@ typedef struct
   DflDuration duration;
 } DflMainContextDispatchData;
 
+/**
+ * DflMainContextIterationData:
+ * @thread_id: ID of the thread which ran the iteration
+ * @prepare_duration: time spent in g_main_context_prepare(), or a negative
+ *    value if unknown
+ * @query_duration: time spent in g_main_context_query(), or a negative value
+ *    if unknown
+ * @poll_duration: time spent waiting in the poll function between the query
+ *    and the check, or a negative value if unknown
+ * @check_duration: time spent in g_main_context_check(), or a negative value
+ *    if unknown
+ * @dispatch_duration: time spent in g_main_context_dispatch(), or a negative
+ *    value if unknown
+ * @woken_up: %TRUE if the poll was ended by a g_main_context_wakeup() call
+ *    from another thread
+ *
+ * Breakdown of the time spent in each phase of one iteration of a main
+ * context. Comparing the phases shows whether a slow main loop is dominated by
+ * dispatching callbacks, or by the prepare and check functions of its sources.
+ *
+ * Since: UNRELEASED
+ */
+typedef struct
+{
+  DflThreadId thread_id;
+  DflDuration prepare_duration;
+  DflDuration query_duration;
+  DflDuration poll_duration;
+  DflDuration check_duration;
+  DflDuration dispatch_duration;
+  gboolean woken_up;
+} DflMainContextIterationData;
+
 /**
  * DflMainContext:
  *
@@ -82,6 +115,13 @@ void dfl_main_context_thread_ownership_iter (DflMainContext      *self,
 void dfl_main_context_dispatch_iter (DflMainContext      *self,
                                      DflTimeSequenceIter *iter,
                                      DflTimestamp         start);
+gboolean dfl_main_context_get_dispatch_aggregate (DflMainContext           *self,
+                                                  DflTimestamp              start,
+                                                  DflTimestamp              end,
+                                                  DflTimeSequenceAggregate *aggregate);
+void dfl_main_context_iteration_iter (DflMainContext      *self,
+                                      DflTimeSequenceIter *iter,
+                                      DflTimestamp         start);
 
 G_END_DECLS
 
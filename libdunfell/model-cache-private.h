@@ -0,0 +1,157 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_MODEL_CACHE_PRIVATE_H
+#define DFL_MODEL_CACHE_PRIVATE_H
+
+#include <glib.h>
+
+#include "atom-table.h"
+#include "main-context.h"
+#include "source.h"
+#include "task.h"
+#include "thread.h"
+#include "time-sequence.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Model cache file format, version 1.0. The cache for a log at `path` is
+ * stored at `path.model`. All integers are in host byte order, as time
+ * sequence payloads are stored exactly as they are laid out in memory so they
+ * can be copied straight out of the mapped file; a cache from a machine with a
+ * different byte order or structure layout is rejected, and rebuilt.
+ *
+ * Header (104 bytes):
+ *    magic[8]          "\x89" "DFM\r\n\x1a\n"
+ *    u16               major version (1)
+ *    u16               minor version (0)
+ *    u32               byte order mark (0x01020304)
+ *    u64               size of the log, in bytes
+ *    u64               modification time of the log (seconds since the epoch)
+ *    u8[32]            SHA-256 checksum of the first and last
+ *                      DFL_MODEL_CACHE_CHECKSUM_LENGTH bytes of the log
+ *    u64               number of atoms (n_atoms)
+ *    u64               number of main contexts (n_main_contexts)
+ *    u64               number of threads (n_threads)
+ *    u64               number of sources (n_sources)
+ *    u64               number of tasks (n_tasks)
+ *
+ * followed by:
+ *    n_atoms × { u64 length, u8 string[length], padding }
+ *    n_main_contexts × main context
+ *    n_threads × thread
+ *    n_sources × source
+ *    n_tasks × task
+ *
+ * Atoms are listed in order, starting from 1, and are re-interned in that
+ * order when loading. Each object is a fixed sequence of u64 fields followed
+ * by its time sequences, as written by its _dfl_*_save_cache() function. A
+ * time sequence is:
+ *    u64               number of elements (n_elements)
+ *    u64               size of each element, including its timestamp
+ *    u8                elements[n_elements × size], padding
+ *
+ * Padding is to a multiple of 8 bytes.
+ *
+ * The cache is considered stale, and is ignored, if the log’s size,
+ * modification time or checksum differ from those recorded in it. The major
+ * version must be bumped whenever the analysis in #DflModel changes.
+ */
+
+#define DFL_MODEL_CACHE_MAGIC "\x89" "DFM\r\n\x1a\n"
+#define DFL_MODEL_CACHE_MAGIC_LENGTH 8
+#define DFL_MODEL_CACHE_VERSION_MAJOR 1
+#define DFL_MODEL_CACHE_VERSION_MINOR 0
+#define DFL_MODEL_CACHE_BYTE_ORDER_MARK 0x01020304
+#define DFL_MODEL_CACHE_HEADER_LENGTH 104
+#define DFL_MODEL_CACHE_CHECKSUM_LENGTH (64 * 1024)
+
+typedef struct
+{
+  guint64 log_size;
+  guint64 log_mtime;
+  guint8 log_checksum[32];
+} DflModelCacheKey;
+
+gboolean _dfl_model_cache_key_compute (DflModelCacheKey  *key,
+                                       const gchar       *log_filename,
+                                       GError           **error);
+
+/* Appends fields to a cache file being built in memory. */
+typedef struct
+{
+  GByteArray *buffer;  /* owned */
+} DflModelCacheWriter;
+
+void _dfl_model_cache_writer_add_uint64 (DflModelCacheWriter *writer,
+                                         guint64              value);
+void _dfl_model_cache_writer_add_data   (DflModelCacheWriter *writer,
+                                         gconstpointer        data,
+                                         gsize                length);
+
+/* Reads fields from a mapped cache file. Reading past the end of the file
+ * sets @invalid and returns zeroes, so callers can read a whole object and
+ * check for errors once. If @mapped_file is set, @data is its contents, and
+ * time sequences keep a reference to it and use their elements in place rather
+ * than copying them. */
+typedef struct
+{
+  const guint8 *data;  /* unowned */
+  gsize length;
+  gsize offset;
+  gboolean invalid;
+  GMappedFile *mapped_file;  /* unowned; nullable */
+} DflModelCacheReader;
+
+guint64       _dfl_model_cache_reader_read_uint64 (DflModelCacheReader *reader);
+gconstpointer _dfl_model_cache_reader_read_data   (DflModelCacheReader *reader,
+                                                   gsize                length);
+DflAtom       _dfl_model_cache_reader_read_atom   (DflModelCacheReader *reader,
+                                                   DflAtomTable        *atom_table);
+
+/* Each of these is implemented alongside the type it serialises. The load
+ * functions return %NULL (or %FALSE) and set @reader->invalid if the cache is
+ * truncated or inconsistent. */
+void     _dfl_time_sequence_save_cache (DflTimeSequence     *sequence,
+                                        DflModelCacheWriter *writer);
+gboolean _dfl_time_sequence_load_cache (DflTimeSequence     *sequence,
+                                        DflModelCacheReader *reader);
+
+void            _dfl_main_context_save_cache (DflMainContext      *self,
+                                              DflModelCacheWriter *writer);
+DflMainContext *_dfl_main_context_load_cache (DflModelCacheReader *reader);
+
+void       _dfl_thread_save_cache (DflThread           *self,
+                                   DflModelCacheWriter *writer);
+DflThread *_dfl_thread_load_cache (DflModelCacheReader *reader,
+                                   DflAtomTable        *atom_table);
+
+void       _dfl_source_save_cache (DflSource           *self,
+                                   DflModelCacheWriter *writer);
+DflSource *_dfl_source_load_cache (DflModelCacheReader *reader,
+                                   DflAtomTable        *atom_table);
+
+void     _dfl_task_save_cache (DflTask             *self,
+                               DflModelCacheWriter *writer);
+DflTask *_dfl_task_load_cache (DflModelCacheReader *reader,
+                               DflAtomTable        *atom_table);
+
+G_END_DECLS
+
+#endif /* !DFL_MODEL_CACHE_PRIVATE_H */
@@ -0,0 +1,175 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "atom-table.h"
+#include "model-cache-private.h"
+
+
+/* Fill in @key for the log at @log_filename. The checksum only covers the
+ * start and end of the log, so that computing it doesn’t cost as much as
+ * loading the log; together with the size and modification time, this is
+ * enough to notice a log being rewritten or appended to. */
+gboolean
+_dfl_model_cache_key_compute (DflModelCacheKey  *key,
+                              const gchar       *log_filename,
+                              GError           **error)
+{
+  GStatBuf buf;
+  GMappedFile *mapped_file = NULL;
+  GChecksum *checksum = NULL;
+  const guint8 *data;
+  gsize length, digest_length;
+
+  if (g_stat (log_filename, &buf) != 0)
+    {
+      int errsv = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+                   "Error getting information about log file ‘%s’: %s",
+                   log_filename, g_strerror (errsv));
+      return FALSE;
+    }
+
+  mapped_file = g_mapped_file_new (log_filename, FALSE, error);
+
+  if (mapped_file == NULL)
+    return FALSE;
+
+  data = (const guint8 *) g_mapped_file_get_contents (mapped_file);
+  length = g_mapped_file_get_length (mapped_file);
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+  if (length <= 2 * DFL_MODEL_CACHE_CHECKSUM_LENGTH)
+    {
+      g_checksum_update (checksum, data, length);
+    }
+  else
+    {
+      g_checksum_update (checksum, data, DFL_MODEL_CACHE_CHECKSUM_LENGTH);
+      g_checksum_update (checksum,
+                         data + length - DFL_MODEL_CACHE_CHECKSUM_LENGTH,
+                         DFL_MODEL_CACHE_CHECKSUM_LENGTH);
+    }
+
+  digest_length = sizeof (key->log_checksum);
+  g_checksum_get_digest (checksum, key->log_checksum, &digest_length);
+  g_assert (digest_length == sizeof (key->log_checksum));
+
+  key->log_size = length;
+  key->log_mtime = buf.st_mtime;
+
+  g_checksum_free (checksum);
+  g_mapped_file_unref (mapped_file);
+
+  return TRUE;
+}
+
+void
+_dfl_model_cache_writer_add_uint64 (DflModelCacheWriter *writer,
+                                    guint64              value)
+{
+  g_byte_array_append (writer->buffer, (const guint8 *) &value,
+                       sizeof (value));
+}
+
+/* Append @length bytes of @data, followed by padding up to a multiple of 8
+ * bytes. */
+void
+_dfl_model_cache_writer_add_data (DflModelCacheWriter *writer,
+                                  gconstpointer        data,
+                                  gsize                length)
+{
+  static const guint8 padding[sizeof (guint64)] = { 0, };
+
+  g_byte_array_append (writer->buffer, data, length);
+  g_byte_array_append (writer->buffer, padding,
+                       (sizeof (guint64) - length % sizeof (guint64)) %
+                       sizeof (guint64));
+}
+
+guint64
+_dfl_model_cache_reader_read_uint64 (DflModelCacheReader *reader)
+{
+  guint64 value;
+
+  if (reader->invalid ||
+      reader->length - reader->offset < sizeof (value))
+    {
+      reader->invalid = TRUE;
+      return 0;
+    }
+
+  memcpy (&value, reader->data + reader->offset, sizeof (value));
+  reader->offset += sizeof (value);
+
+  return value;
+}
+
+/* Return a pointer to the next @length bytes in the file, and skip them and
+ * their padding. The data is only guaranteed to be 8-byte aligned if the file
+ * is mapped at an aligned address. */
+gconstpointer
+_dfl_model_cache_reader_read_data (DflModelCacheReader *reader,
+                                   gsize                length)
+{
+  gconstpointer retval;
+  gsize padded_length;
+
+  padded_length = length + (sizeof (guint64) - length % sizeof (guint64)) %
+                  sizeof (guint64);
+
+  if (reader->invalid ||
+      padded_length < length ||
+      reader->length - reader->offset < padded_length)
+    {
+      reader->invalid = TRUE;
+      return NULL;
+    }
+
+  retval = reader->data + reader->offset;
+  reader->offset += padded_length;
+
+  return retval;
+}
+
+/* Read an atom, checking it is valid in @atom_table. */
+DflAtom
+_dfl_model_cache_reader_read_atom (DflModelCacheReader *reader,
+                                   DflAtomTable        *atom_table)
+{
+  guint64 atom;
+
+  atom = _dfl_model_cache_reader_read_uint64 (reader);
+
+  if (atom > dfl_atom_table_get_n_atoms (atom_table))
+    {
+      reader->invalid = TRUE;
+      return DFL_ATOM_INVALID;
+    }
+
+  return atom;
+}
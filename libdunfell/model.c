@@ -29,6 +29,10 @@
  * The analysis is performed at construction time and not updated afterwards;
  * the event sequence is immutable.
  *
+ * Analysing a large log takes a while, so the results can be saved to a cache
+ * file next to the log with dfl_model_save_cache(), and loaded from it, with
+ * no parsing or analysis, using dfl_model_load_cache().
+ *
  * Since: UNRELEASED
  */
 
@@ -36,10 +40,13 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <gio/gio.h>
+#include <string.h>
 
 #include "event-sequence.h"
 #include "main-context.h"
 #include "model.h"
+#include "model-cache-private.h"
 #include "source.h"
 #include "task.h"
 #include "thread.h"
@@ -189,7 +196,8 @@ dfl_model_analyse (DflModel *self)
   self->sources = dfl_source_factory_from_event_sequence (self->event_sequence);
   self->tasks = dfl_task_factory_from_event_sequence (self->event_sequence);
 
-  dfl_event_sequence_walk (self->event_sequence);
+  /* Walk with one shard per processor. */
+  dfl_event_sequence_walk_sharded (self->event_sequence, 0);
 }
 
 /**
@@ -228,6 +236,25 @@ dfl_model_get_event_sequence (DflModel *self)
   return self->event_sequence;
 }
 
+/**
+ * dfl_model_get_atom_table:
+ * @self: a #DflModel
+ *
+ * Get the table which the names in the model, such as those in
+ * #DflSourceDispatchData, are interned in. This is the atom table of the
+ * #DflModel:event-sequence.
+ *
+ * Returns: (transfer none): the atom table
+ * Since: UNRELEASED
+ */
+DflAtomTable *
+dfl_model_get_atom_table (DflModel *self)
+{
+  g_return_val_if_fail (DFL_IS_MODEL (self), NULL);
+
+  return dfl_event_sequence_get_atom_table (self->event_sequence);
+}
+
 /**
  * dfl_model_dup_main_contexts:
  * @self: a #DflModel
@@ -300,3 +327,488 @@ dfl_model_dup_tasks (DflModel *self)
 
   return g_ptr_array_ref (self->tasks);
 }
+
+static gchar *
+cache_filename_for_log (const gchar *log_filename)
+{
+  return g_strconcat (log_filename, ".model", NULL);
+}
+
+/**
+ * dfl_model_save_cache:
+ * @self: a #DflModel
+ * @log_filename: (type filename): path to the log the model was built from
+ * @error: return location for a #GError, or %NULL
+ *
+ * Save the analysed model to a cache file next to its log (the log’s filename
+ * with `.model` appended), replacing any existing cache atomically. The cache
+ * can be loaded with dfl_model_load_cache() to skip parsing and analysing the
+ * log next time it is opened.
+ *
+ * The cache is keyed on the current contents of the log, so this should be
+ * called soon after the model is built, before the log can change.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ * Since: UNRELEASED
+ */
+gboolean
+dfl_model_save_cache (DflModel     *self,
+                      const gchar  *log_filename,
+                      GError      **error)
+{
+  DflModelCacheKey key;
+  DflModelCacheWriter writer;
+  DflAtomTable *atom_table;
+  gchar *cache_filename = NULL;
+  guint16 version[2];
+  guint32 byte_order_mark = DFL_MODEL_CACHE_BYTE_ORDER_MARK;
+  guint i, n_atoms;
+  gboolean success;
+
+  g_return_val_if_fail (DFL_IS_MODEL (self), FALSE);
+  g_return_val_if_fail (log_filename != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (!_dfl_model_cache_key_compute (&key, log_filename, error))
+    return FALSE;
+
+  atom_table = dfl_model_get_atom_table (self);
+  n_atoms = dfl_atom_table_get_n_atoms (atom_table);
+
+  writer.buffer = g_byte_array_new ();
+
+  /* Header. */
+  version[0] = DFL_MODEL_CACHE_VERSION_MAJOR;
+  version[1] = DFL_MODEL_CACHE_VERSION_MINOR;
+
+  g_byte_array_append (writer.buffer, (const guint8 *) DFL_MODEL_CACHE_MAGIC,
+                       DFL_MODEL_CACHE_MAGIC_LENGTH);
+  g_byte_array_append (writer.buffer, (const guint8 *) version,
+                       sizeof (version));
+  g_byte_array_append (writer.buffer, (const guint8 *) &byte_order_mark,
+                       sizeof (byte_order_mark));
+  _dfl_model_cache_writer_add_uint64 (&writer, key.log_size);
+  _dfl_model_cache_writer_add_uint64 (&writer, key.log_mtime);
+  _dfl_model_cache_writer_add_data (&writer, key.log_checksum,
+                                    sizeof (key.log_checksum));
+  _dfl_model_cache_writer_add_uint64 (&writer, n_atoms);
+  _dfl_model_cache_writer_add_uint64 (&writer, self->main_contexts->len);
+  _dfl_model_cache_writer_add_uint64 (&writer, self->threads->len);
+  _dfl_model_cache_writer_add_uint64 (&writer, self->sources->len);
+  _dfl_model_cache_writer_add_uint64 (&writer, self->tasks->len);
+
+  g_assert (writer.buffer->len == DFL_MODEL_CACHE_HEADER_LENGTH);
+
+  /* Atoms, then objects. */
+  for (i = 1; i <= n_atoms; i++)
+    {
+      const gchar *str = dfl_atom_table_lookup (atom_table, i);
+      gsize length = strlen (str);
+
+      _dfl_model_cache_writer_add_uint64 (&writer, length);
+      _dfl_model_cache_writer_add_data (&writer, str, length);
+    }
+
+  for (i = 0; i < self->main_contexts->len; i++)
+    _dfl_main_context_save_cache (self->main_contexts->pdata[i], &writer);
+  for (i = 0; i < self->threads->len; i++)
+    _dfl_thread_save_cache (self->threads->pdata[i], &writer);
+  for (i = 0; i < self->sources->len; i++)
+    _dfl_source_save_cache (self->sources->pdata[i], &writer);
+  for (i = 0; i < self->tasks->len; i++)
+    _dfl_task_save_cache (self->tasks->pdata[i], &writer);
+
+  cache_filename = cache_filename_for_log (log_filename);
+  success = g_file_set_contents (cache_filename,
+                                 (const gchar *) writer.buffer->data,
+                                 writer.buffer->len, error);
+
+  g_free (cache_filename);
+  g_byte_array_unref (writer.buffer);
+
+  return success;
+}
+
+static void
+save_cache_thread_cb (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+  DflModel *self = DFL_MODEL (source_object);
+  const gchar *log_filename = task_data;
+  GError *error = NULL;
+
+  if (dfl_model_save_cache (self, log_filename, &error))
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+}
+
+/**
+ * dfl_model_save_cache_async:
+ * @self: a #DflModel
+ * @log_filename: (type filename): path to the log the model was built from
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: callback to call once saving is complete
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of dfl_model_save_cache(), which serialises and writes
+ * the cache in a worker thread. The model is only read while saving, so it
+ * may be used from the calling thread meanwhile.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_model_save_cache_async (DflModel            *self,
+                            const gchar         *log_filename,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+  GTask *task = NULL;
+
+  g_return_if_fail (DFL_IS_MODEL (self));
+  g_return_if_fail (log_filename != NULL);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, dfl_model_save_cache_async);
+  g_task_set_task_data (task, g_strdup (log_filename), g_free);
+  g_task_run_in_thread (task, save_cache_thread_cb);
+  g_object_unref (task);
+}
+
+/**
+ * dfl_model_save_cache_finish:
+ * @self: a #DflModel
+ * @result: result of the asynchronous operation
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finish function for dfl_model_save_cache_async().
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ * Since: UNRELEASED
+ */
+gboolean
+dfl_model_save_cache_finish (DflModel      *self,
+                             GAsyncResult  *result,
+                             GError       **error)
+{
+  g_return_val_if_fail (DFL_IS_MODEL (self), FALSE);
+  g_return_val_if_fail (G_IS_ASYNC_RESULT (result), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/* Load @n_objects objects using @load_func into a new array. */
+typedef gpointer (*LoadFunc) (DflModelCacheReader *reader,
+                              DflAtomTable        *atom_table);
+
+static GPtrArray *
+load_objects (DflModelCacheReader *reader,
+              DflAtomTable        *atom_table,
+              guint64              n_objects,
+              LoadFunc             load_func)
+{
+  g_autoptr (GPtrArray) objects = NULL;
+  guint64 i;
+
+  /* Each object is at least one u64, so this bounds the allocation. */
+  if (n_objects > (reader->length - reader->offset) / sizeof (guint64))
+    {
+      reader->invalid = TRUE;
+      return NULL;
+    }
+
+  objects = g_ptr_array_new_full (n_objects, g_object_unref);
+
+  for (i = 0; i < n_objects; i++)
+    {
+      gpointer object = load_func (reader, atom_table);
+
+      if (object == NULL)
+        return NULL;
+
+      g_ptr_array_add (objects, object);
+    }
+
+  return g_steal_pointer (&objects);
+}
+
+static gpointer
+load_main_context (DflModelCacheReader *reader,
+                   DflAtomTable        *atom_table)
+{
+  return _dfl_main_context_load_cache (reader);
+}
+
+static gpointer
+load_thread (DflModelCacheReader *reader,
+             DflAtomTable        *atom_table)
+{
+  return _dfl_thread_load_cache (reader, atom_table);
+}
+
+static gpointer
+load_source (DflModelCacheReader *reader,
+             DflAtomTable        *atom_table)
+{
+  return _dfl_source_load_cache (reader, atom_table);
+}
+
+static gpointer
+load_task (DflModelCacheReader *reader,
+           DflAtomTable        *atom_table)
+{
+  return _dfl_task_load_cache (reader, atom_table);
+}
+
+/**
+ * dfl_model_load_cache:
+ * @log_filename: (type filename): path to a log
+ * @error: return location for a #GError, or %NULL
+ *
+ * Load a model for the log at @log_filename from the cache saved next to it
+ * by dfl_model_save_cache(). The cache is memory mapped, and the log itself
+ * is not parsed, so this is much faster than building the model from the
+ * log. If there is no cache, or it is out of date with respect to the log, or
+ * was written by an incompatible version of the library, an error is
+ * returned; the model should then be built from the log as normal.
+ *
+ * The returned model’s #DflModel:event-sequence is empty, as the events are
+ * not stored in the cache. Its time sequences point directly into the mapped
+ * cache rather than being copied out of it, so the mapping is kept open for
+ * as long as the model is alive.
+ *
+ * Returns: (transfer full): the model, or %NULL on error
+ * Since: UNRELEASED
+ */
+DflModel *
+dfl_model_load_cache (const gchar  *log_filename,
+                      GError      **error)
+{
+  DflModelCacheKey key;
+  DflModelCacheReader reader = { NULL, 0, 0, FALSE, NULL };
+  g_autoptr (DflEventSequence) sequence = NULL;
+  DflModel *model = NULL;
+  DflAtomTable *atom_table;
+  gchar *cache_filename = NULL;
+  GMappedFile *mapped_file = NULL;
+  guint16 version[2];
+  guint32 byte_order_mark;
+  guint64 n_atoms, n_main_contexts, n_threads, n_sources, n_tasks, i;
+  GPtrArray *main_contexts = NULL, *threads = NULL;
+  GPtrArray *sources = NULL, *tasks = NULL;
+  GError *child_error = NULL;
+
+  g_return_val_if_fail (log_filename != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (!_dfl_model_cache_key_compute (&key, log_filename, error))
+    return NULL;
+
+  cache_filename = cache_filename_for_log (log_filename);
+  mapped_file = g_mapped_file_new (cache_filename, FALSE, &child_error);
+
+  if (mapped_file == NULL)
+    goto done;
+
+  reader.data = (const guint8 *) g_mapped_file_get_contents (mapped_file);
+  reader.length = g_mapped_file_get_length (mapped_file);
+  reader.mapped_file = mapped_file;
+
+  /* Header. */
+  if (reader.length < DFL_MODEL_CACHE_HEADER_LENGTH ||
+      memcmp (reader.data, DFL_MODEL_CACHE_MAGIC,
+              DFL_MODEL_CACHE_MAGIC_LENGTH) != 0)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid model cache file ‘%s’ — %s", cache_filename,
+                   "header is invalid");
+      goto done;
+    }
+
+  memcpy (version, reader.data + 8, sizeof (version));
+  memcpy (&byte_order_mark, reader.data + 12, sizeof (byte_order_mark));
+
+  if (version[0] != DFL_MODEL_CACHE_VERSION_MAJOR ||
+      byte_order_mark != DFL_MODEL_CACHE_BYTE_ORDER_MARK)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid model cache file ‘%s’ — %s", cache_filename,
+                   "unsupported version");
+      goto done;
+    }
+
+  reader.offset = 16;
+
+  if (_dfl_model_cache_reader_read_uint64 (&reader) != key.log_size ||
+      _dfl_model_cache_reader_read_uint64 (&reader) != key.log_mtime ||
+      memcmp (_dfl_model_cache_reader_read_data (&reader,
+                                                 sizeof (key.log_checksum)),
+              key.log_checksum, sizeof (key.log_checksum)) != 0)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid model cache file ‘%s’ — %s", cache_filename,
+                   "log has changed since it was cached");
+      goto done;
+    }
+
+  n_atoms = _dfl_model_cache_reader_read_uint64 (&reader);
+  n_main_contexts = _dfl_model_cache_reader_read_uint64 (&reader);
+  n_threads = _dfl_model_cache_reader_read_uint64 (&reader);
+  n_sources = _dfl_model_cache_reader_read_uint64 (&reader);
+  n_tasks = _dfl_model_cache_reader_read_uint64 (&reader);
+
+  g_assert (reader.offset == DFL_MODEL_CACHE_HEADER_LENGTH);
+
+  /* Re-intern the atoms in order, so they get the same values. */
+  sequence = dfl_event_sequence_new (NULL, 0, 0);
+  atom_table = dfl_event_sequence_get_atom_table (sequence);
+
+  for (i = 1; i <= n_atoms && !reader.invalid; i++)
+    {
+      guint64 length;
+      const gchar *data;
+      gchar *str = NULL;
+
+      length = _dfl_model_cache_reader_read_uint64 (&reader);
+      data = _dfl_model_cache_reader_read_data (&reader, length);
+
+      if (data == NULL)
+        break;
+
+      str = g_strndup (data, length);
+
+      if (strlen (str) != length ||
+          dfl_atom_table_intern (atom_table, str) != i)
+        reader.invalid = TRUE;
+
+      g_free (str);
+    }
+
+  if (!reader.invalid)
+    main_contexts = load_objects (&reader, atom_table, n_main_contexts,
+                                  load_main_context);
+  if (!reader.invalid)
+    threads = load_objects (&reader, atom_table, n_threads,
+                            load_thread);
+  if (!reader.invalid)
+    sources = load_objects (&reader, atom_table, n_sources,
+                            load_source);
+  if (!reader.invalid)
+    tasks = load_objects (&reader, atom_table, n_tasks,
+                          load_task);
+
+  if (reader.invalid || reader.offset != reader.length)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid model cache file ‘%s’ — %s", cache_filename,
+                   "file is truncated or corrupt");
+      goto done;
+    }
+
+  /* Analysing the empty sequence gives empty arrays; replace them. */
+  model = dfl_model_new (sequence);
+
+  g_ptr_array_unref (model->main_contexts);
+  model->main_contexts = g_steal_pointer (&main_contexts);
+  g_ptr_array_unref (model->threads);
+  model->threads = g_steal_pointer (&threads);
+  g_ptr_array_unref (model->sources);
+  model->sources = g_steal_pointer (&sources);
+  g_ptr_array_unref (model->tasks);
+  model->tasks = g_steal_pointer (&tasks);
+
+done:
+  g_clear_pointer (&tasks, g_ptr_array_unref);
+  g_clear_pointer (&sources, g_ptr_array_unref);
+  g_clear_pointer (&threads, g_ptr_array_unref);
+  g_clear_pointer (&main_contexts, g_ptr_array_unref);
+  g_clear_pointer (&mapped_file, g_mapped_file_unref);
+  g_free (cache_filename);
+
+  if (child_error != NULL)
+    g_propagate_error (error, child_error);
+
+  return model;
+}
+
+static void
+load_cache_thread_cb (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+  const gchar *log_filename = task_data;
+  DflModel *model = NULL;
+  GError *error = NULL;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  model = dfl_model_load_cache (log_filename, &error);
+
+  if (model != NULL)
+    g_task_return_pointer (task, model, g_object_unref);
+  else
+    g_task_return_error (task, error);
+}
+
+/**
+ * dfl_model_load_cache_async:
+ * @log_filename: (type filename): path to a log
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: callback to call once loading is complete
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of dfl_model_load_cache(), which checks and loads the
+ * cache in a worker thread.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_model_load_cache_async (const gchar         *log_filename,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+  GTask *task = NULL;
+
+  g_return_if_fail (log_filename != NULL);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, dfl_model_load_cache_async);
+  g_task_set_task_data (task, g_strdup (log_filename), g_free);
+  g_task_run_in_thread (task, load_cache_thread_cb);
+  g_object_unref (task);
+}
+
+/**
+ * dfl_model_load_cache_finish:
+ * @result: result of the asynchronous operation
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finish function for dfl_model_load_cache_async().
+ *
+ * Returns: (transfer full): the model, or %NULL on error
+ * Since: UNRELEASED
+ */
+DflModel *
+dfl_model_load_cache_finish (GAsyncResult  *result,
+                             GError       **error)
+{
+  g_return_val_if_fail (G_IS_ASYNC_RESULT (result), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
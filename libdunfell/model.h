@@ -21,7 +21,9 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 
+#include "atom-table.h"
 #include "event-sequence.h"
 
 G_BEGIN_DECLS
@@ -39,12 +41,34 @@ G_DECLARE_FINAL_TYPE (DflModel, dfl_model, DFL, MODEL, GObject)
 DflModel *dfl_model_new (DflEventSequence *event_sequence);
 
 DflEventSequence *dfl_model_get_event_sequence (DflModel *self);
+DflAtomTable     *dfl_model_get_atom_table     (DflModel *self);
 
 GPtrArray        *dfl_model_dup_main_contexts  (DflModel *self);
 GPtrArray        *dfl_model_dup_threads        (DflModel *self);
 GPtrArray        *dfl_model_dup_sources        (DflModel *self);
 GPtrArray        *dfl_model_dup_tasks          (DflModel *self);
 
+DflModel         *dfl_model_load_cache         (const gchar  *log_filename,
+                                                GError      **error);
+void              dfl_model_load_cache_async   (const gchar         *log_filename,
+                                                GCancellable        *cancellable,
+                                                GAsyncReadyCallback  callback,
+                                                gpointer             user_data);
+DflModel         *dfl_model_load_cache_finish  (GAsyncResult  *result,
+                                                GError       **error);
+
+gboolean          dfl_model_save_cache         (DflModel     *self,
+                                                const gchar  *log_filename,
+                                                GError      **error);
+void              dfl_model_save_cache_async   (DflModel            *self,
+                                                const gchar         *log_filename,
+                                                GCancellable        *cancellable,
+                                                GAsyncReadyCallback  callback,
+                                                gpointer             user_data);
+gboolean          dfl_model_save_cache_finish  (DflModel      *self,
+                                                GAsyncResult  *result,
+                                                GError       **error);
+
 G_END_DECLS
 
 #endif /* !DFL_MODEL_H */
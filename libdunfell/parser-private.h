@@ -0,0 +1,85 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_PARSER_PRIVATE_H
+#define DFL_PARSER_PRIVATE_H
+
+#include <glib.h>
+
+#include "log-index.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Binary log format, version 2.0. All integers are little-endian, and all
+ * records are a multiple of 8 bytes long.
+ *
+ * The file starts with a 24 byte header:
+ *    guint8 magic[8];  (DFL_BINARY_MAGIC)
+ *    guint16 major_version;  (DFL_BINARY_VERSION_MAJOR)
+ *    guint16 minor_version;  (DFL_BINARY_VERSION_MINOR)
+ *    guint32 reserved;  (zero)
+ *    guint64 initial_timestamp;
+ *
+ * This is followed by any number of records, each starting with an 8 byte
+ * record header:
+ *    guint16 code;
+ *    guint8 string_mask;
+ *    guint8 n_parameters;
+ *    guint32 length;
+ *
+ * If @code is %DFL_BINARY_CODE_STRING, the record adds an entry to the string
+ * table. It is followed by @length bytes of UTF-8 (without a nul terminator),
+ * padded with zeros to a multiple of 8 bytes. String table entries are
+ * numbered from zero in the order they appear. @string_mask and
+ * @n_parameters are zero.
+ *
+ * Otherwise, @code is the index of the event type in the parser’s table of
+ * known event types (which may only ever be appended to), and the record is:
+ *    guint64 timestamp;
+ *    guint64 thread_id;
+ *    guint64 parameters[n_parameters];
+ * Bit i of @string_mask is set if parameters[i] is an index into the string
+ * table; otherwise, it is the integer value of the parameter, which is
+ * loaded as an ID. String table entries are always loaded as strings, even if
+ * they look like integers. @length is zero.
+ *
+ * Records with an unknown @code are skipped, so that new event types can be
+ * added without changing the format version.
+ */
+
+#define DFL_BINARY_MAGIC "\x89" "DFL\r\n\x1a\n"
+#define DFL_BINARY_MAGIC_LENGTH 8
+#define DFL_BINARY_VERSION_MAJOR 2
+#define DFL_BINARY_VERSION_MINOR 0
+#define DFL_BINARY_HEADER_LENGTH 24
+#define DFL_BINARY_RECORD_HEADER_LENGTH 8
+#define DFL_BINARY_CODE_STRING 0xffff
+#define DFL_BINARY_MAX_PARAMETERS 8
+
+gboolean _dfl_parser_event_type_to_code (const gchar *event_type,
+                                         guint16     *code_out,
+                                         guint       *n_parameters_out);
+
+DflLogIndex *_dfl_parser_build_log_index (const gchar  *data,
+                                          gsize         length,
+                                          GError      **error);
+
+G_END_DECLS
+
+#endif /* !DFL_PARSER_PRIVATE_H */
@@ -35,33 +35,87 @@
 #include <string.h>
 
 #include "event.h"
+#include "event-private.h"
 #include "event-sequence.h"
+#include "event-sequence-private.h"
+#include "event-store-private.h"
+#include "line-scanner-private.h"
+#include "log-index.h"
+#include "log-index-private.h"
 #include "parser.h"
+#include "parser-private.h"
+
+#ifdef HAVE_ZSTD
+#include "zstd-decompressor-private.h"
+#endif
 
 
 static void dfl_parser_dispose (GObject *object);
+static void dfl_parser_finalize (GObject *object);
+
+/* Events to keep when loading a log. Events which don’t match are rejected
+ * before a #DflEvent is allocated for them. See dfl_parser_set_time_range(),
+ * dfl_parser_set_thread_ids() and dfl_parser_set_event_types(). */
+typedef struct
+{
+  guint64 start;  /* relative to the log’s initial timestamp; inclusive */
+  guint64 end;  /* relative to the log’s initial timestamp; inclusive */
+  GHashTable/*<owned guint64>*/ *thread_ids;  /* owned; nullable for all */
+  guint64 event_type_mask;  /* one bit per index in event_type_array */
+} ParseFilter;
 
 struct _DflParser
 {
   GObject parent;
 
   DflEventSequence *sequence;  /* owned */
+  ParseFilter filter;
 };
 
 G_DEFINE_TYPE (DflParser, dfl_parser, G_TYPE_OBJECT)
 
+typedef enum
+{
+  SIGNAL_EVENTS_ADDED,
+} DflParserSignal;
+
+static guint signals[SIGNAL_EVENTS_ADDED + 1] = { 0, };
+
 static void
 dfl_parser_class_init (DflParserClass *klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
   gobject_class->dispose = dfl_parser_dispose;
+  gobject_class->finalize = dfl_parser_finalize;
+
+  /**
+   * DflParser::events-added:
+   * @self: the #DflParser on which the signal is emitted
+   * @events: (element-type DflEvent): the new events, in order
+   *
+   * Emitted while tailing a log with dfl_parser_tail_stream_async(), for
+   * each batch of new events which have been parsed. By the time this is
+   * emitted, the events have already been appended to the parser’s
+   * #DflEventSequence.
+   *
+   * Since: UNRELEASED
+   */
+  signals[SIGNAL_EVENTS_ADDED] =
+    g_signal_new ("events-added", G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  G_TYPE_PTR_ARRAY);
 }
 
 static void
 dfl_parser_init (DflParser *self)
 {
-  /* Nothing to see here. */
+  self->filter.start = 0;
+  self->filter.end = G_MAXUINT64;
+  self->filter.thread_ids = NULL;
+  self->filter.event_type_mask = G_MAXUINT64;
 }
 
 static void
@@ -75,465 +129,2178 @@ dfl_parser_dispose (GObject *object)
   G_OBJECT_CLASS (dfl_parser_parent_class)->dispose (object);
 }
 
+static void
+dfl_parser_finalize (GObject *object)
+{
+  DflParser *self = DFL_PARSER (object);
+
+  g_clear_pointer (&self->filter.thread_ids, g_hash_table_unref);
+
+  /* Chain up to the parent class */
+  G_OBJECT_CLASS (dfl_parser_parent_class)->finalize (object);
+}
+
 typedef struct
 {
   const gchar *event_type;
   guint n_parameters;  /* excluding event type, timestamp and thread ID */
+  gboolean is_lifetime;  /* creates, names or destroys an object */
+  gint partner;  /* index of the other half of a begin/end pair, or -1 */
+  gboolean is_cross_thread;  /* whether the pair may be on different threads */
 } EventData;
 
-const EventData event_type_array[] =
-{
-  { "g_main_context_new", 1 },
-  { "g_main_context_acquire", 2 },
-  { "g_main_context_release", 1 },
-  { "g_main_context_free", 1 },
-  { "g_main_context_before_dispatch", 1 },
-  { "g_main_context_after_dispatch", 1 },
-  { "g_source_new", 6 },
-  { "g_source_before_free", 3 },
-  { "g_source_before_dispatch", 4 },
-  { "g_source_after_dispatch", 3 },
-  { "g_source_set_name", 2 },
-  { "g_source_attach", 3 },
-  { "g_source_destroy", 2 },
-  { "g_thread_spawned", 3 },
-  { "g_task_new", 5 },
-  { "g_task_set_source_tag", 2 },
-  { "g_task_before_return", 4 },
-  { "g_task_propagate", 2 },
-  { "g_task_before_run_in_thread", 2 },
-  { "g_task_after_run_in_thread", 2 },
-};
-
-static const EventData *
-event_data_from_event_type (const gchar *event_type)
+/* Note: The index of each event type in this array is its code in the binary
+ * log format, so new event types must only be appended. */
+static const EventData event_type_array[] =
 {
-  guint i;
+  { "g_main_context_new", 1, TRUE, -1, FALSE },
+  { "g_main_context_acquire", 2, FALSE, 2, FALSE },
+  { "g_main_context_release", 1, FALSE, 1, FALSE },
+  { "g_main_context_free", 1, TRUE, -1, FALSE },
+  { "g_main_context_before_dispatch", 1, FALSE, 5, FALSE },
+  { "g_main_context_after_dispatch", 1, FALSE, 4, FALSE },
+  { "g_source_new", 6, TRUE, -1, FALSE },
+  { "g_source_before_free", 3, TRUE, -1, FALSE },
+  { "g_source_before_dispatch", 4, FALSE, 9, FALSE },
+  { "g_source_after_dispatch", 3, FALSE, 8, FALSE },
+  { "g_source_set_name", 2, TRUE, -1, FALSE },
+  { "g_source_attach", 3, TRUE, -1, FALSE },
+  { "g_source_destroy", 2, TRUE, -1, FALSE },
+  { "g_thread_spawned", 3, TRUE, -1, FALSE },
+  { "g_task_new", 5, TRUE, -1, FALSE },
+  { "g_task_set_source_tag", 2, TRUE, -1, FALSE },
+  { "g_task_before_return", 4, FALSE, -1, FALSE },
+  { "g_task_propagate", 2, TRUE, -1, FALSE },
+  { "g_task_before_run_in_thread", 2, FALSE, 19, TRUE },
+  { "g_task_after_run_in_thread", 2, FALSE, 18, TRUE },
+  { "g_main_context_before_prepare", 1, FALSE, -1, FALSE },
+  { "g_main_context_after_prepare", 3, FALSE, -1, FALSE },
+  { "g_main_context_before_query", 2, FALSE, -1, FALSE },
+  { "g_main_context_after_query", 3, FALSE, -1, FALSE },
+  { "g_main_context_before_check", 3, FALSE, -1, FALSE },
+  { "g_main_context_after_check", 2, FALSE, -1, FALSE },
+  { "g_source_after_prepare", 3, FALSE, -1, FALSE },
+  { "g_source_after_check", 3, FALSE, -1, FALSE },
+  { "g_main_context_wakeup", 1, FALSE, -1, FALSE },
+  { "g_main_context_wakeup_acknowledge", 1, FALSE, -1, FALSE },
+};
 
-  for (i = 0; i < G_N_ELEMENTS (event_type_array); i++)
-    {
-      if (g_strcmp0 (event_type, event_type_array[i].event_type) == 0)
-        return &event_type_array[i];
-    }
+/* ParseFilter.event_type_mask has one bit per event type. */
+G_STATIC_ASSERT (G_N_ELEMENTS (event_type_array) <= 64);
 
-  return NULL;
+/* Check whether @field exactly matches the nul-terminated string @str. */
+static gboolean
+field_equal (const DflEventField *field,
+             const gchar         *str)
+{
+  return (strncmp (field->data, str, field->length) == 0 &&
+          str[field->length] == '\0');
 }
 
-/**
- * dfl_parser_new:
- *
- * TODO
- *
- * Returns: (transfer full): a new #DflParser
- * Since: 0.1.0
- */
-DflParser *
-dfl_parser_new (void)
+/* Event types are classified using a perfect hash of their length and three of
+ * their bytes. The multiplier and byte positions were found by searching for a
+ * combination with no collisions between the types in event_type_array; this
+ * is checked when the hash table is built, so adding a type which collides
+ * will fail loudly. Most lines in a log are of types which are not in the
+ * table, and these are typically rejected after hashing by an empty slot or a
+ * length mismatch, without comparing any strings. */
+#define EVENT_TYPE_HASH_SIZE 128
+#define EVENT_TYPE_HASH_MIN_LENGTH 6
+
+static inline guint
+event_type_hash (const gchar *event_type,
+                 gsize        length)
 {
-  return g_object_new (DFL_TYPE_PARSER, NULL);
+  return (length * 6 +
+          (guchar) event_type[4] +
+          (guchar) event_type[5] +
+          (guchar) event_type[length - 2]) % EVENT_TYPE_HASH_SIZE;
 }
 
-/**
- * dfl_parser_load_from_data:
- * @self: a #DflParser
- * @data: (array length=length): data to load
- * @length: number of bytes in @data
- * @error: return location for a #GError, or %NULL
- *
- * TODO
- *
- * Since: 0.1.0
- */
-void
-dfl_parser_load_from_data (DflParser     *self,
-                           const guint8  *data,
-                           gssize         length,
-                           GError       **error)
-{
-  GInputStream *stream = NULL;
+/* Map from hash to (index in event_type_array + 1), or 0 for an empty slot. */
+static guint8 event_type_hash_table[EVENT_TYPE_HASH_SIZE];
 
-  g_return_if_fail (DFL_IS_PARSER (self));
-  g_return_if_fail (data != NULL);
-  g_return_if_fail (length > 0);
-  g_return_if_fail (error == NULL || *error == NULL);
+/* Lengths of the types in event_type_array. */
+static gsize event_type_length_array[G_N_ELEMENTS (event_type_array)];
 
-  /* Load by creating a stream for the data. */
-  stream = g_memory_input_stream_new_from_data (data, length, NULL);
-  dfl_parser_load_from_stream (self, stream, NULL, error);
-  g_object_unref (stream);
-}
+/* Interned versions of the event types in event_type_array, so that parsing
+ * an event does not have to take the lock in g_intern_static_string(). This is
+ * important when parsing in multiple threads. */
+static const gchar *event_type_interned_array[G_N_ELEMENTS (event_type_array)];
 
-/**
- * dfl_parser_load_from_file:
- * @self: a #DflParser
- * @filename: path to file to load log from
- * @error: return location for a #GError, or %NULL
- *
- * TODO
- *
- * Since: 0.1.0
- */
-void
-dfl_parser_load_from_file (DflParser    *self,
-                           const gchar  *filename,
-                           GError      **error)
+static void
+event_types_init (void)
 {
-  GFile *file = NULL;
-  GFileInputStream *stream = NULL;
+  static gsize initialised = 0;
 
-  g_return_if_fail (DFL_IS_PARSER (self));
-  g_return_if_fail (filename != NULL);
-  g_return_if_fail (error == NULL || *error == NULL);
+  if (g_once_init_enter (&initialised))
+    {
+      guint i;
 
-  /* Load by creating a stream for the file. */
-  file = g_file_new_for_path (filename);
-  stream = g_file_read (file, NULL, error);
-  g_object_unref (file);
+      G_STATIC_ASSERT (G_N_ELEMENTS (event_type_array) < G_MAXUINT8);
 
-  if (stream == NULL)
-    return;
+      for (i = 0; i < G_N_ELEMENTS (event_type_array); i++)
+        {
+          const gchar *event_type = event_type_array[i].event_type;
+          gsize length = strlen (event_type);
+          guint hash;
 
-  dfl_parser_load_from_stream (self, G_INPUT_STREAM (stream), NULL, error);
+          g_assert (length >= EVENT_TYPE_HASH_MIN_LENGTH);
 
-  g_object_unref (stream);
+          hash = event_type_hash (event_type, length);
+          g_assert (event_type_hash_table[hash] == 0);
+
+          event_type_hash_table[hash] = i + 1;
+          event_type_length_array[i] = length;
+          event_type_interned_array[i] = g_intern_static_string (event_type);
+        }
+
+      g_once_init_leave (&initialised, 1);
+    }
 }
 
-/**
- * dfl_parser_load_from_stream:
- * @self: a #DflParser
- * @stream: input stream to read log from
- * @cancellable: a #GCancellable, or %NULL
- * @error: return location for a #GError, or %NULL
- *
- * TODO
- *
- * Since: 0.1.0
- */
-void
-dfl_parser_load_from_stream (DflParser     *self,
-                             GInputStream  *stream,
-                             GCancellable  *cancellable,
-                             GError       **error)
+/* Look up @event_type (which is not nul-terminated) in event_type_array,
+ * returning its index, or -1 if it is not a known event type. */
+static gint
+event_type_lookup (const gchar *event_type,
+                   gsize        length)
 {
-  GDataInputStream *data_stream = NULL;
-  guint8 *line = NULL;
-  gsize length = 0;
-  guint line_number;
-  guint n_comment_lines;
-  guint64 initial_timestamp;
-  GHashTable/*<owned guint64, owned guint64>*/ *highest_timestamps = NULL;
-  guint file_version;
-  GPtrArray/*<owned DflEvent*>*/ *events = NULL;
-  GError *child_error = NULL;
+  guint index;
 
-  g_return_if_fail (DFL_IS_PARSER (self));
-  g_return_if_fail (G_IS_INPUT_STREAM (stream));
-  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
-  g_return_if_fail (error == NULL || *error == NULL);
+  if (length < EVENT_TYPE_HASH_MIN_LENGTH)
+    return -1;
 
-  /* Wrap in a data input stream and read line by line. */
-  data_stream = g_data_input_stream_new (stream);
-  n_comment_lines = 0;
-  file_version = 0;
-  initial_timestamp = 0;
-  highest_timestamps = g_hash_table_new_full (g_int64_hash, g_int64_equal,
-                                              g_free, g_free);
-  events = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-
-  for (line_number = 1,
-       line = (guint8 *) g_data_input_stream_read_line (data_stream, &length,
-                                                        cancellable,
-                                                        &child_error);
-       line != NULL;
-       line_number++, g_free (line),
-       line = (guint8 *) g_data_input_stream_read_line (data_stream, &length,
-                                                        cancellable,
-                                                        &child_error))
-    {
-      const gchar *end = NULL;
-      gchar **components = NULL;
+  index = event_type_hash_table[event_type_hash (event_type, length)];
 
-      /* Note: The line is an arbitrary byte stream. It is not valid UTF-8 and
-       * may contain embedded nuls. Validate that first. */
-      if (!g_utf8_validate ((gchar *) line, length, &end))
-        {
-          /* TODO: Use a proper error code here. */
-          g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                       "Invalid log file line %u — invalid UTF-8 at byte %"
-                       G_GOFFSET_FORMAT,
-                       line_number, (goffset) (((guint8 *) end) - line));
-          break;
-        }
+  if (index == 0 ||
+      event_type_length_array[index - 1] != length ||
+      memcmp (event_type, event_type_array[index - 1].event_type, length) != 0)
+    return -1;
 
-      /* Ignore whitespace. */
-      line = (guint8 *) g_strstrip ((gchar *) line);
+  return index - 1;
+}
 
-      /* Ignore comment or blank lines. */
-      if (line[0] == '\0' || line[0] == '#')
-        {
-          n_comment_lines++;
-          continue;
-        }
+/* Look up the code for @event_type in the binary log format, which is its
+ * index in event_type_array. Returns %FALSE if the event type is unknown. */
+gboolean
+_dfl_parser_event_type_to_code (const gchar *event_type,
+                                guint16     *code_out,
+                                guint       *n_parameters_out)
+{
+  gint index;
 
-      g_debug ("%s: Line: %s", G_STRFUNC, line);
+  event_types_init ();
 
-      /* Split into components. */
-      /* TODO: Formally document log file format. */
-      components = g_strsplit ((gchar *) line, ",", -1);
+  index = event_type_lookup (event_type, strlen (event_type));
 
-      if (components[0] == NULL)
-        {
-          /* TODO: Use a proper error code here. */
-          g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                       "Invalid log file line %u — %s: %s", line_number,
-                       "not enough components", line);
-          g_strfreev (components);
-          break;
-        }
+  if (index < 0)
+    return FALSE;
 
-      if (g_strcmp0 (components[0], "Dunfell log") == 0)
-        {
-          const gchar *version, *timestamp;
+  *code_out = index;
+  *n_parameters_out = event_type_array[index].n_parameters;
 
-          /* Header line? Looks like:
-           *    Dunfell log,1.0,123456
-           * where 1.0 is the log format version, and 123456 is the starting
-           * timestamp. */
+  return TRUE;
+}
 
-          /* Is this the first line? */
-          if (line_number - n_comment_lines != 1)
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Invalid log file line %u — %s: %s", line_number,
-                           "header must be first non-comment line", line);
-              g_strfreev (components);
-              break;
-            }
+static const EventData *
+event_data_from_event_type (const DflEventField *event_type)
+{
+  gint index;
 
-          /* Check the number of components. */
-          if (components[1] == NULL || components[2] == NULL ||
-              components[3] != NULL)
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Invalid log file line %u — %s: %s", line_number,
-                           "header contains the wrong number of components",
-                           line);
-              g_strfreev (components);
-              break;
-            }
+  index = event_type_lookup (event_type->data, event_type->length);
 
-          /* Extract the components. */
-          version = components[1];
-          timestamp = components[2];
+  return (index >= 0) ? &event_type_array[index] : NULL;
+}
 
-          /* File version check. */
-          if (g_strcmp0 (version, "1.0") != 0)
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Unsupported log file version ‘%s’ on line %u"
-                           "(versions supported: 1.0)", version, line_number);
-              g_strfreev (components);
-              break;
-            }
+/* Parse an unsigned decimal integer from @field, which is not nul-terminated.
+ * This accepts the same input as g_ascii_strtoull() with base 10, with the
+ * additional requirement that the whole field is consumed. It returns %FALSE
+ * on an invalid or out of range number. */
+static gboolean
+field_parse_uint64 (const DflEventField *field,
+                    guint64             *out)
+{
+  const gchar *p = field->data;
+  const gchar *end = field->data + field->length;
+  gboolean negative = FALSE;
+  guint64 value = 0;
 
-          file_version = 1;
+  while (p < end && g_ascii_isspace (*p))
+    p++;
 
-          /* Parse the timestamp. */
-          initial_timestamp = g_ascii_strtoull (timestamp, (gchar **) &end, 10);
+  if (p < end && (*p == '+' || *p == '-'))
+    {
+      negative = (*p == '-');
+      p++;
+    }
 
-          if (errno == ERANGE || end == timestamp || *end != '\0')
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Invalid timestamp ‘%s’ on line %u", timestamp,
-                           line_number);
-              g_strfreev (components);
-              break;
-            }
-        }
-      else
-        {
-          const EventData *event_data;
-          const gchar *event_type;
-          const gchar *timestamp;
-          const gchar *tid;
-          guint n_components;
-          guint64 timestamp_int, tid_int;
-          guint64 *highest_timestamp;
-          DflEvent *event = NULL;
-
-          /* Non-header line. Looks like:
-           *    g_idle_dispatch,1449749875412059,8491,140407983871120,12007776,\
-           *    140408421089918,0x7fb36210027e,14614576,0
-           */
-
-          /* Has there been a header? */
-          if (file_version == 0)
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Invalid log file line %u — %s: %s", line_number,
-                           "header must be first non-comment line", line);
-              g_strfreev (components);
-              break;
-            }
+  if (p == end)
+    return FALSE;
 
-          /* Extract the event type. */
-          event_type = g_intern_string (components[0]);
+  for (; p < end; p++)
+    {
+      guint digit;
 
-          if (*event_type == '\0')
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Invalid log file line %u — %s: %s", line_number,
-                           "event type not specified", line);
-              g_strfreev (components);
-              break;
-            }
+      if (*p < '0' || *p > '9')
+        return FALSE;
 
-          /* Match it to an event parser. */
-          event_data = event_data_from_event_type (event_type);
+      digit = *p - '0';
 
-          if (event_data == NULL)
-            {
-              /* Ignore unknown event types to allow for more probe points to be
-               * added to GLib in future. */
-              g_debug ("%s: Ignoring unrecognised event type ‘%s’ on "
-                       "line %u: %s", G_STRFUNC, event_type, line_number, line);
-              g_strfreev (components);
-              continue;
-            }
+      if (value > (G_MAXUINT64 - digit) / 10)
+        return FALSE;
 
-          /* Check the number of components (ignoring the event type, timestamp
-           * and thread ID. */
-          n_components = g_strv_length (components);
+      value = value * 10 + digit;
+    }
 
-          if (n_components < 3 || n_components - 3 != event_data->n_parameters)
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Invalid log file line %u — %s: %s", line_number,
-                           "event line contains the wrong number of components",
-                           line);
-              g_strfreev (components);
-              break;
-            }
+  *out = negative ? -value : value;
 
-          /* Grab the timestamp and thread ID. */
-          timestamp = components[1];
-          tid = components[2];
+  return TRUE;
+}
 
-          timestamp_int = g_ascii_strtoull (timestamp, (gchar **) &end, 10);
+/* Maximum number of comma-separated fields from a line which are stored.
+ * Event lines have at most 9 fields (the event type, timestamp, thread ID and
+ * up to 6 parameters), so anything above this is only counted. */
+#define MAX_FIELDS 16
 
-          if (errno == ERANGE || end == timestamp || *end != '\0')
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Invalid timestamp ‘%s’ on line %u", timestamp,
-                           line_number);
-              g_strfreev (components);
-              break;
-            }
+/* State for parsing a log, shared between the different loading paths, so they
+ * all produce the same #DflEventSequence. */
+typedef struct
+{
+  guint line_number;
+  guint n_comment_lines;
+  guint file_version;
+  DflTimestamp initial_timestamp;
+  GHashTable/*<owned guint64, owned guint64>*/ *highest_timestamps;  /* owned */
+  GHashTable/*<owned guint64, owned guint64>*/ *first_timestamps;  /* owned; nullable */
+  GHashTable/*<owned utf8>*/ *unknown_event_types;  /* owned */
+  DflEventStore events;
+  const ParseFilter *filter;  /* unowned; NULL if only building an index */
+
+  /* If building an index, every event is added to it. If @filter is also set,
+   * the events which match it are added to @events as well, so a log can be
+   * indexed and loaded in one pass. */
+  DflLogIndex *index;  /* owned; nullable */
+  const gchar *index_base;  /* unowned; start of the log being indexed */
+} ParseState;
 
-          tid_int = g_ascii_strtoull (tid, (gchar **) &end, 10);
+static void
+parse_state_init (ParseState        *state,
+                  const ParseFilter *filter)
+{
+  event_types_init ();
+
+  state->filter = filter;
+  state->index = NULL;
+  state->index_base = NULL;
+
+  state->line_number = 0;
+  state->n_comment_lines = 0;
+  state->file_version = 0;
+  state->initial_timestamp = 0;
+  state->highest_timestamps = g_hash_table_new_full (g_int64_hash,
+                                                     g_int64_equal,
+                                                     g_free, g_free);
+  state->first_timestamps = NULL;
+  state->unknown_event_types = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                      g_free, NULL);
+  _dfl_event_store_init (&state->events);
+}
 
-          if (errno == ERANGE || end == tid || *end != '\0')
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Invalid thread ID ‘%s’ on line %u", tid,
-                           line_number);
-              g_strfreev (components);
-              break;
-            }
+static void
+parse_state_clear (ParseState *state)
+{
+  _dfl_event_store_clear (&state->events);
+  g_clear_object (&state->index);
+  g_clear_pointer (&state->unknown_event_types, g_hash_table_unref);
+  g_clear_pointer (&state->first_timestamps, g_hash_table_unref);
+  g_clear_pointer (&state->highest_timestamps, g_hash_table_unref);
+}
 
-          /* Check that the timestamps in each thread are monotonically
-           * increasing. */
-          highest_timestamp = g_hash_table_lookup (highest_timestamps,
-                                                   (gpointer) &tid_int);
+/* Log (once per event type) that an unrecognised event type is being ignored.
+ * Most lines in a typical log are of unrecognised types, so this avoids
+ * formatting a debug message for each of them. */
+static void
+parse_state_ignore_event_type (ParseState          *state,
+                               const DflEventField *event_type)
+{
+  gchar event_type_str[64];
 
-          if ((highest_timestamp == NULL && timestamp_int < initial_timestamp) ||
-              (highest_timestamp != NULL && timestamp_int < *highest_timestamp))
-            {
-              /* TODO: Use a proper error code here. */
-              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
-                           "Invalid timestamp ‘%s’ on line %u: timestamps must "
-                           "be monotonically increasing", timestamp,
-                           line_number);
-              g_strfreev (components);
-              break;
-            }
+  /* Event types are short; if this one isn’t, don’t bother de-duplicating. */
+  if (event_type->length < sizeof (event_type_str))
+    {
+      memcpy (event_type_str, event_type->data, event_type->length);
+      event_type_str[event_type->length] = '\0';
 
-          if (highest_timestamp != NULL)
-            {
-              *highest_timestamp = timestamp_int;
-            }
-          else
-            {
-              guint64 *key = NULL;
+      if (g_hash_table_contains (state->unknown_event_types, event_type_str))
+        return;
 
-              highest_timestamp = g_new0 (guint64, 1);
-              *highest_timestamp = timestamp_int;
-              key = g_new0 (guint64, 1);
-              *key = tid_int;
+      g_hash_table_add (state->unknown_event_types, g_strdup (event_type_str));
+    }
 
-              g_hash_table_insert (highest_timestamps, key, highest_timestamp);
-            }
+  g_debug ("%s: Ignoring unrecognised event type ‘%.*s’",
+           G_STRFUNC, (int) event_type->length, event_type->data);
+}
 
-          /* Create the event. */
-          event = dfl_event_new (event_type, timestamp_int, tid_int,
-                                 (const gchar * const *) components + 3);
-          g_ptr_array_add (events, event);  /* transfer ownership */
-        }
+/* Check that @timestamp is not earlier than the previous event in thread @tid
+ * (or than the start of the log), and record it as the highest timestamp seen
+ * in that thread. Returns %FALSE if the timestamp is out of order. */
+static gboolean
+parse_state_update_timestamp (ParseState *state,
+                              guint64     tid,
+                              guint64     timestamp)
+{
+  guint64 *highest_timestamp;
 
-      g_strfreev (components);
-    }
+  highest_timestamp = g_hash_table_lookup (state->highest_timestamps, &tid);
 
-  g_free (line);
+  if ((highest_timestamp == NULL && timestamp < state->initial_timestamp) ||
+      (highest_timestamp != NULL && timestamp < *highest_timestamp))
+    return FALSE;
 
-  /* Success? */
-  if (child_error == NULL)
+  if (highest_timestamp != NULL)
     {
-      g_clear_object (&self->sequence);
-      self->sequence = dfl_event_sequence_new ((const DflEvent **) events->pdata,
-                                               events->len, initial_timestamp);
+      *highest_timestamp = timestamp;
     }
   else
     {
-      g_propagate_error (error, child_error);
+      guint64 *key = NULL;
+
+      highest_timestamp = g_new0 (guint64, 1);
+      *highest_timestamp = timestamp;
+      key = g_new0 (guint64, 1);
+      *key = tid;
+
+      g_hash_table_insert (state->highest_timestamps, key, highest_timestamp);
+
+      /* If parsing a chunk, also track the first timestamp for each thread,
+       * so monotonicity can be checked across chunk borders. */
+      if (state->first_timestamps != NULL)
+        {
+          guint64 *first_timestamp = NULL;
+
+          first_timestamp = g_new0 (guint64, 1);
+          *first_timestamp = timestamp;
+          key = g_new0 (guint64, 1);
+          *key = tid;
+
+          g_hash_table_insert (state->first_timestamps, key, first_timestamp);
+        }
     }
 
-  g_clear_pointer (&events, g_ptr_array_unref);
-  g_clear_pointer (&highest_timestamps, g_hash_table_unref);
-  g_object_unref (data_stream);
+  return TRUE;
 }
 
-static void
-load_from_stream_thread_cb (GTask         *task,
-                            gpointer       source_object,
-                            gpointer       task_data,
-                            GCancellable  *cancellable)
+/* Check whether an event of type @code (an index into event_type_array)
+ * matches the parser’s filter and should be kept. Lifetime events are always
+ * kept, so that every object in the model is known.
+ *
+ * Begin/end pairs (such as acquire and release) are filtered as a unit where
+ * possible: selecting either event type keeps both, and pairs which may be
+ * split across threads ignore the thread filter. A pair which straddles the
+ * edge of the time range still loses one half; the model clips such spans to
+ * the edge of the loaded range (see _dfl_event_sequence_get_window_start()). */
+static gboolean
+parse_state_filter_event (const ParseState *state,
+                          guint             code,
+                          guint64           timestamp,
+                          guint64           tid)
 {
-  DflParser *self;
-  GInputStream *stream;
-  GError *error = NULL;
+  const ParseFilter *filter = state->filter;
+  const EventData *event_data = &event_type_array[code];
+  guint64 relative_timestamp, type_bits;
 
-  self = DFL_PARSER (source_object);
-  stream = G_INPUT_STREAM (task_data);
+  if (event_data->is_lifetime)
+    return TRUE;
 
-  dfl_parser_load_from_stream (self, stream, cancellable, &error);
+  type_bits = G_GUINT64_CONSTANT (1) << code;
+  if (event_data->partner >= 0)
+    type_bits |= G_GUINT64_CONSTANT (1) << event_data->partner;
 
-  if (error != NULL)
-    g_task_return_error (task, error);
-  else
-    g_task_return_boolean (task, TRUE);
+  if (!(filter->event_type_mask & type_bits))
+    return FALSE;
+
+  /* This can’t underflow, as parse_state_update_timestamp() has checked the
+   * timestamp is not before the start of the log. */
+  relative_timestamp = timestamp - state->initial_timestamp;
+
+  if (relative_timestamp < filter->start || relative_timestamp > filter->end)
+    return FALSE;
+
+  if (filter->thread_ids != NULL && !event_data->is_cross_thread &&
+      !g_hash_table_contains (filter->thread_ids, &tid))
+    return FALSE;
+
+  return TRUE;
 }
 
-/**
- * dfl_parser_load_from_stream_async:
+/* Parse a single line of the log, which starts at @data and ends at the first
+ * newline or at @data + @length. The line is not nul-terminated, and is not
+ * modified. Its length (excluding the newline) is returned in
+ * @line_length_out. Returns %FALSE and sets @error if the line is invalid. */
+static gboolean
+parse_line (ParseState   *state,
+            const gchar  *data,
+            gsize         length,
+            gsize        *line_length_out,
+            GError      **error)
+{
+  const gchar *line = data;
+  const gchar *end = NULL;
+  DflEventField components[MAX_FIELDS];
+  gsize n_components, n_stored_components;
+  gboolean is_ascii;
+
+  state->line_number++;
+
+  /* Find the end of the line and split it into components in a single pass.
+   * TODO: Formally document log file format. */
+  length = _dfl_line_scan (data, length, components,
+                           G_N_ELEMENTS (components), &n_components,
+                           &is_ascii);
+  n_stored_components = MIN (n_components, G_N_ELEMENTS (components));
+
+  if (line_length_out != NULL)
+    *line_length_out = length;
+
+  /* Note: The line is an arbitrary byte stream. It is not valid UTF-8 and
+   * may contain embedded nuls. The scanner checks whether it is plain ASCII;
+   * if not, validate it. */
+  if (!is_ascii && !g_utf8_validate (line, length, &end))
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid log file line %u — invalid UTF-8 at byte %"
+                   G_GOFFSET_FORMAT,
+                   state->line_number, (goffset) (end - line));
+      return FALSE;
+    }
+
+  /* Ignore whitespace. */
+  while (length > 0 && g_ascii_isspace (line[0]))
+    {
+      line++;
+      length--;
+    }
+
+  while (length > 0 && g_ascii_isspace (line[length - 1]))
+    length--;
+
+  /* Ignore comment or blank lines. */
+  if (length == 0 || line[0] == '#')
+    {
+      state->n_comment_lines++;
+      return TRUE;
+    }
+
+  /* Trim the whitespace from the first and last components too. Whitespace
+   * trimming can’t cross a comma, so no other components are affected. */
+  components[0].length -= line - components[0].data;
+  components[0].data = line;
+
+  if (n_stored_components == n_components)
+    components[n_components - 1].length = line + length -
+                                           components[n_components - 1].data;
+
+  if (field_equal (&components[0], "Dunfell log"))
+    {
+      const DflEventField *version, *timestamp;
+
+      /* Header line? Looks like:
+       *    Dunfell log,1.0,123456
+       * where 1.0 is the log format version, and 123456 is the starting
+       * timestamp. */
+
+      /* Is this the first line? */
+      if (state->line_number - state->n_comment_lines != 1)
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid log file line %u — %s: %.*s",
+                       state->line_number,
+                       "header must be first non-comment line",
+                       (int) length, line);
+          return FALSE;
+        }
+
+      /* Check the number of components. */
+      if (n_components != 3)
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid log file line %u — %s: %.*s",
+                       state->line_number,
+                       "header contains the wrong number of components",
+                       (int) length, line);
+          return FALSE;
+        }
+
+      /* Extract the components. */
+      version = &components[1];
+      timestamp = &components[2];
+
+      /* File version check. */
+      if (!field_equal (version, "1.0"))
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Unsupported log file version ‘%.*s’ on line %u"
+                       "(versions supported: 1.0)",
+                       (int) version->length, version->data,
+                       state->line_number);
+          return FALSE;
+        }
+
+      state->file_version = 1;
+
+      /* Parse the timestamp. */
+      if (!field_parse_uint64 (timestamp, &state->initial_timestamp))
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid timestamp ‘%.*s’ on line %u",
+                       (int) timestamp->length, timestamp->data,
+                       state->line_number);
+          return FALSE;
+        }
+    }
+  else
+    {
+      const EventData *event_data;
+      const DflEventField *event_type;
+      const DflEventField *timestamp;
+      const DflEventField *tid;
+      guint64 timestamp_int, tid_int;
+
+      /* Non-header line. Looks like:
+       *    g_idle_dispatch,1449749875412059,8491,140407983871120,12007776,\
+       *    140408421089918,0x7fb36210027e,14614576,0
+       */
+
+      /* Has there been a header? */
+      if (state->file_version == 0)
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid log file line %u — %s: %.*s",
+                       state->line_number,
+                       "header must be first non-comment line",
+                       (int) length, line);
+          return FALSE;
+        }
+
+      /* Extract the event type. */
+      event_type = &components[0];
+
+      if (event_type->length == 0)
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid log file line %u — %s: %.*s",
+                       state->line_number, "event type not specified",
+                       (int) length, line);
+          return FALSE;
+        }
+
+      /* Match it to an event parser. */
+      event_data = event_data_from_event_type (event_type);
+
+      if (event_data == NULL)
+        {
+          /* Ignore unknown event types to allow for more probe points to be
+           * added to GLib in future. */
+          parse_state_ignore_event_type (state, event_type);
+          return TRUE;
+        }
+
+      /* Check the number of components (ignoring the event type, timestamp
+       * and thread ID. */
+      if (n_components < 3 || n_components - 3 != event_data->n_parameters)
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid log file line %u — %s: %.*s",
+                       state->line_number,
+                       "event line contains the wrong number of components",
+                       (int) length, line);
+          return FALSE;
+        }
+
+      /* Grab the timestamp and thread ID. */
+      timestamp = &components[1];
+      tid = &components[2];
+
+      if (!field_parse_uint64 (timestamp, &timestamp_int))
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid timestamp ‘%.*s’ on line %u",
+                       (int) timestamp->length, timestamp->data,
+                       state->line_number);
+          return FALSE;
+        }
+
+      if (!field_parse_uint64 (tid, &tid_int))
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid thread ID ‘%.*s’ on line %u",
+                       (int) tid->length, tid->data, state->line_number);
+          return FALSE;
+        }
+
+      /* Check that the timestamps in each thread are monotonically
+       * increasing. */
+      if (!parse_state_update_timestamp (state, tid_int, timestamp_int))
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid timestamp ‘%.*s’ on line %u: timestamps must "
+                       "be monotonically increasing",
+                       (int) timestamp->length, timestamp->data,
+                       state->line_number);
+          return FALSE;
+        }
+
+      /* Building an index? Record the event’s position, and only create it
+       * if the log is being loaded too. */
+      if (state->index != NULL)
+        {
+          _dfl_log_index_add_event (state->index, data - state->index_base,
+                                    event_data - event_type_array,
+                                    timestamp_int, tid_int,
+                                    event_data->is_lifetime);
+
+          if (state->filter == NULL)
+            return TRUE;
+        }
+
+      /* Drop it if it doesn’t match the filter. */
+      if (!parse_state_filter_event (state, event_data - event_type_array,
+                                     timestamp_int, tid_int))
+        return TRUE;
+
+      /* Store the event. The parameters are copied straight out of the
+       * line. */
+      _dfl_event_store_add (&state->events,
+                            event_type_interned_array[event_data - event_type_array],
+                            timestamp_int, tid_int,
+                            components + 3, n_components - 3);
+    }
+
+  return TRUE;
+}
+
+/* Replace the parser’s event sequence with the events from @state. */
+static void
+parse_state_finish (ParseState *state,
+                    DflParser  *self)
+{
+  g_clear_object (&self->sequence);
+  self->sequence = _dfl_event_sequence_new_from_store (&state->events,
+                                                      state->initial_timestamp);
+
+  /* Spans which start before a time range and end in it have lost their first
+   * half; let the model clip them. */
+  if (state->filter != NULL && state->filter->start > 0)
+    _dfl_event_sequence_set_window_start (self->sequence,
+                                          state->initial_timestamp +
+                                          MIN (state->filter->start,
+                                               G_MAXUINT64 -
+                                               state->initial_timestamp));
+}
+
+/* Read little-endian integers from a possibly unaligned position in a binary
+ * log. */
+static guint16
+read_uint16_le (const guint8 *data)
+{
+  guint16 value;
+
+  memcpy (&value, data, sizeof (value));
+
+  return GUINT16_FROM_LE (value);
+}
+
+static guint32
+read_uint32_le (const guint8 *data)
+{
+  guint32 value;
+
+  memcpy (&value, data, sizeof (value));
+
+  return GUINT32_FROM_LE (value);
+}
+
+static guint64
+read_uint64_le (const guint8 *data)
+{
+  guint64 value;
+
+  memcpy (&value, data, sizeof (value));
+
+  return GUINT64_FROM_LE (value);
+}
+
+/* Check whether @data starts with the magic bytes of a binary log. */
+static gboolean
+is_binary_log (const guint8 *data,
+               gsize         length)
+{
+  return (length >= DFL_BINARY_MAGIC_LENGTH &&
+          memcmp (data, DFL_BINARY_MAGIC, DFL_BINARY_MAGIC_LENGTH) == 0);
+}
+
+/* Compression formats which logs may be wrapped in. These are detected from
+ * the magic bytes at the start of the log, rather than from the file name,
+ * so they work for streams too. */
+typedef enum
+{
+  COMPRESSION_NONE,
+  COMPRESSION_GZIP,
+  COMPRESSION_ZSTD,
+} Compression;
+
+static Compression
+detect_compression (const guint8 *data,
+                    gsize         length)
+{
+  if (length >= 2 && data[0] == 0x1f && data[1] == 0x8b)
+    return COMPRESSION_GZIP;
+  else if (length >= 4 && data[0] == 0x28 && data[1] == 0xb5 &&
+           data[2] == 0x2f && data[3] == 0xfd)
+    return COMPRESSION_ZSTD;
+  else
+    return COMPRESSION_NONE;
+}
+
+/* Create a #GConverter to decompress data in the given @compression format.
+ * If support for the format was not compiled in, return %NULL and set
+ * @error. */
+static GConverter *
+decompressor_new (Compression   compression,
+                  GError      **error)
+{
+  switch (compression)
+    {
+    case COMPRESSION_GZIP:
+      return G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+    case COMPRESSION_ZSTD:
+#ifdef HAVE_ZSTD
+      return G_CONVERTER (_dfl_zstd_decompressor_new ());
+#else
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           "zstd-compressed logs are not supported by this "
+                           "build of libdunfell");
+      return NULL;
+#endif
+    case COMPRESSION_NONE:
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+/* Parse a complete binary log (see parser-private.h for the format) which is
+ * in memory. String table entries are validated and copied into the event
+ * store once, when they are loaded, and event parameters are added to the
+ * store already decoded, so nothing is re-parsed or re-validated per event. */
+static void
+load_from_binary (DflParser     *self,
+                  const guint8  *data,
+                  gsize          length,
+                  GError       **error)
+{
+  ParseState state;
+  GPtrArray/*<unowned utf8>*/ *strings = NULL;
+  gsize offset;
+  guint record_number = 0;
+  guint16 major_version;
+  GError *child_error = NULL;
+
+  g_assert (is_binary_log (data, length));
+
+  parse_state_init (&state, &self->filter);
+  strings = g_ptr_array_new ();
+
+  /* Header. */
+  if (length < DFL_BINARY_HEADER_LENGTH)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Invalid binary log file — %s", "header is truncated");
+      goto done;
+    }
+
+  major_version = read_uint16_le (data + 8);
+
+  if (major_version != DFL_BINARY_VERSION_MAJOR)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Unsupported binary log file version ‘%u.%u’ "
+                   "(versions supported: 2.0)",
+                   major_version, read_uint16_le (data + 10));
+      goto done;
+    }
+
+  state.file_version = DFL_BINARY_VERSION_MAJOR;
+  state.initial_timestamp = read_uint64_le (data + 16);
+
+  /* Records. */
+  for (offset = DFL_BINARY_HEADER_LENGTH; offset < length; )
+    {
+      const guint8 *record = data + offset;
+      guint16 code;
+      guint8 string_mask, n_parameters;
+      guint32 record_data_length;
+      gsize record_length;
+
+      record_number++;
+
+      if (length - offset < DFL_BINARY_RECORD_HEADER_LENGTH)
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid binary log file record %u — %s",
+                       record_number, "record is truncated");
+          goto done;
+        }
+
+      code = read_uint16_le (record);
+      string_mask = record[2];
+      n_parameters = record[3];
+      record_data_length = read_uint32_le (record + 4);
+
+      if (code == DFL_BINARY_CODE_STRING)
+        record_length = DFL_BINARY_RECORD_HEADER_LENGTH +
+                        (((gsize) record_data_length + 7) & ~(gsize) 7);
+      else
+        record_length = DFL_BINARY_RECORD_HEADER_LENGTH +
+                        (2 + (gsize) n_parameters) * sizeof (guint64);
+
+      if (length - offset < record_length)
+        {
+          /* TODO: Use a proper error code here. */
+          g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                       "Invalid binary log file record %u — %s",
+                       record_number, "record is truncated");
+          goto done;
+        }
+
+      offset += record_length;
+
+      if (code == DFL_BINARY_CODE_STRING)
+        {
+          const gchar *string, *copy;
+
+          string = (const gchar *) record + DFL_BINARY_RECORD_HEADER_LENGTH;
+
+          /* This also rejects embedded nuls. */
+          if (!g_utf8_validate (string, record_data_length, NULL))
+            {
+              /* TODO: Use a proper error code here. */
+              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                           "Invalid binary log file record %u — %s",
+                           record_number, "invalid UTF-8 in string");
+              goto done;
+            }
+
+          copy = _dfl_event_store_add_string (&state.events, string,
+                                              record_data_length);
+          g_ptr_array_add (strings, (gpointer) copy);
+        }
+      else if (code < G_N_ELEMENTS (event_type_array))
+        {
+          const EventData *event_data = &event_type_array[code];
+          DflEventParameter parameters[DFL_BINARY_MAX_PARAMETERS];
+          guint64 timestamp, tid;
+          guint i;
+
+          if (n_parameters != event_data->n_parameters)
+            {
+              /* TODO: Use a proper error code here. */
+              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                           "Invalid binary log file record %u — %s",
+                           record_number,
+                           "event contains the wrong number of parameters");
+              goto done;
+            }
+
+          record += DFL_BINARY_RECORD_HEADER_LENGTH;
+          timestamp = read_uint64_le (record);
+          tid = read_uint64_le (record + 8);
+          string_mask &= (1 << n_parameters) - 1;
+
+          for (i = 0; i < n_parameters; i++)
+            {
+              guint64 value = read_uint64_le (record + 16 + i * 8);
+
+              if (string_mask & (1 << i))
+                {
+                  if (value >= strings->len)
+                    {
+                      /* TODO: Use a proper error code here. */
+                      g_set_error (&child_error, G_IO_ERROR,
+                                   G_IO_ERROR_UNKNOWN,
+                                   "Invalid binary log file record %u — %s",
+                                   record_number,
+                                   "invalid string table index");
+                      goto done;
+                    }
+
+                  parameters[i].string = strings->pdata[value];
+                }
+              else
+                {
+                  parameters[i].id = value;
+                }
+            }
+
+          if (!parse_state_update_timestamp (&state, tid, timestamp))
+            {
+              /* TODO: Use a proper error code here. */
+              g_set_error (&child_error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                           "Invalid timestamp ‘%" G_GUINT64_FORMAT "’ in "
+                           "record %u: timestamps must be monotonically "
+                           "increasing",
+                           timestamp, record_number);
+              goto done;
+            }
+
+          if (!parse_state_filter_event (&state, code, timestamp, tid))
+            continue;
+
+          _dfl_event_store_add_decoded (&state.events,
+                                        event_type_interned_array[code],
+                                        timestamp, tid, parameters,
+                                        n_parameters, string_mask);
+        }
+      else
+        {
+          /* Ignore unknown event types to allow for more probe points to be
+           * added to GLib in future. */
+        }
+    }
+
+done:
+  /* Success? */
+  if (child_error == NULL)
+    parse_state_finish (&state, self);
+  else
+    g_propagate_error (error, child_error);
+
+  g_ptr_array_unref (strings);
+  parse_state_clear (&state);
+}
+
+/* Parse lines from @data until the end of the buffer or an error, or (if
+ * @stop_after_header is %TRUE) until the header line has been parsed. Lines
+ * are split in the same way as g_data_input_stream_read_line(): a trailing
+ * newline at the end of the buffer does not start a new line. The number of
+ * bytes consumed is returned in @n_consumed_out. */
+static gboolean
+parse_lines (ParseState   *state,
+             const gchar  *data,
+             gsize         length,
+             gboolean      stop_after_header,
+             gsize        *n_consumed_out,
+             GError      **error)
+{
+  gsize offset = 0;
+  gboolean retval = TRUE;
+
+  while (offset < length)
+    {
+      gsize line_length;
+
+      if (!parse_line (state, data + offset, length - offset, &line_length,
+                       error))
+        {
+          retval = FALSE;
+          break;
+        }
+
+      offset = MIN (offset + line_length + 1, length);
+
+      if (stop_after_header && state->file_version != 0)
+        break;
+    }
+
+  if (n_consumed_out != NULL)
+    *n_consumed_out = offset;
+
+  return retval;
+}
+
+/* Minimum size of a chunk of log to parse in its own thread. Below this, the
+ * overhead of starting the thread outweighs the parallelism. */
+#define PARALLEL_CHUNK_SIZE_MIN (1024 * 1024)
+
+/* A chunk of the log, starting and ending on a line boundary, to be parsed in
+ * a worker thread. */
+typedef struct
+{
+  const gchar *data;  /* unowned */
+  gsize length;
+  ParseState state;
+  gboolean success;
+} ParseChunk;
+
+static void
+parse_chunk_cb (gpointer data,
+                gpointer user_data)
+{
+  ParseChunk *chunk = data;
+
+  /* The error is discarded: if any chunk fails, the whole log is parsed again
+   * serially to report the error. */
+  chunk->success = parse_lines (&chunk->state, chunk->data, chunk->length,
+                                FALSE, NULL, NULL);
+}
+
+/* Check that the timestamps in each thread are monotonically increasing
+ * across the borders between @chunks. Within each chunk, they have already
+ * been checked by parse_line(). */
+static gboolean
+parse_chunks_check_timestamps (const ParseChunk *chunks,
+                               guint             n_chunks)
+{
+  GHashTable/*<unowned guint64, unowned guint64>*/ *highest_timestamps = NULL;
+  gboolean retval = TRUE;
+  guint i;
+
+  highest_timestamps = g_hash_table_new (g_int64_hash, g_int64_equal);
+
+  for (i = 0; i < n_chunks && retval; i++)
+    {
+      GHashTableIter iter;
+      const guint64 *tid, *timestamp;
+
+      g_hash_table_iter_init (&iter, chunks[i].state.first_timestamps);
+
+      while (g_hash_table_iter_next (&iter, (gpointer *) &tid,
+                                     (gpointer *) &timestamp))
+        {
+          const guint64 *highest_timestamp;
+
+          highest_timestamp = g_hash_table_lookup (highest_timestamps, tid);
+
+          if (highest_timestamp != NULL && *timestamp < *highest_timestamp)
+            {
+              retval = FALSE;
+              break;
+            }
+        }
+
+      g_hash_table_iter_init (&iter, chunks[i].state.highest_timestamps);
+
+      while (g_hash_table_iter_next (&iter, (gpointer *) &tid,
+                                     (gpointer *) &timestamp))
+        g_hash_table_insert (highest_timestamps, (gpointer) tid,
+                             (gpointer) timestamp);
+    }
+
+  g_hash_table_unref (highest_timestamps);
+
+  return retval;
+}
+
+/* Parse @data (which follows the header, already parsed into @state) in
+ * @n_chunks chunks in parallel, and append the resulting events to @state in
+ * file order. If @state is building an index, each chunk builds its own, and
+ * they are appended to it in the same way. Returns %FALSE if any line is
+ * invalid, or if the timestamps are not monotonic across chunk borders; the
+ * caller must then parse the log serially to find the error. */
+static gboolean
+parse_chunks (ParseState  *state,
+              const gchar *data,
+              gsize        length,
+              guint        n_chunks)
+{
+  ParseChunk *chunks = NULL;
+  GThreadPool *pool = NULL;
+  gsize chunk_start;
+  gboolean success = TRUE;
+  guint i;
+
+  chunks = g_new0 (ParseChunk, n_chunks);
+
+  /* Split at newline boundaries. Chunks may end up empty if the log contains
+   * very long lines, which is harmless. */
+  for (i = 0, chunk_start = 0; i < n_chunks; i++)
+    {
+      gsize chunk_end;
+
+      if (i == n_chunks - 1)
+        {
+          chunk_end = length;
+        }
+      else
+        {
+          const gchar *newline;
+
+          chunk_end = MAX (chunk_start, (length / n_chunks) * (i + 1));
+          newline = memchr (data + chunk_end, '\n', length - chunk_end);
+          chunk_end = (newline != NULL) ? (gsize) (newline - data) + 1 : length;
+        }
+
+      chunks[i].data = data + chunk_start;
+      chunks[i].length = chunk_end - chunk_start;
+
+      /* Each chunk carries on from the header. As the line number is
+       * non-zero, parse_line() will reject a second header. Line numbers in
+       * later chunks are inaccurate, but they are only used in errors, which
+       * are reported by re-parsing serially. */
+      parse_state_init (&chunks[i].state, state->filter);
+      chunks[i].state.line_number = state->line_number;
+      chunks[i].state.file_version = state->file_version;
+      chunks[i].state.initial_timestamp = state->initial_timestamp;
+      chunks[i].state.first_timestamps = g_hash_table_new_full (g_int64_hash,
+                                                                g_int64_equal,
+                                                                g_free,
+                                                                g_free);
+
+      if (state->index != NULL)
+        {
+          chunks[i].state.index =
+            _dfl_log_index_new (G_N_ELEMENTS (event_type_array));
+          chunks[i].state.index_base = state->index_base;
+        }
+
+      chunk_start = chunk_end;
+    }
+
+  pool = g_thread_pool_new (parse_chunk_cb, NULL, n_chunks, FALSE, NULL);
+
+  for (i = 0; i < n_chunks; i++)
+    g_thread_pool_push (pool, &chunks[i], NULL);
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  /* Reconcile the chunks. */
+  for (i = 0; i < n_chunks; i++)
+    success = success && chunks[i].success;
+
+  success = success && parse_chunks_check_timestamps (chunks, n_chunks);
+
+  /* Merge the events in file order, transferring ownership to @state. */
+  for (i = 0; i < n_chunks && success; i++)
+    {
+      _dfl_event_store_take (&state->events, &chunks[i].state.events);
+
+      if (state->index != NULL)
+        _dfl_log_index_append (state->index, chunks[i].state.index);
+    }
+
+  for (i = 0; i < n_chunks; i++)
+    parse_state_clear (&chunks[i].state);
+
+  g_free (chunks);
+
+  return success;
+}
+
+/* Parse a complete text log which is in memory into @state, which must be
+ * freshly initialised (and, if building an index, have a new index). Lines are
+ * tokenised in place, without copying them. Large logs are split into chunks
+ * which are parsed in parallel. */
+static gboolean
+parse_text_buffer (ParseState   *state,
+                   const gchar  *data,
+                   gsize         length,
+                   GError      **error)
+{
+  gsize header_length;
+  guint n_chunks;
+
+  /* Parse up to and including the header serially, as everything after it
+   * depends on it. */
+  if (!parse_lines (state, data, length, TRUE, &header_length, error))
+    return FALSE;
+
+  n_chunks = MIN ((gsize) g_get_num_processors (),
+                  (length - header_length) / PARALLEL_CHUNK_SIZE_MIN);
+
+  if (n_chunks > 1 &&
+      parse_chunks (state, data + header_length, length - header_length,
+                    n_chunks))
+    return TRUE;
+
+  /* Parse serially. If parallel parsing failed, start again so that the first
+   * error in the file is reported, with the right line number. */
+  if (n_chunks > 1)
+    {
+      const ParseFilter *filter = state->filter;
+      gboolean indexing = (state->index != NULL);
+
+      parse_state_clear (state);
+      parse_state_init (state, filter);
+      header_length = 0;
+
+      if (indexing)
+        {
+          state->index = _dfl_log_index_new (G_N_ELEMENTS (event_type_array));
+          state->index_base = data;
+        }
+    }
+
+  return parse_lines (state, data + header_length, length - header_length,
+                      FALSE, NULL, error);
+}
+
+static void load_from_compressed_stream (DflParser     *self,
+                                         GInputStream  *stream,
+                                         Compression    compression,
+                                         GCancellable  *cancellable,
+                                         GError       **error);
+
+#ifdef HAVE_ZSTD
+/* State for parsing a log as batches of it are decompressed by
+ * _dfl_zstd_decompress_frames(). */
+typedef struct
+{
+  ParseState state;
+  /* Partial line after the last complete line parsed; or the whole log so far
+   * if it is binary, or if its format is not yet known. */
+  GByteArray *pending;  /* owned */
+  gboolean format_known;
+  gboolean is_binary;
+  GError *error;  /* owned; nullable */
+} FramesData;
+
+/* Parse the complete lines in @data, which follows @frames->pending in the
+ * log, and keep the partial line at its end in @frames->pending. Lines are
+ * parsed in place, except for those which span batches. */
+static gboolean
+parse_frames_text (FramesData  *frames,
+                   const gchar *data,
+                   gsize        length)
+{
+  gsize start = 0, complete_length;
+
+  for (complete_length = length;
+       complete_length > 0 && data[complete_length - 1] != '\n';
+       complete_length--);
+
+  /* Finish the line carried over from the previous batch. */
+  if (frames->pending->len > 0)
+    {
+      const gchar *newline = memchr (data, '\n', length);
+
+      start = (newline != NULL) ? (gsize) (newline - data) + 1 : length;
+      g_byte_array_append (frames->pending, (const guint8 *) data, start);
+
+      if (newline == NULL)
+        return TRUE;
+
+      if (!parse_lines (&frames->state, (const gchar *) frames->pending->data,
+                        frames->pending->len, FALSE, NULL, &frames->error))
+        return FALSE;
+
+      g_byte_array_set_size (frames->pending, 0);
+    }
+
+  if (complete_length > start &&
+      !parse_lines (&frames->state, data + start, complete_length - start,
+                    FALSE, NULL, &frames->error))
+    return FALSE;
+
+  start = MAX (start, complete_length);
+  g_byte_array_append (frames->pending, (const guint8 *) data + start,
+                       length - start);
+
+  return TRUE;
+}
+
+static gboolean
+parse_frames_batch_cb (const guint8 *data,
+                       gsize         length,
+                       gpointer      user_data)
+{
+  FramesData *frames = user_data;
+  GByteArray *buffered = NULL;
+  gboolean success;
+
+  if (frames->is_binary)
+    {
+      g_byte_array_append (frames->pending, data, length);
+      return TRUE;
+    }
+  else if (frames->format_known)
+    {
+      return parse_frames_text (frames, (const gchar *) data, length);
+    }
+
+  /* Buffer the start of the log until there is enough to tell whether it is
+   * a binary log, which has to be parsed in one go. */
+  g_byte_array_append (frames->pending, data, length);
+
+  if (frames->pending->len < DFL_BINARY_MAGIC_LENGTH)
+    return TRUE;
+
+  frames->format_known = TRUE;
+  frames->is_binary = is_binary_log (frames->pending->data,
+                                     frames->pending->len);
+
+  if (frames->is_binary)
+    return TRUE;
+
+  buffered = frames->pending;
+  frames->pending = g_byte_array_new ();
+  success = parse_frames_text (frames, (const gchar *) buffered->data,
+                               buffered->len);
+  g_byte_array_unref (buffered);
+
+  return success;
+}
+
+/* Parse a zstd-compressed log which is in memory, decompressing its frames in
+ * parallel batches, and parsing each batch while the next is decompressed.
+ * Returns %FALSE without setting @error if the log’s frames can’t be
+ * decompressed in parallel, in which case it should be parsed as a stream. */
+static gboolean
+load_from_zstd_frames (DflParser    *self,
+                       const gchar  *data,
+                       gsize         length,
+                       GError      **error)
+{
+  FramesData frames;
+  GError *child_error = NULL;
+  gboolean handled;
+
+  parse_state_init (&frames.state, &self->filter);
+  frames.pending = g_byte_array_new ();
+  frames.format_known = FALSE;
+  frames.is_binary = FALSE;
+  frames.error = NULL;
+
+  handled = _dfl_zstd_decompress_frames ((const guint8 *) data, length,
+                                         parse_frames_batch_cb, &frames,
+                                         &child_error);
+
+  if (frames.error != NULL)
+    {
+      g_propagate_error (error, g_steal_pointer (&frames.error));
+      g_clear_error (&child_error);
+      handled = TRUE;
+    }
+  else if (child_error != NULL)
+    {
+      g_propagate_error (error, child_error);
+      handled = TRUE;
+    }
+  else if (handled && frames.is_binary)
+    {
+      load_from_binary (self, frames.pending->data, frames.pending->len,
+                        error);
+    }
+  else if (handled)
+    {
+      /* Parse the final line, which might not have a trailing newline. */
+      if (parse_lines (&frames.state, (const gchar *) frames.pending->data,
+                       frames.pending->len, FALSE, NULL, &child_error))
+        parse_state_finish (&frames.state, self);
+      else
+        g_propagate_error (error, child_error);
+    }
+
+  g_byte_array_unref (frames.pending);
+  parse_state_clear (&frames.state);
+
+  return handled;
+}
+#endif
+
+/* Parse a complete compressed log which is in memory. Multi-frame zstd logs
+ * whose frame sizes are known and bounded are decompressed in parallel
+ * batches, each parsed while the next is decompressed; anything else is
+ * decompressed as a stream and parsed line by line. Either way, the
+ * decompressed log is never held in memory in full (unless it is a binary
+ * log). */
+static void
+load_from_compressed_buffer (DflParser    *self,
+                             const gchar  *data,
+                             gsize         length,
+                             Compression   compression,
+                             GError      **error)
+{
+  GInputStream *memory_stream = NULL;
+
+#ifdef HAVE_ZSTD
+  if (compression == COMPRESSION_ZSTD &&
+      load_from_zstd_frames (self, data, length, error))
+    return;
+#endif
+
+  memory_stream = g_memory_input_stream_new_from_data (data, length, NULL);
+  load_from_compressed_stream (self, memory_stream, compression, NULL, error);
+  g_object_unref (memory_stream);
+}
+
+/* Parse a complete log which is already in memory, such as a mapped file.
+ * Lines are tokenised in place, without copying them. Large logs are split
+ * into chunks which are parsed in parallel. Binary and compressed logs are
+ * detected and handled separately. */
+static void
+load_from_buffer (DflParser    *self,
+                  const gchar  *data,
+                  gsize         length,
+                  GError      **error)
+{
+  ParseState state;
+  Compression compression;
+  GError *child_error = NULL;
+
+  compression = detect_compression ((const guint8 *) data, length);
+
+  if (compression != COMPRESSION_NONE)
+    {
+      load_from_compressed_buffer (self, data, length, compression, error);
+      return;
+    }
+
+  if (is_binary_log ((const guint8 *) data, length))
+    {
+      load_from_binary (self, (const guint8 *) data, length, error);
+      return;
+    }
+
+  parse_state_init (&state, &self->filter);
+
+  /* Success? */
+  if (parse_text_buffer (&state, data, length, &child_error))
+    parse_state_finish (&state, self);
+  else
+    g_propagate_error (error, child_error);
+
+  parse_state_clear (&state);
+}
+
+/* Parse the lifetime event line at @offset in a block of the log which is
+ * otherwise being skipped. The line is validated exactly as parse_line() does
+ * when parsing the whole block; in addition, @offset must be at the start of a
+ * line, and the line must produce an event (lifetime events always match the
+ * filter), so an index which does not match the log is detected. */
+static gboolean
+parse_lifetime_line (ParseState  *state,
+                     const gchar *data,
+                     gsize        block_start,
+                     gsize        block_end,
+                     gsize        offset)
+{
+  guint n_events;
+
+  if (offset < block_start || offset >= block_end ||
+      (offset > 0 && data[offset - 1] != '\n'))
+    return FALSE;
+
+  n_events = _dfl_event_store_get_n_events (&state->events);
+
+  return (parse_line (state, data + offset, block_end - offset, NULL, NULL) &&
+          _dfl_event_store_get_n_events (&state->events) == n_events + 1);
+}
+
+/* Load the events in the parser’s time range from a text log which is in
+ * memory, using @index to skip the blocks of the log which are entirely
+ * outside the range. Lifetime events in skipped blocks are parsed
+ * individually (see parse_lifetime_line()), so the result is the same as from
+ * load_from_buffer(). The other lines in skipped blocks were validated when
+ * the index was built, as indexes are only built from valid logs. Returns
+ * %FALSE if this fails for any reason, in which case the caller should fall
+ * back to load_from_buffer() to report the error properly. */
+static gboolean
+load_from_buffer_indexed (DflParser    *self,
+                          const gchar  *data,
+                          gsize         length,
+                          DflLogIndex  *index)
+{
+  ParseState state;
+  const DflLogIndexBlock *blocks;
+  const guint64 *lifetime_offsets;
+  gsize n_blocks, n_lifetime_offsets, i, j;
+  DflTimestamp start, end;
+  gboolean success;
+
+  blocks = _dfl_log_index_get_blocks (index, &n_blocks);
+  lifetime_offsets = _dfl_log_index_get_lifetime_offsets (index,
+                                                          &n_lifetime_offsets);
+
+  parse_state_init (&state, &self->filter);
+
+  /* Header. */
+  success = (parse_lines (&state, data, length, TRUE, NULL, NULL) &&
+             state.file_version != 0 &&
+             state.initial_timestamp ==
+             dfl_log_index_get_initial_timestamp (index));
+
+  /* Work out the absolute time range, saturating rather than overflowing. */
+  start = state.initial_timestamp +
+          MIN (self->filter.start, G_MAXUINT64 - state.initial_timestamp);
+  end = state.initial_timestamp +
+        MIN (self->filter.end, G_MAXUINT64 - state.initial_timestamp);
+
+  for (i = 0, j = 0; success && i < n_blocks; i++)
+    {
+      gsize block_start = blocks[i].offset;
+      gsize block_end = (i + 1 < n_blocks) ? blocks[i + 1].offset : length;
+
+      if (block_start > block_end || block_end > length)
+        {
+          success = FALSE;
+          break;
+        }
+
+      if (blocks[i].max_timestamp >= start && blocks[i].min_timestamp <= end)
+        {
+          /* Parse the whole block. */
+          success = parse_lines (&state, data + block_start,
+                                 block_end - block_start, FALSE, NULL, NULL);
+
+          while (j < n_lifetime_offsets && lifetime_offsets[j] < block_end)
+            j++;
+        }
+      else
+        {
+          /* Only parse the lifetime events from the block. */
+          for (; success && j < n_lifetime_offsets &&
+                 lifetime_offsets[j] < block_end; j++)
+            {
+              success = parse_lifetime_line (&state, data, block_start,
+                                             block_end, lifetime_offsets[j]);
+            }
+        }
+    }
+
+  if (success)
+    parse_state_finish (&state, self);
+
+  parse_state_clear (&state);
+
+  return success;
+}
+
+/* Load the whole of the mapped log file at @filename (keeping only the events
+ * in the parser’s time range), and build its index at the same time, from the
+ * same parallel parse. Building an index reads the whole log anyway, so this
+ * is no slower than loading it without one. Returns %FALSE if the log has to
+ * be loaded normally. */
+static gboolean
+load_from_file_indexing (DflParser   *self,
+                         const gchar *filename,
+                         const gchar *data,
+                         gsize        length)
+{
+  ParseState state;
+  guint64 mtime;
+  gboolean success;
+  GError *error = NULL;
+
+  if (!_dfl_log_index_stat_log (filename, NULL, &mtime, &error))
+    {
+      g_debug ("%s: Error building index: %s", G_STRFUNC, error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  parse_state_init (&state, &self->filter);
+  state.index = _dfl_log_index_new (G_N_ELEMENTS (event_type_array));
+  state.index_base = data;
+
+  success = parse_text_buffer (&state, data, length, NULL);
+
+  if (success)
+    {
+      parse_state_finish (&state, self);
+
+      _dfl_log_index_set_initial_timestamp (state.index,
+                                            state.initial_timestamp);
+      _dfl_log_index_set_log (state.index, filename, length, mtime);
+
+      /* Saving the index is best-effort: the log may be in a read-only
+       * directory. */
+      dfl_log_index_save (state.index, &error);
+
+      if (error != NULL)
+        {
+          g_debug ("%s: Error saving index: %s", G_STRFUNC, error->message);
+          g_clear_error (&error);
+        }
+    }
+
+  parse_state_clear (&state);
+
+  return success;
+}
+
+/* Load the parser’s time range from the mapped log file at @filename, using
+ * its sidecar index. If the index doesn’t exist or is out of date, load the
+ * whole log and build and save the index as part of that. Returns %FALSE if
+ * the log has to be loaded normally. */
+static gboolean
+load_from_file_indexed (DflParser   *self,
+                        const gchar *filename,
+                        const gchar *data,
+                        gsize        length)
+{
+  DflLogIndex *index = NULL;
+  gboolean success;
+  GError *error = NULL;
+
+  if (detect_compression ((const guint8 *) data, length) != COMPRESSION_NONE ||
+      is_binary_log ((const guint8 *) data, length))
+    return FALSE;
+
+  index = dfl_log_index_load (filename, &error);
+
+  if (index == NULL)
+    {
+      g_debug ("%s: Building index for ‘%s’: %s",
+               G_STRFUNC, filename, error->message);
+      g_clear_error (&error);
+
+      return load_from_file_indexing (self, filename, data, length);
+    }
+
+  success = load_from_buffer_indexed (self, data, length, index);
+  g_object_unref (index);
+
+  return success;
+}
+
+/* Parse a text log from @data_stream line by line. */
+static void
+load_from_text_stream (DflParser         *self,
+                       GDataInputStream  *data_stream,
+                       GCancellable      *cancellable,
+                       GError           **error)
+{
+  gchar *line = NULL;
+  gsize length = 0;
+  ParseState state;
+  GError *child_error = NULL;
+
+  parse_state_init (&state, &self->filter);
+
+  for (line = g_data_input_stream_read_line (data_stream, &length,
+                                             cancellable, &child_error);
+       line != NULL;
+       g_free (line),
+       line = g_data_input_stream_read_line (data_stream, &length,
+                                             cancellable, &child_error))
+    {
+      if (!parse_line (&state, line, length, NULL, &child_error))
+        break;
+    }
+
+  g_free (line);
+
+  /* Success? */
+  if (child_error == NULL)
+    parse_state_finish (&state, self);
+  else
+    g_propagate_error (error, child_error);
+
+  parse_state_clear (&state);
+}
+
+/* Parse a binary log from @stream. The format is not line-based, so the whole
+ * stream is read into memory and parsed from there. */
+static void
+load_from_binary_stream (DflParser     *self,
+                         GInputStream  *stream,
+                         GCancellable  *cancellable,
+                         GError       **error)
+{
+  GOutputStream *memory_stream = NULL;
+
+  memory_stream = g_memory_output_stream_new_resizable ();
+
+  if (g_output_stream_splice (memory_stream, stream,
+                              G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                              cancellable, error) >= 0)
+    {
+      GMemoryOutputStream *memory = G_MEMORY_OUTPUT_STREAM (memory_stream);
+
+      load_from_binary (self, g_memory_output_stream_get_data (memory),
+                        g_memory_output_stream_get_data_size (memory), error);
+    }
+
+  g_object_unref (memory_stream);
+}
+
+/* Parse a log from @stream, detecting whether it is a text, binary or
+ * compressed log. Compressed logs are only accepted if @decompress is %TRUE,
+ * so that they cannot be nested. */
+static void
+load_from_stream (DflParser     *self,
+                  GInputStream  *stream,
+                  gboolean       decompress,
+                  GCancellable  *cancellable,
+                  GError       **error)
+{
+  GDataInputStream *data_stream = NULL;
+  GBufferedInputStream *buffered_stream;
+  const guint8 *peeked;
+  gsize n_peeked;
+  gssize n_read;
+  Compression compression;
+  GError *child_error = NULL;
+
+  data_stream = g_data_input_stream_new (stream);
+  buffered_stream = G_BUFFERED_INPUT_STREAM (data_stream);
+
+  /* Peek at the start of the stream to check whether it’s a binary or
+   * compressed log. */
+  do
+    n_read = g_buffered_input_stream_fill (buffered_stream, -1, cancellable,
+                                           &child_error);
+  while (n_read > 0 &&
+         g_buffered_input_stream_get_available (buffered_stream) <
+         DFL_BINARY_MAGIC_LENGTH);
+
+  if (n_read < 0)
+    {
+      g_propagate_error (error, child_error);
+      g_object_unref (data_stream);
+      return;
+    }
+
+  peeked = g_buffered_input_stream_peek_buffer (buffered_stream, &n_peeked);
+  compression = detect_compression (peeked, n_peeked);
+
+  if (compression != COMPRESSION_NONE && decompress)
+    load_from_compressed_stream (self, G_INPUT_STREAM (data_stream),
+                                 compression, cancellable, error);
+  else if (is_binary_log (peeked, n_peeked))
+    load_from_binary_stream (self, G_INPUT_STREAM (data_stream), cancellable,
+                             error);
+  else
+    load_from_text_stream (self, data_stream, cancellable, error);
+
+  g_object_unref (data_stream);
+}
+
+/* Parse a compressed log from @stream. It is decompressed incrementally as it
+ * is parsed, so memory use does not grow with the size of the decompressed
+ * log (unless it is a binary log, which must be read into memory whole). */
+static void
+load_from_compressed_stream (DflParser     *self,
+                             GInputStream  *stream,
+                             Compression    compression,
+                             GCancellable  *cancellable,
+                             GError       **error)
+{
+  GConverter *converter = NULL;
+  GInputStream *converter_stream = NULL;
+
+  converter = decompressor_new (compression, error);
+
+  if (converter == NULL)
+    return;
+
+  converter_stream = g_converter_input_stream_new (stream, converter);
+  load_from_stream (self, converter_stream, FALSE, cancellable, error);
+
+  g_object_unref (converter_stream);
+  g_object_unref (converter);
+}
+
+/* Build an index for a text log which is in memory, by scanning it (in
+ * parallel, if it is large) without creating any events. Lines are validated
+ * as when loading the log. */
+DflLogIndex *
+_dfl_parser_build_log_index (const gchar  *data,
+                             gsize         length,
+                             GError      **error)
+{
+  ParseState state;
+  DflLogIndex *index = NULL;
+
+  if (detect_compression ((const guint8 *) data, length) != COMPRESSION_NONE ||
+      is_binary_log ((const guint8 *) data, length))
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           "Only uncompressed text logs can be indexed");
+      return NULL;
+    }
+
+  parse_state_init (&state, NULL);
+  state.index = _dfl_log_index_new (G_N_ELEMENTS (event_type_array));
+  state.index_base = data;
+
+  if (parse_text_buffer (&state, data, length, error))
+    {
+      index = g_steal_pointer (&state.index);
+      _dfl_log_index_set_initial_timestamp (index, state.initial_timestamp);
+    }
+
+  parse_state_clear (&state);
+
+  return index;
+}
+
+/**
+ * dfl_parser_new:
+ *
+ * TODO
+ *
+ * Returns: (transfer full): a new #DflParser
+ * Since: 0.1.0
+ */
+DflParser *
+dfl_parser_new (void)
+{
+  return g_object_new (DFL_TYPE_PARSER, NULL);
+}
+
+/**
+ * dfl_parser_set_time_range:
+ * @self: a #DflParser
+ * @start: start of the range, relative to the log’s initial timestamp
+ * @end: end of the range (inclusive), relative to the log’s initial
+ *    timestamp, or %G_MAXINT64 for the end of the log
+ *
+ * Only load events whose timestamps fall in the given range. The range is
+ * relative to the timestamp in the log’s header, so `0` is the start of the
+ * log. Events outside the range are dropped while parsing, so loading a small
+ * window of a large log uses correspondingly little memory.
+ *
+ * Events which create, name or destroy objects (such as `g_source_new`) are
+ * always loaded, so that objects referred to by events in the range can still
+ * be modelled. Spans (such as a main context being acquired) which begin
+ * before the range and end in it are clipped to the start of the range when
+ * building a #DflModel.
+ *
+ * This affects subsequent loads, and must not be called while a load is in
+ * progress.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_parser_set_time_range (DflParser   *self,
+                           DflDuration  start,
+                           DflDuration  end)
+{
+  g_return_if_fail (DFL_IS_PARSER (self));
+  g_return_if_fail (start >= 0);
+  g_return_if_fail (end >= start);
+
+  self->filter.start = start;
+  self->filter.end = (end == G_MAXINT64) ? G_MAXUINT64 : (guint64) end;
+}
+
+/**
+ * dfl_parser_set_thread_ids:
+ * @self: a #DflParser
+ * @thread_ids: (array length=n_thread_ids) (nullable): IDs of the threads to
+ *    load events from, or %NULL to load events from all threads
+ * @n_thread_ids: number of elements in @thread_ids
+ *
+ * Only load events from the given threads. Events from other threads are
+ * dropped while parsing, except for the halves of spans which can begin and
+ * end on different threads (such as `g_task_before_run_in_thread`), which are
+ * always loaded.
+ *
+ * As with dfl_parser_set_time_range(), events which create, name or destroy
+ * objects are always loaded. This affects subsequent loads, and must not be
+ * called while a load is in progress.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_parser_set_thread_ids (DflParser         *self,
+                           const DflThreadId *thread_ids,
+                           gsize              n_thread_ids)
+{
+  gsize i;
+
+  g_return_if_fail (DFL_IS_PARSER (self));
+  g_return_if_fail (thread_ids != NULL || n_thread_ids == 0);
+
+  g_clear_pointer (&self->filter.thread_ids, g_hash_table_unref);
+
+  if (thread_ids == NULL)
+    return;
+
+  self->filter.thread_ids = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                                   g_free, NULL);
+
+  for (i = 0; i < n_thread_ids; i++)
+    {
+      guint64 *key = NULL;
+
+      key = g_new0 (guint64, 1);
+      *key = thread_ids[i];
+      g_hash_table_add (self->filter.thread_ids, key);
+    }
+}
+
+/**
+ * dfl_parser_set_event_types:
+ * @self: a #DflParser
+ * @event_types: (array zero-terminated=1) (nullable): types of the events to
+ *    load, or %NULL to load all types
+ *
+ * Only load events of the given types. Events of other types are dropped
+ * while parsing. Types which the parser does not recognise are ignored.
+ * Events which begin or end a span (such as `g_main_context_acquire` and
+ * `g_main_context_release`) are loaded along with the other half of their pair
+ * if either type is given, so that spans are never half-loaded.
+ *
+ * As with dfl_parser_set_time_range(), events which create, name or destroy
+ * objects are always loaded. This affects subsequent loads, and must not be
+ * called while a load is in progress.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_parser_set_event_types (DflParser           *self,
+                            const gchar * const *event_types)
+{
+  gsize i;
+
+  g_return_if_fail (DFL_IS_PARSER (self));
+
+  if (event_types == NULL)
+    {
+      self->filter.event_type_mask = G_MAXUINT64;
+      return;
+    }
+
+  event_types_init ();
+  self->filter.event_type_mask = 0;
+
+  for (i = 0; event_types[i] != NULL; i++)
+    {
+      gint code = event_type_lookup (event_types[i], strlen (event_types[i]));
+
+      if (code >= 0)
+        self->filter.event_type_mask |= G_GUINT64_CONSTANT (1) << code;
+    }
+}
+
+/**
+ * dfl_parser_load_from_data:
+ * @self: a #DflParser
+ * @data: (array length=length): data to load
+ * @length: number of bytes in @data
+ * @error: return location for a #GError, or %NULL
+ *
+ * TODO
+ *
+ * Since: 0.1.0
+ */
+void
+dfl_parser_load_from_data (DflParser     *self,
+                           const guint8  *data,
+                           gssize         length,
+                           GError       **error)
+{
+  g_return_if_fail (DFL_IS_PARSER (self));
+  g_return_if_fail (data != NULL);
+  g_return_if_fail (length > 0);
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  /* The data is already in memory, so parse it in place. */
+  load_from_buffer (self, (const gchar *) data, length, error);
+}
+
+/**
+ * dfl_parser_load_from_file:
+ * @self: a #DflParser
+ * @filename: path to file to load log from
+ * @error: return location for a #GError, or %NULL
+ *
+ * Load a log from the file at @filename. If possible, the file is mapped into
+ * memory and parsed in place, which is significantly faster than
+ * dfl_parser_load_from_stream() for large logs. If the file cannot be mapped
+ * (for example, if it is a pipe), it is read as a stream instead. The
+ * resulting #DflEventSequence is the same in either case.
+ *
+ * Since: 0.1.0
+ */
+void
+dfl_parser_load_from_file (DflParser    *self,
+                           const gchar  *filename,
+                           GError      **error)
+{
+  GMappedFile *mapped_file = NULL;
+  GFile *file = NULL;
+  GFileInputStream *stream = NULL;
+
+  g_return_if_fail (DFL_IS_PARSER (self));
+  g_return_if_fail (filename != NULL);
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  /* Try mapping the file first. The mapping is read-only and private, so the
+   * parser can tokenise it without copying. */
+  mapped_file = g_mapped_file_new (filename, FALSE, NULL);
+
+  if (mapped_file != NULL)
+    {
+      const gchar *data = g_mapped_file_get_contents (mapped_file);
+      gsize length = g_mapped_file_get_length (mapped_file);
+
+      /* If only part of the log is wanted, use its index to skip the rest. */
+      if (!(self->filter.start > 0 || self->filter.end < G_MAXUINT64) ||
+          !load_from_file_indexed (self, filename, data, length))
+        load_from_buffer (self, data, length, error);
+
+      g_mapped_file_unref (mapped_file);
+
+      return;
+    }
+
+  /* Fall back to loading by creating a stream for the file. This will report
+   * any errors opening the file. */
+  file = g_file_new_for_path (filename);
+  stream = g_file_read (file, NULL, error);
+  g_object_unref (file);
+
+  if (stream == NULL)
+    return;
+
+  dfl_parser_load_from_stream (self, G_INPUT_STREAM (stream), NULL, error);
+
+  g_object_unref (stream);
+}
+
+/**
+ * dfl_parser_load_from_files:
+ * @self: a #DflParser
+ * @filenames: (array zero-terminated=1): paths to the files to load logs from,
+ *    one per process
+ * @error: return location for a #GError, or %NULL
+ *
+ * Load logs from several processes, as with dfl_parser_load_from_file(), and
+ * merge them into a single #DflEventSequence ordered by timestamp, as with
+ * dfl_event_sequence_new_merged(). The events of each log are moved into the
+ * merged sequence rather than copied, so little more memory is needed than
+ * for the logs themselves. The processes are named after the
+ * basenames of their logs. The time range, thread and event type filters
+ * apply to each log separately. At most 256 logs can be merged; if more are
+ * given, %G_IO_ERROR_INVALID_ARGUMENT is returned.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_parser_load_from_files (DflParser           *self,
+                            const gchar * const *filenames,
+                            GError             **error)
+{
+  GPtrArray/*<owned DflEventSequence>*/ *sequences = NULL;
+  GPtrArray/*<owned utf8>*/ *process_names = NULL;
+  gsize i, n_filenames;
+
+  g_return_if_fail (DFL_IS_PARSER (self));
+  g_return_if_fail (filenames != NULL && filenames[0] != NULL);
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  n_filenames = g_strv_length ((gchar **) filenames);
+
+  /* Each process’ index must fit in the tag added to its IDs. */
+  if (n_filenames > DFL_PROCESS_MAX + 1)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                   "Too many logs to merge: %" G_GSIZE_FORMAT " (at most %u)",
+                   n_filenames, DFL_PROCESS_MAX + 1);
+      return;
+    }
+
+  sequences = g_ptr_array_new_with_free_func (g_object_unref);
+  process_names = g_ptr_array_new_with_free_func (g_free);
+
+  for (i = 0; filenames[i] != NULL; i++)
+    {
+      DflParser *child = NULL;
+      GError *child_error = NULL;
+
+      child = dfl_parser_new ();
+      child->filter.start = self->filter.start;
+      child->filter.end = self->filter.end;
+      child->filter.event_type_mask = self->filter.event_type_mask;
+      child->filter.thread_ids = (self->filter.thread_ids != NULL) ?
+                                 g_hash_table_ref (self->filter.thread_ids) :
+                                 NULL;
+
+      dfl_parser_load_from_file (child, filenames[i], &child_error);
+
+      if (child_error != NULL)
+        {
+          g_propagate_prefixed_error (error, child_error, "%s: ",
+                                      filenames[i]);
+          g_object_unref (child);
+          g_ptr_array_unref (process_names);
+          g_ptr_array_unref (sequences);
+          return;
+        }
+
+      /* Nothing else can refer to the child’s sequence, so its events can be
+       * moved into the merged sequence. */
+      g_ptr_array_add (sequences, g_steal_pointer (&child->sequence));
+      g_ptr_array_add (process_names, g_path_get_basename (filenames[i]));
+      g_object_unref (child);
+    }
+
+  g_ptr_array_add (process_names, NULL);
+
+  g_clear_object (&self->sequence);
+  self->sequence =
+      _dfl_event_sequence_new_merged_take ((DflEventSequence **) sequences->pdata,
+                                           (const gchar * const *) process_names->pdata,
+                                           sequences->len);
+
+  g_ptr_array_unref (process_names);
+  g_ptr_array_unref (sequences);
+}
+
+/**
+ * dfl_parser_load_from_stream:
+ * @self: a #DflParser
+ * @stream: input stream to read log from
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * TODO
+ *
+ * Since: 0.1.0
+ */
+void
+dfl_parser_load_from_stream (DflParser     *self,
+                             GInputStream  *stream,
+                             GCancellable  *cancellable,
+                             GError       **error)
+{
+  g_return_if_fail (DFL_IS_PARSER (self));
+  g_return_if_fail (G_IS_INPUT_STREAM (stream));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  load_from_stream (self, stream, TRUE, cancellable, error);
+}
+
+static void
+load_from_stream_thread_cb (GTask         *task,
+                            gpointer       source_object,
+                            gpointer       task_data,
+                            GCancellable  *cancellable)
+{
+  DflParser *self;
+  GInputStream *stream;
+  GError *error = NULL;
+
+  self = DFL_PARSER (source_object);
+  stream = G_INPUT_STREAM (task_data);
+
+  dfl_parser_load_from_stream (self, stream, cancellable, &error);
+
+  if (error != NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * dfl_parser_load_from_stream_async:
  * @self: a #DflParser
  * @stream: input stream to read log from
  * @cancellable: a #GCancellable, or  %NULL
@@ -587,6 +2354,280 @@ dfl_parser_load_from_stream_finish (DflParser     *self,
   g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/* Size of each read from a stream being tailed. */
+#define TAIL_READ_SIZE (64 * 1024)
+
+/* Interval between checks for new data when following a stream which has
+ * reached its end. */
+#define TAIL_POLL_INTERVAL_MS 250
+
+typedef struct
+{
+  GInputStream *stream;  /* owned */
+  gboolean follow;
+  ParseState state;
+  GByteArray *pending;  /* owned; data after the last complete line read */
+} TailData;
+
+static void
+tail_data_free (TailData *data)
+{
+  g_byte_array_unref (data->pending);
+  parse_state_clear (&data->state);
+  g_object_unref (data->stream);
+
+  g_free (data);
+}
+
+static void tail_read (GTask *task);
+
+/* Add any events parsed since the last call to the parser’s event sequence,
+ * and notify about them. The sequence is created once the header has been
+ * parsed. */
+static void
+tail_add_events (DflParser *self,
+                 TailData  *data)
+{
+  guint position, n_events;
+
+  if (data->state.file_version == 0)
+    return;
+
+  n_events = _dfl_event_store_get_n_events (&data->state.events);
+
+  /* The sequence takes the events from the parse state. */
+  if (self->sequence == NULL)
+    {
+      position = 0;
+      parse_state_finish (&data->state, self);
+    }
+  else
+    {
+      position = g_list_model_get_n_items (G_LIST_MODEL (self->sequence));
+      _dfl_event_sequence_append_store (self->sequence, &data->state.events);
+    }
+
+  /* Only create #DflEvents for the signal if anything is listening. */
+  if (n_events > 0 &&
+      g_signal_has_handler_pending (self, signals[SIGNAL_EVENTS_ADDED], 0,
+                                    FALSE))
+    {
+      GPtrArray/*<owned DflEvent>*/ *events = NULL;
+
+      events = _dfl_event_sequence_dup_events (self->sequence, position,
+                                               n_events);
+      g_signal_emit (self, signals[SIGNAL_EVENTS_ADDED], 0, events);
+      g_ptr_array_unref (events);
+    }
+}
+
+static gboolean
+tail_poll_cb (gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+
+  tail_read (task);  /* transfer ownership */
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+tail_read_cb (GObject      *source_object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+  GTask *task = G_TASK (user_data);
+  DflParser *self = g_task_get_source_object (task);
+  TailData *data = g_task_get_task_data (task);
+  GBytes *bytes = NULL;
+  const guint8 *chunk;
+  gsize chunk_length, complete_length;
+  GError *error = NULL;
+
+  bytes = g_input_stream_read_bytes_finish (data->stream, result, &error);
+
+  if (error != NULL)
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  chunk = g_bytes_get_data (bytes, &chunk_length);
+
+  if (chunk_length == 0)
+    {
+      g_bytes_unref (bytes);
+
+      if (data->follow)
+        {
+          GSource *source = NULL;
+
+          /* Wait for more data to be appended. */
+          source = g_timeout_source_new (TAIL_POLL_INTERVAL_MS);
+          g_source_set_callback (source, tail_poll_cb, task, NULL);
+          g_source_attach (source, g_task_get_context (task));
+          g_source_unref (source);
+
+          return;
+        }
+
+      /* End of stream. Parse the final line, which might not have a trailing
+       * newline. */
+      if (parse_lines (&data->state, (const gchar *) data->pending->data,
+                       data->pending->len, FALSE, NULL, &error))
+        {
+          tail_add_events (self, data);
+          g_task_return_boolean (task, TRUE);
+        }
+      else
+        {
+          g_task_return_error (task, error);
+        }
+
+      g_object_unref (task);
+      return;
+    }
+
+  g_byte_array_append (data->pending, chunk, chunk_length);
+  g_bytes_unref (bytes);
+
+  if (data->state.line_number == 0 &&
+      is_binary_log (data->pending->data, data->pending->len))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                               "Binary logs cannot be tailed");
+      g_object_unref (task);
+      return;
+    }
+  else if (data->state.line_number == 0 &&
+           detect_compression (data->pending->data,
+                               data->pending->len) != COMPRESSION_NONE)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                               "Compressed logs cannot be tailed");
+      g_object_unref (task);
+      return;
+    }
+
+  /* Parse all the complete lines read so far, leaving any partial line at
+   * the end for next time. */
+  for (complete_length = data->pending->len;
+       complete_length > 0 && data->pending->data[complete_length - 1] != '\n';
+       complete_length--);
+
+  if (!parse_lines (&data->state, (const gchar *) data->pending->data,
+                    complete_length, FALSE, NULL, &error))
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  g_byte_array_remove_range (data->pending, 0, complete_length);
+  tail_add_events (self, data);
+
+  tail_read (task);  /* transfer ownership */
+}
+
+static void
+tail_read (GTask *task)
+{
+  TailData *data = g_task_get_task_data (task);
+
+  g_input_stream_read_bytes_async (data->stream, TAIL_READ_SIZE,
+                                   g_task_get_priority (task),
+                                   g_task_get_cancellable (task),
+                                   tail_read_cb, task);
+}
+
+/**
+ * dfl_parser_tail_stream_async:
+ * @self: a #DflParser
+ * @stream: input stream to read log from
+ * @follow: %TRUE to keep waiting for more data at the end of @stream; %FALSE
+ *    to finish at the end of @stream
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: callback to call once tailing is complete
+ * @user_data: data to pass to @callback
+ *
+ * Incrementally parse a log which is still being written, such as a file which
+ * dunfell-record is appending to, or a pipe from it. Data is parsed as it
+ * becomes available, and earlier data is never re-read, so each batch of new
+ * events costs time proportional only to its size.
+ *
+ * Any existing event sequence in the parser is replaced. A new
+ * #DflEventSequence is created as soon as the header of the log has been
+ * parsed, and new events are appended to it in batches (emitting
+ * #GListModel::items-changed), emitting #DflParser::events-added for each
+ * batch.
+ *
+ * If @follow is %TRUE, when the end of @stream is reached, the parser polls for
+ * more data to be appended; this is appropriate for files. Tailing then
+ * continues until @cancellable is cancelled or an error occurs. If @follow is
+ * %FALSE, tailing finishes successfully at the end of the stream; this is
+ * appropriate for pipes.
+ *
+ * Tailing happens in the thread-default main context of the caller. Only text
+ * logs can be tailed.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_parser_tail_stream_async (DflParser           *self,
+                              GInputStream        *stream,
+                              gboolean             follow,
+                              GCancellable        *cancellable,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+  GTask *task = NULL;
+  TailData *data = NULL;
+
+  g_return_if_fail (DFL_IS_PARSER (self));
+  g_return_if_fail (G_IS_INPUT_STREAM (stream));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  g_clear_object (&self->sequence);
+
+  data = g_new0 (TailData, 1);
+  data->stream = g_object_ref (stream);
+  data->follow = follow;
+  data->pending = g_byte_array_new ();
+  parse_state_init (&data->state, &self->filter);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, dfl_parser_tail_stream_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) tail_data_free);
+
+  tail_read (task);  /* transfer ownership */
+}
+
+/**
+ * dfl_parser_tail_stream_finish:
+ * @self: a #DflParser
+ * @result: result of the asynchronous operation
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finish function for dfl_parser_tail_stream_async(). If tailing was
+ * cancelled, this returns %G_IO_ERROR_CANCELLED; the events parsed up until
+ * then remain available from dfl_parser_get_event_sequence().
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_parser_tail_stream_finish (DflParser     *self,
+                               GAsyncResult  *result,
+                               GError       **error)
+{
+  g_return_if_fail (DFL_IS_PARSER (self));
+  g_return_if_fail (G_IS_ASYNC_RESULT (result));
+  g_return_if_fail (g_task_is_valid (result, self));
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  g_task_propagate_boolean (G_TASK (result), error);
+}
+
 /**
  * dfl_parser_get_event_sequence:
  * @self: a #DflParser
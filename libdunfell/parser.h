@@ -39,6 +39,15 @@ G_DECLARE_FINAL_TYPE (DflParser, dfl_parser, DFL, PARSER, GObject)
 
 DflParser *dfl_parser_new (void);
 
+void dfl_parser_set_time_range  (DflParser           *self,
+                                 DflDuration          start,
+                                 DflDuration          end);
+void dfl_parser_set_thread_ids  (DflParser           *self,
+                                 const DflThreadId   *thread_ids,
+                                 gsize                n_thread_ids);
+void dfl_parser_set_event_types (DflParser           *self,
+                                 const gchar * const *event_types);
+
 void dfl_parser_load_from_data (DflParser *self,
                                 const guint8 *data,
                                 gssize length,
@@ -47,6 +56,9 @@ void dfl_parser_load_from_data (DflParser *self,
 void dfl_parser_load_from_file (DflParser *self,
                                 const gchar *filename,
                                 GError **error);
+void dfl_parser_load_from_files (DflParser           *self,
+                                 const gchar * const *filenames,
+                                 GError             **error);
 
 void dfl_parser_load_from_stream (DflParser *self,
                                   GInputStream *stream,
@@ -61,6 +73,16 @@ void dfl_parser_load_from_stream_finish (DflParser *self,
                                          GAsyncResult *result,
                                          GError **error);
 
+void dfl_parser_tail_stream_async (DflParser *self,
+                                   GInputStream *stream,
+                                   gboolean follow,
+                                   GCancellable *cancellable,
+                                   GAsyncReadyCallback callback,
+                                   gpointer user_data);
+void dfl_parser_tail_stream_finish (DflParser *self,
+                                    GAsyncResult *result,
+                                    GError **error);
+
 DflEventSequence *dfl_parser_get_event_sequence (DflParser *self);
 
 G_END_DECLS
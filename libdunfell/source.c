@@ -34,14 +34,16 @@
 #include <gio/gio.h>
 #include <string.h>
 
+#include "atom-table.h"
 #include "event.h"
 #include "event-sequence.h"
+#include "event-sequence-private.h"
+#include "model-cache-private.h"
 #include "source.h"
 #include "time-sequence.h"
 
 
 static void dfl_source_dispose (GObject *object);
-static void dfl_source_dispatch_data_clear (DflSourceDispatchData *data);
 
 struct _DflSource
 {
@@ -61,7 +63,11 @@ struct _DflSource
    * dispatch. A duration of ≥ 0 is valid; < 0 is not. */
   DflTimeSequence/*<DflMainContextDispatchData>*/ dispatch_events;
 
-  gchar *name;  /* owned; nullable */
+  /* Interns the names; shared with the other objects from the same event
+   * sequence. %NULL if the source was not built from an event sequence, in
+   * which case it has no names. */
+  DflAtomTable *atom_table;  /* owned; nullable */
+  DflAtom name;
 
   DflId attach_context;
   DflTimestamp attach_timestamp;
@@ -84,8 +90,13 @@ static void
 dfl_source_init (DflSource *self)
 {
   dfl_time_sequence_init (&self->dispatch_events,
-                          sizeof (DflSourceDispatchData),
-                          (GDestroyNotify) dfl_source_dispatch_data_clear, 0);
+                          sizeof (DflSourceDispatchData), NULL, 0);
+  dfl_time_sequence_add_aggregate (&self->dispatch_events,
+                                   G_STRUCT_OFFSET (DflSourceDispatchData,
+                                                    duration));
+  dfl_time_sequence_add_interval_index (&self->dispatch_events,
+                                        G_STRUCT_OFFSET (DflSourceDispatchData,
+                                                         duration));
 }
 
 static void
@@ -94,19 +105,12 @@ dfl_source_dispose (GObject *object)
   DflSource *self = DFL_SOURCE (object);
 
   dfl_time_sequence_clear (&self->dispatch_events);
-  g_clear_pointer (&self->name, g_free);
+  g_clear_object (&self->atom_table);
 
   /* Chain up to the parent class */
   G_OBJECT_CLASS (dfl_source_parent_class)->dispose (object);
 }
 
-static void
-dfl_source_dispatch_data_clear (DflSourceDispatchData *data)
-{
-  g_free (data->dispatch_name);
-  g_free (data->callback_name);
-}
-
 /**
  * dfl_source_new:
  * @id: TODO
@@ -136,6 +140,20 @@ dfl_source_new (DflId        id,
   return source;
 }
 
+/* Intern the string parameter @index of @event in the source’s atom table. */
+static DflAtom
+source_intern_parameter (DflSource *source,
+                         DflEvent  *event,
+                         guint      index)
+{
+  gchar buffer[DFL_EVENT_PARAMETER_BUFFER_SIZE];
+
+  return dfl_atom_table_intern (source->atom_table,
+                                dfl_event_format_parameter (event, index,
+                                                            buffer,
+                                                            sizeof (buffer)));
+}
+
 static void
 source_before_after_dispatch_cb (DflEventSequence *sequence,
                                  DflEvent         *event,
@@ -159,10 +177,10 @@ source_before_after_dispatch_cb (DflEventSequence *sequence,
       DflSourceDispatchData *last_element;
       DflTimestamp last_timestamp;
       DflSourceDispatchData *next_element;
-      const gchar *dispatch_name, *callback_name;
+      DflAtom dispatch_name, callback_name;
 
-      dispatch_name = dfl_event_get_parameter_utf8 (event, 1);
-      callback_name = dfl_event_get_parameter_utf8 (event, 2);
+      dispatch_name = source_intern_parameter (source, event, 1);
+      callback_name = source_intern_parameter (source, event, 2);
 
       /* Check that the previous element in the sequence has a valid (non-zero)
        * duration, otherwise no //after// event was logged and something very
@@ -187,13 +205,13 @@ source_before_after_dispatch_cb (DflEventSequence *sequence,
                                                timestamp);
       next_element->thread_id = thread_id;
       next_element->duration = -1;  /* will be set by the paired //after// */
-      next_element->dispatch_name = g_strdup (dispatch_name);
-      next_element->callback_name = g_strdup (callback_name);
+      next_element->dispatch_name = dispatch_name;
+      next_element->callback_name = callback_name;
     }
   else
     {
       DflSourceDispatchData *last_element;
-      DflTimestamp last_timestamp;
+      DflTimestamp last_timestamp, window_start;
 
       /* Check that the previous element in the sequence has an invalid (zero)
        * duration, otherwise no //before// event was logged.
@@ -202,7 +220,21 @@ source_before_after_dispatch_cb (DflEventSequence *sequence,
       last_element = dfl_time_sequence_get_last_element (&source->dispatch_events,
                                                          &last_timestamp);
 
-      if (last_element == NULL)
+      if (last_element == NULL &&
+          _dfl_event_sequence_get_window_start (sequence, &window_start) &&
+          window_start <= timestamp)
+        {
+          /* The dispatch started before the start of the loaded time range,
+           * so clip it to start there. Its names are unknown. */
+          last_element = dfl_time_sequence_append (&source->dispatch_events,
+                                                   window_start);
+          last_timestamp = window_start;
+          last_element->thread_id = thread_id;
+          last_element->duration = -1;
+          last_element->dispatch_name = DFL_ATOM_INVALID;
+          last_element->callback_name = DFL_ATOM_INVALID;
+        }
+      else if (last_element == NULL)
         {
           /* TODO: Some better error reporting framework than g_warning(). */
           g_warning ("Saw a g_main_context_dispatch() call finish for a "
@@ -215,8 +247,8 @@ source_before_after_dispatch_cb (DflEventSequence *sequence,
           last_timestamp = timestamp;
           last_element->thread_id = thread_id;
           last_element->duration = -1;
-          last_element->dispatch_name = NULL;
-          last_element->callback_name = NULL;
+          last_element->dispatch_name = DFL_ATOM_INVALID;
+          last_element->callback_name = DFL_ATOM_INVALID;
         }
       else if (last_element->duration >= 0)
         {
@@ -241,8 +273,8 @@ source_before_after_dispatch_cb (DflEventSequence *sequence,
           last_timestamp = timestamp;
           last_element->thread_id = thread_id;
           last_element->duration = -1;
-          last_element->dispatch_name = NULL;
-          last_element->callback_name = NULL;
+          last_element->dispatch_name = DFL_ATOM_INVALID;
+          last_element->callback_name = DFL_ATOM_INVALID;
         }
 
       /* Update the element’s duration. */
@@ -274,16 +306,14 @@ source_set_name_cb (DflEventSequence *sequence,
                     gpointer          user_data)
 {
   DflSource *source = user_data;
-  const gchar *name;
 
   /* Does this event correspond to the right source? */
   g_assert (dfl_event_get_parameter_id (event, 0) == source->id);
 
-  if (source->name != NULL)
+  if (source->name != DFL_ATOM_INVALID)
     return;
 
-  name = dfl_event_get_parameter_utf8 (event, 1);
-  source->name = g_strdup (name);
+  source->name = source_intern_parameter (source, event, 1);
 }
 
 static void
@@ -338,34 +368,47 @@ source_new_cb (DflEventSequence *sequence,
   source = dfl_source_new (source_id,
                            dfl_event_get_timestamp (event),
                            dfl_event_get_thread_id (event));
+  source->atom_table =
+      g_object_ref (dfl_event_sequence_get_atom_table (sequence));
 
   dfl_event_sequence_start_walker_group (sequence);
 
-  dfl_event_sequence_add_walker (sequence, "g_source_set_name", source_id,
-                                 source_set_name_cb,
-                                 g_object_ref (source),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_source_before_free", source_id,
-                                 source_before_free_cb,
-                                 g_object_ref (source),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_source_before_dispatch",
-                                 source_id,
-                                 source_before_after_dispatch_cb,
-                                 g_object_ref (source),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_source_after_dispatch", source_id,
-                                 source_before_after_dispatch_cb,
-                                 g_object_ref (source),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_source_attach", source_id,
-                                 source_attach_cb,
-                                 g_object_ref (source),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_source_destroy", source_id,
-                                 source_destroy_cb,
-                                 g_object_ref (source),
-                                 (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_source_set_name",
+                                      source_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      source_set_name_cb,
+                                      g_object_ref (source),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_source_before_free",
+                                      source_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      source_before_free_cb,
+                                      g_object_ref (source),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_source_before_dispatch",
+                                      source_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      source_before_after_dispatch_cb,
+                                      g_object_ref (source),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_source_after_dispatch",
+                                      source_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      source_before_after_dispatch_cb,
+                                      g_object_ref (source),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_source_attach",
+                                      source_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      source_attach_cb,
+                                      g_object_ref (source),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_source_destroy",
+                                      source_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      source_destroy_cb,
+                                      g_object_ref (source),
+                                      (GDestroyNotify) g_object_unref);
 
   /* Remove the walkers once the source is destroyed. */
   dfl_event_sequence_end_walker_group (sequence, "g_source_before_free",
@@ -398,6 +441,73 @@ dfl_source_factory_from_event_sequence (DflEventSequence *sequence)
   return sources;
 }
 
+/* Serialise the analysed state of @self to a model cache. See
+ * model-cache-private.h. */
+void
+_dfl_source_save_cache (DflSource           *self,
+                        DflModelCacheWriter *writer)
+{
+  _dfl_model_cache_writer_add_uint64 (writer, self->id);
+  _dfl_model_cache_writer_add_uint64 (writer, self->new_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->free_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->new_thread_id);
+  _dfl_model_cache_writer_add_uint64 (writer, self->name);
+  _dfl_model_cache_writer_add_uint64 (writer, self->attach_context);
+  _dfl_model_cache_writer_add_uint64 (writer, self->attach_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->attach_thread_id);
+  _dfl_model_cache_writer_add_uint64 (writer, self->destroy_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->destroy_thread_id);
+
+  _dfl_time_sequence_save_cache (&self->dispatch_events, writer);
+}
+
+DflSource *
+_dfl_source_load_cache (DflModelCacheReader *reader,
+                        DflAtomTable        *atom_table)
+{
+  g_autoptr (DflSource) source = NULL;
+  DflId id;
+  DflTimestamp new_timestamp, free_timestamp;
+  DflThreadId new_thread_id;
+  DflTimeSequenceIter iter;
+  DflSourceDispatchData *dispatch;
+  guint n_atoms;
+
+  id = _dfl_model_cache_reader_read_uint64 (reader);
+  new_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+  free_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+  new_thread_id = _dfl_model_cache_reader_read_uint64 (reader);
+
+  source = dfl_source_new (id, new_timestamp, new_thread_id);
+  source->atom_table = g_object_ref (atom_table);
+  source->free_timestamp = free_timestamp;
+  source->name = _dfl_model_cache_reader_read_atom (reader, atom_table);
+  source->attach_context = _dfl_model_cache_reader_read_uint64 (reader);
+  source->attach_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+  source->attach_thread_id = _dfl_model_cache_reader_read_uint64 (reader);
+  source->destroy_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+  source->destroy_thread_id = _dfl_model_cache_reader_read_uint64 (reader);
+
+  if (!_dfl_time_sequence_load_cache (&source->dispatch_events, reader))
+    return NULL;
+
+  /* Check the dispatch names are valid atoms. */
+  n_atoms = dfl_atom_table_get_n_atoms (atom_table);
+  dfl_time_sequence_iter_init (&iter, &source->dispatch_events, 0);
+
+  while (dfl_time_sequence_iter_next (&iter, NULL, (gpointer *) &dispatch))
+    {
+      if (dispatch->dispatch_name > n_atoms ||
+          dispatch->callback_name > n_atoms)
+        {
+          reader->invalid = TRUE;
+          return NULL;
+        }
+    }
+
+  return g_steal_pointer (&source);
+}
+
 /**
  * dfl_source_get_id:
  * @self: a #DflSource
@@ -429,6 +539,28 @@ dfl_source_get_name (DflSource *self)
 {
   g_return_val_if_fail (DFL_IS_SOURCE (self), NULL);
 
+  if (self->atom_table == NULL)
+    return NULL;
+
+  return dfl_atom_table_lookup (self->atom_table, self->name);
+}
+
+/**
+ * dfl_source_get_name_atom:
+ * @self: a #DflSource
+ *
+ * Get the name of the source as an atom in the atom table of the event
+ * sequence it was built from. This is cheaper to compare than the string
+ * returned by dfl_source_get_name().
+ *
+ * Returns: atom for the source’s name, or %DFL_ATOM_INVALID if it has none
+ * Since: UNRELEASED
+ */
+DflAtom
+dfl_source_get_name_atom (DflSource *self)
+{
+  g_return_val_if_fail (DFL_IS_SOURCE (self), DFL_ATOM_INVALID);
+
   return self->name;
 }
 
@@ -588,3 +720,55 @@ dfl_source_dispatch_iter (DflSource           *self,
 
   dfl_time_sequence_iter_init (iter, &self->dispatch_events, start);
 }
+
+/**
+ * dfl_source_dispatch_iter_range:
+ * @self: a #DflSource
+ * @iter: an uninitialised #DflTimeSequenceIter to use
+ * @start: timestamp to start iterating from (inclusive)
+ * @end: timestamp to stop iterating at (exclusive)
+ *
+ * Iterate over the dispatches of this source which started in [@start, @end).
+ * See dfl_time_sequence_iter_init_range().
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_source_dispatch_iter_range (DflSource           *self,
+                                DflTimeSequenceIter *iter,
+                                DflTimestamp         start,
+                                DflTimestamp         end)
+{
+  g_return_if_fail (DFL_IS_SOURCE (self));
+  g_return_if_fail (iter != NULL);
+
+  dfl_time_sequence_iter_init_range (iter, &self->dispatch_events, start, end);
+}
+
+/**
+ * dfl_source_get_dispatch_aggregate:
+ * @self: a #DflSource
+ * @start: timestamp to start from (inclusive)
+ * @end: timestamp to end at (exclusive)
+ * @aggregate: (out caller-allocates): return location for the statistics
+ *
+ * Get the number of dispatches of this source which started in [@start, @end),
+ * along with their total, minimum and maximum durations, in O(log n) time.
+ *
+ * Returns: %TRUE if there were any dispatches in the range, %FALSE otherwise
+ * Since: UNRELEASED
+ */
+gboolean
+dfl_source_get_dispatch_aggregate (DflSource                *self,
+                                   DflTimestamp              start,
+                                   DflTimestamp              end,
+                                   DflTimeSequenceAggregate *aggregate)
+{
+  g_return_val_if_fail (DFL_IS_SOURCE (self), FALSE);
+  g_return_val_if_fail (aggregate != NULL, FALSE);
+
+  return dfl_time_sequence_get_aggregate (&self->dispatch_events,
+                                          G_STRUCT_OFFSET (DflSourceDispatchData,
+                                                           duration),
+                                          start, end, aggregate);
+}
@@ -22,6 +22,7 @@
 #include <glib.h>
 #include <glib-object.h>
 
+#include "atom-table.h"
 #include "event-sequence.h"
 #include "time-sequence.h"
 
@@ -31,21 +32,25 @@ G_BEGIN_DECLS
  * DflSourceDispatchData:
  * @thread_id: TODO
  * @duration: TODO
- * @dispatch_name: (nullable): name of the dispatch function for the #GSource
- *    from #GSourceFuncs
- * @callback_name: (nullable): name of the user callback function set with
- *    g_source_set_callback()
+ * @dispatch_name: atom for the name of the dispatch function for the #GSource
+ *    from #GSourceFuncs, or %DFL_ATOM_INVALID if unknown
+ * @callback_name: atom for the name of the user callback function set with
+ *    g_source_set_callback(), or %DFL_ATOM_INVALID if unknown
  *
  * TODO
  *
+ * The names are atoms in the #DflAtomTable of the event sequence the source was
+ * built from (see dfl_event_sequence_get_atom_table()), so this structure
+ * owns no memory and dispatches can be grouped by comparing the atoms.
+ *
  * Since: UNRELEASED
  */
 typedef struct
 {
   DflThreadId thread_id;
   DflDuration duration;
-  gchar *dispatch_name;  /* owned */
-  gchar *callback_name;  /* owned */
+  DflAtom dispatch_name;
+  DflAtom callback_name;
 } DflSourceDispatchData;
 
 /**
@@ -66,6 +71,7 @@ GPtrArray *dfl_source_factory_from_event_sequence (DflEventSequence *sequence);
 
 DflId dfl_source_get_id (DflSource *self);
 const gchar *dfl_source_get_name (DflSource *self);
+DflAtom dfl_source_get_name_atom (DflSource *self);
 
 DflTimestamp dfl_source_get_new_timestamp (DflSource *self);
 DflTimestamp dfl_source_get_free_timestamp (DflSource *self);
@@ -82,6 +88,14 @@ DflThreadId dfl_source_get_new_thread_id (DflSource *self);
 void dfl_source_dispatch_iter (DflSource           *self,
                                DflTimeSequenceIter *iter,
                                DflTimestamp         start);
+void dfl_source_dispatch_iter_range (DflSource           *self,
+                                     DflTimeSequenceIter *iter,
+                                     DflTimestamp         start,
+                                     DflTimestamp         end);
+gboolean dfl_source_get_dispatch_aggregate (DflSource                *self,
+                                            DflTimestamp              start,
+                                            DflTimestamp              end,
+                                            DflTimeSequenceAggregate *aggregate);
 
 G_END_DECLS
 
@@ -34,7 +34,10 @@
 #include <gio/gio.h>
 #include <string.h>
 
+#include "atom-table.h"
 #include "event.h"
+#include "event-sequence-private.h"
+#include "model-cache-private.h"
 #include "task.h"
 #include "time-sequence.h"
 
@@ -47,13 +50,18 @@ struct _DflTask
 
   DflId id;
 
+  /* Interns the names; shared with the other objects from the same event
+   * sequence. %NULL if the task was not built from an event sequence, in
+   * which case it has no names. */
+  DflAtomTable *atom_table;  /* owned; nullable */
+
   DflTimestamp new_timestamp;
   DflThreadId new_thread_id;
   DflId source_object;
   DflId cancellable;
-  gchar *callback_name;  /* owned */
+  DflAtom callback_name;
   DflId callback_data;
-  gchar *source_tag_name;  /* owned */
+  DflAtom source_tag_name;
   DflTimestamp return_timestamp;
   DflThreadId return_thread_id;
   DflTimestamp propagate_timestamp;
@@ -62,7 +70,7 @@ struct _DflTask
   DflThreadId run_in_thread_id;
   DflTimestamp before_run_in_thread_timestamp;
   DflTimestamp after_run_in_thread_timestamp;
-  gchar *run_in_thread_name;  /* owned */
+  DflAtom run_in_thread_name;
   gboolean run_in_thread_cancelled;
 
   /* NOTE: Task data may be set zero or more times, so needs to be implemented
@@ -90,9 +98,7 @@ dfl_task_dispose (GObject *object)
 {
   DflTask *self = DFL_TASK (object);
 
-  g_clear_pointer (&self->callback_name, g_free);
-  g_clear_pointer (&self->source_tag_name, g_free);
-  g_clear_pointer (&self->run_in_thread_name, g_free);
+  g_clear_object (&self->atom_table);
 
   /* Chain up to the parent class */
   G_OBJECT_CLASS (dfl_task_parent_class)->dispose (object);
@@ -129,6 +135,20 @@ dfl_task_new (DflId        id,
 
 #include "event-sequence.h"
 
+/* Intern the string parameter @index of @event in the task’s atom table. */
+static DflAtom
+task_intern_parameter (DflTask  *task,
+                       DflEvent *event,
+                       guint     index)
+{
+  gchar buffer[DFL_EVENT_PARAMETER_BUFFER_SIZE];
+
+  return dfl_atom_table_intern (task->atom_table,
+                                dfl_event_format_parameter (event, index,
+                                                            buffer,
+                                                            sizeof (buffer)));
+}
+
 static void
 task_set_source_tag_cb (DflEventSequence *sequence,
                         DflEvent         *event,
@@ -139,14 +159,13 @@ task_set_source_tag_cb (DflEventSequence *sequence,
   /* Does this event correspond to the right task? */
   g_assert (dfl_event_get_parameter_id (event, 0) == task->id);
 
-  if (task->source_tag_name != NULL)
+  if (task->source_tag_name != DFL_ATOM_INVALID)
     {
       /* TODO: Some better error reporting framework than g_warning(). */
       g_warning ("Saw two g_task_set_source_tag() calls for the same task.");
-      g_free (task->source_tag_name);
     }
 
-  task->source_tag_name = g_strdup (dfl_event_get_parameter_utf8 (event, 1));
+  task->source_tag_name = task_intern_parameter (task, event, 1);
 }
 
 static void
@@ -215,7 +234,7 @@ task_before_run_in_thread_cb (DflEventSequence *sequence,
     }
 
   task->before_run_in_thread_timestamp = dfl_event_get_timestamp (event);
-  task->run_in_thread_name = g_strdup (dfl_event_get_parameter_utf8 (event, 1));
+  task->run_in_thread_name = task_intern_parameter (task, event, 1);
   task->run_in_thread_id = dfl_event_get_thread_id (event);
 }
 
@@ -225,7 +244,7 @@ task_after_run_in_thread_cb (DflEventSequence *sequence,
                              gpointer          user_data)
 {
   DflTask *task = user_data;
-  DflTimestamp timestamp;
+  DflTimestamp timestamp, window_start;
 
   /* Does this event correspond to the right task? */
   g_assert (dfl_event_get_parameter_id (event, 0) == task->id);
@@ -237,8 +256,16 @@ task_after_run_in_thread_cb (DflEventSequence *sequence,
       /* TODO: Some better error reporting framework than g_warning(). */
       g_warning ("Saw two g_task_run_in_thread() calls for the same task.");
     }
+  else if (task->before_run_in_thread_timestamp == 0 &&
+           _dfl_event_sequence_get_window_start (sequence, &window_start) &&
+           window_start <= timestamp)
+    {
+      /* The task started running before the start of the loaded time range,
+       * so clip it to start there. */
+      task->before_run_in_thread_timestamp = window_start;
+    }
   else if (task->before_run_in_thread_timestamp == 0 ||
-           task->before_run_in_thread_timestamp < timestamp)
+           task->before_run_in_thread_timestamp > timestamp)
     {
       g_warning ("Events for g_task_run_in_thread() appeared in the wrong "
                  "order.");
@@ -261,38 +288,46 @@ task_new_cb (DflEventSequence *sequence,
   task = dfl_task_new (task_id, dfl_event_get_timestamp (event),
                        dfl_event_get_thread_id (event));
 
+  task->atom_table =
+      g_object_ref (dfl_event_sequence_get_atom_table (sequence));
+
   task->source_object = dfl_event_get_parameter_id (event, 1);
   task->cancellable = dfl_event_get_parameter_id (event, 2);
-  task->callback_name = g_strdup (dfl_event_get_parameter_utf8 (event, 3));
+  task->callback_name = task_intern_parameter (task, event, 3);
   task->callback_data = dfl_event_get_parameter_id (event, 4);
 
   dfl_event_sequence_start_walker_group (sequence);
 
-  dfl_event_sequence_add_walker (sequence, "g_task_set_source_tag",
-                                 task_id,
-                                 task_set_source_tag_cb,
-                                 g_object_ref (task),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_task_before_return",
-                                 task_id,
-                                 task_before_return_cb,
-                                 g_object_ref (task),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_task_propagate",
-                                 task_id,
-                                 task_propagate_cb,
-                                 g_object_ref (task),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_task_before_run_in_thread",
-                                 task_id,
-                                 task_before_run_in_thread_cb,
-                                 g_object_ref (task),
-                                 (GDestroyNotify) g_object_unref);
-  dfl_event_sequence_add_walker (sequence, "g_task_after_run_in_thread",
-                                 task_id,
-                                 task_after_run_in_thread_cb,
-                                 g_object_ref (task),
-                                 (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_task_set_source_tag",
+                                      task_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      task_set_source_tag_cb,
+                                      g_object_ref (task),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_task_before_return",
+                                      task_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      task_before_return_cb,
+                                      g_object_ref (task),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_task_propagate",
+                                      task_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      task_propagate_cb,
+                                      g_object_ref (task),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_task_before_run_in_thread",
+                                      task_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      task_before_run_in_thread_cb,
+                                      g_object_ref (task),
+                                      (GDestroyNotify) g_object_unref);
+  dfl_event_sequence_add_walker_full (sequence, "g_task_after_run_in_thread",
+                                      task_id,
+                                      DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                      task_after_run_in_thread_cb,
+                                      g_object_ref (task),
+                                      (GDestroyNotify) g_object_unref);
 
   dfl_event_sequence_end_walker_group (sequence, "g_task_propagate", task_id);
 
@@ -323,6 +358,76 @@ dfl_task_factory_from_event_sequence (DflEventSequence *sequence)
   return tasks;
 }
 
+/* Serialise the analysed state of @self to a model cache. See
+ * model-cache-private.h. */
+void
+_dfl_task_save_cache (DflTask             *self,
+                      DflModelCacheWriter *writer)
+{
+  _dfl_model_cache_writer_add_uint64 (writer, self->id);
+  _dfl_model_cache_writer_add_uint64 (writer, self->new_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->new_thread_id);
+  _dfl_model_cache_writer_add_uint64 (writer, self->source_object);
+  _dfl_model_cache_writer_add_uint64 (writer, self->cancellable);
+  _dfl_model_cache_writer_add_uint64 (writer, self->callback_name);
+  _dfl_model_cache_writer_add_uint64 (writer, self->callback_data);
+  _dfl_model_cache_writer_add_uint64 (writer, self->source_tag_name);
+  _dfl_model_cache_writer_add_uint64 (writer, self->return_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->return_thread_id);
+  _dfl_model_cache_writer_add_uint64 (writer, self->propagate_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->propagate_thread_id);
+  _dfl_model_cache_writer_add_uint64 (writer, self->returned_error);
+  _dfl_model_cache_writer_add_uint64 (writer, self->run_in_thread_id);
+  _dfl_model_cache_writer_add_uint64 (writer,
+                                      self->before_run_in_thread_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer,
+                                      self->after_run_in_thread_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->run_in_thread_name);
+  _dfl_model_cache_writer_add_uint64 (writer, self->run_in_thread_cancelled);
+}
+
+DflTask *
+_dfl_task_load_cache (DflModelCacheReader *reader,
+                      DflAtomTable        *atom_table)
+{
+  g_autoptr (DflTask) task = NULL;
+  DflId id;
+  DflTimestamp new_timestamp;
+  DflThreadId new_thread_id;
+
+  id = _dfl_model_cache_reader_read_uint64 (reader);
+  new_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+  new_thread_id = _dfl_model_cache_reader_read_uint64 (reader);
+
+  task = dfl_task_new (id, new_timestamp, new_thread_id);
+  task->atom_table = g_object_ref (atom_table);
+  task->source_object = _dfl_model_cache_reader_read_uint64 (reader);
+  task->cancellable = _dfl_model_cache_reader_read_uint64 (reader);
+  task->callback_name = _dfl_model_cache_reader_read_atom (reader, atom_table);
+  task->callback_data = _dfl_model_cache_reader_read_uint64 (reader);
+  task->source_tag_name = _dfl_model_cache_reader_read_atom (reader,
+                                                             atom_table);
+  task->return_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+  task->return_thread_id = _dfl_model_cache_reader_read_uint64 (reader);
+  task->propagate_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+  task->propagate_thread_id = _dfl_model_cache_reader_read_uint64 (reader);
+  task->returned_error = (_dfl_model_cache_reader_read_uint64 (reader) != 0);
+  task->run_in_thread_id = _dfl_model_cache_reader_read_uint64 (reader);
+  task->before_run_in_thread_timestamp =
+      _dfl_model_cache_reader_read_uint64 (reader);
+  task->after_run_in_thread_timestamp =
+      _dfl_model_cache_reader_read_uint64 (reader);
+  task->run_in_thread_name = _dfl_model_cache_reader_read_atom (reader,
+                                                                atom_table);
+  task->run_in_thread_cancelled =
+      (_dfl_model_cache_reader_read_uint64 (reader) != 0);
+
+  if (reader->invalid)
+    return NULL;
+
+  return g_steal_pointer (&task);
+}
+
 /**
  * dfl_task_get_id:
  * @self: a #DflTask
@@ -444,6 +549,18 @@ dfl_task_get_callback_name (DflTask *self)
 {
   g_return_val_if_fail (DFL_IS_TASK (self), NULL);
 
+  if (self->atom_table == NULL)
+    return NULL;
+
+  return dfl_atom_table_lookup (self->atom_table, self->callback_name);
+}
+
+/* TODO */
+DflAtom
+dfl_task_get_callback_name_atom (DflTask *self)
+{
+  g_return_val_if_fail (DFL_IS_TASK (self), DFL_ATOM_INVALID);
+
   return self->callback_name;
 }
 
@@ -453,5 +570,17 @@ dfl_task_get_source_tag_name (DflTask *self)
 {
   g_return_val_if_fail (DFL_IS_TASK (self), NULL);
 
+  if (self->atom_table == NULL)
+    return NULL;
+
+  return dfl_atom_table_lookup (self->atom_table, self->source_tag_name);
+}
+
+/* TODO */
+DflAtom
+dfl_task_get_source_tag_name_atom (DflTask *self)
+{
+  g_return_val_if_fail (DFL_IS_TASK (self), DFL_ATOM_INVALID);
+
   return self->source_tag_name;
 }
@@ -22,6 +22,7 @@
 #include <glib.h>
 #include <glib-object.h>
 
+#include "atom-table.h"
 #include "event-sequence.h"
 #include "time-sequence.h"
 
@@ -59,7 +60,9 @@ DflTimestamp dfl_task_get_thread_after_timestamp (DflTask *self);
 DflThreadId dfl_task_get_thread_id (DflTask *self);
 
 const gchar *dfl_task_get_callback_name (DflTask *self);
+DflAtom dfl_task_get_callback_name_atom (DflTask *self);
 const gchar *dfl_task_get_source_tag_name (DflTask *self);
+DflAtom dfl_task_get_source_tag_name_atom (DflTask *self);
 
 G_END_DECLS
 
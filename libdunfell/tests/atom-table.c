@@ -0,0 +1,141 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <locale.h>
+#include <string.h>
+
+#include "atom-table.h"
+#include "model.h"
+#include "parser.h"
+#include "source.h"
+#include "task.h"
+
+
+/* Test that interning the same string twice gives the same atom, and that
+ * atoms can be looked up again. */
+static void
+test_atom_table_intern (void)
+{
+  DflAtomTable *table = NULL;
+  DflAtom a, b, c;
+  gchar *copy = NULL;
+
+  table = dfl_atom_table_new ();
+  g_assert_cmpuint (dfl_atom_table_get_n_atoms (table), ==, 0);
+
+  g_assert_cmpuint (dfl_atom_table_intern (table, NULL), ==,
+                    DFL_ATOM_INVALID);
+  g_assert_null (dfl_atom_table_lookup (table, DFL_ATOM_INVALID));
+
+  a = dfl_atom_table_intern (table, "g_idle_dispatch");
+  copy = g_strdup ("g_idle_dispatch");
+  b = dfl_atom_table_intern (table, copy);
+  g_free (copy);
+  c = dfl_atom_table_intern (table, "");
+
+  g_assert_cmpuint (a, !=, DFL_ATOM_INVALID);
+  g_assert_cmpuint (a, ==, b);
+  g_assert_cmpuint (c, !=, DFL_ATOM_INVALID);
+  g_assert_cmpuint (c, !=, a);
+  g_assert_cmpuint (dfl_atom_table_get_n_atoms (table), ==, 2);
+
+  g_assert_cmpstr (dfl_atom_table_lookup (table, a), ==, "g_idle_dispatch");
+  g_assert_cmpstr (dfl_atom_table_lookup (table, c), ==, "");
+
+  g_object_unref (table);
+}
+
+/* Test that the objects in a model share one atom table, so the same name
+ * gets the same atom wherever it appears. */
+static void
+test_atom_table_model (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,100\n"
+    "g_source_new,101,1,10,0,0,0,0,0\n"
+    "g_source_set_name,102,1,10,idle_cb\n"
+    "g_source_before_dispatch,103,1,10,g_idle_dispatch,idle_cb,0\n"
+    "g_source_after_dispatch,104,1,10,0,0\n"
+    "g_task_new,105,1,20,0,0,idle_cb,0\n";
+  DflParser *parser = NULL;
+  DflEventSequence *sequence;
+  DflModel *model = NULL;
+  DflAtomTable *table;
+  GPtrArray/*<owned DflSource>*/ *sources = NULL;
+  GPtrArray/*<owned DflTask>*/ *tasks = NULL;
+  DflSource *source;
+  DflTask *task;
+  DflTimeSequenceIter iter;
+  DflSourceDispatchData *dispatch;
+  GError *error = NULL;
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+
+  sequence = dfl_parser_get_event_sequence (parser);
+  model = dfl_model_new (sequence);
+  table = dfl_model_get_atom_table (model);
+  g_assert_true (table == dfl_event_sequence_get_atom_table (sequence));
+
+  sources = dfl_model_dup_sources (model);
+  tasks = dfl_model_dup_tasks (model);
+  g_assert_cmpuint (sources->len, ==, 1);
+  g_assert_cmpuint (tasks->len, ==, 1);
+  source = sources->pdata[0];
+  task = tasks->pdata[0];
+
+  g_assert_cmpstr (dfl_source_get_name (source), ==, "idle_cb");
+  g_assert_cmpstr (dfl_task_get_callback_name (task), ==, "idle_cb");
+  g_assert_cmpuint (dfl_source_get_name_atom (source), ==,
+                    dfl_task_get_callback_name_atom (task));
+  g_assert_cmpuint (dfl_task_get_source_tag_name_atom (task), ==,
+                    DFL_ATOM_INVALID);
+
+  dfl_source_dispatch_iter (source, &iter, 0);
+  g_assert_true (dfl_time_sequence_iter_next (&iter, NULL,
+                                              (gpointer *) &dispatch));
+  g_assert_cmpint (dispatch->duration, ==, 1);
+  g_assert_cmpuint (dispatch->callback_name, ==,
+                    dfl_source_get_name_atom (source));
+  g_assert_cmpstr (dfl_atom_table_lookup (table, dispatch->dispatch_name), ==,
+                   "g_idle_dispatch");
+  g_assert_false (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+
+  g_assert_cmpuint (dfl_atom_table_get_n_atoms (table), ==, 2);
+
+  g_ptr_array_unref (tasks);
+  g_ptr_array_unref (sources);
+  g_object_unref (model);
+  g_object_unref (parser);
+}
+
+int
+main (int argc, char *argv[])
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/atom-table/intern", test_atom_table_intern);
+  g_test_add_func ("/atom-table/model", test_atom_table_model);
+
+  return g_test_run ();
+}
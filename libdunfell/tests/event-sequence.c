@@ -18,8 +18,10 @@
 
 #include <glib.h>
 #include <locale.h>
+#include <string.h>
 
 #include "event-sequence.h"
+#include "parser.h"
 
 
 typedef struct
@@ -91,17 +93,25 @@ static void
 test_event_sequence_single (void)
 {
   DflEventSequence *sequence = NULL;
-  DflEvent *event = NULL;
+  DflEvent *event = NULL, *item = NULL;
+  GObject *object = NULL;
 
   event = g_object_new (DFL_TYPE_EVENT, NULL);
   sequence = dfl_event_sequence_new ((const DflEvent **) &event, 1, 123456);
   g_object_unref (event);
 
   g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sequence)), ==, 1);
-  g_assert (g_list_model_get_item (G_LIST_MODEL (sequence), 0) == event);
-  g_assert (DFL_IS_EVENT (g_list_model_get_item (G_LIST_MODEL (sequence), 0)));
-  g_assert (g_list_model_get_item (G_LIST_MODEL (sequence), 0) ==
-            g_list_model_get_object (G_LIST_MODEL (sequence), 0));
+
+  /* Events passed to dfl_event_sequence_new() are kept alive by the sequence,
+   * so the same object is returned each time. */
+  item = g_list_model_get_item (G_LIST_MODEL (sequence), 0);
+  g_assert (item == event);
+  g_assert (DFL_IS_EVENT (item));
+  object = g_list_model_get_object (G_LIST_MODEL (sequence), 0);
+  g_assert (object == G_OBJECT (item));
+  g_object_unref (object);
+  g_object_unref (item);
+
   g_assert_null (g_list_model_get_item (G_LIST_MODEL (sequence), 1));
   g_assert_cmpuint (g_list_model_get_item_type (G_LIST_MODEL (sequence)), ==,
                     DFL_TYPE_EVENT);
@@ -294,6 +304,521 @@ test_event_sequence_walk_empty_group (void)
   g_object_unref (sequence);
 }
 
+typedef struct
+{
+  guint victim_id;
+  guint counter;
+} RemoveData;
+
+static void
+walker_remove_victim (DflEventSequence *sequence,
+                      DflEvent         *event,
+                      gpointer          user_data)
+{
+  RemoveData *data = user_data;
+
+  /* Remove the other walker the first time this is called, and add a new
+   * walker for the same event type and ID, which should not be called until
+   * the next matching event. */
+  if (data->victim_id != 0)
+    {
+      dfl_event_sequence_remove_walker (sequence, data->victim_id);
+      data->victim_id = 0;
+
+      dfl_event_sequence_add_walker (sequence, "type_a", 1, walker_count,
+                                     &data->counter, NULL);
+    }
+}
+
+/* Test that removing a walker from within another walker’s callback stops it
+ * being called for the current event, even if it matches, and that walkers
+ * added from within a callback only match from the next event onwards. */
+static void
+test_event_sequence_walk_remove_in_callback (void)
+{
+  DflEventSequence *sequence = NULL;
+  const EventVector vectors[] = {
+    { "type_a", 1 },
+    { "type_a", 2 },
+    { "type_a", 1 },
+  };
+  RemoveData data = { 0, 0 };
+
+  sequence = event_sequence_from_vectors (vectors, G_N_ELEMENTS (vectors));
+  dfl_event_sequence_add_walker (sequence, "type_a", 1,
+                                 walker_remove_victim, &data, NULL);
+  data.victim_id = dfl_event_sequence_add_walker (sequence, "type_a", 1,
+                                                  walker_not_reached,
+                                                  NULL, NULL);
+  dfl_event_sequence_walk (sequence);
+  g_object_unref (sequence);
+
+  g_assert_cmpuint (data.victim_id, ==, 0);
+  g_assert_cmpuint (data.counter, ==, 1);
+}
+
+typedef struct
+{
+  guint counter;
+  DflTimestamp last_timestamp;
+} ShardData;
+
+static void
+walker_shard_count (DflEventSequence *sequence,
+                    DflEvent         *event,
+                    gpointer          user_data)
+{
+  ShardData *data = user_data;
+
+  /* Each shard must see its events in order. */
+  g_assert_cmpuint (dfl_event_get_timestamp (event), >=,
+                    data->last_timestamp);
+
+  data->counter++;
+  data->last_timestamp = dfl_event_get_timestamp (event);
+}
+
+/* Test that a sharded walk calls shard-safe walkers for each of many IDs the
+ * right number of times, in order, and that removing a group of shard-safe
+ * walkers part-way through still works. */
+static void
+test_event_sequence_walk_sharded (void)
+{
+  DflEventSequence *sequence = NULL;
+  GArray/*<EventVector>*/ *vectors = NULL;
+  ShardData data[33] = { { 0, 0 }, };
+  const EventVector remove_vector = { "type_b", 5 };
+  guint i, j;
+
+  vectors = g_array_new (FALSE, FALSE, sizeof (EventVector));
+
+  for (i = 0; i < 100; i++)
+    {
+      if (i == 50)
+        g_array_append_val (vectors, remove_vector);
+
+      for (j = 1; j < G_N_ELEMENTS (data); j++)
+        {
+          EventVector vector = { "type_a", j };
+          g_array_append_val (vectors, vector);
+        }
+    }
+
+  sequence = event_sequence_from_vectors ((const EventVector *) vectors->data,
+                                          vectors->len);
+  g_array_unref (vectors);
+
+  for (j = 1; j < G_N_ELEMENTS (data); j++)
+    {
+      dfl_event_sequence_start_walker_group (sequence);
+      dfl_event_sequence_add_walker_full (sequence, "type_a", j,
+                                          DFL_EVENT_WALKER_FLAGS_SHARD_SAFE,
+                                          walker_shard_count, &data[j], NULL);
+      dfl_event_sequence_end_walker_group (sequence, "type_b", j);
+    }
+
+  dfl_event_sequence_walk_sharded (sequence, 4);
+  g_object_unref (sequence);
+
+  for (j = 1; j < G_N_ELEMENTS (data); j++)
+    g_assert_cmpuint (data[j].counter, ==, (j == 5) ? 50 : 100);
+}
+
+/* Test iterating over the events of a given type, and of a given type and ID,
+ * including skipping to a timestamp. */
+static void
+test_event_sequence_iter (void)
+{
+  DflEventSequence *sequence = NULL;
+  const EventVector vectors[] = {
+    { "type_a", 1 },
+    { "type_b", 1 },
+    { "type_a", 2 },
+    { "type_a", 1 },
+    { "type_b", 2 },
+    { "type_a", 1 },
+    { "type_a", 1 },
+  };
+  DflEventSequenceIter iter;
+  guint position;
+  DflTimestamp timestamp;
+
+  sequence = event_sequence_from_vectors (vectors, G_N_ELEMENTS (vectors));
+
+  /* All events of one type. */
+  dfl_event_sequence_iter_init (&iter, sequence, "type_b", DFL_ID_INVALID);
+  g_assert_cmpuint (dfl_event_sequence_iter_get_n_remaining (&iter), ==, 2);
+  g_assert_true (dfl_event_sequence_iter_next (&iter, &position, NULL));
+  g_assert_cmpuint (position, ==, 1);
+  g_assert_true (dfl_event_sequence_iter_next (&iter, &position, NULL));
+  g_assert_cmpuint (position, ==, 4);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, &position, NULL));
+
+  /* Events of one type and ID, skipping forwards. The events’ timestamps are
+   * their positions. */
+  dfl_event_sequence_iter_init (&iter, sequence, "type_a", 1);
+  g_assert_cmpuint (dfl_event_sequence_iter_get_n_remaining (&iter), ==, 4);
+  dfl_event_sequence_iter_skip_to_timestamp (&iter, 4);
+  g_assert_cmpuint (dfl_event_sequence_iter_get_n_remaining (&iter), ==, 2);
+  g_assert_true (dfl_event_sequence_iter_next (&iter, &position, &timestamp));
+  g_assert_cmpuint (position, ==, 5);
+  g_assert_cmpuint (timestamp, ==, 5);
+
+  /* Skipping backwards does nothing. */
+  dfl_event_sequence_iter_skip_to_timestamp (&iter, 0);
+  g_assert_true (dfl_event_sequence_iter_next (&iter, &position, NULL));
+  g_assert_cmpuint (position, ==, 6);
+  dfl_event_sequence_iter_skip_to_timestamp (&iter, 100);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+
+  /* Unknown event types and IDs. */
+  dfl_event_sequence_iter_init (&iter, sequence, "type_unknown",
+                                DFL_ID_INVALID);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+  dfl_event_sequence_iter_init (&iter, sequence, "type_b", 3);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+
+  /* All events. */
+  dfl_event_sequence_iter_init (&iter, sequence, NULL, DFL_ID_INVALID);
+  g_assert_cmpuint (dfl_event_sequence_iter_get_n_remaining (&iter), ==,
+                    G_N_ELEMENTS (vectors));
+
+  g_object_unref (sequence);
+}
+
+/* Test that slicing a sequence by timestamp gives the right events, and that
+ * walking, iterating and slicing the slice work relative to its start. */
+static void
+test_event_sequence_slice (void)
+{
+  DflEventSequence *sequence = NULL, *slice = NULL, *slice2 = NULL;
+  const EventVector vectors[] = {
+    { "type_a", 1 },
+    { "type_b", 1 },
+    { "type_a", 2 },
+    { "type_a", 1 },
+    { "type_b", 2 },
+    { "type_a", 1 },
+  };
+  DflEventSequenceIter iter;
+  DflEvent *event;
+  guint position, counter = 0;
+
+  sequence = event_sequence_from_vectors (vectors, G_N_ELEMENTS (vectors));
+
+  /* The events’ timestamps are their positions. */
+  slice = dfl_event_sequence_slice (sequence, 2, 5);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (slice)), ==, 3);
+  event = g_list_model_get_item (G_LIST_MODEL (slice), 0);
+  g_assert_cmpuint (dfl_event_get_timestamp (event), ==, 2);
+  g_object_unref (event);
+  g_assert_null (g_list_model_get_item (G_LIST_MODEL (slice), 3));
+  g_assert (dfl_event_sequence_get_atom_table (slice) ==
+            dfl_event_sequence_get_atom_table (sequence));
+
+  dfl_event_sequence_add_walker (slice, "type_a", 1, walker_count, &counter,
+                                 NULL);
+  dfl_event_sequence_walk (slice);
+  g_assert_cmpuint (counter, ==, 1);
+
+  dfl_event_sequence_iter_init (&iter, slice, "type_b", DFL_ID_INVALID);
+  g_assert_true (dfl_event_sequence_iter_next (&iter, &position, NULL));
+  g_assert_cmpuint (position, ==, 2);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+
+  /* Slices of slices, and empty slices. */
+  slice2 = dfl_event_sequence_slice (slice, 3, 100);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (slice2)), ==, 2);
+  event = g_list_model_get_item (G_LIST_MODEL (slice2), 1);
+  g_assert_cmpuint (dfl_event_get_timestamp (event), ==, 4);
+  g_object_unref (event);
+  g_object_unref (slice2);
+
+  slice2 = dfl_event_sequence_slice (sequence, 100, 200);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (slice2)), ==, 0);
+  g_object_unref (slice2);
+
+  /* The slice keeps the events alive. */
+  g_object_unref (sequence);
+  event = g_list_model_get_item (G_LIST_MODEL (slice), 2);
+  g_assert_cmpuint (dfl_event_get_timestamp (event), ==, 4);
+  g_object_unref (event);
+  g_object_unref (slice);
+}
+
+/* Test that iterating over a slice still works after events of a new type
+ * have been appended to its parent, which shares its store. */
+static void
+test_event_sequence_slice_append (void)
+{
+  DflEventSequence *sequence = NULL, *slice = NULL, *slice2 = NULL;
+  const EventVector vectors[] = {
+    { "type_a", 1 },
+    { "type_b", 1 },
+    { "type_a", 2 },
+    { "type_b", 2 },
+  };
+  const gchar * const parameters[] = { "1", NULL };
+  DflEvent *appended = NULL;
+  DflEventSequenceIter iter;
+  guint position;
+
+  sequence = event_sequence_from_vectors (vectors, G_N_ELEMENTS (vectors));
+  slice = dfl_event_sequence_slice (sequence, 1, 4);
+  slice2 = dfl_event_sequence_slice (sequence, 0, 2);
+
+  /* Build the slices’ posting lists: both per-type and per-ID for @slice, but
+   * only per-type for @slice2. */
+  dfl_event_sequence_iter_init (&iter, slice, "type_a", 2);
+  g_assert_true (dfl_event_sequence_iter_next (&iter, &position, NULL));
+  g_assert_cmpuint (position, ==, 1);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+
+  dfl_event_sequence_iter_init (&iter, slice2, "type_b", DFL_ID_INVALID);
+  g_assert_true (dfl_event_sequence_iter_next (&iter, &position, NULL));
+  g_assert_cmpuint (position, ==, 1);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+
+  /* Add a new event type to the shared store. */
+  appended = dfl_event_new ("type_c", 4, 0  /* thread ID */, parameters);
+  dfl_event_sequence_append (sequence, (const DflEvent **) &appended, 1);
+  g_object_unref (appended);
+
+  /* The slices have no events of the new type. */
+  dfl_event_sequence_iter_init (&iter, slice, "type_c", DFL_ID_INVALID);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+  dfl_event_sequence_iter_init (&iter, slice, "type_c", 1);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+  dfl_event_sequence_iter_init (&iter, slice2, "type_c", 1);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+  dfl_event_sequence_iter_init (&iter, slice2, "type_c", DFL_ID_INVALID);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+
+  /* Existing types are unaffected. */
+  dfl_event_sequence_iter_init (&iter, slice2, "type_a", 1);
+  g_assert_true (dfl_event_sequence_iter_next (&iter, &position, NULL));
+  g_assert_cmpuint (position, ==, 0);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+
+  /* The parent sees the new events. */
+  dfl_event_sequence_iter_init (&iter, sequence, "type_c", 1);
+  g_assert_true (dfl_event_sequence_iter_next (&iter, &position, NULL));
+  g_assert_cmpuint (position, ==, 4);
+  g_assert_false (dfl_event_sequence_iter_next (&iter, NULL, NULL));
+
+  g_object_unref (slice2);
+  g_object_unref (slice);
+  g_object_unref (sequence);
+}
+
+/* Test that merging sequences orders their events by timestamp, stably, and
+ * tags the events from each sequence with its process. */
+static void
+test_event_sequence_merge (void)
+{
+  DflEventSequence *sequences[2] = { NULL, };
+  DflEventSequence *merged = NULL;
+  const EventVector vectors1[] = {
+    { "type_a", 1 },
+    { "type_a", 1 },
+    { "type_b", 1 },
+  };
+  const EventVector vectors2[] = {
+    { "type_a", 1 },
+    { "type_c", 2 },
+    { "type_d", 0 },
+  };
+  const gchar * const process_names[] = { "service", "client" };
+  const struct
+  {
+    const gchar *event_type;
+    guint process;
+    DflTimestamp timestamp;
+  } expected[] = {
+    { "type_a", 0, 0 },
+    { "type_a", 1, 0 },
+    { "type_a", 0, 1 },
+    { "type_c", 1, 1 },
+    { "type_b", 0, 2 },
+    { "type_d", 1, 2 },
+  };
+  DflEvent *event;
+  guint i;
+
+  /* The events’ timestamps are their positions in their own sequences. */
+  sequences[0] = event_sequence_from_vectors (vectors1,
+                                              G_N_ELEMENTS (vectors1));
+  sequences[1] = event_sequence_from_vectors (vectors2,
+                                              G_N_ELEMENTS (vectors2));
+
+  merged = dfl_event_sequence_new_merged (sequences, process_names, 2);
+  g_object_unref (sequences[1]);
+  g_object_unref (sequences[0]);
+
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (merged)), ==,
+                    G_N_ELEMENTS (expected));
+  g_assert_cmpuint (dfl_event_sequence_get_n_processes (merged), ==, 2);
+  g_assert_cmpstr (dfl_event_sequence_get_process_name (merged, 1), ==,
+                   "client");
+
+  for (i = 0; i < G_N_ELEMENTS (expected); i++)
+    {
+      event = g_list_model_get_item (G_LIST_MODEL (merged), i);
+
+      g_assert_cmpstr (dfl_event_get_event_type (event), ==,
+                       expected[i].event_type);
+      g_assert_cmpuint (dfl_event_get_process (event), ==,
+                        expected[i].process);
+      g_assert_cmpuint (dfl_event_get_timestamp (event), ==,
+                        expected[i].timestamp);
+
+      g_object_unref (event);
+    }
+
+  /* Objects with the same ID in different processes must be distinct. */
+  if (sizeof (DflId) >= 8)
+    {
+      DflEvent *event0 = g_list_model_get_item (G_LIST_MODEL (merged), 0);
+      DflEvent *event1 = g_list_model_get_item (G_LIST_MODEL (merged), 1);
+
+      g_assert_cmpuint (dfl_event_get_parameter_id (event0, 0), ==, 1);
+      g_assert_cmpuint (dfl_event_get_parameter_id (event1, 0), !=, 1);
+
+      g_object_unref (event1);
+      g_object_unref (event0);
+    }
+
+  /* NULL IDs stay NULL, whichever process they are from. */
+  event = g_list_model_get_item (G_LIST_MODEL (merged), 5);
+  g_assert_cmpuint (dfl_event_get_process (event), ==, 1);
+  g_assert_cmpuint (dfl_event_get_parameter_id (event, 0), ==,
+                    DFL_ID_INVALID);
+  g_object_unref (event);
+
+  g_object_unref (merged);
+}
+
+static void
+walker_retain (DflEventSequence *sequence,
+               DflEvent         *event,
+               gpointer          user_data)
+{
+  GPtrArray/*<owned DflEvent>*/ *retained = user_data;
+
+  g_ptr_array_add (retained, g_object_ref (event));
+}
+
+/* Test that events which are created on demand from a parsed log stay valid
+ * when a walker keeps a reference to them, and that retrieving the same item
+ * twice returns the same event. */
+static void
+test_event_sequence_walk_retained (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,100\n"
+    "g_main_context_new,101,1,10\n"
+    "g_main_context_acquire,102,1,10,1\n"
+    "g_source_set_name,103,2,20,name\n"
+    "g_main_context_release,104,1,10\n";
+  DflParser *parser = NULL;
+  DflEventSequence *sequence;
+  GPtrArray/*<owned DflEvent>*/ *retained = NULL;
+  DflEvent *event;
+  GError *error = NULL;
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+
+  sequence = g_object_ref (dfl_parser_get_event_sequence (parser));
+  g_object_unref (parser);
+
+  retained = g_ptr_array_new_with_free_func (g_object_unref);
+  dfl_event_sequence_add_walker (sequence, NULL, DFL_ID_INVALID,
+                                 walker_retain, retained, NULL);
+  dfl_event_sequence_walk (sequence);
+
+  g_assert_cmpuint (retained->len, ==, 4);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sequence)), ==,
+                    4);
+
+  g_assert_cmpstr (dfl_event_get_event_type (retained->pdata[0]), ==,
+                   "g_main_context_new");
+  g_assert_cmpuint (dfl_event_get_timestamp (retained->pdata[0]), ==, 101);
+  g_assert_cmpuint (dfl_event_get_parameter_id (retained->pdata[1], 1), ==,
+                    1);
+  g_assert_cmpuint (dfl_event_get_thread_id (retained->pdata[2]), ==, 2);
+  g_assert_cmpstr (dfl_event_get_parameter_utf8 (retained->pdata[2], 1), ==,
+                   "name");
+  g_assert_cmpuint (dfl_event_get_timestamp (retained->pdata[3]), ==, 104);
+
+  event = g_list_model_get_item (G_LIST_MODEL (sequence), 2);
+  g_assert (DFL_IS_EVENT (event));
+  g_assert_cmpstr (dfl_event_get_parameter_utf8 (event, 1), ==, "name");
+
+  /* The events must outlive the sequence. */
+  g_object_unref (sequence);
+
+  g_assert_cmpstr (dfl_event_get_parameter_utf8 (retained->pdata[2], 1), ==,
+                   "name");
+  g_assert_cmpstr (dfl_event_get_parameter_utf8 (event, 1), ==, "name");
+  g_object_unref (event);
+
+  g_ptr_array_unref (retained);
+}
+
+/* Test that the events created by g_list_model_get_item() are not all kept
+ * alive by the sequence once the caller has dropped its reference, but that
+ * those which are still referenced stay valid, even after their cache slot
+ * has been reused. */
+static void
+test_event_sequence_get_item_bounded (void)
+{
+  GString *log = NULL;
+  DflParser *parser = NULL;
+  DflEventSequence *sequence;
+  DflEvent *first, *retained, *event;
+  guint i, n_events = 10000;
+  GError *error = NULL;
+
+  log = g_string_new ("Dunfell log,1.0,100\n");
+
+  for (i = 0; i < n_events; i++)
+    g_string_append_printf (log, "g_main_context_acquire,%u,1,10,%u\n",
+                            101 + i, i);
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, (const guint8 *) log->str, log->len,
+                             &error);
+  g_assert_no_error (error);
+
+  sequence = dfl_parser_get_event_sequence (parser);
+
+  first = g_list_model_get_item (G_LIST_MODEL (sequence), 0);
+  g_object_add_weak_pointer (G_OBJECT (first), (gpointer *) &first);
+  g_object_unref (first);
+  g_assert_nonnull (first);
+
+  retained = g_list_model_get_item (G_LIST_MODEL (sequence), 1);
+
+  for (i = 0; i < n_events; i++)
+    {
+      event = g_list_model_get_item (G_LIST_MODEL (sequence), i);
+      g_assert_cmpuint (dfl_event_get_timestamp (event), ==, 101 + i);
+      g_object_unref (event);
+    }
+
+  /* The first event has been evicted, but the retained one is still valid. */
+  g_assert_null (first);
+  g_assert_cmpuint (dfl_event_get_timestamp (retained), ==, 102);
+  g_assert_cmpuint (dfl_event_get_parameter_id (retained, 1), ==, 1);
+
+  g_object_unref (retained);
+  g_object_unref (parser);
+  g_string_free (log, TRUE);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -317,6 +842,19 @@ main (int argc, char *argv[])
                    test_event_sequence_walk_remove_group_then_id_reuse);
   g_test_add_func ("/event-sequence/walk/empty-group",
                    test_event_sequence_walk_empty_group);
+  g_test_add_func ("/event-sequence/walk/remove-in-callback",
+                   test_event_sequence_walk_remove_in_callback);
+  g_test_add_func ("/event-sequence/walk/sharded",
+                   test_event_sequence_walk_sharded);
+  g_test_add_func ("/event-sequence/iter", test_event_sequence_iter);
+  g_test_add_func ("/event-sequence/slice", test_event_sequence_slice);
+  g_test_add_func ("/event-sequence/slice/append",
+                   test_event_sequence_slice_append);
+  g_test_add_func ("/event-sequence/merge", test_event_sequence_merge);
+  g_test_add_func ("/event-sequence/walk/retained",
+                   test_event_sequence_walk_retained);
+  g_test_add_func ("/event-sequence/get-item/bounded",
+                   test_event_sequence_get_item_bounded);
 
   return g_test_run ();
 }
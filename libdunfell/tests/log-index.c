@@ -0,0 +1,309 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "event.h"
+#include "log-index.h"
+#include "parser.h"
+
+
+/* Write @log to a new temporary file and return its path. */
+static gchar *
+write_log (const gchar *log,
+           gsize        length)
+{
+  gchar *filename = NULL;
+  gint fd;
+  GError *error = NULL;
+
+  fd = g_file_open_tmp ("dunfell-log-index-XXXXXX.log", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  g_file_set_contents (filename, log, length, &error);
+  g_assert_no_error (error);
+
+  return filename;
+}
+
+/* Delete the log at @filename and its index, if it has one. */
+static void
+delete_log (gchar *filename)
+{
+  gchar *index_filename = NULL;
+
+  index_filename = g_strconcat (filename, ".idx", NULL);
+  g_unlink (index_filename);
+  g_unlink (filename);
+
+  g_free (index_filename);
+  g_free (filename);
+}
+
+/* Test that an index summarises a log correctly, and survives being saved
+ * and loaded. */
+static void
+test_log_index_build (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,100\n"
+    "# Comment\n"
+    "g_main_context_acquire,110,1,0,0\n"
+    "nonexistent_event,115\n"
+    "g_thread_spawned,120,2,0,0,worker\n"
+    "g_main_context_release,130,1,0\n"
+    "g_main_context_acquire,125,2,0,0\n";
+  gchar *filename = NULL;
+  DflLogIndex *index = NULL, *loaded_index = NULL;
+  const DflLogIndexThread *threads;
+  gsize n_threads;
+  FILE *file = NULL;
+  GError *error = NULL;
+
+  filename = write_log (log, strlen (log));
+
+  /* Build. */
+  index = dfl_log_index_build (filename, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpstr (dfl_log_index_get_log_filename (index), ==, filename);
+  g_assert_cmpuint (dfl_log_index_get_initial_timestamp (index), ==, 100);
+  g_assert_cmpuint (dfl_log_index_get_final_timestamp (index), ==, 130);
+
+  threads = dfl_log_index_get_threads (index, &n_threads);
+  g_assert_cmpuint (n_threads, ==, 2);
+  g_assert_cmpuint (threads[0].thread_id, ==, 1);
+  g_assert_cmpuint (threads[0].first_timestamp, ==, 110);
+  g_assert_cmpuint (threads[0].last_timestamp, ==, 130);
+  g_assert_cmpuint (threads[0].n_events, ==, 2);
+  g_assert_cmpuint (threads[1].thread_id, ==, 2);
+  g_assert_cmpuint (threads[1].first_timestamp, ==, 120);
+  g_assert_cmpuint (threads[1].last_timestamp, ==, 125);
+  g_assert_cmpuint (threads[1].n_events, ==, 2);
+
+  g_assert_cmpuint (dfl_log_index_get_event_type_count (index,
+                                                        "g_main_context_acquire"),
+                    ==, 2);
+  g_assert_cmpuint (dfl_log_index_get_event_type_count (index,
+                                                        "g_thread_spawned"),
+                    ==, 1);
+  g_assert_cmpuint (dfl_log_index_get_event_type_count (index,
+                                                        "nonexistent_event"),
+                    ==, 0);
+
+  /* Save and load. */
+  dfl_log_index_save (index, &error);
+  g_assert_no_error (error);
+
+  loaded_index = dfl_log_index_load (filename, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpuint (dfl_log_index_get_initial_timestamp (loaded_index), ==,
+                    100);
+  g_assert_cmpuint (dfl_log_index_get_final_timestamp (loaded_index), ==, 130);
+
+  threads = dfl_log_index_get_threads (loaded_index, &n_threads);
+  g_assert_cmpuint (n_threads, ==, 2);
+  g_assert_cmpuint (threads[1].thread_id, ==, 2);
+  g_assert_cmpuint (threads[1].last_timestamp, ==, 125);
+  g_assert_cmpuint (dfl_log_index_get_event_type_count (loaded_index,
+                                                        "g_main_context_release"),
+                    ==, 1);
+
+  g_clear_object (&loaded_index);
+
+  /* Changing the log makes the index stale. */
+  file = g_fopen (filename, "a");
+  g_assert_nonnull (file);
+  fputs ("g_main_context_release,140,2,0\n", file);
+  fclose (file);
+
+  loaded_index = dfl_log_index_load (filename, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN);
+  g_assert_null (loaded_index);
+  g_clear_error (&error);
+
+  g_object_unref (index);
+  delete_log (filename);
+}
+
+/* Test that binary logs can’t be indexed. */
+static void
+test_log_index_binary (void)
+{
+  const gchar log[] = "\x89" "DFL\r\n\x1a\n";
+  gchar *filename = NULL;
+  DflLogIndex *index = NULL;
+  GError *error = NULL;
+
+  filename = write_log (log, sizeof (log) - 1);
+
+  index = dfl_log_index_build (filename, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+  g_assert_null (index);
+  g_clear_error (&error);
+
+  delete_log (filename);
+}
+
+/* Check that two parsers loaded the same events. */
+static void
+assert_sequences_equal (DflParser *parser1,
+                        DflParser *parser2)
+{
+  GListModel *sequence1, *sequence2;
+  guint i;
+
+  sequence1 = G_LIST_MODEL (dfl_parser_get_event_sequence (parser1));
+  sequence2 = G_LIST_MODEL (dfl_parser_get_event_sequence (parser2));
+
+  g_assert_cmpuint (g_list_model_get_n_items (sequence1), ==,
+                    g_list_model_get_n_items (sequence2));
+
+  for (i = 0; i < g_list_model_get_n_items (sequence1); i++)
+    {
+      DflEvent *event1 = g_list_model_get_item (sequence1, i);
+      DflEvent *event2 = g_list_model_get_item (sequence2, i);
+
+      g_assert_cmpstr (dfl_event_get_event_type (event1), ==,
+                       dfl_event_get_event_type (event2));
+      g_assert_cmpuint (dfl_event_get_timestamp (event1), ==,
+                        dfl_event_get_timestamp (event2));
+      g_assert_cmpuint (dfl_event_get_thread_id (event1), ==,
+                        dfl_event_get_thread_id (event2));
+
+      g_object_unref (event2);
+      g_object_unref (event1);
+    }
+}
+
+/* Test that loading a time range from a log using its index gives the same
+ * events as loading it without the index, including lifetime events from
+ * outside the range. The index is built while loading the log the first time,
+ * from the same (parallel) parse, so check it covers the whole log. */
+static void
+test_log_index_parser (void)
+{
+  GString *log = NULL;
+  gchar *filename = NULL, *index_filename = NULL;
+  DflParser *indexed_parser = NULL, *reindexed_parser = NULL;
+  DflParser *unindexed_parser = NULL;
+  DflLogIndex *index = NULL;
+  const DflLogIndexThread *threads;
+  gsize n_threads;
+  guint n_events = 0;
+  GError *error = NULL;
+
+  /* Build a log spanning several index blocks, with a lifetime event every so
+   * often. */
+  log = g_string_new ("Dunfell log,1.0,1000\n");
+
+  while (log->len < 4 * 1024 * 1024)
+    {
+      g_string_append_printf (log, "g_main_context_acquire,%u,1,%u,1\n",
+                              1000 + n_events, n_events);
+      n_events++;
+
+      if (n_events % 1000 == 0)
+        {
+          g_string_append_printf (log, "g_source_new,%u,2,1,2,3,4,5,6\n",
+                                  1000 + n_events);
+          n_events++;
+        }
+    }
+
+  filename = write_log (log->str, log->len);
+  index_filename = g_strconcat (filename, ".idx", NULL);
+
+  /* Without an index. */
+  unindexed_parser = dfl_parser_new ();
+  dfl_parser_set_time_range (unindexed_parser, n_events / 2,
+                             n_events / 2 + 1000);
+  dfl_parser_load_from_data (unindexed_parser, (const guint8 *) log->str,
+                             log->len, &error);
+  g_assert_no_error (error);
+
+  /* Building the index on first load. */
+  g_assert_false (g_file_test (index_filename, G_FILE_TEST_EXISTS));
+
+  indexed_parser = dfl_parser_new ();
+  dfl_parser_set_time_range (indexed_parser, n_events / 2,
+                             n_events / 2 + 1000);
+  dfl_parser_load_from_file (indexed_parser, filename, &error);
+  g_assert_no_error (error);
+
+  g_assert_true (g_file_test (index_filename, G_FILE_TEST_EXISTS));
+  assert_sequences_equal (indexed_parser, unindexed_parser);
+
+  index = dfl_log_index_load (filename, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpuint (dfl_log_index_get_initial_timestamp (index), ==, 1000);
+  g_assert_cmpuint (dfl_log_index_get_final_timestamp (index), ==,
+                    1000 + n_events - 1);
+
+  threads = dfl_log_index_get_threads (index, &n_threads);
+  g_assert_cmpuint (n_threads, ==, 2);
+  g_assert_cmpuint (threads[0].thread_id, ==, 1);
+  g_assert_cmpuint (threads[0].first_timestamp, ==, 1000);
+  g_assert_cmpuint (threads[1].thread_id, ==, 2);
+  g_assert_cmpuint (threads[0].n_events + threads[1].n_events, ==, n_events);
+  g_assert_cmpuint (threads[1].n_events, ==,
+                    dfl_log_index_get_event_type_count (index,
+                                                        "g_source_new"));
+
+  g_object_unref (index);
+
+  /* Using the existing index. */
+  reindexed_parser = dfl_parser_new ();
+  dfl_parser_set_time_range (reindexed_parser, n_events / 2,
+                             n_events / 2 + 1000);
+  dfl_parser_load_from_file (reindexed_parser, filename, &error);
+  g_assert_no_error (error);
+
+  assert_sequences_equal (reindexed_parser, unindexed_parser);
+
+  g_object_unref (reindexed_parser);
+  g_object_unref (indexed_parser);
+  g_object_unref (unindexed_parser);
+
+  g_free (index_filename);
+  delete_log (filename);
+  g_string_free (log, TRUE);
+}
+
+int
+main (int argc, char *argv[])
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/log-index/build", test_log_index_build);
+  g_test_add_func ("/log-index/binary", test_log_index_binary);
+  g_test_add_func ("/log-index/parser", test_log_index_parser);
+
+  return g_test_run ();
+}
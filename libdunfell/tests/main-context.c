@@ -101,6 +101,69 @@ test_main_context_parse_log_single_context_single_thread (void)
   g_ptr_array_unref (main_contexts);
 }
 
+/* Test that the main loop phase events are turned into a breakdown of each
+ * iteration, ignoring events from before the first complete iteration. */
+static void
+test_main_context_parse_log_iterations (void)
+{
+  GPtrArray/*<owned DflMainContext>*/ *main_contexts = NULL;
+  DflMainContext *context;
+  DflTimeSequenceIter iter;
+  DflTimestamp timestamp;
+  DflMainContextIterationData *iteration;
+
+  /* Timestamps: 1+; thread IDs: 1000, 1001; context ID: 666 */
+  main_contexts = parser_helper (
+    "Dunfell log,1.0,1\n"
+    "g_main_context_new,1,1000,666\n"
+    "g_main_context_after_check,50,1000,666,0\n"
+    "g_main_context_before_prepare,100,1000,666\n"
+    "g_main_context_after_prepare,103,1000,666,0,0\n"
+    "g_main_context_before_query,104,1000,666,0\n"
+    "g_main_context_after_query,106,1000,666,-1,1\n"
+    "g_main_context_wakeup,150,1001,666\n"
+    "g_main_context_before_check,160,1000,666,0,1\n"
+    "g_main_context_wakeup_acknowledge,161,1000,666\n"
+    "g_main_context_after_check,165,1000,666,1\n"
+    "g_main_context_before_dispatch,166,1000,666\n"
+    "g_main_context_after_dispatch,176,1000,666\n"
+    "g_main_context_before_prepare,200,1000,666\n"
+    "g_main_context_after_prepare,201,1000,666,0,1\n"
+    "g_main_context_after_query,202,1000,666,-1,1\n"
+    "g_main_context_free,300,1000,666\n");
+
+  g_assert_cmpuint (main_contexts->len, ==, 1);
+  context = main_contexts->pdata[0];
+
+  dfl_main_context_iteration_iter (context, &iter, 0);
+
+  g_assert_true (dfl_time_sequence_iter_next (&iter, &timestamp,
+                                              (gpointer *) &iteration));
+  g_assert_cmpuint (timestamp, ==, 100);
+  g_assert_cmpuint (iteration->thread_id, ==, 1000);
+  g_assert_cmpint (iteration->prepare_duration, ==, 3);
+  g_assert_cmpint (iteration->query_duration, ==, 2);
+  g_assert_cmpint (iteration->poll_duration, ==, 54);
+  g_assert_cmpint (iteration->check_duration, ==, 5);
+  g_assert_cmpint (iteration->dispatch_duration, ==, 10);
+  g_assert_true (iteration->woken_up);
+
+  /* The second iteration is missing its g_main_context_before_query event. */
+  g_assert_true (dfl_time_sequence_iter_next (&iter, &timestamp,
+                                              (gpointer *) &iteration));
+  g_assert_cmpuint (timestamp, ==, 200);
+  g_assert_cmpint (iteration->prepare_duration, ==, 1);
+  g_assert_cmpint (iteration->query_duration, <, 0);
+  g_assert_cmpint (iteration->poll_duration, <, 0);
+  g_assert_cmpint (iteration->check_duration, <, 0);
+  g_assert_cmpint (iteration->dispatch_duration, <, 0);
+  g_assert_false (iteration->woken_up);
+
+  g_assert_false (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+
+  g_ptr_array_unref (main_contexts);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -114,6 +177,8 @@ main (int argc, char *argv[])
                    test_main_context_parse_log_empty);
   g_test_add_func ("/main-context/parse-log/single-context-single-thread",
                    test_main_context_parse_log_single_context_single_thread);
+  g_test_add_func ("/main-context/parse-log/iterations",
+                   test_main_context_parse_log_iterations);
 
   return g_test_run ();
 }
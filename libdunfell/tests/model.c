@@ -0,0 +1,400 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "main-context.h"
+#include "model.h"
+#include "parser.h"
+#include "source.h"
+#include "task.h"
+#include "thread.h"
+
+
+/* Write @log to a new temporary file and return its path. */
+static gchar *
+write_log (const gchar *log)
+{
+  gchar *filename = NULL;
+  gint fd;
+  GError *error = NULL;
+
+  fd = g_file_open_tmp ("dunfell-model-XXXXXX.log", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  g_file_set_contents (filename, log, -1, &error);
+  g_assert_no_error (error);
+
+  return filename;
+}
+
+/* Delete the log at @filename and its model cache, if it has one. */
+static void
+delete_log (gchar *filename)
+{
+  gchar *cache_filename = NULL;
+
+  cache_filename = g_strconcat (filename, ".model", NULL);
+  g_unlink (cache_filename);
+  g_unlink (filename);
+
+  g_free (cache_filename);
+  g_free (filename);
+}
+
+/* Test that a model survives being saved to and loaded from a cache, and that
+ * the cache is ignored once the log changes. */
+static void
+test_model_cache (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,1\n"
+    "g_thread_spawned,1,1000,0,0,worker\n"
+    "g_main_context_new,2,1000,666\n"
+    "g_main_context_acquire,3,1000,666,1\n"
+    "g_source_new,4,1000,10,0,0,0,0,0\n"
+    "g_source_set_name,5,1000,10,idle\n"
+    "g_main_context_before_dispatch,6,1000,666\n"
+    "g_source_before_dispatch,7,1000,10,g_idle_dispatch,idle_cb,0\n"
+    "g_source_after_dispatch,9,1000,10,0,0\n"
+    "g_main_context_after_dispatch,10,1000,666\n"
+    "g_main_context_release,11,1000,666\n"
+    "g_task_new,12,1000,20,0,0,task_cb,0\n"
+    "g_task_set_source_tag,13,1000,20,my_function\n";
+  gchar *filename = NULL;
+  DflParser *parser = NULL;
+  DflModel *model = NULL, *loaded_model = NULL;
+  GPtrArray *threads = NULL, *main_contexts = NULL, *sources = NULL;
+  GPtrArray *tasks = NULL;
+  DflThread *thread;
+  DflMainContext *main_context;
+  DflSource *source;
+  DflTask *task;
+  DflTimeSequenceIter iter;
+  DflTimestamp timestamp;
+  DflSourceDispatchData *dispatch;
+  DflMainContextDispatchData *main_context_dispatch;
+  FILE *file = NULL;
+  GError *error = NULL;
+
+  filename = write_log (log);
+
+  /* No cache yet. */
+  loaded_model = dfl_model_load_cache (filename, &error);
+  g_assert_nonnull (error);
+  g_assert_null (loaded_model);
+  g_clear_error (&error);
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_file (parser, filename, &error);
+  g_assert_no_error (error);
+
+  model = dfl_model_new (dfl_parser_get_event_sequence (parser));
+  dfl_model_save_cache (model, filename, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (model);
+  g_object_unref (parser);
+
+  /* Load it again and check everything is there. */
+  loaded_model = dfl_model_load_cache (filename, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (loaded_model);
+
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (dfl_model_get_event_sequence (loaded_model))),
+                    ==, 0);
+
+  threads = dfl_model_dup_threads (loaded_model);
+  g_assert_cmpuint (threads->len, ==, 1);
+  thread = threads->pdata[0];
+  g_assert_cmpuint (dfl_thread_get_id (thread), ==, 1000);
+  g_assert_cmpstr (dfl_thread_get_name (thread), ==, "worker");
+  g_assert_cmpuint (dfl_thread_get_new_timestamp (thread), ==, 1);
+  g_assert_cmpuint (dfl_thread_get_free_timestamp (thread), ==, 13);
+
+  main_contexts = dfl_model_dup_main_contexts (loaded_model);
+  g_assert_cmpuint (main_contexts->len, ==, 1);
+  main_context = main_contexts->pdata[0];
+  g_assert_cmpuint (dfl_main_context_get_id (main_context), ==, 666);
+
+  dfl_main_context_dispatch_iter (main_context, &iter, 0);
+  g_assert_true (dfl_time_sequence_iter_next (&iter, &timestamp,
+                                              (gpointer *) &main_context_dispatch));
+  g_assert_cmpuint (timestamp, ==, 6);
+  g_assert_cmpint (main_context_dispatch->duration, ==, 4);
+  g_assert_false (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+
+  sources = dfl_model_dup_sources (loaded_model);
+  g_assert_cmpuint (sources->len, ==, 1);
+  source = sources->pdata[0];
+  g_assert_cmpuint (dfl_source_get_id (source), ==, 10);
+  g_assert_cmpstr (dfl_source_get_name (source), ==, "idle");
+
+  dfl_source_dispatch_iter (source, &iter, 0);
+  g_assert_true (dfl_time_sequence_iter_next (&iter, &timestamp,
+                                              (gpointer *) &dispatch));
+  g_assert_cmpuint (timestamp, ==, 7);
+  g_assert_cmpint (dispatch->duration, ==, 2);
+  g_assert_cmpstr (dfl_atom_table_lookup (dfl_model_get_atom_table (loaded_model),
+                                          dispatch->callback_name), ==,
+                   "idle_cb");
+
+  tasks = dfl_model_dup_tasks (loaded_model);
+  g_assert_cmpuint (tasks->len, ==, 1);
+  task = tasks->pdata[0];
+  g_assert_cmpuint (dfl_task_get_id (task), ==, 20);
+  g_assert_cmpstr (dfl_task_get_callback_name (task), ==, "task_cb");
+  g_assert_cmpstr (dfl_task_get_source_tag_name (task), ==, "my_function");
+
+  g_ptr_array_unref (tasks);
+  g_ptr_array_unref (sources);
+  g_ptr_array_unref (main_contexts);
+  g_ptr_array_unref (threads);
+  g_object_unref (loaded_model);
+
+  /* Appending to the log makes the cache stale. */
+  file = g_fopen (filename, "a");
+  g_assert_nonnull (file);
+  fputs ("g_main_context_free,14,1000,666\n", file);
+  fclose (file);
+
+  loaded_model = dfl_model_load_cache (filename, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN);
+  g_assert_null (loaded_model);
+  g_clear_error (&error);
+
+  delete_log (filename);
+}
+
+static void
+async_result_cb (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  GAsyncResult **result_out = user_data;
+
+  g_assert_null (*result_out);
+  *result_out = g_object_ref (result);
+}
+
+/* Test saving and loading a cache asynchronously, with enough elements in a
+ * time sequence that several of its blocks are used in place from the mapped
+ * cache. */
+static void
+test_model_cache_async (void)
+{
+  const guint n_spans = 100;
+  GString *log = NULL;
+  gchar *filename = NULL;
+  DflParser *parser = NULL;
+  DflModel *model = NULL, *loaded_model = NULL;
+  GPtrArray *main_contexts = NULL;
+  GAsyncResult *result = NULL;
+  DflTimeSequenceIter iter;
+  DflTimestamp timestamp;
+  DflThreadOwnershipData *ownership;
+  guint i;
+  GError *error = NULL;
+
+  log = g_string_new ("Dunfell log,1.0,1\n"
+                      "g_main_context_new,2,1000,666\n");
+
+  for (i = 0; i < n_spans; i++)
+    g_string_append_printf (log,
+                            "g_main_context_acquire,%u,1000,666,1\n"
+                            "g_main_context_release,%u,1000,666\n",
+                            10 + 2 * i, 11 + 2 * i);
+
+  filename = write_log (log->str);
+  g_string_free (log, TRUE);
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_file (parser, filename, &error);
+  g_assert_no_error (error);
+
+  model = dfl_model_new (dfl_parser_get_event_sequence (parser));
+  dfl_model_save_cache_async (model, filename, NULL, async_result_cb, &result);
+
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_true (dfl_model_save_cache_finish (model, result, &error));
+  g_assert_no_error (error);
+  g_clear_object (&result);
+
+  g_object_unref (model);
+  g_object_unref (parser);
+
+  dfl_model_load_cache_async (filename, NULL, async_result_cb, &result);
+
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  loaded_model = dfl_model_load_cache_finish (result, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (loaded_model);
+  g_clear_object (&result);
+
+  main_contexts = dfl_model_dup_main_contexts (loaded_model);
+  g_assert_cmpuint (main_contexts->len, ==, 1);
+  dfl_main_context_thread_ownership_iter (main_contexts->pdata[0], &iter, 0);
+
+  for (i = 0; i < n_spans; i++)
+    {
+      g_assert_true (dfl_time_sequence_iter_next (&iter, &timestamp,
+                                                  (gpointer *) &ownership));
+      g_assert_cmpuint (timestamp, ==, 10 + 2 * i);
+      g_assert_cmpint (ownership->duration, ==, 1);
+    }
+
+  g_assert_false (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+
+  g_ptr_array_unref (main_contexts);
+  g_object_unref (loaded_model);
+
+  delete_log (filename);
+}
+
+/* Check that the spans in @iter have the given @starts and @durations (read
+ * from @duration_offset in each element). @starts is terminated by a zero. */
+static void
+assert_spans (DflTimeSequenceIter *iter,
+              gsize                duration_offset,
+              const DflTimestamp  *starts,
+              const DflDuration   *durations)
+{
+  DflTimestamp timestamp;
+  gpointer data;
+  gsize i;
+
+  for (i = 0; starts[i] != 0; i++)
+    {
+      g_assert_true (dfl_time_sequence_iter_next (iter, &timestamp, &data));
+      g_assert_cmpuint (timestamp, ==, starts[i]);
+      g_assert_cmpint (G_STRUCT_MEMBER (DflDuration, data, duration_offset),
+                       ==, durations[i]);
+    }
+
+  g_assert_false (dfl_time_sequence_iter_next (iter, NULL, NULL));
+}
+
+/* Test that a model built from a log loaded with filters is consistent: spans
+ * which straddle the start of the time range are clipped to it, and filtering
+ * by event type keeps both halves of each span. Any inconsistency would cause
+ * a (fatal) warning while building the model. */
+static void
+test_model_filtered (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,1\n"
+    "g_main_context_new,2,1000,666\n"
+    "g_source_new,3,1000,10,0,0,0,0,0\n"
+    "g_main_context_acquire,10,1000,666,1\n"
+    "g_main_context_before_dispatch,20,1000,666\n"
+    "g_source_before_dispatch,30,1000,10,g_idle_dispatch,idle_cb,0\n"
+    "g_source_after_dispatch,50,1000,10,0,0\n"
+    "g_main_context_after_dispatch,60,1000,666\n"
+    "g_main_context_release,70,1000,666\n"
+    "g_main_context_acquire,80,1000,666,1\n"
+    "g_main_context_release,90,1000,666\n";
+  const gchar *event_types[] = { "g_main_context_release", NULL };
+  const DflTimestamp window_ownership_starts[] = { 40, 80, 0 };
+  const DflDuration window_ownership_durations[] = { 30, 10 };
+  const DflTimestamp window_dispatch_starts[] = { 40, 0 };
+  const DflDuration window_main_context_dispatch_durations[] = { 20 };
+  const DflDuration window_source_dispatch_durations[] = { 10 };
+  const DflTimestamp types_ownership_starts[] = { 10, 80, 0 };
+  const DflDuration types_ownership_durations[] = { 60, 10 };
+  const DflTimestamp no_starts[] = { 0 };
+  DflParser *parser = NULL;
+  DflModel *model = NULL;
+  GPtrArray *main_contexts = NULL, *sources = NULL;
+  DflTimeSequenceIter iter;
+  GError *error = NULL;
+
+  /* Time range starting part-way through several spans. */
+  parser = dfl_parser_new ();
+  dfl_parser_set_time_range (parser, 39, G_MAXINT64);
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+
+  model = dfl_model_new (dfl_parser_get_event_sequence (parser));
+
+  main_contexts = dfl_model_dup_main_contexts (model);
+  g_assert_cmpuint (main_contexts->len, ==, 1);
+  dfl_main_context_thread_ownership_iter (main_contexts->pdata[0], &iter, 0);
+  assert_spans (&iter, G_STRUCT_OFFSET (DflThreadOwnershipData, duration),
+                window_ownership_starts, window_ownership_durations);
+  dfl_main_context_dispatch_iter (main_contexts->pdata[0], &iter, 0);
+  assert_spans (&iter, G_STRUCT_OFFSET (DflMainContextDispatchData, duration),
+                window_dispatch_starts, window_main_context_dispatch_durations);
+
+  sources = dfl_model_dup_sources (model);
+  g_assert_cmpuint (sources->len, ==, 1);
+  dfl_source_dispatch_iter (sources->pdata[0], &iter, 0);
+  assert_spans (&iter, G_STRUCT_OFFSET (DflSourceDispatchData, duration),
+                window_dispatch_starts, window_source_dispatch_durations);
+
+  g_ptr_array_unref (sources);
+  g_ptr_array_unref (main_contexts);
+  g_object_unref (model);
+  g_object_unref (parser);
+
+  /* Event types, selecting only one half of a pair. */
+  parser = dfl_parser_new ();
+  dfl_parser_set_event_types (parser, event_types);
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+
+  model = dfl_model_new (dfl_parser_get_event_sequence (parser));
+
+  main_contexts = dfl_model_dup_main_contexts (model);
+  g_assert_cmpuint (main_contexts->len, ==, 1);
+  dfl_main_context_thread_ownership_iter (main_contexts->pdata[0], &iter, 0);
+  assert_spans (&iter, G_STRUCT_OFFSET (DflThreadOwnershipData, duration),
+                types_ownership_starts, types_ownership_durations);
+  dfl_main_context_dispatch_iter (main_contexts->pdata[0], &iter, 0);
+  assert_spans (&iter, G_STRUCT_OFFSET (DflMainContextDispatchData, duration),
+                no_starts, NULL);
+
+  g_ptr_array_unref (main_contexts);
+  g_object_unref (model);
+  g_object_unref (parser);
+}
+
+int
+main (int argc, char *argv[])
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/model/cache", test_model_cache);
+  g_test_add_func ("/model/cache/async", test_model_cache_async);
+  g_test_add_func ("/model/filtered", test_model_filtered);
+
+  return g_test_run ();
+}
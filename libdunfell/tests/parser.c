@@ -16,10 +16,19 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <gio/gio.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <locale.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "event.h"
 #include "parser.h"
 
 
@@ -64,6 +73,964 @@ test_parser_log (gconstpointer data)
   g_object_unref (parser);
 }
 
+/* Test that loading a log from a file (which uses a mapping) produces the same
+ * events as loading it from memory. */
+static void
+test_parser_log_file (gconstpointer data)
+{
+  const LogTestVector *vector = data;
+  DflParser *file_parser = NULL, *data_parser = NULL;
+  GListModel *file_sequence, *data_sequence;
+  gchar *filename = NULL;
+  gint fd;
+  guint i;
+  GError *error = NULL;
+
+  fd = g_file_open_tmp ("dunfell-parser-XXXXXX.log", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  g_file_set_contents (filename, vector->log, -1, &error);
+  g_assert_no_error (error);
+
+  file_parser = dfl_parser_new ();
+  dfl_parser_load_from_file (file_parser, filename, &error);
+  g_assert_no_error (error);
+
+  data_parser = dfl_parser_new ();
+  dfl_parser_load_from_data (data_parser, (const guint8 *) vector->log,
+                             strlen (vector->log), &error);
+  g_assert_no_error (error);
+
+  file_sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (file_parser));
+  data_sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (data_parser));
+
+  g_assert_cmpuint (g_list_model_get_n_items (file_sequence), ==,
+                    vector->n_events_expected);
+  g_assert_cmpuint (g_list_model_get_n_items (data_sequence), ==,
+                    vector->n_events_expected);
+
+  for (i = 0; i < vector->n_events_expected; i++)
+    {
+      DflEvent *file_event = NULL, *data_event = NULL;
+      gchar **file_parameters = NULL, **data_parameters = NULL;
+      guint j;
+
+      file_event = g_list_model_get_item (file_sequence, i);
+      data_event = g_list_model_get_item (data_sequence, i);
+
+      g_assert_cmpstr (dfl_event_get_event_type (file_event), ==,
+                       dfl_event_get_event_type (data_event));
+      g_assert_cmpuint (dfl_event_get_timestamp (file_event), ==,
+                        dfl_event_get_timestamp (data_event));
+      g_assert_cmpuint (dfl_event_get_thread_id (file_event), ==,
+                        dfl_event_get_thread_id (data_event));
+
+      g_object_get (file_event, "parameters", &file_parameters, NULL);
+      g_object_get (data_event, "parameters", &data_parameters, NULL);
+
+      g_assert_cmpuint (g_strv_length (file_parameters), ==,
+                        g_strv_length (data_parameters));
+
+      for (j = 0; file_parameters[j] != NULL; j++)
+        g_assert_cmpstr (file_parameters[j], ==, data_parameters[j]);
+
+      g_strfreev (data_parameters);
+      g_strfreev (file_parameters);
+      g_object_unref (data_event);
+      g_object_unref (file_event);
+    }
+
+  g_object_unref (data_parser);
+  g_object_unref (file_parser);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+/* Build a log which is large enough to be parsed in parallel. Thread 1 has
+ * increasing timestamps throughout; thread 2 has one event at the start, and
+ * one at the end with timestamp @thread2_last_timestamp. */
+static GString *
+build_large_log (guint   *n_events_out,
+                 guint64  thread2_last_timestamp)
+{
+  GString *log = NULL;
+  guint n_events = 0;
+
+  log = g_string_new ("Dunfell log,1.0,100\n");
+  g_string_append (log, "g_main_context_acquire,1000,2,0,0\n");
+  n_events++;
+
+  while (log->len < 8 * 1024 * 1024)
+    {
+      g_string_append_printf (log, "g_main_context_acquire,%u,1,%u,1\n",
+                              1000 + n_events, n_events);
+      n_events++;
+
+      /* Include some ignored lines too. */
+      if (n_events % 100 == 0)
+        g_string_append (log, "# Comment\nnonexistent_event,125\n");
+    }
+
+  g_string_append_printf (log, "g_main_context_acquire,%" G_GUINT64_FORMAT
+                          ",2,0,0\n", thread2_last_timestamp);
+  n_events++;
+
+  *n_events_out = n_events;
+
+  return log;
+}
+
+/* Test that a large log (which may be parsed in parallel) is loaded with all
+ * its events in file order. */
+static void
+test_parser_log_large (void)
+{
+  DflParser *parser = NULL;
+  GListModel *sequence;
+  GString *log = NULL;
+  DflTimestamp previous_timestamp = 0;
+  guint n_events, i;
+  GError *error = NULL;
+
+  log = build_large_log (&n_events, 2000);
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, (const guint8 *) log->str, log->len,
+                             &error);
+  g_assert_no_error (error);
+
+  sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (parser));
+  g_assert_cmpuint (g_list_model_get_n_items (sequence), ==, n_events);
+
+  for (i = 0; i < n_events - 1; i++)
+    {
+      DflEvent *event = NULL;
+
+      event = g_list_model_get_item (sequence, i);
+      g_assert_cmpuint (dfl_event_get_timestamp (event), >,
+                        previous_timestamp);
+      previous_timestamp = dfl_event_get_timestamp (event);
+      g_object_unref (event);
+    }
+
+  g_object_unref (parser);
+  g_string_free (log, TRUE);
+}
+
+/* Test that non-monotonic timestamps are detected in a large log, even if
+ * the events for the thread are far apart (and hence may be parsed in
+ * different chunks). */
+static void
+test_parser_log_large_non_monotonic (void)
+{
+  DflParser *parser = NULL;
+  GString *log = NULL;
+  guint n_events;
+  GError *error = NULL;
+
+  log = build_large_log (&n_events, 500);
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, (const guint8 *) log->str, log->len,
+                             &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN);
+  g_assert_null (dfl_parser_get_event_sequence (parser));
+  g_error_free (error);
+
+  g_object_unref (parser);
+  g_string_free (log, TRUE);
+}
+
+/* Check that the events loaded by @parser have the given timestamps, in
+ * order. @expected_timestamps is terminated by 0. */
+static void
+assert_event_timestamps (DflParser          *parser,
+                         const DflTimestamp *expected_timestamps)
+{
+  GListModel *sequence;
+  guint i;
+
+  sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (parser));
+
+  for (i = 0; expected_timestamps[i] != 0; i++)
+    {
+      DflEvent *event = NULL;
+
+      g_assert_cmpuint (i, <, g_list_model_get_n_items (sequence));
+      event = g_list_model_get_item (sequence, i);
+      g_assert_cmpuint (dfl_event_get_timestamp (event), ==,
+                        expected_timestamps[i]);
+      g_object_unref (event);
+    }
+
+  g_assert_cmpuint (g_list_model_get_n_items (sequence), ==, i);
+}
+
+/* Test that events can be filtered by time, thread and type while parsing,
+ * and that lifetime events are always kept. */
+static void
+test_parser_filter (void)
+{
+  DflParser *parser = NULL;
+  const gchar *log =
+    "Dunfell log,1.0,100\n"
+    "g_source_new,110,1,1,2,3,4,5,6\n"
+    "g_main_context_acquire,120,1,0,0\n"
+    "g_main_context_acquire,130,2,0,0\n"
+    "g_source_before_dispatch,140,1,1,2,3,4\n"
+    "g_main_context_release,150,2,0\n"
+    "g_source_before_free,160,1,1,2,3\n";
+  const DflThreadId thread1[] = { 1 }, thread2[] = { 2 };
+  const gchar *event_types[] = { "g_main_context_release", "nonexistent",
+                                 NULL };
+  const DflTimestamp all[] = { 110, 120, 130, 140, 150, 160, 0 };
+  const DflTimestamp time_range[] = { 110, 130, 140, 160, 0 };
+  const DflTimestamp thread_ids[] = { 110, 130, 150, 160, 0 };
+  /* Selecting g_main_context_release also selects g_main_context_acquire, so
+   * that spans are not half-loaded. */
+  const DflTimestamp types[] = { 110, 120, 130, 150, 160, 0 };
+  const DflTimestamp combined[] = { 110, 120, 160, 0 };
+  GError *error = NULL;
+
+  parser = dfl_parser_new ();
+
+  /* Time range. */
+  dfl_parser_set_time_range (parser, 25, 45);
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+  assert_event_timestamps (parser, time_range);
+
+  dfl_parser_set_time_range (parser, 0, G_MAXINT64);
+
+  /* Thread IDs. */
+  dfl_parser_set_thread_ids (parser, thread2, G_N_ELEMENTS (thread2));
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+  assert_event_timestamps (parser, thread_ids);
+
+  dfl_parser_set_thread_ids (parser, NULL, 0);
+
+  /* Event types. */
+  dfl_parser_set_event_types (parser, event_types);
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+  assert_event_timestamps (parser, types);
+
+  dfl_parser_set_event_types (parser, NULL);
+
+  /* Combined. */
+  dfl_parser_set_thread_ids (parser, thread1, G_N_ELEMENTS (thread1));
+  dfl_parser_set_time_range (parser, 0, 25);
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+  assert_event_timestamps (parser, combined);
+
+  /* Reset. */
+  dfl_parser_set_thread_ids (parser, NULL, 0);
+  dfl_parser_set_time_range (parser, 0, G_MAXINT64);
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+  assert_event_timestamps (parser, all);
+
+  g_object_unref (parser);
+}
+
+/* Test that event parameters are decoded into IDs and strings on load, and
+ * that both can be read back as strings. */
+static void
+test_parser_parameters (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,100\n"
+    "g_source_set_name,101,1,18446744073709551615,007\n"
+    "g_source_set_name,102,1,0,name with spaces\n"
+    "g_source_set_name,103,1,42,\n"
+    "g_source_set_name,104,1,43,+5\n";
+  DflParser *parser = NULL;
+  GListModel *sequence;
+  DflEvent *event;
+  gchar buffer[DFL_EVENT_PARAMETER_BUFFER_SIZE];
+  gchar buffer2[DFL_EVENT_PARAMETER_BUFFER_SIZE];
+  const gchar *formatted, *formatted2;
+  GError *error = NULL;
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+
+  sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (parser));
+  g_assert_cmpuint (g_list_model_get_n_items (sequence), ==, 4);
+
+  /* IDs are formatted into the caller’s buffer; strings are returned
+   * directly. */
+  event = g_list_model_get_item (sequence, 0);
+  g_assert_cmpuint (dfl_event_get_parameter_id (event, 0), ==, G_MAXUINT64);
+  formatted = dfl_event_format_parameter (event, 0, buffer, sizeof (buffer));
+  g_assert (formatted == buffer);
+  g_assert_cmpstr (dfl_event_get_parameter_utf8 (event, 1), ==, "007");
+  g_assert (dfl_event_format_parameter (event, 1, buffer2, sizeof (buffer2)) ==
+            dfl_event_get_parameter_utf8 (event, 1));
+  g_object_unref (event);
+
+  /* Formatting a parameter doesn’t overwrite one returned earlier, even from
+   * another event. */
+  event = g_list_model_get_item (sequence, 1);
+  g_assert_cmpuint (dfl_event_get_parameter_id (event, 0), ==, 0);
+  formatted2 = dfl_event_format_parameter (event, 0, buffer2,
+                                           sizeof (buffer2));
+  g_assert_cmpstr (formatted, ==, "18446744073709551615");
+  g_assert_cmpstr (formatted2, ==, "0");
+  g_assert_cmpstr (dfl_event_get_parameter_utf8 (event, 1), ==,
+                   "name with spaces");
+
+  /* IDs can’t be returned without a buffer. */
+  g_test_expect_message ("libdunfell", G_LOG_LEVEL_WARNING,
+                         "Event parameter 0 is an ID*");
+  g_assert_null (dfl_event_get_parameter_utf8 (event, 0));
+  g_test_assert_expected_messages ();
+  g_object_unref (event);
+
+  event = g_list_model_get_item (sequence, 2);
+  g_assert_cmpuint (dfl_event_get_parameter_id (event, 0), ==, 42);
+  g_assert_cmpstr (dfl_event_get_parameter_utf8 (event, 1), ==, "");
+  g_object_unref (event);
+
+  /* Numbers which aren’t in canonical form are kept as strings, so they
+   * round-trip exactly, but can still be read as IDs, as before. */
+  event = g_list_model_get_item (sequence, 3);
+  g_assert_cmpstr (dfl_event_get_parameter_utf8 (event, 1), ==, "+5");
+  g_assert_cmpuint (dfl_event_get_parameter_id (event, 1), ==, 5);
+  g_object_unref (event);
+
+  event = g_list_model_get_item (sequence, 0);
+  g_assert_cmpuint (dfl_event_get_parameter_id (event, 1), ==, 7);
+  g_object_unref (event);
+
+  event = g_list_model_get_item (sequence, 1);
+  g_test_expect_message ("libdunfell", G_LOG_LEVEL_WARNING,
+                         "Event parameter ‘name with spaces’ cannot be "
+                         "interpreted as an ID.");
+  dfl_event_get_parameter_id (event, 1);
+  g_test_assert_expected_messages ();
+  g_object_unref (event);
+
+  g_object_unref (parser);
+}
+
+/* Compress @data with gzip, entirely in memory. */
+static GBytes *
+gzip_compress (const gchar *data,
+               gsize        length)
+{
+  GZlibCompressor *compressor = NULL;
+  GOutputStream *memory_stream = NULL, *converter_stream = NULL;
+  GBytes *bytes = NULL;
+  GError *error = NULL;
+
+  compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+  memory_stream = g_memory_output_stream_new_resizable ();
+  converter_stream = g_converter_output_stream_new (memory_stream,
+                                                    G_CONVERTER (compressor));
+
+  g_output_stream_write_all (converter_stream, data, length, NULL, NULL,
+                             &error);
+  g_assert_no_error (error);
+  g_output_stream_close (converter_stream, NULL, &error);
+  g_assert_no_error (error);
+
+  bytes = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (memory_stream));
+
+  g_object_unref (converter_stream);
+  g_object_unref (memory_stream);
+  g_object_unref (compressor);
+
+  return bytes;
+}
+
+/* Test that gzip-compressed logs are decompressed transparently, whether
+ * loaded from memory or from a stream. */
+static void
+test_parser_log_gzip (void)
+{
+  DflParser *parser = NULL;
+  GInputStream *stream = NULL;
+  GListModel *sequence;
+  GString *log = NULL;
+  GBytes *compressed = NULL;
+  const guint8 *compressed_data;
+  gsize compressed_length;
+  guint n_events;
+  GError *error = NULL;
+
+  log = build_large_log (&n_events, 2000);
+  compressed = gzip_compress (log->str, log->len);
+  compressed_data = g_bytes_get_data (compressed, &compressed_length);
+
+  /* From memory. */
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, compressed_data, compressed_length,
+                             &error);
+  g_assert_no_error (error);
+
+  sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (parser));
+  g_assert_cmpuint (g_list_model_get_n_items (sequence), ==, n_events);
+
+  g_object_unref (parser);
+
+  /* From a stream. */
+  parser = dfl_parser_new ();
+  stream = g_memory_input_stream_new_from_bytes (compressed);
+  dfl_parser_load_from_stream (parser, stream, NULL, &error);
+  g_assert_no_error (error);
+
+  sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (parser));
+  g_assert_cmpuint (g_list_model_get_n_items (sequence), ==, n_events);
+
+  g_object_unref (stream);
+  g_object_unref (parser);
+
+  /* Truncated. */
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, compressed_data, compressed_length / 2,
+                             &error);
+  g_assert_nonnull (error);
+  g_assert_null (dfl_parser_get_event_sequence (parser));
+  g_clear_error (&error);
+
+  g_object_unref (parser);
+
+  g_bytes_unref (compressed);
+  g_string_free (log, TRUE);
+}
+
+#ifdef HAVE_ZSTD
+/* Compress @data with zstd, entirely in memory, as a sequence of independent
+ * frames of at most @frame_length bytes of input each. Each frame declares
+ * its decompressed size. */
+static GBytes *
+zstd_compress (const gchar *data,
+               gsize        length,
+               gsize        frame_length)
+{
+  GByteArray *output = NULL;
+  gsize offset;
+
+  output = g_byte_array_new ();
+
+  for (offset = 0; offset < length; offset += frame_length)
+    {
+      gsize input_length = MIN (frame_length, length - offset);
+      gsize bound = ZSTD_compressBound (input_length);
+      gsize output_length = output->len;
+      gsize retval;
+
+      g_byte_array_set_size (output, output_length + bound);
+      retval = ZSTD_compress (output->data + output_length, bound,
+                              data + offset, input_length, 1);
+      g_assert_false (ZSTD_isError (retval));
+      g_byte_array_set_size (output, output_length + retval);
+    }
+
+  return g_byte_array_free_to_bytes (output);
+}
+
+/* Check that loading @data (from memory and from a stream) gives a sequence
+ * of @n_events events. */
+static void
+assert_loads_n_events (const guint8 *data,
+                       gsize         length,
+                       guint         n_events)
+{
+  DflParser *parser = NULL;
+  GInputStream *stream = NULL;
+  GListModel *sequence;
+  GError *error = NULL;
+
+  /* From memory. */
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, data, length, &error);
+  g_assert_no_error (error);
+
+  sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (parser));
+  g_assert_cmpuint (g_list_model_get_n_items (sequence), ==, n_events);
+
+  g_object_unref (parser);
+
+  /* From a stream. */
+  parser = dfl_parser_new ();
+  stream = g_memory_input_stream_new_from_data (data, length, NULL);
+  dfl_parser_load_from_stream (parser, stream, NULL, &error);
+  g_assert_no_error (error);
+
+  sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (parser));
+  g_assert_cmpuint (g_list_model_get_n_items (sequence), ==, n_events);
+
+  g_object_unref (stream);
+  g_object_unref (parser);
+}
+
+/* Check that loading @data (from memory and from a stream) fails cleanly. */
+static void
+assert_loads_error (const guint8 *data,
+                    gsize         length)
+{
+  DflParser *parser = NULL;
+  GInputStream *stream = NULL;
+  GError *error = NULL;
+
+  /* From memory. */
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, data, length, &error);
+  g_assert_nonnull (error);
+  g_assert_null (dfl_parser_get_event_sequence (parser));
+  g_clear_error (&error);
+
+  g_object_unref (parser);
+
+  /* From a stream. */
+  parser = dfl_parser_new ();
+  stream = g_memory_input_stream_new_from_data (data, length, NULL);
+  dfl_parser_load_from_stream (parser, stream, NULL, &error);
+  g_assert_nonnull (error);
+  g_assert_null (dfl_parser_get_event_sequence (parser));
+  g_clear_error (&error);
+
+  g_object_unref (stream);
+  g_object_unref (parser);
+}
+
+/* Test that zstd-compressed logs round-trip, whether they are a single frame
+ * (decompressed as a stream) or multiple frames (decompressed in parallel). */
+static void
+test_parser_log_zstd (void)
+{
+  GString *log = NULL;
+  GBytes *compressed = NULL;
+  const guint8 *compressed_data;
+  gsize compressed_length;
+  guint n_events;
+
+  log = build_large_log (&n_events, 2000);
+
+  /* Single frame. */
+  compressed = zstd_compress (log->str, log->len, log->len);
+  compressed_data = g_bytes_get_data (compressed, &compressed_length);
+  assert_loads_n_events (compressed_data, compressed_length, n_events);
+  g_bytes_unref (compressed);
+
+  /* Multiple frames, which split lines between them. */
+  compressed = zstd_compress (log->str, log->len, log->len / 7 + 1);
+  compressed_data = g_bytes_get_data (compressed, &compressed_length);
+  assert_loads_n_events (compressed_data, compressed_length, n_events);
+  g_bytes_unref (compressed);
+
+  g_string_free (log, TRUE);
+}
+
+/* Test that truncated or corrupt zstd-compressed logs cause an error, rather
+ * than a crash. */
+static void
+test_parser_log_zstd_invalid (void)
+{
+  GString *log = NULL;
+  GBytes *compressed = NULL;
+  guint8 *corrupt_data = NULL;
+  gsize compressed_length, i;
+  guint n_events;
+
+  /* Two raw frames, each declaring (in single segment mode with an 8-byte
+   * content size) that they decompress to 1TiB, but containing only 4 bytes
+   * each. The declared sizes must not be trusted for allocation. */
+  const guint8 huge_frames[] = {
+    0x28, 0xb5, 0x2f, 0xfd, 0xe0,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x21, 0x00, 0x00, 'D', 'u', 'n', 'f',
+    0x28, 0xb5, 0x2f, 0xfd, 0xe0,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x21, 0x00, 0x00, 'e', 'l', 'l', ' ',
+  };
+
+  log = build_large_log (&n_events, 2000);
+
+  /* Truncated, both as a single frame and as multiple frames. */
+  compressed = zstd_compress (log->str, log->len, log->len);
+  compressed_length = g_bytes_get_size (compressed);
+  assert_loads_error (g_bytes_get_data (compressed, NULL),
+                      compressed_length / 2);
+  g_bytes_unref (compressed);
+
+  compressed = zstd_compress (log->str, log->len, log->len / 7 + 1);
+  compressed_length = g_bytes_get_size (compressed);
+  assert_loads_error (g_bytes_get_data (compressed, NULL),
+                      compressed_length - 1);
+
+  /* Corrupt a quarter of the data, spanning at least one frame header. */
+  corrupt_data = g_malloc (compressed_length);
+  memcpy (corrupt_data, g_bytes_get_data (compressed, NULL),
+          compressed_length);
+
+  for (i = compressed_length / 4; i < compressed_length / 2; i++)
+    corrupt_data[i] ^= 0x5a;
+
+  assert_loads_error (corrupt_data, compressed_length);
+
+  g_free (corrupt_data);
+  g_bytes_unref (compressed);
+
+  /* Frame headers declaring huge sizes. */
+  assert_loads_error (huge_frames, sizeof (huge_frames));
+
+  g_string_free (log, TRUE);
+}
+#endif
+
+/* Test that loading several logs with dfl_parser_load_from_files(), which
+ * moves their events into the merged sequence, gives the same events as
+ * merging separately loaded sequences, which copies them. */
+static void
+test_parser_files (void)
+{
+  const gchar *logs[] = {
+    "Dunfell log,1.0,100\n"
+    "g_main_context_new,101,1,10\n"
+    "g_main_context_acquire,103,1,10,1\n"
+    "g_source_set_name,105,1,20,server\n",
+    "Dunfell log,1.0,100\n"
+    "g_main_context_new,102,1,10\n"
+    "g_main_context_acquire,104,1,10,1\n"
+    "g_source_set_name,106,1,20,client\n",
+  };
+  gchar *filenames[G_N_ELEMENTS (logs) + 1] = { NULL, };
+  DflParser *parser = NULL, *parsers[G_N_ELEMENTS (logs)] = { NULL, };
+  DflEventSequence *sequences[G_N_ELEMENTS (logs)];
+  DflEventSequence *merged = NULL;
+  GListModel *taken;
+  gint fd;
+  guint i, j;
+  GError *error = NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (logs); i++)
+    {
+      fd = g_file_open_tmp ("dunfell-parser-XXXXXX.log", &filenames[i],
+                            &error);
+      g_assert_no_error (error);
+      close (fd);
+
+      g_file_set_contents (filenames[i], logs[i], -1, &error);
+      g_assert_no_error (error);
+
+      parsers[i] = dfl_parser_new ();
+      dfl_parser_load_from_data (parsers[i], (const guint8 *) logs[i],
+                                 strlen (logs[i]), &error);
+      g_assert_no_error (error);
+      sequences[i] = dfl_parser_get_event_sequence (parsers[i]);
+    }
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_files (parser, (const gchar * const *) filenames,
+                              &error);
+  g_assert_no_error (error);
+
+  taken = G_LIST_MODEL (dfl_parser_get_event_sequence (parser));
+  merged = dfl_event_sequence_new_merged (sequences, NULL,
+                                          G_N_ELEMENTS (sequences));
+
+  g_assert_cmpuint (g_list_model_get_n_items (taken), ==, 6);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (merged)), ==, 6);
+  g_assert_cmpuint (dfl_event_sequence_get_n_processes (DFL_EVENT_SEQUENCE (taken)),
+                    ==, 2);
+
+  for (i = 0; i < 6; i++)
+    {
+      DflEvent *taken_event = g_list_model_get_item (taken, i);
+      DflEvent *merged_event = g_list_model_get_item (G_LIST_MODEL (merged),
+                                                      i);
+
+      g_assert_cmpuint (dfl_event_get_timestamp (taken_event), ==, 101 + i);
+      g_assert_cmpstr (dfl_event_get_event_type (taken_event), ==,
+                       dfl_event_get_event_type (merged_event));
+      g_assert_cmpuint (dfl_event_get_process (taken_event), ==, i % 2);
+      g_assert_cmpuint (dfl_event_get_thread_id (taken_event), ==,
+                        dfl_event_get_thread_id (merged_event));
+      g_assert_cmpuint (dfl_event_get_parameter_id (taken_event, 0), ==,
+                        dfl_event_get_parameter_id (merged_event, 0));
+
+      g_object_unref (merged_event);
+      g_object_unref (taken_event);
+    }
+
+  /* The separately loaded sequences are unchanged. */
+  for (i = 0; i < G_N_ELEMENTS (sequences); i++)
+    {
+      g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sequences[i])),
+                        ==, 3);
+
+      for (j = 0; j < 3; j++)
+        {
+          DflEvent *event = g_list_model_get_item (G_LIST_MODEL (sequences[i]),
+                                                   j);
+
+          g_assert_cmpuint (dfl_event_get_process (event), ==, 0);
+          g_assert_cmpuint (dfl_event_get_parameter_id (event, 0), <, 100);
+          g_object_unref (event);
+        }
+    }
+
+  /* The merged events outlive the parser. */
+  g_object_ref (taken);
+  g_object_unref (parser);
+  g_assert_cmpuint (g_list_model_get_n_items (taken), ==, 6);
+  g_object_unref (taken);
+
+  g_object_unref (merged);
+
+  for (i = 0; i < G_N_ELEMENTS (logs); i++)
+    {
+      g_object_unref (parsers[i]);
+      g_unlink (filenames[i]);
+      g_free (filenames[i]);
+    }
+}
+
+/* Test that loading more logs than can be merged fails with an error, before
+ * trying to load any of them. */
+static void
+test_parser_files_too_many (void)
+{
+  DflParser *parser = NULL;
+  GPtrArray/*<owned filename>*/ *filenames = NULL;
+  guint i;
+  GError *error = NULL;
+
+  filenames = g_ptr_array_new_with_free_func (g_free);
+
+  for (i = 0; i < 257; i++)
+    g_ptr_array_add (filenames, g_strdup_printf ("nonexistent-%u.log", i));
+  g_ptr_array_add (filenames, NULL);
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_files (parser,
+                              (const gchar * const *) filenames->pdata,
+                              &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+  g_assert_null (dfl_parser_get_event_sequence (parser));
+  g_clear_error (&error);
+
+  g_object_unref (parser);
+  g_ptr_array_unref (filenames);
+}
+
+/* Benchmark parsing a log with the mix of event types which dunfell-record
+ * produces: most lines are of types the parser ignores. Run with `-m perf`. */
+static void
+test_parser_perf (void)
+{
+  const gchar *event_types[] = {
+    "g_main_context_before_prepare",
+    "g_main_context_after_prepare",
+    "g_main_context_before_query",
+    "g_main_context_after_query",
+    "g_main_context_before_check",
+    "g_main_context_after_check",
+    "g_main_context_wakeup",
+    "g_main_context_acquire",
+    "g_main_context_release",
+  };
+  const guint n_lines = 1000000;
+  DflParser *parser = NULL;
+  GString *log = NULL;
+  guint i;
+  gdouble elapsed;
+  GError *error = NULL;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Performance tests not enabled; use -m perf");
+      return;
+    }
+
+  log = g_string_new ("Dunfell log,1.0,100\n");
+
+  for (i = 0; i < n_lines; i++)
+    {
+      const gchar *event_type = event_types[i % G_N_ELEMENTS (event_types)];
+
+      if (g_str_equal (event_type, "g_main_context_release"))
+        g_string_append_printf (log, "%s,%u,8491,140407983871120\n",
+                                event_type, 1000 + i);
+      else
+        g_string_append_printf (log, "%s,%u,8491,140407983871120,1\n",
+                                event_type, 1000 + i);
+    }
+
+  parser = dfl_parser_new ();
+
+  g_test_timer_start ();
+  dfl_parser_load_from_data (parser, (const guint8 *) log->str, log->len,
+                             &error);
+  elapsed = g_test_timer_elapsed ();
+  g_assert_no_error (error);
+
+  g_test_minimized_result (elapsed * 1e9 / n_lines,
+                           "Parsed %u lines in %.3f s (%.1f ns per line)",
+                           n_lines, elapsed, elapsed * 1e9 / n_lines);
+
+  g_object_unref (parser);
+  g_string_free (log, TRUE);
+}
+
+static void
+events_added_cb (DflParser *parser,
+                 GPtrArray *events,
+                 gpointer   user_data)
+{
+  guint *n_events_added = user_data;
+
+  *n_events_added += events->len;
+}
+
+static void
+async_result_cb (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  GAsyncResult **result_out = user_data;
+
+  g_assert_null (*result_out);
+  *result_out = g_object_ref (result);
+}
+
+/* Test that tailing a stream without following it loads all the events, and
+ * reports them in batches. */
+static void
+test_parser_tail_stream (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,123\n"
+    "g_main_context_acquire,124,1,0,0\n"
+    "g_main_context_acquire,125,1,0,0";
+  DflParser *parser = NULL;
+  GInputStream *stream = NULL;
+  GAsyncResult *result = NULL;
+  DflEventSequence *sequence;
+  guint n_events_added = 0;
+  GError *error = NULL;
+
+  parser = dfl_parser_new ();
+  g_signal_connect (parser, "events-added", (GCallback) events_added_cb,
+                    &n_events_added);
+
+  stream = g_memory_input_stream_new_from_data (log, strlen (log), NULL);
+  dfl_parser_tail_stream_async (parser, stream, FALSE, NULL, async_result_cb,
+                                &result);
+
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  dfl_parser_tail_stream_finish (parser, result, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpuint (n_events_added, ==, 2);
+
+  sequence = dfl_parser_get_event_sequence (parser);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sequence)), ==, 2);
+
+  g_object_unref (result);
+  g_object_unref (stream);
+  g_object_unref (parser);
+}
+
+/* Test that following a file which is being appended to picks up new events,
+ * including lines which are written in several parts. */
+static void
+test_parser_tail_file (void)
+{
+  DflParser *parser = NULL;
+  GFile *file = NULL;
+  GFileInputStream *input_stream = NULL;
+  FILE *output = NULL;
+  GCancellable *cancellable = NULL;
+  GAsyncResult *result = NULL;
+  DflEventSequence *sequence;
+  DflEvent *event;
+  guint n_events_added = 0;
+  gchar *filename = NULL;
+  gint fd;
+  GError *error = NULL;
+
+  fd = g_file_open_tmp ("dunfell-parser-XXXXXX.log", &filename, &error);
+  g_assert_no_error (error);
+  output = fdopen (fd, "w");
+  g_assert_nonnull (output);
+
+  fputs ("Dunfell log,1.0,123\ng_main_context_acquire,124,1,0,0\n", output);
+  fflush (output);
+
+  file = g_file_new_for_path (filename);
+  input_stream = g_file_read (file, NULL, &error);
+  g_assert_no_error (error);
+
+  parser = dfl_parser_new ();
+  g_signal_connect (parser, "events-added", (GCallback) events_added_cb,
+                    &n_events_added);
+
+  cancellable = g_cancellable_new ();
+  dfl_parser_tail_stream_async (parser, G_INPUT_STREAM (input_stream), TRUE,
+                                cancellable, async_result_cb, &result);
+
+  while (n_events_added < 1)
+    g_main_context_iteration (NULL, TRUE);
+
+  sequence = dfl_parser_get_event_sequence (parser);
+  g_assert_nonnull (sequence);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sequence)), ==, 1);
+
+  /* Append a line in two parts. */
+  fputs ("g_main_context_acquire,12", output);
+  fflush (output);
+  fputs ("5,1,0,0\n", output);
+  fflush (output);
+
+  while (n_events_added < 2)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert (dfl_parser_get_event_sequence (parser) == sequence);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sequence)), ==, 2);
+  event = g_list_model_get_item (G_LIST_MODEL (sequence), 1);
+  g_assert_cmpuint (dfl_event_get_timestamp (event), ==, 125);
+  g_object_unref (event);
+
+  /* Stop tailing. */
+  g_cancellable_cancel (cancellable);
+
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  dfl_parser_tail_stream_finish (parser, result, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&error);
+
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sequence)), ==, 2);
+
+  g_object_unref (result);
+  g_object_unref (cancellable);
+  g_object_unref (parser);
+  g_object_unref (input_stream);
+  g_object_unref (file);
+  fclose (output);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -100,6 +1067,14 @@ main (int argc, char *argv[])
       "Dunfell log,1.0,123\n"
       "g_main_context_acquire,124,1,0,0\n"
       "nonexistent_event,125\n" },
+    { 2,
+      "Dunfell log,1.0,123\r\n"
+      "  g_main_context_acquire,124,1,140407983871120,1 \r\n"
+      "\tg_source_set_name,125,1,140407983871120,naïve source name\t\n" },
+    { 1,
+      "Dunfell log,1.0,123\n"
+      "g_source_new,1449749875412059,8491,140407983871120,12007776,"
+      "140408421089918,0x7fb36210027e,14614576,0\n" },
   };
 
   setlocale (LC_ALL, "");
@@ -107,6 +1082,21 @@ main (int argc, char *argv[])
   g_test_init (&argc, &argv, NULL);
 
   g_test_add_func ("/parser/construction", test_parser_construction);
+  g_test_add_func ("/parser/log/large", test_parser_log_large);
+  g_test_add_func ("/parser/log/large/non-monotonic",
+                   test_parser_log_large_non_monotonic);
+  g_test_add_func ("/parser/log/gzip", test_parser_log_gzip);
+#ifdef HAVE_ZSTD
+  g_test_add_func ("/parser/log/zstd", test_parser_log_zstd);
+  g_test_add_func ("/parser/log/zstd/invalid", test_parser_log_zstd_invalid);
+#endif
+  g_test_add_func ("/parser/filter", test_parser_filter);
+  g_test_add_func ("/parser/files", test_parser_files);
+  g_test_add_func ("/parser/files/too-many", test_parser_files_too_many);
+  g_test_add_func ("/parser/parameters", test_parser_parameters);
+  g_test_add_func ("/parser/perf", test_parser_perf);
+  g_test_add_func ("/parser/tail/stream", test_parser_tail_stream);
+  g_test_add_func ("/parser/tail/file", test_parser_tail_file);
 
   for (i = 0; i < G_N_ELEMENTS (test_vectors); i++)
     {
@@ -115,6 +1105,10 @@ main (int argc, char *argv[])
       test_name = g_strdup_printf ("/parser/log/%u", i);
       g_test_add_data_func (test_name, &test_vectors[i], test_parser_log);
       g_free (test_name);
+
+      test_name = g_strdup_printf ("/parser/log-file/%u", i);
+      g_test_add_data_func (test_name, &test_vectors[i], test_parser_log_file);
+      g_free (test_name);
     }
 
   return g_test_run ();
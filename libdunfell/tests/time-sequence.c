@@ -288,6 +288,386 @@ test_time_sequence_iter_multiple (void)
     }
 }
 
+/* Test that iterators start at the first of a run of elements with the same
+ * timestamp, for sequences long enough to use the search accelerator, and
+ * while elements are appended between searches. */
+static void
+test_time_sequence_iter_bursts (void)
+{
+  g_auto (DflTimeSequence) sequence;
+  DflTimeSequenceIter iter;
+  DflTimestamp timestamps[1000];
+  gsize i, j;
+
+  dfl_time_sequence_init (&sequence, sizeof (guint), NULL, 0);
+
+  for (i = 0; i < G_N_ELEMENTS (timestamps); i++)
+    {
+      guint *data;
+
+      /* Long runs of identical timestamps, then short ones. */
+      if (i == 0)
+        timestamps[i] = 10;
+      else if (i % 97 == 0 || (i > 500 && i % 5 == 0))
+        timestamps[i] = timestamps[i - 1] + 10;
+      else
+        timestamps[i] = timestamps[i - 1];
+
+      data = dfl_time_sequence_append (&sequence, timestamps[i]);
+      *data = (guint) i;
+
+      /* Search every so often, so the search accelerator is built and then
+       * goes stale. */
+      if (i % 37 != 0)
+        continue;
+
+      for (j = 0; j <= i; j++)
+        {
+          DflTimestamp start = timestamps[j] + (j % 3) - 1;
+          DflTimestamp timestamp;
+          gsize expected_index;
+          guint *found;
+
+          g_test_message ("i: %" G_GSIZE_FORMAT ", j: %" G_GSIZE_FORMAT,
+                          i, j);
+
+          /* Brute force the first element of the last run ≤ @start. */
+          expected_index = i + 1;
+
+          while (expected_index > 0 &&
+                 timestamps[expected_index - 1] > start)
+            expected_index--;
+
+          if (expected_index == 0)
+            continue;
+
+          expected_index--;
+
+          while (expected_index > 0 &&
+                 timestamps[expected_index - 1] == timestamps[expected_index])
+            expected_index--;
+
+          dfl_time_sequence_iter_init (&iter, &sequence, start);
+
+          g_assert_true (dfl_time_sequence_iter_next (&iter, &timestamp,
+                                                      (gpointer *) &found));
+          g_assert_cmpuint (timestamp, ==, timestamps[expected_index]);
+          g_assert_cmpuint (*found, ==, expected_index);
+        }
+    }
+}
+
+/* Test that element addresses are stable across appends, across several
+ * storage blocks, and that preallocation works. */
+static void
+test_time_sequence_stable (void)
+{
+  g_auto (DflTimeSequence) sequence;
+  DflTimeSequenceIter iter;
+  const gsize n_elements = 40000;  /* spans several full-sized blocks */
+  guint **elements;
+  gsize i;
+
+  elements = g_new (guint *, n_elements);
+  dfl_time_sequence_init (&sequence, sizeof (guint), NULL, 20);
+
+  for (i = 0; i < n_elements; i++)
+    {
+      elements[i] = dfl_time_sequence_append (&sequence, i);
+      g_assert_nonnull (elements[i]);
+      *elements[i] = (guint) i;
+    }
+
+  dfl_time_sequence_iter_init (&iter, &sequence, 0);
+
+  for (i = 0; i < n_elements; i++)
+    {
+      DflTimestamp timestamp;
+      guint *data;
+
+      g_assert_true (dfl_time_sequence_iter_next (&iter, &timestamp,
+                                                  (gpointer *) &data));
+      g_assert_cmpuint (timestamp, ==, i);
+      g_assert (data == elements[i]);
+      g_assert_cmpuint (*data, ==, i);
+    }
+
+  g_assert_false (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+
+  g_free (elements);
+}
+
+/* Test range aggregates against a brute-force calculation, while elements are
+ * appended between queries. */
+static void
+test_time_sequence_aggregate (void)
+{
+  g_auto (DflTimeSequence) sequence;
+  DflTimeSequenceAggregate aggregate;
+  gint64 values[3000];
+  gsize i, j;
+
+  dfl_time_sequence_init (&sequence, 2 * sizeof (gint64), NULL, 0);
+  dfl_time_sequence_add_aggregate (&sequence, sizeof (gint64));
+
+  /* Empty sequence. */
+  g_assert_false (dfl_time_sequence_get_aggregate (&sequence, sizeof (gint64),
+                                                   0, G_MAXUINT64,
+                                                   &aggregate));
+  g_assert_cmpuint (aggregate.count, ==, 0);
+
+  for (i = 0; i < G_N_ELEMENTS (values); i++)
+    {
+      gint64 *data;
+
+      /* Every tenth value is unknown. Timestamps are 10 × the index. */
+      values[i] = (i % 10 == 3) ? -1 : (gint64) ((i * 7919) % 1000);
+
+      data = dfl_time_sequence_append (&sequence, i * 10);
+      data[0] = G_MAXINT64;  /* not aggregated */
+      data[1] = values[i];
+
+      if (i % 499 != 0)
+        continue;
+
+      for (j = 0; j < 50; j++)
+        {
+          gsize start = g_test_rand_int_range (0, i + 1);
+          gsize end = g_test_rand_int_range (start, i + 2);
+          DflTimeSequenceAggregate expected = { 0, };
+          gsize k;
+
+          for (k = start; k < end; k++)
+            {
+              if (values[k] < 0)
+                continue;
+
+              expected.min = (expected.count == 0) ? values[k] :
+                             MIN (expected.min, values[k]);
+              expected.max = (expected.count == 0) ? values[k] :
+                             MAX (expected.max, values[k]);
+              expected.count++;
+              expected.sum += values[k];
+            }
+
+          g_test_message ("[%" G_GSIZE_FORMAT ", %" G_GSIZE_FORMAT ")",
+                          start, end);
+
+          /* Timestamps between elements round up to the next element. */
+          g_assert_cmpint (dfl_time_sequence_get_aggregate (&sequence,
+                                                            sizeof (gint64),
+                                                            start * 10 - (start > 0),
+                                                            end * 10 - (end > 0),
+                                                            &aggregate),
+                           ==, expected.count > 0);
+          g_assert_cmpuint (aggregate.count, ==, expected.count);
+          g_assert_cmpint (aggregate.sum, ==, expected.sum);
+          g_assert_cmpint (aggregate.min, ==, expected.min);
+          g_assert_cmpint (aggregate.max, ==, expected.max);
+        }
+    }
+}
+
+/* Test that payload changes to elements which have already been summarised
+ * are picked up by aggregate queries once they are invalidated. */
+static void
+test_time_sequence_aggregate_invalidate (void)
+{
+  g_auto (DflTimeSequence) sequence;
+  DflTimeSequenceAggregate aggregate;
+  DflTimeSequenceIter iter;
+  gint64 *data, *last_data = NULL;
+  gsize i;
+
+  dfl_time_sequence_init (&sequence, sizeof (gint64), NULL, 0);
+  dfl_time_sequence_add_aggregate (&sequence, 0);
+
+  /* Enough elements for several levels of summary nodes; the last one's value
+   * is not known yet. */
+  for (i = 0; i < 1000; i++)
+    {
+      data = dfl_time_sequence_append (&sequence, i);
+      *data = (i < 999) ? 1 : -1;
+      last_data = data;
+    }
+
+  g_assert_true (dfl_time_sequence_get_aggregate (&sequence, 0, 0, G_MAXUINT64,
+                                                  &aggregate));
+  g_assert_cmpuint (aggregate.count, ==, 999);
+  g_assert_cmpint (aggregate.sum, ==, 999);
+
+  /* Fill in the last value, as when a span ends. */
+  *last_data = 5;
+  dfl_time_sequence_invalidate_aggregates (&sequence, 999);
+
+  g_assert_true (dfl_time_sequence_get_aggregate (&sequence, 0, 0, G_MAXUINT64,
+                                                  &aggregate));
+  g_assert_cmpuint (aggregate.count, ==, 1000);
+  g_assert_cmpint (aggregate.sum, ==, 1004);
+  g_assert_cmpint (aggregate.max, ==, 5);
+
+  /* Change an early value. */
+  dfl_time_sequence_iter_init (&iter, &sequence, 10);
+  g_assert_true (dfl_time_sequence_iter_next (&iter, NULL, (gpointer *) &data));
+  *data = 100;
+  dfl_time_sequence_invalidate_aggregates (&sequence, 10);
+
+  g_assert_true (dfl_time_sequence_get_aggregate (&sequence, 0, 0, 500,
+                                                  &aggregate));
+  g_assert_cmpuint (aggregate.count, ==, 500);
+  g_assert_cmpint (aggregate.sum, ==, 599);
+  g_assert_cmpint (aggregate.max, ==, 100);
+}
+
+/* Test overlap queries on an interval index against a brute-force search. */
+static void
+test_time_sequence_overlapping (void)
+{
+  g_auto (DflTimeSequence) sequence;
+  DflTimestamp timestamps[2000];
+  DflDuration durations[G_N_ELEMENTS (timestamps)];
+  gsize i, j;
+
+  dfl_time_sequence_init (&sequence, sizeof (DflDuration), NULL, 0);
+  dfl_time_sequence_add_interval_index (&sequence, 0);
+
+  for (i = 0; i < G_N_ELEMENTS (timestamps); i++)
+    {
+      DflDuration *data;
+
+      /* Mostly short intervals, with a few long ones and some unknown. */
+      timestamps[i] = (i > 0) ? timestamps[i - 1] + (i * 7) % 5 : 0;
+
+      if (i % 97 == 0)
+        durations[i] = 2000;
+      else if (i % 13 == 0)
+        durations[i] = -1;
+      else
+        durations[i] = (i * 31) % 20;
+
+      data = dfl_time_sequence_append (&sequence, timestamps[i]);
+      *data = durations[i];
+    }
+
+  for (j = 0; j < 200; j++)
+    {
+      DflTimeSequenceIter iter;
+      DflTimestamp start, end, timestamp;
+      DflDuration *data;
+      gsize k;
+
+      start = g_test_rand_int_range (0, timestamps[G_N_ELEMENTS (timestamps) - 1] + 10);
+      end = start + g_test_rand_int_range (1, 50);
+
+      g_test_message ("[%" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ")",
+                      start, end);
+
+      dfl_time_sequence_iter_init (&iter, &sequence, 0);
+
+      for (k = 0; k < G_N_ELEMENTS (timestamps); k++)
+        {
+          DflTimestamp element_end;
+
+          element_end = timestamps[k] + MAX (durations[k], 0);
+
+          if (timestamps[k] >= end ||
+              (timestamps[k] < start && element_end <= start))
+            continue;
+
+          g_assert_true (dfl_time_sequence_iter_next_overlapping (&iter, 0,
+                                                                  start, end,
+                                                                  &timestamp,
+                                                                  (gpointer *) &data));
+          g_assert_cmpuint (timestamp, ==, timestamps[k]);
+          g_assert_cmpint (*data, ==, durations[k]);
+          g_assert (dfl_time_sequence_iter_get_data (&iter) == data);
+        }
+
+      g_assert_false (dfl_time_sequence_iter_next_overlapping (&iter, 0,
+                                                               start, end,
+                                                               NULL, NULL));
+    }
+}
+
+/* Test ranged iteration and fetching elements in bulk. */
+static void
+test_time_sequence_iter_range (void)
+{
+  g_auto (DflTimeSequence) sequence;
+  DflTimeSequenceIter iter;
+  DflTimestamp timestamps[100];
+  guint data[100];
+  DflTimestamp timestamp;
+  guint *element;
+  gsize i, n_fetched;
+
+  /* Timestamps 0, 0, 10, 10, 20, 20, … 49990, 49990. */
+  dfl_time_sequence_init (&sequence, sizeof (guint), NULL, 0);
+
+  for (i = 0; i < 10000; i++)
+    {
+      element = dfl_time_sequence_append (&sequence, (i / 2) * 10);
+      *element = (guint) i;
+    }
+
+  /* A range excludes the element before @start, unlike
+   * dfl_time_sequence_iter_init(). */
+  dfl_time_sequence_iter_init_range (&iter, &sequence, 15, 35);
+
+  g_assert_true (dfl_time_sequence_iter_next (&iter, &timestamp,
+                                              (gpointer *) &element));
+  g_assert_cmpuint (timestamp, ==, 20);
+  g_assert_cmpuint (*element, ==, 4);
+  g_assert_true (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+  g_assert_true (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+  g_assert_true (dfl_time_sequence_iter_next (&iter, &timestamp, NULL));
+  g_assert_cmpuint (timestamp, ==, 30);
+  g_assert_false (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+
+  for (i = 0; i < 4; i++)
+    g_assert_true (dfl_time_sequence_iter_previous (&iter, NULL, NULL));
+  g_assert_false (dfl_time_sequence_iter_previous (&iter, NULL, NULL));
+
+  /* Empty ranges. */
+  dfl_time_sequence_iter_init_range (&iter, &sequence, 11, 19);
+  g_assert_false (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+  dfl_time_sequence_iter_init_range (&iter, &sequence, 30, 30);
+  g_assert_false (dfl_time_sequence_iter_next (&iter, NULL, NULL));
+
+  /* Fetch in bulk across several storage blocks, with a partial final
+   * fetch. */
+  dfl_time_sequence_iter_init_range (&iter, &sequence, 10, 49990);
+
+  for (i = 2; i < 9998; i += n_fetched)
+    {
+      gsize j;
+
+      n_fetched = dfl_time_sequence_iter_next_n (&iter, G_N_ELEMENTS (data),
+                                                 timestamps, data);
+      g_assert_cmpuint (n_fetched, ==, MIN (G_N_ELEMENTS (data), 9998 - i));
+
+      for (j = 0; j < n_fetched; j++)
+        {
+          g_assert_cmpuint (timestamps[j], ==, ((i + j) / 2) * 10);
+          g_assert_cmpuint (data[j], ==, i + j);
+        }
+
+      g_assert_cmpuint (dfl_time_sequence_iter_get_timestamp (&iter), ==,
+                        timestamps[n_fetched - 1]);
+    }
+
+  g_assert_cmpuint (dfl_time_sequence_iter_next_n (&iter, G_N_ELEMENTS (data),
+                                                   NULL, NULL), ==, 0);
+  g_assert_null (dfl_time_sequence_iter_get_data (&iter));
+
+  /* Unranged iterators can be fetched from too. */
+  dfl_time_sequence_iter_init (&iter, &sequence, 49990);
+  g_assert_cmpuint (dfl_time_sequence_iter_next_n (&iter, G_N_ELEMENTS (data),
+                                                   NULL, data), ==, 2);
+  g_assert_cmpuint (data[0], ==, 9998);
+  g_assert_cmpuint (data[1], ==, 9999);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -301,8 +681,17 @@ main (int argc, char *argv[])
   g_test_add_func ("/time-sequence/iter/single",
                    test_time_sequence_iter_single);
   g_test_add_func ("/time-sequence/multiple", test_time_sequence_multiple);
+  g_test_add_func ("/time-sequence/stable", test_time_sequence_stable);
   g_test_add_func ("/time-sequence/iter/multiple",
                    test_time_sequence_iter_multiple);
+  g_test_add_func ("/time-sequence/iter/bursts",
+                   test_time_sequence_iter_bursts);
+  g_test_add_func ("/time-sequence/iter/range", test_time_sequence_iter_range);
+  g_test_add_func ("/time-sequence/aggregate", test_time_sequence_aggregate);
+  g_test_add_func ("/time-sequence/aggregate/invalidate",
+                   test_time_sequence_aggregate_invalidate);
+  g_test_add_func ("/time-sequence/overlapping",
+                   test_time_sequence_overlapping);
 
   return g_test_run ();
 }
@@ -0,0 +1,228 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <locale.h>
+#include <string.h>
+
+#include "event.h"
+#include "parser.h"
+#include "writer.h"
+
+
+/* Test that writing a text log out as a binary log, and loading it again,
+ * gives the same events. */
+static void
+test_writer_round_trip (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,123\n"
+    "g_main_context_acquire,124,1,140407983871120,1\n"
+    "g_thread_spawned,125,2,140407983871120,0,worker thread\n"
+    "g_source_set_name,126,1,12007776,worker thread\n"
+    "g_source_set_name,127,2,12007777,0x7fb36210027e\n"
+    "g_main_context_release,128,1,18446744073709551615\n";
+  DflParser *text_parser = NULL, *binary_parser = NULL;
+  DflWriter *writer = NULL;
+  GOutputStream *stream = NULL;
+  GListModel *text_sequence, *binary_sequence;
+  DflEvent *event = NULL;
+  const guint8 *data;
+  gsize length;
+  guint i, n_events;
+  GError *error = NULL;
+
+  text_parser = dfl_parser_new ();
+  dfl_parser_load_from_data (text_parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+
+  text_sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (text_parser));
+  n_events = g_list_model_get_n_items (text_sequence);
+  g_assert_cmpuint (n_events, ==, 5);
+
+  /* Write it out. */
+  stream = g_memory_output_stream_new_resizable ();
+  writer = dfl_writer_new (stream, 123);
+  dfl_writer_write_event_sequence (writer,
+                                   DFL_EVENT_SEQUENCE (text_sequence),
+                                   NULL, &error);
+  g_assert_no_error (error);
+
+  data = g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (stream));
+  length = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream));
+  g_assert_cmpuint (length, >, 0);
+
+  /* Load it again. */
+  binary_parser = dfl_parser_new ();
+  dfl_parser_load_from_data (binary_parser, data, length, &error);
+  g_assert_no_error (error);
+
+  binary_sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (binary_parser));
+  g_assert_cmpuint (g_list_model_get_n_items (binary_sequence), ==, n_events);
+
+  for (i = 0; i < n_events; i++)
+    {
+      DflEvent *text_event = NULL, *binary_event = NULL;
+      gchar **text_parameters = NULL, **binary_parameters = NULL;
+      guint j;
+
+      text_event = g_list_model_get_item (text_sequence, i);
+      binary_event = g_list_model_get_item (binary_sequence, i);
+
+      g_assert (dfl_event_get_event_type (text_event) ==
+                dfl_event_get_event_type (binary_event));
+      g_assert_cmpuint (dfl_event_get_timestamp (text_event), ==,
+                        dfl_event_get_timestamp (binary_event));
+      g_assert_cmpuint (dfl_event_get_thread_id (text_event), ==,
+                        dfl_event_get_thread_id (binary_event));
+
+      g_object_get (text_event, "parameters", &text_parameters, NULL);
+      g_object_get (binary_event, "parameters", &binary_parameters, NULL);
+
+      g_assert_cmpuint (g_strv_length (text_parameters), ==,
+                        g_strv_length (binary_parameters));
+
+      for (j = 0; text_parameters[j] != NULL; j++)
+        g_assert_cmpstr (text_parameters[j], ==, binary_parameters[j]);
+
+      g_strfreev (binary_parameters);
+      g_strfreev (text_parameters);
+      g_object_unref (binary_event);
+      g_object_unref (text_event);
+    }
+
+  /* IDs are loaded as IDs, and strings from the string table (which are shared
+   * between events) stay valid for as long as the event does. */
+  event = g_list_model_get_item (binary_sequence, 2);
+  g_assert_cmpuint (dfl_event_get_parameter_id (event, 0), ==, 12007776);
+  g_object_unref (binary_parser);
+  g_assert_cmpstr (dfl_event_get_parameter_utf8 (event, 1), ==,
+                   "worker thread");
+  g_object_unref (event);
+
+  g_object_unref (writer);
+  g_object_unref (stream);
+  g_object_unref (text_parser);
+}
+
+/* Test that a truncated binary log is rejected. */
+static void
+test_writer_truncated (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,123\n"
+    "g_main_context_acquire,124,1,140407983871120,1\n";
+  DflParser *parser = NULL;
+  DflWriter *writer = NULL;
+  GOutputStream *stream = NULL;
+  const guint8 *data;
+  gsize length;
+  GError *error = NULL;
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+
+  stream = g_memory_output_stream_new_resizable ();
+  writer = dfl_writer_new (stream, 123);
+  dfl_writer_write_event_sequence (writer,
+                                   dfl_parser_get_event_sequence (parser),
+                                   NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (parser);
+
+  data = g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (stream));
+  length = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream));
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, data, length - 1, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN);
+  g_assert_null (dfl_parser_get_event_sequence (parser));
+  g_clear_error (&error);
+
+  g_object_unref (parser);
+  g_object_unref (writer);
+  g_object_unref (stream);
+}
+
+/* Test that once writing to the stream has failed, all further writes fail,
+ * rather than producing a log which refers to lost string records. */
+static void
+test_writer_failed (void)
+{
+  const gchar *log =
+    "Dunfell log,1.0,123\n"
+    "g_source_set_name,126,1,12007776,worker thread\n";
+  DflParser *parser = NULL;
+  DflWriter *writer = NULL;
+  GOutputStream *stream = NULL;
+  GListModel *sequence;
+  DflEvent *event = NULL;
+  guint8 buffer[32];
+  GError *error = NULL;
+
+  parser = dfl_parser_new ();
+  dfl_parser_load_from_data (parser, (const guint8 *) log, strlen (log),
+                             &error);
+  g_assert_no_error (error);
+
+  sequence = G_LIST_MODEL (dfl_parser_get_event_sequence (parser));
+  event = g_list_model_get_item (sequence, 0);
+
+  /* A fixed-size stream which is too small for the header and the first
+   * event. */
+  stream = g_memory_output_stream_new (buffer, sizeof (buffer), NULL, NULL);
+  writer = dfl_writer_new (stream, 123);
+
+  dfl_writer_write_event (writer, event, NULL, &error);
+  g_assert_no_error (error);
+  dfl_writer_flush (writer, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE);
+  g_clear_error (&error);
+
+  /* The writer has now failed, even though the buffer is empty. */
+  dfl_writer_write_event (writer, event, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE);
+  g_clear_error (&error);
+
+  dfl_writer_flush (writer, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE);
+  g_clear_error (&error);
+
+  g_object_unref (event);
+  g_object_unref (writer);
+  g_object_unref (stream);
+  g_object_unref (parser);
+}
+
+int
+main (int argc, char *argv[])
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/writer/round-trip", test_writer_round_trip);
+  g_test_add_func ("/writer/truncated", test_writer_truncated);
+  g_test_add_func ("/writer/failed", test_writer_failed);
+
+  return g_test_run ();
+}
@@ -34,8 +34,10 @@
 #include <gio/gio.h>
 #include <string.h>
 
+#include "atom-table.h"
 #include "event.h"
 #include "event-sequence.h"
+#include "model-cache-private.h"
 #include "thread.h"
 #include "time-sequence.h"
 
@@ -52,7 +54,10 @@ struct _DflThread
   DflTimestamp new_timestamp;
   DflTimestamp free_timestamp;
 
-  gchar *name;  /* owned; nullable */
+  /* Interns @name; shared with the other objects from the same event
+   * sequence, if the thread was built from one. */
+  DflAtomTable *atom_table;  /* owned; nullable */
+  DflAtom name;
 };
 
 G_DEFINE_TYPE (DflThread, dfl_thread, G_TYPE_OBJECT)
@@ -76,11 +81,31 @@ dfl_thread_finalize (GObject *object)
 {
   DflThread *self = DFL_THREAD (object);
 
-  g_free (self->name);
+  g_clear_object (&self->atom_table);
 
   G_OBJECT_CLASS (dfl_thread_parent_class)->finalize (object);
 }
 
+static DflThread *
+thread_new (DflThreadId   id,
+            DflTimestamp  new_timestamp,
+            DflAtomTable *atom_table,
+            DflAtom       name)
+{
+  DflThread *thread = NULL;
+
+  thread = g_object_new (DFL_TYPE_THREAD, NULL);
+
+  /* TODO: Use properties properly. */
+  thread->id = id;
+  thread->new_timestamp = new_timestamp;
+  thread->free_timestamp = new_timestamp;
+  thread->atom_table = (atom_table != NULL) ? g_object_ref (atom_table) : NULL;
+  thread->name = name;
+
+  return thread;
+}
+
 /**
  * dfl_thread_new:
  * @id: TODO
@@ -98,17 +123,16 @@ dfl_thread_new (DflThreadId   id,
                 DflTimestamp  new_timestamp,
                 const gchar  *name)
 {
-  DflThread *thread = NULL;
+  g_autoptr (DflAtomTable) atom_table = NULL;
+  DflAtom name_atom = DFL_ATOM_INVALID;
 
-  thread = g_object_new (DFL_TYPE_THREAD, NULL);
-
-  /* TODO: Use properties properly. */
-  thread->id = id;
-  thread->new_timestamp = new_timestamp;
-  thread->free_timestamp = new_timestamp;
-  thread->name = g_strdup (name);
+  if (name != NULL)
+    {
+      atom_table = dfl_atom_table_new ();
+      name_atom = dfl_atom_table_intern (atom_table, name);
+    }
 
-  return thread;
+  return thread_new (id, new_timestamp, atom_table, name_atom);
 }
 
 static void
@@ -120,7 +144,8 @@ event_cb (DflEventSequence *sequence,
   DflThread *thread = NULL;
   DflThreadId thread_id;
   guint i;
-  const gchar *name = NULL;
+  DflAtomTable *atom_table;
+  DflAtom name = DFL_ATOM_INVALID;
 
   thread_id = dfl_event_get_thread_id (event);
 
@@ -139,11 +164,21 @@ event_cb (DflEventSequence *sequence,
 
   /* We can know the thread’s nickname if it was detected from a
    * g_thread_spawned event. */
+  atom_table = dfl_event_sequence_get_atom_table (sequence);
+
   if (dfl_event_get_event_type (event) ==
       g_intern_static_string ("g_thread_spawned"))
-    name = dfl_event_get_parameter_utf8 (event, 2);
+    {
+      gchar buffer[DFL_EVENT_PARAMETER_BUFFER_SIZE];
+      const gchar *parameter;
 
-  thread = dfl_thread_new (thread_id, dfl_event_get_timestamp (event), name);
+      parameter = dfl_event_format_parameter (event, 2, buffer,
+                                              sizeof (buffer));
+      name = dfl_atom_table_intern (atom_table, parameter);
+    }
+
+  thread = thread_new (thread_id, dfl_event_get_timestamp (event),
+                       atom_table, name);
   g_ptr_array_add (threads, thread);  /* transfer */
 }
 
@@ -170,6 +205,43 @@ dfl_thread_factory_from_event_sequence (DflEventSequence *sequence)
   return threads;
 }
 
+/* Serialise @self to a model cache. See model-cache-private.h. */
+void
+_dfl_thread_save_cache (DflThread           *self,
+                        DflModelCacheWriter *writer)
+{
+  _dfl_model_cache_writer_add_uint64 (writer, self->id);
+  _dfl_model_cache_writer_add_uint64 (writer, self->new_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->free_timestamp);
+  _dfl_model_cache_writer_add_uint64 (writer, self->name);
+}
+
+DflThread *
+_dfl_thread_load_cache (DflModelCacheReader *reader,
+                        DflAtomTable        *atom_table)
+{
+  DflThread *thread = NULL;
+  DflThreadId id;
+  DflTimestamp new_timestamp, free_timestamp;
+  DflAtom name;
+
+  id = _dfl_model_cache_reader_read_uint64 (reader);
+  new_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+  free_timestamp = _dfl_model_cache_reader_read_uint64 (reader);
+  name = _dfl_model_cache_reader_read_atom (reader, atom_table);
+
+  if (reader->invalid || free_timestamp < new_timestamp)
+    {
+      reader->invalid = TRUE;
+      return NULL;
+    }
+
+  thread = thread_new (id, new_timestamp, atom_table, name);
+  thread->free_timestamp = free_timestamp;
+
+  return thread;
+}
+
 /**
  * dfl_thread_get_id:
  * @self: a #DflThread
@@ -201,7 +273,10 @@ dfl_thread_get_name (DflThread *self)
 {
   g_return_val_if_fail (DFL_IS_THREAD (self), NULL);
 
-  return self->name;
+  if (self->atom_table == NULL)
+    return NULL;
+
+  return dfl_atom_table_lookup (self->atom_table, self->name);
 }
 
 /**
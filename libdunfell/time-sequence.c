@@ -24,6 +24,13 @@
  *
  * TODO
  *
+ * A #DflTimeSequence is not thread safe, even for readers: lookups and
+ * queries lazily build and extend the sequence’s search accelerator and any
+ * aggregates or interval indexes (see dfl_time_sequence_add_aggregate()), so
+ * concurrent reads of the same sequence from several threads must be
+ * serialised by the caller. Only the elements themselves are left untouched by
+ * reads.
+ *
  * Since: 0.1.0
  */
 
@@ -31,7 +38,9 @@
 
 #include <errno.h>
 #include <glib.h>
+#include <string.h>
 
+#include "model-cache-private.h"
 #include "time-sequence.h"
 
 
@@ -41,10 +50,52 @@ typedef struct
   guint8 data[];
 } DflTimeSequenceElement;
 
+/* Search accelerator for dfl_time_sequence_find_timestamp(). This is a dense
+ * copy of the timestamps of the first @n_elements elements of the sequence,
+ * in Eytzinger (breadth-first binary tree) order, so that the first few levels
+ * of every search share a handful of cache lines and the search loop can be
+ * branchless. @keys and @indices are 1-based; @indices maps each entry of
+ * @keys back to its element index. Elements appended since the accelerator
+ * was built are searched directly. */
+typedef struct
+{
+  gsize n_elements;
+  DflTimestamp *keys;  /* (array length=n_elements + 1) */
+  gsize *indices;  /* (array length=n_elements + 1) */
+} DflTimeSequenceSearch;
+
+/* Sequences shorter than this are searched directly; building an accelerator
+ * for them is not worth it. */
+#define SEARCH_MIN_ELEMENTS 64
+
+/* Summary pyramid for one #gint64 field of the element payloads, used by
+ * dfl_time_sequence_get_aggregate(). Each node on level L summarises
+ * 2^((L + 1) * AGGREGATE_FANOUT_SHIFT) consecutive elements (apart from the
+ * last node on each level, which may be partial). Levels are added until the
+ * top one has a single node.
+ *
+ * If @interval is set, the field is a #DflDuration, and the value summarised
+ * is the end timestamp of each element (its timestamp plus the duration, or
+ * just its timestamp if the duration is unknown). The maximum end timestamp
+ * of each node is then used as an interval index by
+ * dfl_time_sequence_iter_next_overlapping(). */
+typedef struct
+{
+  gsize field_offset;
+  gboolean interval;
+  gsize n_elements;  /* number of elements summarised */
+  GPtrArray *levels;  /* (element-type GArray<DflTimeSequenceAggregate>) (owned) */
+} DflTimeSequenceAggregator;
+
+#define AGGREGATE_FANOUT_SHIFT 4
+#define AGGREGATE_FANOUT (1 << AGGREGATE_FANOUT_SHIFT)
+
 typedef struct
 {
   DflTimeSequence *sequence;
   gsize index;
+  gsize start_index;  /* lower bound on @index for ranged iterators, or 0 */
+  gsize end_index;  /* upper bound on @index for ranged iterators, or G_MAXSIZE */
   DflTimeSequenceElement *last_returned_element;  /* (nullable) (ownership none) */
 } DflTimeSequenceIterReal;
 
@@ -59,12 +110,141 @@ typedef struct
   gsize element_size;  /* does not include sizeof(DflTimeSequenceElement); in bytes */
   GDestroyNotify element_destroy_notify;
   gsize n_elements_valid;
-  gsize n_elements_allocated;
-  gpointer *elements;  /* actually DflTimeSequenceElement+element_size */
+  gsize n_elements_allocated;  /* always the end of a block */
+  guint8 **blocks;  /* (array length=n_blocks) (owned); each block is an array of DflTimeSequenceElement+element_size */
+  DflTimeSequenceSearch *search;  /* (nullable) (owned) */
+  GPtrArray *aggregators;  /* (nullable) (owned) (element-type DflTimeSequenceAggregator) */
+  GMappedFile *mapped_file;  /* (nullable) (owned); model cache which some blocks point into */
 } DflTimeSequenceReal;
 
 G_STATIC_ASSERT (sizeof (DflTimeSequenceReal) == sizeof (DflTimeSequence));
 
+/* Elements are stored in a list of blocks, which are never reallocated, so
+ * appending never copies existing elements and element addresses are stable.
+ * The first block holds 2^BLOCK_MIN_SHIFT elements, and each subsequent block
+ * doubles in size until they reach 2^BLOCK_MAX_SHIFT elements; all later
+ * blocks are that size. That keeps short sequences (of which there are many)
+ * small, while long sequences are split into fixed-size blocks. The block
+ * directory is grown by doubling, but only holds pointers.
+ *
+ * The block holding a given index, and the index's offset in it, can be
+ * calculated in O(1). */
+#define BLOCK_MIN_SHIFT 4
+#define BLOCK_MAX_SHIFT 14
+
+static inline gsize
+block_get_n_elements (gsize block)
+{
+  if (block == 0)
+    return (gsize) 1 << BLOCK_MIN_SHIFT;
+  else if (block <= BLOCK_MAX_SHIFT - BLOCK_MIN_SHIFT + 1)
+    return (gsize) 1 << (block + BLOCK_MIN_SHIFT - 1);
+  else
+    return (gsize) 1 << BLOCK_MAX_SHIFT;
+}
+
+static inline gsize
+block_for_index (gsize  index,
+                 gsize *offset)
+{
+  if (index < ((gsize) 1 << BLOCK_MIN_SHIFT))
+    {
+      *offset = index;
+      return 0;
+    }
+  else if (index < ((gsize) 1 << BLOCK_MAX_SHIFT))
+    {
+      guint msb = g_bit_storage (index) - 1;
+
+      *offset = index - ((gsize) 1 << msb);
+      return msb - BLOCK_MIN_SHIFT + 1;
+    }
+  else
+    {
+      *offset = index & (((gsize) 1 << BLOCK_MAX_SHIFT) - 1);
+      return (index >> BLOCK_MAX_SHIFT) + (BLOCK_MAX_SHIFT - BLOCK_MIN_SHIFT);
+    }
+}
+
+static gsize
+dfl_time_sequence_get_n_blocks (DflTimeSequence *sequence)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  gsize offset;
+
+  if (self->n_elements_allocated == 0)
+    return 0;
+
+  return block_for_index (self->n_elements_allocated - 1, &offset) + 1;
+}
+
+/* Whether @block points into the sequence’s mapped model cache, rather than
+ * being owned by the sequence. See _dfl_time_sequence_load_cache(). */
+static gboolean
+dfl_time_sequence_block_is_borrowed (DflTimeSequence *sequence,
+                                     gsize            block)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  guintptr start, address;
+
+  if (self->mapped_file == NULL)
+    return FALSE;
+
+  start = (guintptr) g_mapped_file_get_contents (self->mapped_file);
+  address = (guintptr) self->blocks[block];
+
+  return (address >= start &&
+          address - start < g_mapped_file_get_length (self->mapped_file));
+}
+
+/* Free all the blocks of @sequence which it owns, and its block directory. */
+static void
+dfl_time_sequence_free_blocks (DflTimeSequence *sequence)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  gsize i, n_blocks;
+
+  n_blocks = dfl_time_sequence_get_n_blocks (sequence);
+
+  for (i = 0; i < n_blocks; i++)
+    {
+      if (!dfl_time_sequence_block_is_borrowed (sequence, i))
+        g_free (self->blocks[i]);
+    }
+
+  g_clear_pointer (&self->blocks, g_free);
+  g_clear_pointer (&self->mapped_file, g_mapped_file_unref);
+  self->n_elements_allocated = 0;
+}
+
+/* Allocate blocks until there is space for at least @n_elements elements. */
+static void
+dfl_time_sequence_reserve (DflTimeSequence *sequence,
+                           gsize            n_elements)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  gsize n_blocks;
+
+  n_blocks = dfl_time_sequence_get_n_blocks (sequence);
+
+  while (self->n_elements_allocated < n_elements)
+    {
+      gsize block_n_elements;
+
+      /* The directory is full whenever @n_blocks is a power of two. */
+      if ((n_blocks & (n_blocks - 1)) == 0)
+        self->blocks = g_renew (guint8 *, self->blocks,
+                                MAX (n_blocks * 2, 1));
+
+      block_n_elements = block_get_n_elements (n_blocks);
+      self->blocks[n_blocks] =
+        g_malloc_n (block_n_elements,
+                    sizeof (DflTimeSequenceElement) + self->element_size);
+      self->n_elements_allocated += block_n_elements;
+      n_blocks++;
+    }
+}
+
 /**
  * dfl_time_sequence_init:
  * @sequence: an uninitialised #DflTimeSequence
@@ -91,57 +271,152 @@ dfl_time_sequence_init (DflTimeSequence *sequence,
   self->element_size = element_size;
   self->element_destroy_notify = element_destroy_notify;
   self->n_elements_valid = 0;
-  self->n_elements_allocated = n_elements_preallocated;
-  self->elements = g_malloc_n (n_elements_preallocated,
-                               sizeof (DflTimeSequenceElement) + element_size);
+  self->n_elements_allocated = 0;
+  self->blocks = NULL;
+  self->search = NULL;
+  self->aggregators = NULL;
+  self->mapped_file = NULL;
+
+  dfl_time_sequence_reserve (sequence, n_elements_preallocated);
 }
 
-static gboolean
-dfl_time_sequence_is_valid_element (DflTimeSequence        *sequence,
-                                    DflTimeSequenceElement *element)
+static DflTimeSequenceElement *
+dfl_time_sequence_index (DflTimeSequence *sequence,
+                         gsize            index)
 {
   DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
-  gsize element_size;  /* size, in bytes, of a single element */
-  gsize elements_length;  /* length, in bytes, of the self->elements allocation */
+  gsize block, offset;
 
-  element_size = sizeof (DflTimeSequenceElement) + self->element_size;
-  elements_length = self->n_elements_valid * element_size;
+  g_assert (index < self->n_elements_valid);
 
-  return ((guint8 *) element >= (guint8 *) self->elements &&
-          (guint8 *) element < (guint8 *) self->elements + elements_length &&
-          (((guint8 *) element - (guint8 *) self->elements) % element_size) == 0);
+  block = block_for_index (index, &offset);
+
+  return (DflTimeSequenceElement *)
+    (self->blocks[block] +
+     offset * (sizeof (DflTimeSequenceElement) + self->element_size));
 }
 
-static DflTimeSequenceElement *
-dfl_time_sequence_index (DflTimeSequence *sequence,
-                         gsize            index)
+static void
+dfl_time_sequence_search_free (DflTimeSequenceSearch *search)
+{
+  if (search == NULL)
+    return;
+
+  g_free (search->keys);
+  g_free (search->indices);
+  g_free (search);
+}
+
+/* Fill the subtree of @search rooted at Eytzinger position @k from the
+ * elements starting at @index, in order. Return the index of the next unused
+ * element. */
+static gsize
+dfl_time_sequence_search_fill (DflTimeSequence       *sequence,
+                               DflTimeSequenceSearch *search,
+                               gsize                  index,
+                               gsize                  k)
+{
+  if (k > search->n_elements)
+    return index;
+
+  index = dfl_time_sequence_search_fill (sequence, search, index, 2 * k);
+  search->keys[k] = dfl_time_sequence_index (sequence, index)->timestamp;
+  search->indices[k] = index;
+  index++;
+
+  return dfl_time_sequence_search_fill (sequence, search, index, 2 * k + 1);
+}
+
+/* (Re)build the search accelerator if enough elements have been appended
+ * since it was last built. Rebuilding once the sequence has doubled in length
+ * keeps the cost amortised O(1) per append. */
+static void
+dfl_time_sequence_ensure_search (DflTimeSequence *sequence)
 {
   DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
-  gpointer element;
+  DflTimeSequenceSearch *search;
+  gsize n_elements_searchable;
 
-  g_assert (index < self->n_elements_valid);
+  n_elements_searchable = (self->search != NULL) ? self->search->n_elements : 0;
 
-  element = ((guint8 *) self->elements +
-             index * (sizeof (DflTimeSequenceElement) + self->element_size));
+  if (self->n_elements_valid < SEARCH_MIN_ELEMENTS ||
+      self->n_elements_valid / 2 < n_elements_searchable)
+    return;
 
-  g_return_val_if_fail (dfl_time_sequence_is_valid_element (sequence, element),
-                        NULL);
-  return (DflTimeSequenceElement *) element;
+  dfl_time_sequence_search_free (self->search);
+
+  search = g_new (DflTimeSequenceSearch, 1);
+  search->n_elements = self->n_elements_valid;
+  search->keys = g_new (DflTimestamp, search->n_elements + 1);
+  search->indices = g_new (gsize, search->n_elements + 1);
+  dfl_time_sequence_search_fill (sequence, search, 0, 1);
+
+  self->search = search;
+}
+
+/* Return the index of the first element whose timestamp is ≥ @timestamp, or
+ * the number of elements if there is no such element. */
+static gsize
+dfl_time_sequence_lower_bound (DflTimeSequence *sequence,
+                               DflTimestamp     timestamp)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  gsize left_index, right_index;
+
+  left_index = 0;
+
+  if (self->search != NULL)
+    {
+      const DflTimeSequenceSearch *search = self->search;
+      gsize k = 1;
+
+      /* Branchless descent: go right whenever the key is too small. The
+       * position one past the last left turn is the lower bound; recover it
+       * by stripping the trailing right turns (set bits) plus the final left
+       * turn off @k. */
+      while (k <= search->n_elements)
+        k = 2 * k + (search->keys[k] < timestamp);
+
+      k >>= g_bit_nth_lsf (~k, -1) + 1;
+
+      if (k != 0)
+        return search->indices[k];
+
+      left_index = search->n_elements;
+    }
+
+  /* Binary search over the remaining elements. */
+  right_index = self->n_elements_valid;
+
+  while (left_index < right_index)
+    {
+      gsize middle = left_index + (right_index - left_index) / 2;
+
+      if (dfl_time_sequence_index (sequence, middle)->timestamp < timestamp)
+        left_index = middle + 1;
+      else
+        right_index = middle;
+    }
+
+  return left_index;
 }
 
 /* Find the element with the largest timestamp ≤ @timestamp and return its
  * index in @index. If there are multiple elements with the same timestamp,
  * return the first of them. Return %FALSE if no element with a timestamp ≤
  * @timestamp was found; return %TRUE otherwise. If %FALSE is returned, @index
- * is guaranteed to be set to 0. */
+ * is guaranteed to be set to 0.
+ *
+ * This takes O(log n) time, even if there are long runs of elements with the
+ * same timestamp. */
 static gboolean
 dfl_time_sequence_find_timestamp (DflTimeSequence *sequence,
                                   DflTimestamp     timestamp,
                                   gsize           *index)
 {
   DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
-  gsize left_index, right_index, middle;
   DflTimeSequenceElement *element, *prev_element, *next_element;
+  gsize upper_index;
   gsize _index;
   gboolean valid;
 
@@ -160,40 +435,19 @@ dfl_time_sequence_find_timestamp (DflTimeSequence *sequence,
       goto done;
     }
 
-  /* Binary search. */
-  left_index = 0;
-  right_index = self->n_elements_valid - 1;
-
-  do
-    {
-      middle = (left_index + right_index) / 2;  /* truncate */
-      element = dfl_time_sequence_index (sequence, middle);
+  dfl_time_sequence_ensure_search (sequence);
 
-      if (element->timestamp > timestamp && middle > 0)
-        right_index = middle - 1;
-      else if (element->timestamp < timestamp && middle < G_MAXSIZE)
-        left_index = middle + 1;
-      else
-        break;
-    }
-  while (left_index <= right_index);
+  /* Find the first element after @timestamp. The one before it has the
+   * largest timestamp ≤ @timestamp; then find the first element with that
+   * timestamp. */
+  upper_index = (timestamp == G_MAXUINT64) ?
+                self->n_elements_valid :
+                dfl_time_sequence_lower_bound (sequence, timestamp + 1);
 
-  /* Work backwards until we find the first of the matching elements. (Multiple
-   * elements can have the same timestamp.) */
-  prev_element = (middle > 0) ? dfl_time_sequence_index (sequence, middle - 1) : NULL;
-
-  while (middle > 1 &&
-         (prev_element->timestamp >= timestamp ||
-          prev_element->timestamp == element->timestamp))
-    {
-      middle--;
-      element = prev_element;
-      prev_element = dfl_time_sequence_index (sequence, middle - 1);
-    }
-
-  if (element->timestamp <= timestamp)
+  if (upper_index > 0)
     {
-      _index = middle;
+      element = dfl_time_sequence_index (sequence, upper_index - 1);
+      _index = dfl_time_sequence_lower_bound (sequence, element->timestamp);
       valid = TRUE;
     }
   else
@@ -254,10 +508,433 @@ dfl_time_sequence_clear (DflTimeSequence *sequence)
         }
     }
 
-  g_free (self->elements);
-  self->elements = NULL;
+  dfl_time_sequence_free_blocks (sequence);
   self->n_elements_valid = 0;
-  self->n_elements_allocated = 0;
+
+  g_clear_pointer (&self->search, dfl_time_sequence_search_free);
+  g_clear_pointer (&self->aggregators, g_ptr_array_unref);
+}
+
+static void
+dfl_time_sequence_aggregator_free (DflTimeSequenceAggregator *aggregator)
+{
+  g_ptr_array_unref (aggregator->levels);
+  g_free (aggregator);
+}
+
+static DflTimeSequenceAggregator *
+dfl_time_sequence_find_aggregator (DflTimeSequence *sequence,
+                                   gsize            field_offset,
+                                   gboolean         interval)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  gsize i;
+
+  for (i = 0; self->aggregators != NULL && i < self->aggregators->len; i++)
+    {
+      DflTimeSequenceAggregator *aggregator;
+
+      aggregator = self->aggregators->pdata[i];
+
+      if (aggregator->field_offset == field_offset &&
+          aggregator->interval == interval)
+        return aggregator;
+    }
+
+  return NULL;
+}
+
+/* Add @value to @aggregate, ignoring it if it is negative (unknown). */
+static inline void
+aggregate_add_value (DflTimeSequenceAggregate *aggregate,
+                     gint64                    value)
+{
+  if (value < 0)
+    return;
+
+  if (aggregate->count == 0)
+    {
+      aggregate->min = value;
+      aggregate->max = value;
+    }
+  else
+    {
+      aggregate->min = MIN (aggregate->min, value);
+      aggregate->max = MAX (aggregate->max, value);
+    }
+
+  aggregate->count++;
+  aggregate->sum += value;
+}
+
+static inline void
+aggregate_merge (DflTimeSequenceAggregate       *aggregate,
+                 const DflTimeSequenceAggregate *other)
+{
+  if (other->count == 0)
+    return;
+
+  if (aggregate->count == 0)
+    {
+      *aggregate = *other;
+      return;
+    }
+
+  aggregate->count += other->count;
+  aggregate->sum += other->sum;
+  aggregate->min = MIN (aggregate->min, other->min);
+  aggregate->max = MAX (aggregate->max, other->max);
+}
+
+/* Get the value summarised by @aggregator for the element at @index. */
+static inline gint64
+dfl_time_sequence_get_value (DflTimeSequence           *sequence,
+                             DflTimeSequenceAggregator *aggregator,
+                             gsize                      index)
+{
+  DflTimeSequenceElement *element;
+  gint64 value;
+
+  element = dfl_time_sequence_index (sequence, index);
+  memcpy (&value, element->data + aggregator->field_offset, sizeof (value));
+
+  if (aggregator->interval)
+    value = (gint64) element->timestamp + MAX (value, 0);
+
+  return value;
+}
+
+/* Add child @index of @level to @aggregate. A %NULL @level means the elements
+ * themselves. */
+static inline void
+aggregate_add_child (DflTimeSequenceAggregate  *aggregate,
+                     DflTimeSequence           *sequence,
+                     DflTimeSequenceAggregator *aggregator,
+                     GArray                    *level,
+                     gsize                      index)
+{
+  if (level == NULL)
+    aggregate_add_value (aggregate,
+                         dfl_time_sequence_get_value (sequence, aggregator,
+                                                      index));
+  else
+    aggregate_merge (aggregate,
+                     &g_array_index (level, DflTimeSequenceAggregate, index));
+}
+
+/* Bring @aggregator up to date with the elements appended since it was last
+ * updated, or invalidated by dfl_time_sequence_invalidate_aggregates(). The
+ * nodes covering those elements are recomputed; nothing else is, so payload
+ * changes to earlier elements are only picked up if they were invalidated. */
+static void
+dfl_time_sequence_update_aggregator (DflTimeSequence           *sequence,
+                                     DflTimeSequenceAggregator *aggregator)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  GArray *level, *child_level;
+  gsize n_children, first_node, n_nodes, node, i;
+  guint level_index;
+
+  if (aggregator->n_elements == self->n_elements_valid)
+    return;
+
+  child_level = NULL;
+  n_children = self->n_elements_valid;
+
+  for (level_index = 0; n_children > 1; level_index++)
+    {
+      n_nodes = (n_children + AGGREGATE_FANOUT - 1) >> AGGREGATE_FANOUT_SHIFT;
+
+      if (level_index == aggregator->levels->len)
+        g_ptr_array_add (aggregator->levels,
+                         g_array_new (FALSE, TRUE,
+                                      sizeof (DflTimeSequenceAggregate)));
+
+      level = aggregator->levels->pdata[level_index];
+      first_node = (aggregator->n_elements >>
+                    ((level_index + 1) * AGGREGATE_FANOUT_SHIFT));
+      g_array_set_size (level, n_nodes);
+
+      for (node = first_node; node < n_nodes; node++)
+        {
+          DflTimeSequenceAggregate *aggregate;
+          gsize end;
+
+          aggregate = &g_array_index (level, DflTimeSequenceAggregate, node);
+          memset (aggregate, 0, sizeof (*aggregate));
+          end = MIN ((node + 1) << AGGREGATE_FANOUT_SHIFT, n_children);
+
+          for (i = node << AGGREGATE_FANOUT_SHIFT; i < end; i++)
+            aggregate_add_child (aggregate, sequence, aggregator,
+                                 child_level, i);
+        }
+
+      child_level = level;
+      n_children = n_nodes;
+    }
+
+  aggregator->n_elements = self->n_elements_valid;
+}
+
+static void
+dfl_time_sequence_add_aggregator (DflTimeSequence *sequence,
+                                  gsize            field_offset,
+                                  gboolean         interval)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  DflTimeSequenceAggregator *aggregator;
+
+  if (dfl_time_sequence_find_aggregator (sequence, field_offset,
+                                         interval) != NULL)
+    return;
+
+  if (self->aggregators == NULL)
+    self->aggregators =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) dfl_time_sequence_aggregator_free);
+
+  aggregator = g_new0 (DflTimeSequenceAggregator, 1);
+  aggregator->field_offset = field_offset;
+  aggregator->interval = interval;
+  aggregator->n_elements = 0;
+  aggregator->levels =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+
+  g_ptr_array_add (self->aggregators, aggregator);
+}
+
+/**
+ * dfl_time_sequence_add_aggregate:
+ * @sequence: a #DflTimeSequence
+ * @field_offset: offset of a #gint64 field in the element payload, as
+ *    returned by G_STRUCT_OFFSET()
+ *
+ * Maintain summary statistics for the given field of the elements in
+ * @sequence, so that dfl_time_sequence_get_aggregate() can answer queries
+ * about it over any range of timestamps in O(log n) time, without iterating
+ * over the elements. Negative field values are treated as unknown, and are
+ * not included in the statistics.
+ *
+ * The statistics are computed lazily when first queried, and then extended as
+ * elements are appended. Changes to the payloads of elements which have
+ * already been summarised (such as filling in a duration once a span ends) are
+ * not picked up unless dfl_time_sequence_invalidate_aggregates() is called
+ * for them. As queries update the statistics, they are not thread safe; see
+ * the section documentation.
+ *
+ * Adding the same field more than once has no effect.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_time_sequence_add_aggregate (DflTimeSequence *sequence,
+                                 gsize            field_offset)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+
+  g_return_if_fail (sequence != NULL);
+  g_return_if_fail (self->element_size >= sizeof (gint64) &&
+                    field_offset <= self->element_size - sizeof (gint64));
+
+  dfl_time_sequence_add_aggregator (sequence, field_offset, FALSE);
+}
+
+/**
+ * dfl_time_sequence_invalidate_aggregates:
+ * @sequence: a #DflTimeSequence
+ * @start: timestamp of the first element whose payload has changed
+ *
+ * Notify @sequence that the payloads of its elements with timestamps of at
+ * least @start have been modified since they were appended, so that any
+ * aggregates (see dfl_time_sequence_add_aggregate()) and interval indexes (see
+ * dfl_time_sequence_add_interval_index()) are recomputed for them when next
+ * queried. This is not needed after appending elements, which are picked up
+ * automatically.
+ *
+ * Invalidating just the last element, such as after filling in its duration,
+ * is cheap: only O(log n) summary nodes are recomputed.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_time_sequence_invalidate_aggregates (DflTimeSequence *sequence,
+                                         DflTimestamp     start)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  gsize index, i;
+
+  g_return_if_fail (sequence != NULL);
+
+  if (self->aggregators == NULL)
+    return;
+
+  index = dfl_time_sequence_lower_bound (sequence, start);
+
+  for (i = 0; i < self->aggregators->len; i++)
+    {
+      DflTimeSequenceAggregator *aggregator = self->aggregators->pdata[i];
+
+      aggregator->n_elements = MIN (aggregator->n_elements, index);
+    }
+}
+
+/**
+ * dfl_time_sequence_get_aggregate:
+ * @sequence: a #DflTimeSequence
+ * @field_offset: offset of a field previously passed to
+ *    dfl_time_sequence_add_aggregate()
+ * @start: timestamp to start from (inclusive)
+ * @end: timestamp to end at (exclusive)
+ * @aggregate: (out caller-allocates): return location for the statistics
+ *
+ * Get the count, sum, minimum and maximum of the known values of the given
+ * field, over all elements whose timestamps are in [@start, @end). This takes
+ * O(log n) time.
+ *
+ * Returns: %TRUE if any known values were found, %FALSE otherwise
+ * Since: UNRELEASED
+ */
+gboolean
+dfl_time_sequence_get_aggregate (DflTimeSequence          *sequence,
+                                 gsize                     field_offset,
+                                 DflTimestamp              start,
+                                 DflTimestamp              end,
+                                 DflTimeSequenceAggregate *aggregate)
+{
+  DflTimeSequenceAggregator *aggregator;
+  gsize lo, hi, i;
+  gint level_index;
+
+  g_return_val_if_fail (sequence != NULL, FALSE);
+  g_return_val_if_fail (aggregate != NULL, FALSE);
+
+  aggregator = dfl_time_sequence_find_aggregator (sequence, field_offset,
+                                                  FALSE);
+  g_return_val_if_fail (aggregator != NULL, FALSE);
+
+  memset (aggregate, 0, sizeof (*aggregate));
+
+  if (start >= end)
+    return FALSE;
+
+  dfl_time_sequence_ensure_search (sequence);
+  dfl_time_sequence_update_aggregator (sequence, aggregator);
+
+  lo = dfl_time_sequence_lower_bound (sequence, start);
+  hi = dfl_time_sequence_lower_bound (sequence, end);
+
+  /* Climb the pyramid, summing the partial nodes at either end of the range
+   * on each level (level -1 being the elements themselves), until the range
+   * is covered by whole nodes on the level above. */
+  for (level_index = -1; lo < hi; level_index++)
+    {
+      GArray *level;
+
+      level = (level_index >= 0) ? aggregator->levels->pdata[level_index] : NULL;
+
+      if ((guint) (level_index + 1) >= aggregator->levels->len)
+        {
+          for (i = lo; i < hi; i++)
+            aggregate_add_child (aggregate, sequence, aggregator, level, i);
+
+          break;
+        }
+
+      while (lo < hi && (lo & (AGGREGATE_FANOUT - 1)) != 0)
+        aggregate_add_child (aggregate, sequence, aggregator, level, lo++);
+
+      while (lo < hi && (hi & (AGGREGATE_FANOUT - 1)) != 0)
+        aggregate_add_child (aggregate, sequence, aggregator, level, --hi);
+
+      lo >>= AGGREGATE_FANOUT_SHIFT;
+      hi >>= AGGREGATE_FANOUT_SHIFT;
+    }
+
+  return (aggregate->count > 0);
+}
+
+/* Find the first element in [@from, @to) whose end timestamp, according to
+ * the interval @aggregator, is after @start. Search the subtree rooted at
+ * @node on @level_index (-1 meaning the elements themselves), skipping
+ * subtrees which end no later than @start. Return @to if there is no such
+ * element. */
+static gsize
+dfl_time_sequence_find_overlapping (DflTimeSequence           *sequence,
+                                    DflTimeSequenceAggregator *aggregator,
+                                    gint                       level_index,
+                                    gsize                      node,
+                                    gsize                      from,
+                                    gsize                      to,
+                                    DflTimestamp               start)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  const DflTimeSequenceAggregate *aggregate;
+  gsize shift, child, n_children;
+
+  shift = (level_index + 1) * AGGREGATE_FANOUT_SHIFT;
+
+  if (((node + 1) << shift) <= from || (node << shift) >= to)
+    return to;
+
+  if (level_index < 0)
+    return ((DflTimestamp) dfl_time_sequence_get_value (sequence, aggregator,
+                                                        node) > start) ? node : to;
+
+  aggregate = &g_array_index ((GArray *) aggregator->levels->pdata[level_index],
+                              DflTimeSequenceAggregate, node);
+
+  if (aggregate->count == 0 || (DflTimestamp) aggregate->max <= start)
+    return to;
+
+  n_children = (level_index > 0) ?
+               ((GArray *) aggregator->levels->pdata[level_index - 1])->len :
+               self->n_elements_valid;
+
+  for (child = node << AGGREGATE_FANOUT_SHIFT;
+       child < MIN ((node + 1) << AGGREGATE_FANOUT_SHIFT, n_children);
+       child++)
+    {
+      gsize index;
+
+      index = dfl_time_sequence_find_overlapping (sequence, aggregator,
+                                                  level_index - 1, child,
+                                                  from, to, start);
+
+      if (index < to)
+        return index;
+    }
+
+  return to;
+}
+
+/**
+ * dfl_time_sequence_add_interval_index:
+ * @sequence: a #DflTimeSequence
+ * @duration_offset: offset of a #DflDuration field in the element payload,
+ *    as returned by G_STRUCT_OFFSET()
+ *
+ * Treat each element of @sequence as an interval, from its timestamp to its
+ * timestamp plus the given duration field, and maintain an index of them so
+ * that dfl_time_sequence_iter_next_overlapping() can find the elements which
+ * overlap a time point or window in O(log n) time per element found. Negative
+ * durations are treated as unknown, and such elements as instantaneous.
+ *
+ * Like dfl_time_sequence_add_aggregate(), the index is built lazily, and
+ * changes to the durations of elements which have already been indexed must
+ * be notified with dfl_time_sequence_invalidate_aggregates().
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_time_sequence_add_interval_index (DflTimeSequence *sequence,
+                                      gsize            duration_offset)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+
+  g_return_if_fail (sequence != NULL);
+  g_return_if_fail (self->element_size >= sizeof (DflDuration) &&
+                    duration_offset <= self->element_size - sizeof (DflDuration));
+
+  dfl_time_sequence_add_aggregator (sequence, duration_offset, TRUE);
 }
 
 /**
@@ -307,10 +984,8 @@ dfl_time_sequence_get_last_element (DflTimeSequence *sequence,
  *
  * TODO
  *
- * Note that the pointers returned from dfl_time_sequence_append() may change
- * if dfl_time_sequence_append() is called again, due to internal reallocations.
- * The returned pointer is only valid until the next call to
- * dfl_time_sequence_append().
+ * The returned pointer remains valid until the sequence is cleared: appending
+ * further elements never moves existing ones.
  *
  * Returns: (transfer none): TODO
  * Since: 0.1.0
@@ -332,15 +1007,8 @@ dfl_time_sequence_append (DflTimeSequence *sequence,
   g_return_val_if_fail (last_element == NULL || timestamp >= last_timestamp,
                        NULL);
 
-  /* Do we need to expand the array first? */
-  if (self->n_elements_valid == self->n_elements_allocated)
-    {
-      self->n_elements_allocated =
-        ((gsize) 1 << (g_bit_nth_msf (self->n_elements_allocated, -1) + 1));
-      self->elements = g_realloc_n (self->elements, self->n_elements_allocated,
-                                    sizeof (DflTimeSequenceElement) +
-                                    self->element_size);
-    }
+  /* Do we need to allocate another block first? */
+  dfl_time_sequence_reserve (sequence, self->n_elements_valid + 1);
 
   g_assert (self->n_elements_allocated > self->n_elements_valid);
 
@@ -350,23 +1018,185 @@ dfl_time_sequence_append (DflTimeSequence *sequence,
   element = dfl_time_sequence_index (sequence, self->n_elements_valid - 1);
   element->timestamp = timestamp;
 
+  /* Zero the payload, including any padding, so that elements can be written
+   * to a model cache byte for byte. */
+  memset (element->data, 0, self->element_size);
+
   return element->data;
 }
 
+/* Write the elements of @sequence to a model cache. The element payloads are
+ * written as-is, so must not contain pointers. */
+void
+_dfl_time_sequence_save_cache (DflTimeSequence     *sequence,
+                               DflModelCacheWriter *writer)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  gsize element_size, i, block;
+
+  g_return_if_fail (self->element_destroy_notify == NULL);
+
+  element_size = sizeof (DflTimeSequenceElement) + self->element_size;
+
+  _dfl_model_cache_writer_add_uint64 (writer, self->n_elements_valid);
+  _dfl_model_cache_writer_add_uint64 (writer, element_size);
+
+  /* Every block but the last holds a multiple of 16 elements, so is written
+   * without padding and the blocks are contiguous in the cache. */
+  for (i = 0, block = 0; i < self->n_elements_valid; block++)
+    {
+      gsize n_elements;
+
+      n_elements = MIN (block_get_n_elements (block),
+                        self->n_elements_valid - i);
+      _dfl_model_cache_writer_add_data (writer, self->blocks[block],
+                                        n_elements * element_size);
+      i += n_elements;
+    }
+}
+
+/* Load the elements of @sequence, which must be initialised and empty, from
+ * a model cache.
+ *
+ * If @reader has a mapped file, the elements are not copied: the cache stores
+ * them contiguously, so every block but the last can point straight into the
+ * mapping, which the sequence then keeps a reference to. Those elements are
+ * read-only. The last block is always copied, so that appending elements, or
+ * modifying the last element, never writes to the mapping. Otherwise, the
+ * elements are copied out a block at a time. */
+gboolean
+_dfl_time_sequence_load_cache (DflTimeSequence     *sequence,
+                               DflModelCacheReader *reader)
+{
+  DflTimeSequenceReal *self = (DflTimeSequenceReal *) sequence;
+  guint64 n_elements, element_size, i;
+  gsize block;
+  const guint8 *elements;
+  DflTimestamp last_timestamp = 0;
+
+  g_return_val_if_fail (self->n_elements_valid == 0, FALSE);
+
+  n_elements = _dfl_model_cache_reader_read_uint64 (reader);
+  element_size = _dfl_model_cache_reader_read_uint64 (reader);
+
+  if (reader->invalid ||
+      element_size != sizeof (DflTimeSequenceElement) + self->element_size ||
+      n_elements > G_MAXSIZE / element_size)
+    {
+      reader->invalid = TRUE;
+      return FALSE;
+    }
+
+  elements = _dfl_model_cache_reader_read_data (reader,
+                                                n_elements * element_size);
+
+  if (elements == NULL)
+    return FALSE;
+
+  /* The timestamps must be monotonic for lookups to work. */
+  for (i = 0; i < n_elements; i++)
+    {
+      DflTimestamp timestamp;
+
+      memcpy (&timestamp, elements + i * element_size, sizeof (timestamp));
+
+      if (timestamp < last_timestamp)
+        {
+          reader->invalid = TRUE;
+          return FALSE;
+        }
+
+      last_timestamp = timestamp;
+    }
+
+  g_clear_pointer (&self->search, dfl_time_sequence_search_free);
+
+  if (reader->mapped_file != NULL && n_elements > 0)
+    {
+      gsize last_block, offset;
+
+      /* Any preallocated blocks are empty, so can be dropped. */
+      dfl_time_sequence_free_blocks (sequence);
+
+      last_block = block_for_index (n_elements - 1, &offset);
+      self->blocks = g_new (guint8 *, (gsize) 1 << g_bit_storage (last_block));
+
+      for (i = 0, block = 0; block < last_block; block++)
+        {
+          self->blocks[block] = (guint8 *) elements + i * element_size;
+          i += block_get_n_elements (block);
+        }
+
+      self->blocks[last_block] = g_malloc_n (block_get_n_elements (last_block),
+                                             element_size);
+      memcpy (self->blocks[last_block], elements + i * element_size,
+              (n_elements - i) * element_size);
+
+      self->n_elements_allocated = i + block_get_n_elements (last_block);
+      self->mapped_file = g_mapped_file_ref (reader->mapped_file);
+    }
+  else
+    {
+      dfl_time_sequence_reserve (sequence, n_elements);
+
+      for (i = 0, block = 0; i < n_elements; block++)
+        {
+          gsize block_n_elements;
+
+          block_n_elements = MIN (block_get_n_elements (block),
+                                  n_elements - i);
+          memcpy (self->blocks[block], elements + i * element_size,
+                  block_n_elements * element_size);
+          i += block_n_elements;
+        }
+    }
+
+  self->n_elements_valid = n_elements;
+
+  return TRUE;
+}
+
+/* Checking the validity of an iterator is relatively expensive, and the
+ * iterator functions are called in tight loops over millions of elements, so
+ * the checks are only compiled into debug builds. Non-debug builds just check
+ * for %NULL. */
+#ifndef NDEBUG
 static gboolean
 dfl_time_sequence_iter_is_valid (DflTimeSequenceIter *iter)
 {
   DflTimeSequenceIterReal *self = (DflTimeSequenceIterReal *) iter;
-  DflTimeSequenceReal *sequence = (DflTimeSequenceReal *) self->sequence;
+  DflTimeSequenceReal *sequence;
+
+  if (self == NULL || self->sequence == NULL)
+    return FALSE;
+
+  sequence = (DflTimeSequenceReal *) self->sequence;
 
-  return (self != NULL &&
-          self->sequence != NULL &&
-          self->index <= sequence->n_elements_valid &&
+  /* The last returned element is either side of @index, depending on whether
+   * it was returned by next() or previous(). */
+  return (self->index <= sequence->n_elements_valid &&
+          self->start_index <= self->index &&
+          self->index <= self->end_index &&
           (self->last_returned_element == NULL ||
-           dfl_time_sequence_is_valid_element (self->sequence,
-                                               self->last_returned_element)));
+           (self->index > 0 &&
+            self->last_returned_element ==
+            dfl_time_sequence_index (self->sequence, self->index - 1)) ||
+           (self->index < sequence->n_elements_valid &&
+            self->last_returned_element ==
+            dfl_time_sequence_index (self->sequence, self->index))));
 }
 
+#define iter_return_if_invalid(iter) \
+  g_return_if_fail (dfl_time_sequence_iter_is_valid (iter))
+#define iter_return_val_if_invalid(iter, val) \
+  g_return_val_if_fail (dfl_time_sequence_iter_is_valid (iter), val)
+#else  /* NDEBUG */
+#define iter_return_if_invalid(iter) \
+  g_return_if_fail ((iter) != NULL)
+#define iter_return_val_if_invalid(iter, val) \
+  g_return_val_if_fail ((iter) != NULL, val)
+#endif  /* NDEBUG */
+
 /**
  * dfl_time_sequence_iter_init:
  * @iter: an uninitialised #DflTimeSequenceIter
@@ -388,10 +1218,53 @@ dfl_time_sequence_iter_init (DflTimeSequenceIter *iter,
   g_return_if_fail (sequence != NULL);
 
   self->sequence = sequence;
+  self->start_index = 0;
+  self->end_index = G_MAXSIZE;
   self->last_returned_element = NULL;
   dfl_time_sequence_find_timestamp (sequence, start, &self->index);
 }
 
+/**
+ * dfl_time_sequence_iter_init_range:
+ * @iter: an uninitialised #DflTimeSequenceIter
+ * @sequence: the #DflTimeSequence to iterate over
+ * @start: timestamp to start at (inclusive)
+ * @end: timestamp to end at (exclusive)
+ *
+ * Initialise @iter to iterate over the elements of @sequence whose timestamps
+ * are in [@start, @end). Unlike dfl_time_sequence_iter_init(), this does not
+ * include the element before @start. dfl_time_sequence_iter_next() and
+ * dfl_time_sequence_iter_next_n() return %FALSE or 0 at @end, and
+ * dfl_time_sequence_iter_previous() returns %FALSE at @start, so callers do
+ * not need to check timestamps themselves.
+ *
+ * The bounds are found in O(log n) time. Elements appended after this is
+ * called are not included.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_time_sequence_iter_init_range (DflTimeSequenceIter *iter,
+                                   DflTimeSequence     *sequence,
+                                   DflTimestamp         start,
+                                   DflTimestamp         end)
+{
+  DflTimeSequenceIterReal *self = (DflTimeSequenceIterReal *) iter;
+
+  g_return_if_fail (iter != NULL);
+  g_return_if_fail (sequence != NULL);
+
+  dfl_time_sequence_ensure_search (sequence);
+
+  self->sequence = sequence;
+  self->start_index = dfl_time_sequence_lower_bound (sequence, start);
+  self->end_index = (start < end) ?
+                    dfl_time_sequence_lower_bound (sequence, end) :
+                    self->start_index;
+  self->index = self->start_index;
+  self->last_returned_element = NULL;
+}
+
 /**
  * dfl_time_sequence_iter_next:
  * @iter: a #DflTimeSequenceIter
@@ -412,12 +1285,12 @@ dfl_time_sequence_iter_next (DflTimeSequenceIter *iter,
   DflTimeSequenceReal *sequence;
   DflTimeSequenceElement *element;
 
-  g_return_val_if_fail (dfl_time_sequence_iter_is_valid (iter), FALSE);
+  iter_return_val_if_invalid (iter, FALSE);
 
   sequence = (DflTimeSequenceReal *) self->sequence;
 
   /* Reached the end? */
-  if (self->index >= sequence->n_elements_valid)
+  if (self->index >= MIN (self->end_index, sequence->n_elements_valid))
     {
       self->last_returned_element = NULL;
       return FALSE;
@@ -437,6 +1310,85 @@ dfl_time_sequence_iter_next (DflTimeSequenceIter *iter,
   return TRUE;
 }
 
+/**
+ * dfl_time_sequence_iter_next_n:
+ * @iter: a #DflTimeSequenceIter
+ * @n_elements: maximum number of elements to fetch
+ * @timestamps: (out caller-allocates) (array length=n_elements) (optional):
+ *    return location for the timestamps of the elements
+ * @data: (out caller-allocates) (optional): return location for copies of the
+ *    element data, which must be at least @n_elements times the element size
+ *    passed to dfl_time_sequence_init() in length
+ *
+ * Like dfl_time_sequence_iter_next(), but fetch up to @n_elements elements
+ * at once, copying their timestamps and data into the given buffers. This is
+ * the fastest way to read large ranges of a sequence: the elements are copied
+ * out a storage block at a time, without per-element overheads.
+ *
+ * Returns: number of elements fetched, which is less than @n_elements only if
+ *    the end of the sequence (or the range it was initialised with) was
+ *    reached
+ * Since: UNRELEASED
+ */
+gsize
+dfl_time_sequence_iter_next_n (DflTimeSequenceIter *iter,
+                               gsize                n_elements,
+                               DflTimestamp        *timestamps,
+                               gpointer             data)
+{
+  DflTimeSequenceIterReal *self = (DflTimeSequenceIterReal *) iter;
+  DflTimeSequenceReal *sequence;
+  gsize end_index, n_fetched, i, stride;
+  guint8 *data_out = data;
+
+  iter_return_val_if_invalid (iter, 0);
+
+  sequence = (DflTimeSequenceReal *) self->sequence;
+  end_index = MIN (self->end_index, sequence->n_elements_valid);
+  n_fetched = (self->index < end_index) ?
+              MIN (n_elements, end_index - self->index) : 0;
+
+  if (n_fetched == 0)
+    {
+      self->last_returned_element = NULL;
+      return 0;
+    }
+
+  stride = sizeof (DflTimeSequenceElement) + sequence->element_size;
+
+  /* Copy each run of elements within a block in a tight loop. */
+  for (i = 0; i < n_fetched;)
+    {
+      gsize block, offset, run, j;
+      const guint8 *element_bytes;
+
+      block = block_for_index (self->index + i, &offset);
+      run = MIN (block_get_n_elements (block) - offset, n_fetched - i);
+      element_bytes = sequence->blocks[block] + offset * stride;
+
+      for (j = 0; j < run; j++, element_bytes += stride)
+        {
+          const DflTimeSequenceElement *element;
+
+          element = (const DflTimeSequenceElement *) element_bytes;
+
+          if (timestamps != NULL)
+            timestamps[i + j] = element->timestamp;
+          if (data_out != NULL)
+            memcpy (data_out + (i + j) * sequence->element_size,
+                    element->data, sequence->element_size);
+        }
+
+      i += run;
+    }
+
+  self->index += n_fetched;
+  self->last_returned_element = dfl_time_sequence_index (self->sequence,
+                                                         self->index - 1);
+
+  return n_fetched;
+}
+
 /**
  * dfl_time_sequence_iter_previous:
  * @iter: a #DflTimeSequenceIter
@@ -456,10 +1408,10 @@ dfl_time_sequence_iter_previous (DflTimeSequenceIter *iter,
   DflTimeSequenceIterReal *self = (DflTimeSequenceIterReal *) iter;
   DflTimeSequenceElement *element;
 
-  g_return_val_if_fail (dfl_time_sequence_iter_is_valid (iter), FALSE);
+  iter_return_val_if_invalid (iter, FALSE);
 
   /* Reached the end? */
-  if (self->index == 0)
+  if (self->index <= self->start_index)
     {
       self->last_returned_element = NULL;
       return FALSE;
@@ -478,6 +1430,103 @@ dfl_time_sequence_iter_previous (DflTimeSequenceIter *iter,
   return TRUE;
 }
 
+/**
+ * dfl_time_sequence_iter_next_overlapping:
+ * @iter: a #DflTimeSequenceIter
+ * @duration_offset: offset of a field previously passed to
+ *    dfl_time_sequence_add_interval_index()
+ * @start: start of the window (inclusive)
+ * @end: end of the window (exclusive)
+ * @timestamp: (out caller-allocates) (optional): TODO
+ * @data: (out caller-allocates) (optional) (nullable): TODO
+ *
+ * Like dfl_time_sequence_iter_next(), but skip forwards to the next element
+ * whose interval overlaps [@start, @end). That includes elements which
+ * started before @start but had not finished by then, such as a long dispatch
+ * which starts off the top of the timeline. To find everything running at a
+ * time t, use a window of [t, t + 1).
+ *
+ * To iterate over all overlapping elements, initialise @iter with a @start
+ * of 0, then call this repeatedly. Each call takes O(log n) time.
+ *
+ * Returns: %TRUE if an overlapping element was found, %FALSE otherwise
+ * Since: UNRELEASED
+ */
+gboolean
+dfl_time_sequence_iter_next_overlapping (DflTimeSequenceIter *iter,
+                                         gsize                duration_offset,
+                                         DflTimestamp         start,
+                                         DflTimestamp         end,
+                                         DflTimestamp        *timestamp,
+                                         gpointer            *data)
+{
+  DflTimeSequenceIterReal *self = (DflTimeSequenceIterReal *) iter;
+  DflTimeSequenceAggregator *aggregator;
+  DflTimeSequenceElement *element;
+  gsize first_starting, first_after, index, node, n_nodes, shift;
+  gint top_level_index;
+
+  iter_return_val_if_invalid (iter, FALSE);
+
+  aggregator = dfl_time_sequence_find_aggregator (self->sequence,
+                                                  duration_offset, TRUE);
+  g_return_val_if_fail (aggregator != NULL, FALSE);
+
+  if (start >= end)
+    {
+      self->last_returned_element = NULL;
+      return FALSE;
+    }
+
+  dfl_time_sequence_ensure_search (self->sequence);
+  dfl_time_sequence_update_aggregator (self->sequence, aggregator);
+
+  /* Elements which start in the window all overlap it; elements which start
+   * before it overlap if they end after @start. Find the first of the latter
+   * by descending the interval index from the top level. */
+  first_starting = dfl_time_sequence_lower_bound (self->sequence, start);
+  first_after = MIN (dfl_time_sequence_lower_bound (self->sequence, end),
+                     self->end_index);
+  index = first_starting;
+
+  if (self->index < first_starting)
+    {
+      top_level_index = (gint) aggregator->levels->len - 1;
+      shift = (top_level_index + 1) * AGGREGATE_FANOUT_SHIFT;
+      n_nodes = (top_level_index >= 0) ?
+                ((GArray *) aggregator->levels->pdata[top_level_index])->len :
+                first_starting;
+
+      for (node = self->index >> shift;
+           node < n_nodes && index == first_starting;
+           node++)
+        index = dfl_time_sequence_find_overlapping (self->sequence, aggregator,
+                                                    top_level_index, node,
+                                                    self->index,
+                                                    first_starting, start);
+    }
+
+  index = MAX (index, self->index);
+
+  /* Reached the end? */
+  if (index >= first_after)
+    {
+      self->last_returned_element = NULL;
+      return FALSE;
+    }
+
+  element = dfl_time_sequence_index (self->sequence, index);
+  self->last_returned_element = element;
+  self->index = index + 1;
+
+  if (timestamp != NULL)
+    *timestamp = element->timestamp;
+  if (data != NULL)
+    *data = element->data;
+
+  return TRUE;
+}
+
 /**
  * dfl_time_sequence_iter_copy:
  * @iter: a #DflTimeSequenceIter
@@ -494,15 +1543,13 @@ dfl_time_sequence_iter_copy (DflTimeSequenceIter *iter)
   g_autoptr (DflTimeSequenceIter) new_iter = NULL;
   DflTimeSequenceIterReal *new_iter_real, *iter_real;
 
-  g_return_val_if_fail (dfl_time_sequence_iter_is_valid (iter), NULL);
+  iter_return_val_if_invalid (iter, NULL);
 
   new_iter = g_new0 (DflTimeSequenceIter, 1);
   new_iter_real = (DflTimeSequenceIterReal *) new_iter;
   iter_real = (DflTimeSequenceIterReal *) iter;
 
-  new_iter_real->sequence = iter_real->sequence;
-  new_iter_real->index = iter_real->index;
-  new_iter_real->last_returned_element = iter_real->last_returned_element;
+  *new_iter_real = *iter_real;
 
   return g_steal_pointer (&new_iter);
 }
@@ -519,7 +1566,7 @@ dfl_time_sequence_iter_copy (DflTimeSequenceIter *iter)
 void
 dfl_time_sequence_iter_free (DflTimeSequenceIter *iter)
 {
-  g_return_if_fail (dfl_time_sequence_iter_is_valid (iter));
+  iter_return_if_invalid (iter);
 
   g_free (iter);
 }
@@ -542,8 +1589,8 @@ dfl_time_sequence_iter_equal (DflTimeSequenceIter *iter1,
 {
   DflTimeSequenceIterReal *iter1_real, *iter2_real;
 
-  g_return_val_if_fail (dfl_time_sequence_iter_is_valid (iter1), FALSE);
-  g_return_val_if_fail (dfl_time_sequence_iter_is_valid (iter2), FALSE);
+  iter_return_val_if_invalid (iter1, FALSE);
+  iter_return_val_if_invalid (iter2, FALSE);
 
   iter1_real = (DflTimeSequenceIterReal *) iter1;
   iter2_real = (DflTimeSequenceIterReal *) iter2;
@@ -570,7 +1617,7 @@ dfl_time_sequence_iter_get_timestamp (DflTimeSequenceIter *iter)
 {
   DflTimeSequenceIterReal *self = (DflTimeSequenceIterReal *) iter;
 
-  g_return_val_if_fail (dfl_time_sequence_iter_is_valid (iter), 0);
+  iter_return_val_if_invalid (iter, 0);
 
   if (self->last_returned_element == NULL)
     return 0;
@@ -594,7 +1641,7 @@ dfl_time_sequence_iter_get_data (DflTimeSequenceIter *iter)
 {
   DflTimeSequenceIterReal *self = (DflTimeSequenceIterReal *) iter;
 
-  g_return_val_if_fail (dfl_time_sequence_iter_is_valid (iter), NULL);
+  iter_return_val_if_invalid (iter, NULL);
 
   if (self->last_returned_element == NULL)
     return NULL;
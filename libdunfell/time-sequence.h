@@ -37,7 +37,7 @@ G_BEGIN_DECLS
  */
 typedef struct
 {
-  gpointer dummy[5];
+  gpointer dummy[8];
 } DflTimeSequence;
 
 void dfl_time_sequence_init (DflTimeSequence *sequence,
@@ -53,6 +53,39 @@ gpointer dfl_time_sequence_append           (DflTimeSequence *sequence,
 
 G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (DflTimeSequence, dfl_time_sequence_clear)
 
+/**
+ * DflTimeSequenceAggregate:
+ * @count: number of elements with a known (non-negative) value
+ * @sum: sum of the known values
+ * @min: smallest known value, or 0 if @count is 0
+ * @max: largest known value, or 0 if @count is 0
+ *
+ * Summary statistics for a #gint64 field of the elements in a range of a
+ * #DflTimeSequence, as returned by dfl_time_sequence_get_aggregate().
+ *
+ * Since: UNRELEASED
+ */
+typedef struct
+{
+  guint64 count;
+  gint64 sum;
+  gint64 min;
+  gint64 max;
+} DflTimeSequenceAggregate;
+
+void     dfl_time_sequence_add_aggregate (DflTimeSequence          *sequence,
+                                          gsize                     field_offset);
+gboolean dfl_time_sequence_get_aggregate (DflTimeSequence          *sequence,
+                                          gsize                     field_offset,
+                                          DflTimestamp              start,
+                                          DflTimestamp              end,
+                                          DflTimeSequenceAggregate *aggregate);
+void     dfl_time_sequence_invalidate_aggregates (DflTimeSequence *sequence,
+                                                  DflTimestamp     start);
+
+void     dfl_time_sequence_add_interval_index (DflTimeSequence *sequence,
+                                               gsize            duration_offset);
+
 /**
  * DflTimeSequenceIter:
  *
@@ -63,7 +96,7 @@ G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (DflTimeSequence, dfl_time_sequence_clear)
  */
 typedef struct
 {
-  gpointer dummy[3];
+  gpointer dummy[5];
 } DflTimeSequenceIter;
 
 GType dfl_time_sequence_iter_get_type (void);
@@ -71,12 +104,26 @@ GType dfl_time_sequence_iter_get_type (void);
 void     dfl_time_sequence_iter_init (DflTimeSequenceIter *iter,
                                       DflTimeSequence     *sequence,
                                       DflTimestamp         start);
+void     dfl_time_sequence_iter_init_range (DflTimeSequenceIter *iter,
+                                            DflTimeSequence     *sequence,
+                                            DflTimestamp         start,
+                                            DflTimestamp         end);
 gboolean dfl_time_sequence_iter_next (DflTimeSequenceIter *iter,
                                       DflTimestamp        *timestamp,
                                       gpointer            *data);
+gsize    dfl_time_sequence_iter_next_n (DflTimeSequenceIter *iter,
+                                        gsize                n_elements,
+                                        DflTimestamp        *timestamps,
+                                        gpointer             data);
 gboolean dfl_time_sequence_iter_previous (DflTimeSequenceIter *iter,
                                           DflTimestamp        *timestamp,
                                           gpointer            *data);
+gboolean dfl_time_sequence_iter_next_overlapping (DflTimeSequenceIter *iter,
+                                                  gsize                duration_offset,
+                                                  DflTimestamp         start,
+                                                  DflTimestamp         end,
+                                                  DflTimestamp        *timestamp,
+                                                  gpointer            *data);
 
 DflTimeSequenceIter *dfl_time_sequence_iter_copy          (DflTimeSequenceIter *iter);
 void                 dfl_time_sequence_iter_free          (DflTimeSequenceIter *iter);
@@ -0,0 +1,397 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:writer
+ * @short_description: Dunfell binary log file writer
+ * @stability: Unstable
+ * @include: libdunfell/writer.h
+ *
+ * #DflWriter writes events to a #GOutputStream in the binary Dunfell log
+ * format (version 2.0), which can be loaded by #DflParser in the same way as
+ * a text log. Binary logs are smaller than text logs and much faster to load,
+ * as timestamps, thread IDs and numeric parameters are stored as fixed-width
+ * integers, and repeated strings are only stored once.
+ *
+ * Output is buffered; call dfl_writer_flush() once all events have been
+ * written. The writer does not close its stream.
+ *
+ * Since: UNRELEASED
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "event.h"
+#include "event-private.h"
+#include "event-sequence.h"
+#include "event-sequence-private.h"
+#include "parser-private.h"
+#include "writer.h"
+
+
+/* Size at which the buffer is written out to the stream. */
+#define BUFFER_SIZE (64 * 1024)
+
+static void dfl_writer_dispose  (GObject *object);
+static void dfl_writer_finalize (GObject *object);
+
+struct _DflWriter
+{
+  GObject parent;
+
+  GOutputStream *stream;  /* owned */
+  GByteArray *buffer;  /* owned */
+
+  /* String table: map from string to its index in the table. */
+  GHashTable/*<owned utf8, guint>*/ *strings;  /* owned */
+
+  /* Error from the first failed write to @stream. Once this is set, the log
+   * is incomplete (string records referenced by later events may have been
+   * lost), so all further writes fail with it. */
+  GError *failure;  /* owned; nullable */
+};
+
+G_DEFINE_TYPE (DflWriter, dfl_writer, G_TYPE_OBJECT)
+
+static void
+dfl_writer_class_init (DflWriterClass *klass)
+{
+  GObjectClass *object_class = (GObjectClass *) klass;
+
+  object_class->dispose = dfl_writer_dispose;
+  object_class->finalize = dfl_writer_finalize;
+}
+
+static void
+dfl_writer_init (DflWriter *self)
+{
+  self->buffer = g_byte_array_sized_new (BUFFER_SIZE);
+  self->strings = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, NULL);
+}
+
+static void
+dfl_writer_dispose (GObject *object)
+{
+  DflWriter *self = DFL_WRITER (object);
+
+  g_clear_object (&self->stream);
+
+  /* Chain up to the parent class */
+  G_OBJECT_CLASS (dfl_writer_parent_class)->dispose (object);
+}
+
+static void
+dfl_writer_finalize (GObject *object)
+{
+  DflWriter *self = DFL_WRITER (object);
+
+  g_hash_table_unref (self->strings);
+  g_byte_array_unref (self->buffer);
+  g_clear_error (&self->failure);
+
+  G_OBJECT_CLASS (dfl_writer_parent_class)->finalize (object);
+}
+
+static void
+append_uint16_le (GByteArray *buffer,
+                  guint16     value)
+{
+  value = GUINT16_TO_LE (value);
+  g_byte_array_append (buffer, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+append_uint32_le (GByteArray *buffer,
+                  guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (buffer, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+append_uint64_le (GByteArray *buffer,
+                  guint64     value)
+{
+  value = GUINT64_TO_LE (value);
+  g_byte_array_append (buffer, (const guint8 *) &value, sizeof (value));
+}
+
+/**
+ * dfl_writer_new:
+ * @stream: stream to write the log to
+ * @initial_timestamp: the timestamp of the start of the log (before the first
+ *    event)
+ *
+ * Create a new #DflWriter which writes a binary log to @stream. The log header
+ * is buffered immediately, and written out with the first flush.
+ *
+ * Returns: (transfer full): a new #DflWriter
+ * Since: UNRELEASED
+ */
+DflWriter *
+dfl_writer_new (GOutputStream *stream,
+                DflTimestamp   initial_timestamp)
+{
+  DflWriter *writer = NULL;
+
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), NULL);
+
+  writer = g_object_new (DFL_TYPE_WRITER, NULL);
+
+  /* TODO: Use properties properly. */
+  writer->stream = g_object_ref (stream);
+
+  /* Header. */
+  g_byte_array_append (writer->buffer, (const guint8 *) DFL_BINARY_MAGIC,
+                       DFL_BINARY_MAGIC_LENGTH);
+  append_uint16_le (writer->buffer, DFL_BINARY_VERSION_MAJOR);
+  append_uint16_le (writer->buffer, DFL_BINARY_VERSION_MINOR);
+  append_uint32_le (writer->buffer, 0);
+  append_uint64_le (writer->buffer, initial_timestamp);
+
+  return writer;
+}
+
+/* Get the index of @str in the string table, appending a string record to the
+ * buffer if it’s not already there. */
+static guint
+get_string_index (DflWriter   *self,
+                  const gchar *str)
+{
+  gpointer index_ptr;
+  guint index;
+  gsize length;
+  static const guint8 padding[8] = { 0, };
+
+  if (g_hash_table_lookup_extended (self->strings, str, NULL, &index_ptr))
+    return GPOINTER_TO_UINT (index_ptr);
+
+  index = g_hash_table_size (self->strings);
+  g_hash_table_insert (self->strings, g_strdup (str),
+                       GUINT_TO_POINTER (index));
+
+  length = strlen (str);
+
+  append_uint16_le (self->buffer, DFL_BINARY_CODE_STRING);
+  g_byte_array_append (self->buffer, padding, 2);
+  append_uint32_le (self->buffer, length);
+  g_byte_array_append (self->buffer, (const guint8 *) str, length);
+  g_byte_array_append (self->buffer, padding, (8 - (length % 8)) % 8);
+
+  return index;
+}
+
+/**
+ * dfl_writer_write_event:
+ * @self: a #DflWriter
+ * @event: the event to write
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Append @event to the log. Events must be written in the order they happened
+ * in each thread, or the log will fail to load.
+ *
+ * The event is buffered, and the buffer is written to the stream when it is
+ * full, so this may block and may return an error from the stream.
+ *
+ * If the type of @event is not known to #DflParser, an error is returned.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_writer_write_event (DflWriter     *self,
+                        DflEvent      *event,
+                        GCancellable  *cancellable,
+                        GError       **error)
+{
+  const DflEventParameters *parameters;
+  guint64 values[DFL_BINARY_MAX_PARAMETERS];
+  guint8 string_mask = 0;
+  guint8 record_header[4];
+  guint16 code;
+  guint n_parameters, i;
+
+  g_return_if_fail (DFL_IS_WRITER (self));
+  g_return_if_fail (DFL_IS_EVENT (event));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  if (self->failure != NULL)
+    {
+      g_propagate_error (error, g_error_copy (self->failure));
+      return;
+    }
+
+  parameters = _dfl_event_get_parameters (event);
+
+  if (!_dfl_parser_event_type_to_code (dfl_event_get_event_type (event),
+                                       &code, &n_parameters) ||
+      n_parameters != parameters->n_parameters)
+    {
+      /* TODO: Use a proper error code here. */
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_UNKNOWN,
+                   "Event of type ‘%s’ cannot be written to a binary log",
+                   dfl_event_get_event_type (event));
+      return;
+    }
+
+  g_assert (n_parameters <= DFL_BINARY_MAX_PARAMETERS);
+
+  /* Work out the parameter values first, as this may append string records
+   * to the buffer. The event’s parameters are already split into IDs and
+   * strings in the same way as the binary format. */
+  for (i = 0; i < n_parameters; i++)
+    {
+      if (parameters->string_mask & (1 << i))
+        {
+          values[i] = get_string_index (self, parameters->values[i].string);
+          string_mask |= 1 << i;
+        }
+      else
+        {
+          values[i] = parameters->values[i].id;
+        }
+    }
+
+  record_header[0] = code & 0xff;
+  record_header[1] = code >> 8;
+  record_header[2] = string_mask;
+  record_header[3] = n_parameters;
+
+  g_byte_array_append (self->buffer, record_header, sizeof (record_header));
+  append_uint32_le (self->buffer, 0);
+  append_uint64_le (self->buffer, dfl_event_get_timestamp (event));
+  append_uint64_le (self->buffer, dfl_event_get_thread_id (event));
+
+  for (i = 0; i < n_parameters; i++)
+    append_uint64_le (self->buffer, values[i]);
+
+  if (self->buffer->len >= BUFFER_SIZE)
+    dfl_writer_flush (self, cancellable, error);
+}
+
+typedef struct
+{
+  DflWriter *writer;  /* unowned */
+  GCancellable *cancellable;  /* unowned; nullable */
+  GError *error;  /* owned; nullable */
+} WriteSequenceData;
+
+static gboolean
+write_sequence_cb (DflEvent *event,
+                   gpointer  user_data)
+{
+  WriteSequenceData *data = user_data;
+
+  dfl_writer_write_event (data->writer, event, data->cancellable,
+                          &data->error);
+
+  return (data->error == NULL);
+}
+
+/**
+ * dfl_writer_write_event_sequence:
+ * @self: a #DflWriter
+ * @sequence: the events to write
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Append all the events from @sequence to the log, in order, and flush the
+ * writer. This is typically used to convert a text log into a binary one.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_writer_write_event_sequence (DflWriter         *self,
+                                 DflEventSequence  *sequence,
+                                 GCancellable      *cancellable,
+                                 GError           **error)
+{
+  WriteSequenceData data;
+
+  g_return_if_fail (DFL_IS_WRITER (self));
+  g_return_if_fail (DFL_IS_EVENT_SEQUENCE (sequence));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  data.writer = self;
+  data.cancellable = cancellable;
+  data.error = NULL;
+
+  /* Iterate without creating a #DflEvent for every event in the sequence. */
+  _dfl_event_sequence_foreach (sequence, 0, write_sequence_cb, &data);
+
+  if (data.error == NULL)
+    dfl_writer_flush (self, cancellable, &data.error);
+
+  if (data.error != NULL)
+    g_propagate_error (error, data.error);
+}
+
+/**
+ * dfl_writer_flush:
+ * @self: a #DflWriter
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Write any buffered data out to the stream, and flush the stream.
+ *
+ * If writing to the stream fails, the log is left incomplete, and this and all
+ * subsequent calls to dfl_writer_write_event() and dfl_writer_flush() return
+ * the same error.
+ *
+ * Since: UNRELEASED
+ */
+void
+dfl_writer_flush (DflWriter     *self,
+                  GCancellable  *cancellable,
+                  GError       **error)
+{
+  GError *local_error = NULL;
+
+  g_return_if_fail (DFL_IS_WRITER (self));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  if (self->failure != NULL)
+    {
+      g_propagate_error (error, g_error_copy (self->failure));
+      return;
+    }
+
+  if (g_output_stream_write_all (self->stream, self->buffer->data,
+                                 self->buffer->len, NULL, cancellable,
+                                 &local_error))
+    g_output_stream_flush (self->stream, cancellable, &local_error);
+
+  /* Drop the buffered data even on error, so the buffer doesn’t grow
+   * without bound. The string records in it are lost, so the writer cannot
+   * continue: later events could refer to them. */
+  g_byte_array_set_size (self->buffer, 0);
+
+  if (local_error != NULL)
+    {
+      self->failure = g_error_copy (local_error);
+      g_propagate_error (error, local_error);
+    }
+}
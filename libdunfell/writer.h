@@ -0,0 +1,58 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_WRITER_H
+#define DFL_WRITER_H
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "event.h"
+#include "event-sequence.h"
+
+G_BEGIN_DECLS
+
+/**
+ * DflWriter:
+ *
+ * All the fields in this structure are private.
+ *
+ * Since: UNRELEASED
+ */
+#define DFL_TYPE_WRITER dfl_writer_get_type ()
+G_DECLARE_FINAL_TYPE (DflWriter, dfl_writer, DFL, WRITER, GObject)
+
+DflWriter *dfl_writer_new (GOutputStream *stream,
+                           DflTimestamp   initial_timestamp);
+
+void dfl_writer_write_event (DflWriter     *self,
+                             DflEvent      *event,
+                             GCancellable  *cancellable,
+                             GError       **error);
+void dfl_writer_write_event_sequence (DflWriter         *self,
+                                      DflEventSequence  *sequence,
+                                      GCancellable      *cancellable,
+                                      GError           **error);
+void dfl_writer_flush (DflWriter     *self,
+                       GCancellable  *cancellable,
+                       GError       **error);
+
+G_END_DECLS
+
+#endif /* !DFL_WRITER_H */
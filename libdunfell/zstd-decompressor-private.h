@@ -0,0 +1,51 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DFL_ZSTD_DECOMPRESSOR_PRIVATE_H
+#define DFL_ZSTD_DECOMPRESSOR_PRIVATE_H
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* A #GConverter which decompresses a zstd stream, which may contain multiple
+ * frames. Only available if libdunfell was built with zstd support. */
+#define DFL_TYPE_ZSTD_DECOMPRESSOR _dfl_zstd_decompressor_get_type ()
+G_DECLARE_FINAL_TYPE (DflZstdDecompressor, _dfl_zstd_decompressor, DFL,
+                      ZSTD_DECOMPRESSOR, GObject)
+
+DflZstdDecompressor *_dfl_zstd_decompressor_new (void);
+
+/* Called with each batch of data decompressed by
+ * _dfl_zstd_decompress_frames(), in order. Return %FALSE to stop
+ * decompressing. */
+typedef gboolean (*DflZstdBatchFunc) (const guint8 *data,
+                                      gsize         length,
+                                      gpointer      user_data);
+
+gboolean _dfl_zstd_decompress_frames (const guint8      *data,
+                                      gsize              length,
+                                      DflZstdBatchFunc   func,
+                                      gpointer           user_data,
+                                      GError           **error);
+
+G_END_DECLS
+
+#endif /* !DFL_ZSTD_DECOMPRESSOR_PRIVATE_H */
@@ -0,0 +1,443 @@
+/* vim:set et sw=2 cin cino=t0,f0,(0,{s,>2s,n-s,^-s,e2s: */
+/*
+ * Copyright © Philip Withnall 2016 <philip@tecnocode.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <string.h>
+#include <zstd.h>
+
+#include "zstd-decompressor-private.h"
+
+
+static void dfl_zstd_decompressor_converter_init (GConverterIface *iface);
+static void dfl_zstd_decompressor_finalize (GObject *object);
+static GConverterResult dfl_zstd_decompressor_convert (GConverter       *converter,
+                                                       const void       *inbuf,
+                                                       gsize             inbuf_size,
+                                                       void             *outbuf,
+                                                       gsize             outbuf_size,
+                                                       GConverterFlags   flags,
+                                                       gsize            *bytes_read,
+                                                       gsize            *bytes_written,
+                                                       GError          **error);
+static void dfl_zstd_decompressor_reset (GConverter *converter);
+
+struct _DflZstdDecompressor
+{
+  GObject parent;
+
+  ZSTD_DStream *stream;  /* owned */
+};
+
+G_DEFINE_TYPE_WITH_CODE (DflZstdDecompressor, _dfl_zstd_decompressor,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_CONVERTER,
+                                                dfl_zstd_decompressor_converter_init))
+
+static void
+_dfl_zstd_decompressor_class_init (DflZstdDecompressorClass *klass)
+{
+  GObjectClass *object_class = (GObjectClass *) klass;
+
+  object_class->finalize = dfl_zstd_decompressor_finalize;
+}
+
+static void
+dfl_zstd_decompressor_converter_init (GConverterIface *iface)
+{
+  iface->convert = dfl_zstd_decompressor_convert;
+  iface->reset = dfl_zstd_decompressor_reset;
+}
+
+static void
+_dfl_zstd_decompressor_init (DflZstdDecompressor *self)
+{
+  self->stream = ZSTD_createDStream ();
+  ZSTD_initDStream (self->stream);
+}
+
+static void
+dfl_zstd_decompressor_finalize (GObject *object)
+{
+  DflZstdDecompressor *self = DFL_ZSTD_DECOMPRESSOR (object);
+
+  ZSTD_freeDStream (self->stream);
+
+  G_OBJECT_CLASS (_dfl_zstd_decompressor_parent_class)->finalize (object);
+}
+
+static GConverterResult
+dfl_zstd_decompressor_convert (GConverter       *converter,
+                               const void       *inbuf,
+                               gsize             inbuf_size,
+                               void             *outbuf,
+                               gsize             outbuf_size,
+                               GConverterFlags   flags,
+                               gsize            *bytes_read,
+                               gsize            *bytes_written,
+                               GError          **error)
+{
+  DflZstdDecompressor *self = DFL_ZSTD_DECOMPRESSOR (converter);
+  ZSTD_inBuffer input = { inbuf, inbuf_size, 0 };
+  ZSTD_outBuffer output = { outbuf, outbuf_size, 0 };
+  gsize retval;
+  gboolean input_at_end;
+
+  retval = ZSTD_decompressStream (self->stream, &output, &input);
+
+  if (ZSTD_isError (retval))
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Invalid zstd-compressed data: %s",
+                   ZSTD_getErrorName (retval));
+      return G_CONVERTER_ERROR;
+    }
+
+  *bytes_read = input.pos;
+  *bytes_written = output.pos;
+
+  input_at_end = ((flags & G_CONVERTER_INPUT_AT_END) &&
+                  input.pos == inbuf_size);
+
+  /* A return value of zero means a frame has been completely decoded and
+   * flushed. Another frame may follow, unless this is the end of the input. */
+  if (retval == 0 && input_at_end)
+    return G_CONVERTER_FINISHED;
+
+  if (input.pos == 0 && output.pos == 0)
+    {
+      if (flags & G_CONVERTER_INPUT_AT_END)
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                             "Truncated zstd-compressed data");
+      else if (outbuf_size == 0)
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                             "Need more output space");
+      else
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                             "Need more input");
+
+      return G_CONVERTER_ERROR;
+    }
+
+  if ((flags & G_CONVERTER_FLUSH) && input.pos == inbuf_size)
+    return G_CONVERTER_FLUSHED;
+
+  return G_CONVERTER_CONVERTED;
+}
+
+static void
+dfl_zstd_decompressor_reset (GConverter *converter)
+{
+  DflZstdDecompressor *self = DFL_ZSTD_DECOMPRESSOR (converter);
+
+  ZSTD_initDStream (self->stream);
+}
+
+/* Create a new zstd decompressor, for use with a #GConverterInputStream. */
+DflZstdDecompressor *
+_dfl_zstd_decompressor_new (void)
+{
+  return g_object_new (DFL_TYPE_ZSTD_DECOMPRESSOR, NULL);
+}
+
+/* Upper bound on the decompressed size of each batch of frames which is
+ * decompressed in parallel. Frame headers are untrusted, so their declared
+ * sizes cannot be allocated unchecked; and this bounds memory use to two
+ * batches however large the log is. */
+#define MAX_BATCH_OUTPUT_LENGTH (64 * 1024 * 1024)  /* bytes */
+
+/* State shared between the decompression threads, used to wait for a batch
+ * of frames to be decompressed. */
+typedef struct
+{
+  GMutex mutex;
+  GCond cond;
+  guint n_pending;  /* number of frames pushed but not yet decompressed */
+} Batches;
+
+typedef struct
+{
+  const guint8 *src;  /* unowned */
+  gsize src_length;
+  guint8 *dest;  /* unowned; set when the frame’s batch is started */
+  gsize dest_offset;  /* offset of the frame’s output in its batch */
+  gsize dest_length;
+  gboolean success;
+} Frame;
+
+/* A run of consecutive frames whose total decompressed size is at most
+ * %MAX_BATCH_OUTPUT_LENGTH. */
+typedef struct
+{
+  guint first_frame;
+  guint n_frames;
+  gsize output_length;
+} Batch;
+
+static void
+decompress_frame_cb (gpointer data,
+                     gpointer user_data)
+{
+  Frame *frame = data;
+  Batches *batches = user_data;
+  gsize retval;
+
+  retval = ZSTD_decompress (frame->dest, frame->dest_length,
+                            frame->src, frame->src_length);
+  frame->success = (!ZSTD_isError (retval) && retval == frame->dest_length);
+
+  g_mutex_lock (&batches->mutex);
+  if (--batches->n_pending == 0)
+    g_cond_signal (&batches->cond);
+  g_mutex_unlock (&batches->mutex);
+}
+
+/* Check whether the frame at @data is a skippable frame, as used for the seek
+ * table in the seekable zstd format. */
+static gboolean
+is_skippable_frame (const guint8 *data,
+                    gsize         length)
+{
+  guint32 magic;
+
+  if (length < sizeof (magic))
+    return FALSE;
+
+  memcpy (&magic, data, sizeof (magic));
+
+  return ((GUINT32_FROM_LE (magic) & 0xfffffff0) == 0x184d2a50);
+}
+
+/* Start decompressing the frames of @batch into @output, in @pool. */
+static void
+batch_start (const Batch  *batch,
+             GArray       *frames,
+             guint8       *output,
+             GThreadPool  *pool,
+             Batches      *batches)
+{
+  guint i;
+
+  g_mutex_lock (&batches->mutex);
+  batches->n_pending += batch->n_frames;
+  g_mutex_unlock (&batches->mutex);
+
+  for (i = batch->first_frame; i < batch->first_frame + batch->n_frames; i++)
+    {
+      Frame *frame = &g_array_index (frames, Frame, i);
+
+      frame->dest = output + frame->dest_offset;
+      g_thread_pool_push (pool, frame, NULL);
+    }
+}
+
+/* Wait for the batch which was last started to be decompressed, and return
+ * whether all its frames were valid. */
+static gboolean
+batch_finish (const Batch *batch,
+              GArray      *frames,
+              Batches     *batches)
+{
+  gboolean success = TRUE;
+  guint i;
+
+  g_mutex_lock (&batches->mutex);
+  while (batches->n_pending > 0)
+    g_cond_wait (&batches->cond, &batches->mutex);
+  g_mutex_unlock (&batches->mutex);
+
+  for (i = batch->first_frame; i < batch->first_frame + batch->n_frames; i++)
+    success = success && g_array_index (frames, Frame, i).success;
+
+  return success;
+}
+
+/*
+ * _dfl_zstd_decompress_frames:
+ * @data: zstd-compressed data
+ * @length: length of @data, in bytes
+ * @func: function to call with each batch of decompressed data
+ * @user_data: data to pass to @func
+ * @error: return location for a #GError, or %NULL
+ *
+ * Decompress @data in parallel, one thread per frame, in batches of frames
+ * which are passed to @func in order. The next batch is decompressed while
+ * @func handles the current one, and at most two batches are held in memory
+ * at once, so this works for logs of any size. If @func returns %FALSE,
+ * decompression stops, and %TRUE is still returned.
+ *
+ * This is only possible if @data contains multiple frames which all declare
+ * their decompressed size (such as those written by the seekable zstd format,
+ * or by `zstd` with multiple input blocks), none of which is larger than
+ * %MAX_BATCH_OUTPUT_LENGTH. If not, or if the batch buffers cannot be
+ * allocated, %FALSE is returned without setting @error or calling @func, and
+ * the caller should decompress @data as a stream instead. If a frame is
+ * invalid, %FALSE is returned and @error is set, possibly after @func has been
+ * called for earlier batches.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ */
+gboolean
+_dfl_zstd_decompress_frames (const guint8      *data,
+                             gsize              length,
+                             DflZstdBatchFunc   func,
+                             gpointer           user_data,
+                             GError           **error)
+{
+  GArray/*<Frame>*/ *frames = NULL;
+  GArray/*<Batch>*/ *batch_array = NULL;
+  Batches batches;
+  GThreadPool *pool = NULL;
+  guint8 *outputs[2] = { NULL, NULL };
+  gsize offset, max_output_length = 0;
+  gboolean success = TRUE;
+  guint i;
+
+  frames = g_array_new (FALSE, FALSE, sizeof (Frame));
+  batch_array = g_array_new (FALSE, FALSE, sizeof (Batch));
+
+  /* Find the frames and their sizes, and split them into batches. */
+  for (offset = 0; offset < length; )
+    {
+      Frame frame;
+      Batch *batch = NULL;
+      gsize compressed_length;
+      unsigned long long content_length;
+
+      compressed_length = ZSTD_findFrameCompressedSize (data + offset,
+                                                        length - offset);
+
+      if (ZSTD_isError (compressed_length))
+        {
+          success = FALSE;
+          break;
+        }
+
+      if (is_skippable_frame (data + offset, length - offset))
+        {
+          offset += compressed_length;
+          continue;
+        }
+
+      content_length = ZSTD_getFrameContentSize (data + offset,
+                                                 length - offset);
+
+      if (content_length == ZSTD_CONTENTSIZE_UNKNOWN ||
+          content_length == ZSTD_CONTENTSIZE_ERROR ||
+          content_length > MAX_BATCH_OUTPUT_LENGTH)
+        {
+          success = FALSE;
+          break;
+        }
+
+      if (batch_array->len > 0)
+        batch = &g_array_index (batch_array, Batch, batch_array->len - 1);
+
+      if (batch == NULL ||
+          content_length > MAX_BATCH_OUTPUT_LENGTH - batch->output_length)
+        {
+          Batch new_batch = { frames->len, 0, 0 };
+
+          g_array_append_val (batch_array, new_batch);
+          batch = &g_array_index (batch_array, Batch, batch_array->len - 1);
+        }
+
+      frame.src = data + offset;
+      frame.src_length = compressed_length;
+      frame.dest = NULL;
+      frame.dest_offset = batch->output_length;
+      frame.dest_length = content_length;
+      frame.success = FALSE;
+      g_array_append_val (frames, frame);
+
+      batch->n_frames++;
+      batch->output_length += content_length;
+      max_output_length = MAX (max_output_length, batch->output_length);
+
+      offset += compressed_length;
+    }
+
+  /* Not worth it, or not possible? Let the caller decompress as a stream,
+   * which will report any errors. */
+  if (success && frames->len >= 2)
+    {
+      outputs[0] = g_try_malloc (max_output_length);
+      outputs[1] = (batch_array->len > 1) ? g_try_malloc (max_output_length)
+                                          : NULL;
+    }
+
+  if (!success || frames->len < 2 || outputs[0] == NULL ||
+      (batch_array->len > 1 && outputs[1] == NULL))
+    {
+      g_free (outputs[1]);
+      g_free (outputs[0]);
+      g_array_unref (batch_array);
+      g_array_unref (frames);
+      return FALSE;
+    }
+
+  g_mutex_init (&batches.mutex);
+  g_cond_init (&batches.cond);
+  batches.n_pending = 0;
+
+  pool = g_thread_pool_new (decompress_frame_cb, &batches,
+                            MIN (g_get_num_processors (), frames->len),
+                            FALSE, NULL);
+
+  /* Decompress each batch while the previous one is being handled. */
+  batch_start (&g_array_index (batch_array, Batch, 0), frames, outputs[0],
+               pool, &batches);
+
+  for (i = 0; i < batch_array->len; i++)
+    {
+      const Batch *batch = &g_array_index (batch_array, Batch, i);
+
+      success = batch_finish (batch, frames, &batches);
+
+      if (!success)
+        break;
+
+      if (i + 1 < batch_array->len)
+        batch_start (&g_array_index (batch_array, Batch, i + 1), frames,
+                     outputs[(i + 1) % 2], pool, &batches);
+
+      if (!func (outputs[i % 2], batch->output_length, user_data))
+        break;
+    }
+
+  /* Wait for any batch still being decompressed before freeing its output. */
+  g_thread_pool_free (pool, TRUE, TRUE);
+
+  g_cond_clear (&batches.cond);
+  g_mutex_clear (&batches.mutex);
+  g_free (outputs[1]);
+  g_free (outputs[0]);
+  g_array_unref (batch_array);
+  g_array_unref (frames);
+
+  if (!success)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                           "Invalid zstd-compressed data");
+      return FALSE;
+    }
+
+  return TRUE;
+}
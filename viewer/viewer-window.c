@@ -34,6 +34,7 @@
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 
+#include "libdunfell/log-index.h"
 #include "libdunfell/model.h"
 #include "libdunfell/parser.h"
 #include "libdunfell-ui/timeline.h"
@@ -69,6 +70,7 @@ struct _DfvViewerWindow
   GtkWidget *timeline_scrolled_window;
   GtkWidget *timeline;  /* NULL iff not loaded */
   GtkWidget *home_page_box;
+  GtkLabel *loading_label;
 };
 
 G_DEFINE_TYPE (DfvViewerWindow, dfv_viewer_window, GTK_TYPE_APPLICATION_WINDOW)
@@ -93,6 +95,8 @@ dfv_viewer_window_class_init (DfvViewerWindowClass *klass)
                                         timeline_scrolled_window);
   gtk_widget_class_bind_template_child (widget_class, DfvViewerWindow,
                                         home_page_box);
+  gtk_widget_class_bind_template_child (widget_class, DfvViewerWindow,
+                                        loading_label);
   gtk_widget_class_bind_template_callback (widget_class, open_button_clicked);
   gtk_widget_class_bind_template_callback (widget_class, record_button_clicked);
 
@@ -337,15 +341,23 @@ record_button_clicked (GtkButton *button,
   dfv_viewer_window_record (self);
 }
 
+static void set_file_cb_cache (GObject      *source_object,
+                               GAsyncResult *result,
+                               gpointer      user_data);
 static void set_file_cb1 (GObject      *source_object,
                           GAsyncResult *result,
                           gpointer      user_data);
 static void set_file_cb2 (GObject      *source_object,
                           GAsyncResult *result,
                           gpointer      user_data);
+static void show_model       (DfvViewerWindow *self,
+                              DflModel        *model);
 static void set_file_cb_name (GObject      *source_object,
                               GAsyncResult *result,
                               gpointer      user_data);
+static void save_cache_cb    (GObject      *source_object,
+                              GAsyncResult *result,
+                              gpointer      user_data);
 
 static void
 info_bar_response_cb (GtkInfoBar *info_bar,
@@ -408,11 +420,45 @@ dfv_viewer_window_clear_file (DfvViewerWindow *self,
   g_clear_pointer (&self->timeline, gtk_widget_destroy);
 }
 
+/* If @file is a log with an up-to-date index, show its extent while it’s
+ * loading. The index is small, so this is quick. */
+static void
+update_loading_label (DfvViewerWindow *self,
+                      GFile           *file)
+{
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *label = NULL;
+  g_autoptr (DflLogIndex) index = NULL;
+  DflDuration duration;
+  gsize n_threads;
+
+  path = g_file_get_path (file);
+
+  if (path != NULL)
+    index = dfl_log_index_load (path, NULL);
+
+  if (index == NULL)
+    {
+      gtk_label_set_label (self->loading_label, _("Loading…"));
+      return;
+    }
+
+  dfl_log_index_get_threads (index, &n_threads);
+  duration = dfl_log_index_get_final_timestamp (index) -
+             dfl_log_index_get_initial_timestamp (index);
+
+  label = g_strdup_printf (_("Loading %.1f s of events from %" G_GSIZE_FORMAT
+                             " threads…"),
+                           (gdouble) duration / G_USEC_PER_SEC, n_threads);
+  gtk_label_set_label (self->loading_label, label);
+}
+
 static void
 dfv_viewer_window_set_file (DfvViewerWindow *self,
                             GFile           *file)
 {
   GCancellable *cancellable = NULL;
+  g_autofree gchar *path = NULL;
 
   g_return_if_fail (DFV_IS_VIEWER_WINDOW (self));
   g_return_if_fail (file == NULL || G_IS_FILE (file));
@@ -421,6 +467,7 @@ dfv_viewer_window_set_file (DfvViewerWindow *self,
     return;
 
   /* Start loading. */
+  update_loading_label (self, file);
   gtk_stack_set_visible_child_name (self->main_stack, "loading");
   g_object_notify (G_OBJECT (self), "file");
 
@@ -435,12 +482,51 @@ dfv_viewer_window_set_file (DfvViewerWindow *self,
                            G_PRIORITY_DEFAULT, cancellable,
                            set_file_cb_name, self);
 
-  /* Open the file. */
-  g_file_read_async (file, G_PRIORITY_DEFAULT, cancellable, set_file_cb1, self);
+  /* If the log has an up-to-date model cache, load that instead of parsing
+   * the log. Checking the cache means checksumming the log, so do it in a
+   * worker thread. */
+  path = g_file_get_path (file);
+
+  if (path != NULL)
+    dfl_model_load_cache_async (path, cancellable, set_file_cb_cache, self);
+  else
+    g_file_read_async (file, G_PRIORITY_DEFAULT, cancellable, set_file_cb1,
+                       self);
 
   g_object_unref (cancellable);
 }
 
+static void
+set_file_cb_cache (GObject      *source_object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  DfvViewerWindow *self;
+  g_autoptr (DflModel) model = NULL;
+  g_autoptr (GError) error = NULL;
+
+  model = dfl_model_load_cache_finish (result, &error);
+
+  /* The window may have been closed, or another file opened. */
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  self = DFV_VIEWER_WINDOW (user_data);
+
+  if (model != NULL)
+    {
+      g_clear_object (&self->open_cancellable);
+      show_model (self, model);
+      return;
+    }
+
+  g_debug ("Not using model cache: %s", error->message);
+
+  /* Open the file. */
+  g_file_read_async (self->file, G_PRIORITY_DEFAULT, self->open_cancellable,
+                     set_file_cb1, self);
+}
+
 static void
 set_file_cb1 (GObject      *source_object,
               GAsyncResult *result,
@@ -480,6 +566,7 @@ set_file_cb2 (GObject      *source_object,
   DflParser *parser;
   DflEventSequence *sequence;
   g_autoptr (DflModel) model = NULL;
+  g_autofree gchar *path = NULL;
   GError *child_error = NULL;
 
   self = DFV_VIEWER_WINDOW (user_data);
@@ -508,7 +595,34 @@ set_file_cb2 (GObject      *source_object,
 
   g_clear_object (&self->open_cancellable);
 
-  /* Create and show the timeline and statistics widgets. */
+  /* Cache the model so the log opens quickly next time. This is written in a
+   * worker thread while the model is shown, which only reads from it. */
+  path = g_file_get_path (self->file);
+
+  if (path != NULL)
+    dfl_model_save_cache_async (model, path, NULL, save_cache_cb,
+                                g_steal_pointer (&path));
+
+  show_model (self, model);
+}
+
+static void
+save_cache_cb (GObject      *source_object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  g_autofree gchar *path = user_data;
+  g_autoptr (GError) error = NULL;
+
+  if (!dfl_model_save_cache_finish (DFL_MODEL (source_object), result, &error))
+    g_debug ("Error saving model cache for ‘%s’: %s", path, error->message);
+}
+
+/* Create and show the timeline and statistics widgets for @model. */
+static void
+show_model (DfvViewerWindow *self,
+            DflModel        *model)
+{
   self->timeline = GTK_WIDGET (dwl_timeline_new (model));
   gtk_container_add (GTK_CONTAINER (self->timeline_scrolled_window),
                      self->timeline);